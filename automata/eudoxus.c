@@ -48,12 +48,46 @@
 #include <ironautomata/vls.h>
 
 #include <assert.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
+/**
+ * A memory mapped automata file.
+ *
+ * Mappings are read-only and shared, so every engine (and, via the page
+ * cache, every process) loading the same file uses the same memory.  They
+ * are kept in a process wide list, keyed by file identity, and unmapped
+ * when the last engine using them is destroyed.
+ */
+typedef struct ia_eudoxus_mapping_t ia_eudoxus_mapping_t;
+struct ia_eudoxus_mapping_t
+{
+    dev_t                 dev;       /**< Device of file. */
+    ino_t                 ino;       /**< Inode of file. */
+    off_t                 size;      /**< Size of file and mapping. */
+    time_t                mtime;     /**< Modification time of file. */
+    void                 *base;      /**< Start of mapping. */
+    size_t                refcount;  /**< Number of engines using mapping. */
+    ia_eudoxus_mapping_t *next;      /**< Next mapping in list. */
+};
+
+/**
+ * All current mappings.
+ */
+static ia_eudoxus_mapping_t *s_mappings = NULL;
+
+/**
+ * Lock for @c s_mappings and mapping reference counts.
+ */
+static pthread_mutex_t s_mappings_lock = PTHREAD_MUTEX_INITIALIZER;
+
 struct ia_eudoxus_t
 {
     /**
@@ -61,6 +95,11 @@ struct ia_eudoxus_t
      */
     const ia_eudoxus_automata_t *automata;
 
+    /**
+     * Mapping holding @c automata or NULL if @c automata is owned memory.
+     */
+    ia_eudoxus_mapping_t *mapping;
+
     /**
      * Most recent error message.
      *
@@ -177,9 +216,130 @@ enum ia_eudoxus_extended_command_t
 };
 typedef enum ia_eudoxus_extended_command_t ia_eudoxus_extended_command_t;
 
-ia_eudoxus_result_t ia_eudoxus_create(
-    ia_eudoxus_t **out_eudoxus,
-    char          *data
+/**
+ * Acquire a shared read-only mapping of the file open as @a fd.
+ *
+ * @param[out] out_mapping Mapping, with its reference count incremented.
+ * @param[in]  fd          File descriptor of automata file.
+ * @return
+ * - IA_EUDOXUS_OK on success.
+ * - IA_EUDOXUS_EINVAL if @a fd is not a non-empty regular file.
+ * - IA_EUDOXUS_EALLOC if the file could not be mapped.
+ */
+static
+ia_eudoxus_result_t ia_eudoxus_mapping_acquire(
+    ia_eudoxus_mapping_t **out_mapping,
+    int                    fd
+)
+{
+    struct stat           st;
+    ia_eudoxus_mapping_t *mapping;
+    ia_eudoxus_result_t   rc = IA_EUDOXUS_OK;
+
+    if (fstat(fd, &st) != 0 || ! S_ISREG(st.st_mode) || st.st_size <= 0) {
+        return IA_EUDOXUS_EINVAL;
+    }
+
+    pthread_mutex_lock(&s_mappings_lock);
+
+    for (mapping = s_mappings; mapping != NULL; mapping = mapping->next) {
+        if (
+            mapping->dev   == st.st_dev  &&
+            mapping->ino   == st.st_ino  &&
+            mapping->size  == st.st_size &&
+            mapping->mtime == st.st_mtime
+        ) {
+            ++mapping->refcount;
+            goto finish;
+        }
+    }
+
+    mapping = (ia_eudoxus_mapping_t *)malloc(sizeof(*mapping));
+    if (mapping == NULL) {
+        rc = IA_EUDOXUS_EALLOC;
+        goto finish;
+    }
+
+    mapping->base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapping->base == MAP_FAILED) {
+        free(mapping);
+        mapping = NULL;
+        rc = IA_EUDOXUS_EALLOC;
+        goto finish;
+    }
+
+    mapping->dev      = st.st_dev;
+    mapping->ino      = st.st_ino;
+    mapping->size     = st.st_size;
+    mapping->mtime    = st.st_mtime;
+    mapping->refcount = 1;
+    mapping->next     = s_mappings;
+    s_mappings        = mapping;
+
+finish:
+    pthread_mutex_unlock(&s_mappings_lock);
+
+    if (rc == IA_EUDOXUS_OK) {
+        *out_mapping = mapping;
+    }
+    return rc;
+}
+
+/**
+ * Release a mapping acquired by ia_eudoxus_mapping_acquire().
+ *
+ * The file is unmapped when the last reference is released.
+ *
+ * @param[in] mapping Mapping to release.
+ */
+static
+void ia_eudoxus_mapping_release(
+    ia_eudoxus_mapping_t *mapping
+)
+{
+    ia_eudoxus_mapping_t **link;
+
+    assert(mapping != NULL);
+
+    pthread_mutex_lock(&s_mappings_lock);
+
+    assert(mapping->refcount > 0);
+    --mapping->refcount;
+    if (mapping->refcount > 0) {
+        pthread_mutex_unlock(&s_mappings_lock);
+        return;
+    }
+
+    for (link = &s_mappings; *link != NULL; link = &((*link)->next)) {
+        if (*link == mapping) {
+            *link = mapping->next;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&s_mappings_lock);
+
+    munmap(mapping->base, mapping->size);
+    free(mapping);
+}
+
+/**
+ * Create a Eudoxus engine for @a data.
+ *
+ * On success, the engine owns @a data or the reference to @a mapping.  On
+ * failure, the caller retains ownership.
+ *
+ * @param[out] out_eudoxus Variable to hold pointer to created engine.
+ * @param[in]  data        Data holding automata.
+ * @param[in]  mapping     Mapping holding @a data or NULL if @a data is
+ *                         malloced.
+ * @return As ia_eudoxus_create().
+ */
+static
+ia_eudoxus_result_t ia_eudoxus_create_internal(
+    ia_eudoxus_t         **out_eudoxus,
+    const char            *data,
+    ia_eudoxus_mapping_t  *mapping
 )
 {
     ia_eudoxus_t        *eudoxus = NULL;
@@ -194,7 +354,8 @@ ia_eudoxus_result_t ia_eudoxus_create(
         return IA_EUDOXUS_EINVAL;
     }
 
-    eudoxus->automata           = (ia_eudoxus_automata_t *)data;
+    eudoxus->automata           = (const ia_eudoxus_automata_t *)data;
+    eudoxus->mapping            = mapping;
     eudoxus->error_message      = NULL;
     eudoxus->free_error_message = false;
 
@@ -221,6 +382,45 @@ finish:
     return rc;
 }
 
+ia_eudoxus_result_t ia_eudoxus_create(
+    ia_eudoxus_t **out_eudoxus,
+    char          *data
+)
+{
+    return ia_eudoxus_create_internal(out_eudoxus, data, NULL);
+}
+
+/**
+ * Create a Eudoxus engine from a shared mapping of @a fd.
+ *
+ * @param[out] out_eudoxus Variable to hold pointer to created engine.
+ * @param[in]  fd          File descriptor of automata file.
+ * @return
+ * - IA_EUDOXUS_OK on success.
+ * - IA_EUDOXUS_EINVAL if @a fd can not be mapped.
+ * - Other codes as described in ia_eudoxus_create().
+ */
+static
+ia_eudoxus_result_t ia_eudoxus_create_from_fd(
+    ia_eudoxus_t **out_eudoxus,
+    int            fd
+)
+{
+    ia_eudoxus_mapping_t *mapping = NULL;
+    ia_eudoxus_result_t   rc;
+
+    rc = ia_eudoxus_mapping_acquire(&mapping, fd);
+    if (rc != IA_EUDOXUS_OK) {
+        return rc;
+    }
+
+    rc = ia_eudoxus_create_internal(out_eudoxus, mapping->base, mapping);
+    if (rc != IA_EUDOXUS_OK) {
+        ia_eudoxus_mapping_release(mapping);
+    }
+
+    return rc;
+}
 
 ia_eudoxus_result_t ia_eudoxus_create_from_file(
     ia_eudoxus_t **out_eudoxus,
@@ -229,10 +429,22 @@ ia_eudoxus_result_t ia_eudoxus_create_from_file(
 {
     char *buffer = NULL;
     size_t did_read = 0;
+    ia_eudoxus_result_t rc;
+
+    if (out_eudoxus == NULL || fp == NULL) {
+        return IA_EUDOXUS_EINVAL;
+    }
+
+    /* Share a mapping of the file if possible. */
+    rc = ia_eudoxus_create_from_fd(out_eudoxus, fileno(fp));
+    if (rc != IA_EUDOXUS_EINVAL && rc != IA_EUDOXUS_EALLOC) {
+        return rc;
+    }
 
+    /* Otherwise, fall back to reading it. */
     off_t file_size = lseek(fileno(fp), 0, SEEK_END);
     lseek(fileno(fp), 0, SEEK_SET);
-    if (file_size < 0) {
+    if (file_size <= 0) {
         return IA_EUDOXUS_EINVAL;
     }
 
@@ -247,7 +459,12 @@ ia_eudoxus_result_t ia_eudoxus_create_from_file(
         return IA_EUDOXUS_EINVAL;
     }
 
-    return ia_eudoxus_create(out_eudoxus, buffer);
+    rc = ia_eudoxus_create(out_eudoxus, buffer);
+    if (rc != IA_EUDOXUS_OK) {
+        free(buffer);
+    }
+
+    return rc;
 }
 
 ia_eudoxus_result_t ia_eudoxus_create_from_path(
@@ -255,6 +472,10 @@ ia_eudoxus_result_t ia_eudoxus_create_from_path(
     const char    *path
 )
 {
+    if (out_eudoxus == NULL || path == NULL) {
+        return IA_EUDOXUS_EINVAL;
+    }
+
     FILE *fp = fopen(path, "r");
     if (! fp) {
         return IA_EUDOXUS_EINVAL;
@@ -275,9 +496,12 @@ void ia_eudoxus_destroy(
         return;
     }
 
+    if (eudoxus->mapping != NULL) {
+        ia_eudoxus_mapping_release(eudoxus->mapping);
+    }
     /* Better to cast away const here than to not have const checks for
      * all uses. */
-    if (eudoxus->automata) {
+    else if (eudoxus->automata) {
         free((void *)eudoxus->automata);
     }
     if (eudoxus->error_message != NULL && eudoxus->free_error_message) {
@@ -119,6 +119,14 @@ ia_eudoxus_result_t ia_eudoxus_create(
 /**
  * As above, but load from FILE.
  *
+ * If @a fp is a regular file, it is memory mapped read-only and shared
+ * rather than read: engines loading the same file share a single mapping,
+ * which is unmapped when the last of them is destroyed.  As the mapping is
+ * shared, processes loading the same file also share its pages via the page
+ * cache.  Automata files should be replaced (e.g., renamed over) rather than
+ * modified in place while in use.  If mapping fails, the file is read into
+ * memory instead.
+ *
  * @param[out] out_eudoxus Variable to hold pointer to created engine.
  * @param[in]  fp          @c FILE* to load from.
  * @return
@@ -157,6 +165,9 @@ ia_eudoxus_result_t ia_eudoxus_create_from_path(
 /**
  * Destroy engine @a eudoxus, releasing associated memory.
  *
+ * If @a eudoxus was loaded from a shared mapping, its reference to that
+ * mapping is released, unmapping it if this was the last one.
+ *
  * Behavior of any method that takes @a eudoxus as a parameter is undefined
  * after calling this.
  *
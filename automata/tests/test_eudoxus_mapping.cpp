@@ -0,0 +1,215 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronAutomata --- Eudoxus shared mapping test.
+ *
+ * mmap() and munmap() are wrapped to count the mappings of automata files.
+ **/
+
+#include <ironautomata/eudoxus.h>
+#include <ironautomata/eudoxus_automata.h>
+
+#include <set>
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+
+using namespace std;
+
+namespace {
+
+//! If true, mmap() of a file fails.
+bool g_fail_mmap = false;
+//! Live mappings of files.
+set<void *> g_mappings;
+//! Number of files mapped.
+size_t g_mmaps = 0;
+//! Number of files unmapped.
+size_t g_munmaps = 0;
+
+}
+
+extern "C" {
+
+void *mmap(
+    void   *addr,
+    size_t  length,
+    int     prot,
+    int     flags,
+    int     fd,
+    off_t   offset
+)
+{
+    typedef void *(*mmap_t)(void *, size_t, int, int, int, off_t);
+    static mmap_t real_mmap =
+        reinterpret_cast<mmap_t>(dlsym(RTLD_NEXT, "mmap"));
+    void *result;
+
+    if (fd >= 0 && g_fail_mmap) {
+        errno = ENOMEM;
+        return MAP_FAILED;
+    }
+
+    result = real_mmap(addr, length, prot, flags, fd, offset);
+    if (fd >= 0 && result != MAP_FAILED) {
+        ++g_mmaps;
+        g_mappings.insert(result);
+    }
+    return result;
+}
+
+int munmap(void *addr, size_t length)
+{
+    typedef int (*munmap_t)(void *, size_t);
+    static munmap_t real_munmap =
+        reinterpret_cast<munmap_t>(dlsym(RTLD_NEXT, "munmap"));
+
+    if (g_mappings.erase(addr) > 0) {
+        ++g_munmaps;
+    }
+    return real_munmap(addr, length);
+}
+
+}
+
+class TestEudoxusMapping : public ::testing::Test
+{
+public:
+    virtual void SetUp()
+    {
+        ia_eudoxus_automata_t automata;
+        int                   fd;
+
+        g_fail_mmap = false;
+        g_mmaps = 0;
+        g_munmaps = 0;
+
+        /* A header is all that loading checks. */
+        memset(&automata, 0, sizeof(automata));
+        automata.version = IA_EUDOXUS_VERSION;
+        automata.is_big_endian = ia_eudoxus_is_big_endian();
+        automata.data_length = sizeof(automata);
+
+        strcpy(m_path, "automata_test_mapping.XXXXXX");
+        fd = mkstemp(m_path);
+        ASSERT_LE(0, fd);
+        ASSERT_EQ(
+            ssize_t(sizeof(automata)),
+            write(fd, &automata, sizeof(automata)));
+        close(fd);
+    }
+
+    virtual void TearDown()
+    {
+        unlink(m_path);
+    }
+
+    ia_eudoxus_t *load()
+    {
+        ia_eudoxus_t *eudoxus = NULL;
+
+        EXPECT_EQ(IA_EUDOXUS_OK, ia_eudoxus_create_from_path(&eudoxus, m_path));
+        return eudoxus;
+    }
+
+    char m_path[64];
+};
+
+TEST_F(TestEudoxusMapping, SharedBetweenLoads)
+{
+    ia_eudoxus_t *first = load();
+    ia_eudoxus_t *second = load();
+
+    ASSERT_TRUE(first != NULL);
+    ASSERT_TRUE(second != NULL);
+    EXPECT_NE(first, second);
+    EXPECT_EQ(1U, g_mmaps);
+
+    ia_eudoxus_destroy(first);
+    ia_eudoxus_destroy(second);
+}
+
+TEST_F(TestEudoxusMapping, UnmappedOnLastRelease)
+{
+    ia_eudoxus_t *eudoxus[3];
+
+    for (int i = 0; i < 3; ++i) {
+        eudoxus[i] = load();
+        ASSERT_TRUE(eudoxus[i] != NULL);
+    }
+    EXPECT_EQ(1U, g_mmaps);
+
+    ia_eudoxus_destroy(eudoxus[1]);
+    ia_eudoxus_destroy(eudoxus[0]);
+    EXPECT_EQ(0U, g_munmaps);
+    ia_eudoxus_destroy(eudoxus[2]);
+    EXPECT_EQ(1U, g_munmaps);
+
+    /* The next load maps the file again. */
+    eudoxus[0] = load();
+    ASSERT_TRUE(eudoxus[0] != NULL);
+    EXPECT_EQ(2U, g_mmaps);
+    ia_eudoxus_destroy(eudoxus[0]);
+    EXPECT_EQ(2U, g_munmaps);
+}
+
+TEST_F(TestEudoxusMapping, ReadWhenMmapFails)
+{
+    g_fail_mmap = true;
+
+    ia_eudoxus_t *first = load();
+    ia_eudoxus_t *second = load();
+
+    ASSERT_TRUE(first != NULL);
+    ASSERT_TRUE(second != NULL);
+    EXPECT_EQ(0U, g_mmaps);
+
+    ia_eudoxus_destroy(first);
+    ia_eudoxus_destroy(second);
+    EXPECT_EQ(0U, g_munmaps);
+}
+
+TEST_F(TestEudoxusMapping, RejectedReleasesMapping)
+{
+    ia_eudoxus_automata_t automata;
+    ia_eudoxus_t         *eudoxus = NULL;
+    FILE                 *fp;
+
+    /* Rewrite the file with a version this engine does not accept. */
+    fp = fopen(m_path, "r+");
+    ASSERT_TRUE(fp != NULL);
+    ASSERT_EQ(1U, fread(&automata, sizeof(automata), 1, fp));
+    automata.version = IA_EUDOXUS_VERSION + 1;
+    rewind(fp);
+    ASSERT_EQ(1U, fwrite(&automata, sizeof(automata), 1, fp));
+    fclose(fp);
+
+    EXPECT_EQ(
+        IA_EUDOXUS_EINCOMPAT,
+        ia_eudoxus_create_from_path(&eudoxus, m_path));
+    EXPECT_EQ(1U, g_mmaps);
+    EXPECT_EQ(1U, g_munmaps);
+}
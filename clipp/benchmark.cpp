@@ -0,0 +1,205 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronBee --- CLIPP Benchmark Support Implementation
+ */
+
+#include "benchmark.hpp"
+
+#include <boost/format.hpp>
+#include <boost/thread/locks.hpp>
+
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+namespace IronBee {
+namespace CLIPP {
+
+namespace {
+
+//! Values with their own bucket; also twice the buckets per power of two.
+const ib_time_t c_linear = 64;
+
+//! Bucket index of @a value.
+size_t bucket_of(ib_time_t value)
+{
+    if (value < c_linear) {
+        return value;
+    }
+
+    size_t shift = 0;
+    while ((value >> shift) >= c_linear) {
+        ++shift;
+    }
+    return shift * (c_linear / 2) + (value >> shift);
+}
+
+//! Largest value in bucket @a bucket.
+ib_time_t value_of(size_t bucket)
+{
+    if (bucket < size_t(c_linear)) {
+        return bucket;
+    }
+
+    size_t    shift = bucket / (c_linear / 2) - 1;
+    ib_time_t sub   = bucket % (c_linear / 2) + c_linear / 2;
+    return ((sub + 1) << shift) - 1;
+}
+
+const char* c_phase_names[Benchmark::NUM_PHASES] = {
+    "connection",
+    "transaction",
+    "request_header",
+    "request_body",
+    "response",
+    "postprocess"
+};
+
+} // Anonymous
+
+LatencyHistogram::LatencyHistogram() :
+    m_buckets(bucket_of(numeric_limits<ib_time_t>::max()) + 1),
+    m_count(0),
+    m_sum(0),
+    m_max(0)
+{
+    // nop
+}
+
+void LatencyHistogram::record(ib_time_t value)
+{
+    ++m_buckets[bucket_of(value)];
+    ++m_count;
+    m_sum += value;
+    m_max = std::max(m_max, value);
+}
+
+double LatencyHistogram::mean() const
+{
+    return (m_count == 0) ? 0 : m_sum / m_count;
+}
+
+ib_time_t LatencyHistogram::percentile(double fraction) const
+{
+    uint64_t target = static_cast<uint64_t>(fraction * m_count + 0.5);
+    uint64_t seen   = 0;
+
+    if (m_count == 0) {
+        return 0;
+    }
+    target = std::max(target, uint64_t(1));
+    for (size_t i = 0; i < m_buckets.size(); ++i) {
+        seen += m_buckets[i];
+        if (seen >= target) {
+            return std::min(value_of(i), m_max);
+        }
+    }
+    return m_max;
+}
+
+Benchmark::Benchmark() :
+    m_start(0),
+    m_tx_memory_total(0),
+    m_tx_memory_max(0)
+{
+    // nop
+}
+
+void Benchmark::start()
+{
+    boost::lock_guard<boost::mutex> guard(m_mutex);
+    if (m_start == 0) {
+        m_start = ib_clock_get_time();
+    }
+}
+
+void Benchmark::record(phase_e phase, ib_time_t duration)
+{
+    boost::lock_guard<boost::mutex> guard(m_mutex);
+    m_phases[phase].record(duration);
+}
+
+void Benchmark::mark_postprocess()
+{
+    if (m_postprocess_started.get() == NULL) {
+        m_postprocess_started.reset(new ib_time_t);
+    }
+    *m_postprocess_started = ib_clock_get_time();
+}
+
+ib_time_t Benchmark::postprocess_started()
+{
+    ib_time_t* started = m_postprocess_started.get();
+    if (started == NULL) {
+        return 0;
+    }
+    ib_time_t result = *started;
+    *started = 0;
+    return result;
+}
+
+void Benchmark::record_tx_memory(size_t bytes)
+{
+    boost::lock_guard<boost::mutex> guard(m_mutex);
+    m_tx_memory_total += bytes;
+    m_tx_memory_max = std::max(m_tx_memory_max, bytes);
+}
+
+void Benchmark::report(ostream& out) const
+{
+    boost::lock_guard<boost::mutex> guard(m_mutex);
+
+    ib_time_t wall = (m_start == 0) ? 0 : ib_clock_get_time() - m_start;
+    double    seconds = std::max(wall, ib_time_t(1)) / 1e6;
+    uint64_t  num_tx = m_phases[TRANSACTION].count();
+
+    out << boost::format(
+        "Benchmark: %d connections, %d transactions in %.3f s "
+        "(%.1f transactions/s)\n") %
+        m_phases[CONNECTION].count() %
+        num_tx %
+        seconds %
+        (num_tx / seconds);
+
+    out << boost::format("%-15s %9s %9s %8s %8s %8s %8s %8s\n") %
+        "phase (us)" % "count" % "mean" % "p50" % "p90" % "p99" % "p99.9" %
+        "max";
+    for (int i = 0; i < NUM_PHASES; ++i) {
+        const LatencyHistogram& h = m_phases[i];
+        out << boost::format("%-15s %9d %9.1f %8d %8d %8d %8d %8d\n") %
+            c_phase_names[i] %
+            h.count() %
+            h.mean() %
+            h.percentile(0.5) %
+            h.percentile(0.9) %
+            h.percentile(0.99) %
+            h.percentile(0.999) %
+            h.max();
+    }
+
+    out << boost::format(
+        "Transaction memory pool bytes: mean %.0f max %d\n") %
+        ((num_tx == 0) ? 0.0 : double(m_tx_memory_total) / num_tx) %
+        m_tx_memory_max;
+}
+
+} // CLIPP
+} // IronBee
@@ -0,0 +1,137 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronBee --- CLIPP Benchmark Support
+ */
+
+#ifndef __IRONBEE__CLIPP__BENCHMARK__
+#define __IRONBEE__CLIPP__BENCHMARK__
+
+#include <ironbee/clock.h>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+
+#include <ostream>
+#include <vector>
+
+#include <stdint.h>
+
+namespace IronBee {
+namespace CLIPP {
+
+/**
+ * Histogram of durations with bounded relative error.
+ *
+ * Values below 64 have their own bucket; larger values share buckets
+ * 1/32nd of a power of two wide, so percentiles are within about 3% while
+ * the histogram stays a fixed, small size.
+ **/
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    //! Record @a value.
+    void record(ib_time_t value);
+
+    //! Number of recorded values.
+    uint64_t count() const
+    {
+        return m_count;
+    }
+
+    //! Mean of recorded values.
+    double mean() const;
+
+    //! Largest recorded value.
+    ib_time_t max() const
+    {
+        return m_max;
+    }
+
+    //! Smallest value that at least @a fraction of values do not exceed.
+    ib_time_t percentile(double fraction) const;
+
+private:
+    std::vector<uint64_t> m_buckets;
+    uint64_t              m_count;
+    double                m_sum;
+    ib_time_t             m_max;
+};
+
+/**
+ * Records time spent by IronBee per connection, transaction and phase.
+ *
+ * All durations are in microseconds, as measured by ib_clock_get_time().
+ * Methods may be called from multiple threads.
+ **/
+class Benchmark
+{
+public:
+    //! Measured intervals.
+    enum phase_e {
+        CONNECTION,      //!< Connection opened to closed.
+        TRANSACTION,     //!< Request started to response finished.
+        REQUEST_HEADER,  //!< Request line and header.
+        REQUEST_BODY,    //!< Request body and request finished.
+        RESPONSE,        //!< Response line, header, body and finished.
+        POSTPROCESS,     //!< Post processing and logging.
+        NUM_PHASES
+    };
+
+    Benchmark();
+
+    //! Note that work has started; the first call starts the clock.
+    void start();
+
+    //! Record @a duration for @a phase.
+    void record(phase_e phase, ib_time_t duration);
+
+    /**
+     * Note the start of post processing in this thread.
+     *
+     * Called from an engine hook, which cannot tell which transaction
+     * timer to charge.  The notifying thread reads it back with
+     * postprocess_started().
+     **/
+    void mark_postprocess();
+
+    //! Time of the last mark_postprocess() in this thread or 0.
+    ib_time_t postprocess_started();
+
+    //! Record @a bytes of transaction memory pool use.
+    void record_tx_memory(size_t bytes);
+
+    //! Write a report to @a out.
+    void report(std::ostream& out) const;
+
+private:
+    mutable boost::mutex                  m_mutex;
+    boost::thread_specific_ptr<ib_time_t> m_postprocess_started;
+    ib_time_t                             m_start;
+    LatencyHistogram                      m_phases[NUM_PHASES];
+    uint64_t                              m_tx_memory_total;
+    size_t                                m_tx_memory_max;
+};
+
+} // CLIPP
+} // IronBee
+
+#endif
@@ -211,7 +211,8 @@ component_t construct_component(const string& arg)
  * above.
  **/
 
-//! Construct threaded IronBee consumer, interpreting @a arg as @e path:n
+//! Construct threaded IronBee consumer, interpreting @a arg as
+//! @e path:n[:depth[:batch]]
 component_t construct_ironbee_threaded_consumer(const string& arg);
 
 //! Construct proxy consumer, interpreting @a arg as @e host:port:listen_port
@@ -234,7 +235,15 @@ component_t construct_splitdata_modifier(const string& arg);
 //! Construct split header modifier.  An empty @a arg is 0, otherwise integer.
 component_t construct_splitheader_modifier(const string& arg);
 
-//! Construct ironbee modifiers.  @a arg is <config path>:<default behavior>.
+//! Construct IronBee benchmark consumer, interpreting @a arg as @e path.
+component_t construct_ironbee_benchmark_consumer(const string& arg);
+
+/**
+ * Construct ironbee modifiers.  @a arg is <config path>:<default behavior>.
+ *
+ * @tparam benchmark Record and report time spent in IronBee?
+ **/
+template <bool benchmark>
 component_t construct_ironbee_modifier(const string& arg);
 
 /**
@@ -319,8 +328,13 @@ void help()
     "\n"
     "Consumers:\n"
     "  ironbee:<path>  -- Internal IronBee using <path> as configuration.\n"
-    "  ironbee_threaded:<path>:<n> -- Internal IronBee using <n> threads\n"
-    "                                 and <path> as configuration.\n"
+    "  ironbee_benchmark:<path> -- As ironbee, but report time spent in\n"
+    "                              IronBee per connection, transaction\n"
+    "                              and phase.\n"
+    "  ironbee_threaded:<path>:<n>[:<depth>[:<batch>]] --\n"
+    "    Internal IronBee using <n> threads and <path> as configuration.\n"
+    "    Inputs are queued in batches of <batch> (16) with at most\n"
+    "    <depth> (64) batches queued.  Reports throughput and latency.\n"
     "  writepb:<path>  -- Output to protobuf file at <path>.\n"
     "  writehtp:<path> -- Output in HTP test format at <path>.\n"
     "                     Best with unparsed format and only 1 connection.\n"
@@ -427,6 +441,9 @@ void help()
     "    clipp:allow passes data through; clipp:block blocks data;\n"
     "    and clipp:break stops the current chain.\n"
     "    <behavior> is optional and defaults to 'allow'.\n"
+    "  @ironbee_benchmark:config:behavior --\n"
+    "    As @ironbee, but report time spent in IronBee per connection,\n"
+    "    transaction and phase.\n"
     "  @time -- Output timing of each transaction.\n"
     ;
 }
@@ -591,6 +608,7 @@ int main(int argc, char** argv)
     component_factory_map_t consumer_factory_map = boost::assign::map_list_of
         ("ironbee",  construct_component<IronBeeConsumer>)
         ("ironbee_threaded",  construct_ironbee_threaded_consumer)
+        ("ironbee_benchmark", construct_ironbee_benchmark_consumer)
         ("writepb",  construct_component<PBConsumer>)
         ("writehtp", construct_component<HTPConsumer>)
         ("view",     construct_component<ViewConsumer>)
@@ -618,7 +636,8 @@ int main(int argc, char** argv)
         ("add",             construct_set_add_modifier<SetModifier::ADD>)
         ("addmissing",      construct_set_add_modifier<SetModifier::ADD_MISSING>)
         ("fillbody",        construct_argless_component<FillBodyModifier>)
-        ("ironbee",         construct_ironbee_modifier)
+        ("ironbee",         construct_ironbee_modifier<false>)
+        ("ironbee_benchmark", construct_ironbee_modifier<true>)
         ("time",            construct_argless_component<TimeModifier>)
         ;
 
@@ -1091,17 +1110,32 @@ component_t construct_ironbee_threaded_consumer(const string& arg)
 {
     string config_path;
     size_t num_workers;
+    size_t queue_depth = IronBeeThreadedConsumer::default_queue_depth;
+    size_t batch_size = IronBeeThreadedConsumer::default_batch_size;
 
     vector<string> subargs = split_on_char(arg, ':');
-    if (subargs.size() == 2) {
+    if (subargs.size() >= 2 && subargs.size() <= 4) {
         config_path = subargs[0];
         num_workers = boost::lexical_cast<size_t>(subargs[1]);
+        if (subargs.size() >= 3) {
+            queue_depth = boost::lexical_cast<size_t>(subargs[2]);
+        }
+        if (subargs.size() >= 4) {
+            batch_size = boost::lexical_cast<size_t>(subargs[3]);
+        }
     }
     else {
         throw runtime_error("Could not parse ironbee_threaded arg: " + arg);
     }
 
-    return IronBeeThreadedConsumer(config_path, num_workers);
+    return IronBeeThreadedConsumer(
+        config_path, num_workers, queue_depth, batch_size
+    );
+}
+
+component_t construct_ironbee_benchmark_consumer(const string& arg)
+{
+    return IronBeeConsumer(arg, true);
 }
 
 component_t construct_proxy_consumer(const string& arg)
@@ -1126,6 +1160,7 @@ component_t construct_proxy_consumer(const string& arg)
     return ProxyConsumer(proxy_host, proxy_port, listen_port);
 }
 
+template <bool benchmark>
 component_t construct_ironbee_modifier(const string& arg)
 {
     IronBeeModifier::behavior_e behavior = IronBeeModifier::ALLOW;
@@ -1151,7 +1186,7 @@ component_t construct_ironbee_modifier(const string& arg)
         throw runtime_error("Could not parse @ironbee arg: " + arg);
     }
 
-    return IronBeeModifier(config_path, behavior);
+    return IronBeeModifier(config_path, behavior, benchmark);
 }
 
 component_t build_component(
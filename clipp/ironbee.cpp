@@ -24,14 +24,20 @@
 
 #include "ironbee.hpp"
 
+#include <clipp/benchmark.hpp>
 #include <clipp/control.hpp>
+#include <clipp/worker_pool.hpp>
 
 #include <ironbeepp/all.hpp>
 #include <ironbee/rule_engine.h>
 
+#include <boost/format.hpp>
 #include <boost/make_shared.hpp>
+#include <boost/scoped_ptr.hpp>
 #include <boost/thread.hpp>
 
+#include <iostream>
+
 using namespace std;
 
 namespace IronBee {
@@ -70,11 +76,21 @@ class IronBeeDelegate :
     public Input::Delegate
 {
 public:
+    /**
+     * Constructor.
+     *
+     * @param[in] engine    Engine to notify.
+     * @param[in] benchmark If not NULL, time spent in @a engine is
+     *                      recorded here.
+     **/
     explicit
-    IronBeeDelegate(IronBee::Engine engine) :
-        m_engine(engine)
+    IronBeeDelegate(IronBee::Engine engine, Benchmark* benchmark = NULL) :
+        m_engine(engine),
+        m_benchmark(benchmark),
+        m_connection_started(0),
+        m_transaction_started(0)
     {
-        // nop
+        fill(m_tx_phases, m_tx_phases + Benchmark::NUM_PHASES, 0);
     }
 
     ~IronBeeDelegate()
@@ -87,6 +103,11 @@ public:
 
     void connection_opened(const Input::ConnectionEvent& event)
     {
+        if (m_benchmark) {
+            m_benchmark->start();
+            m_connection_started = ib_clock_get_time();
+        }
+
         {
             boost::lock_guard<boost::mutex> guard(m_mutex);
 
@@ -133,6 +154,13 @@ public:
             m_connection.destroy();
         }
         m_connection = IronBee::Connection();
+
+        if (m_benchmark) {
+            m_benchmark->record(
+                Benchmark::CONNECTION,
+                ib_clock_get_time() - m_connection_started
+            );
+        }
     };
 
     void connection_data_in(const Input::DataEvent& event)
@@ -158,6 +186,10 @@ public:
             );
         }
 
+        ib_time_t start = now();
+        m_transaction_started = start;
+        fill(m_tx_phases, m_tx_phases + Benchmark::NUM_PHASES, 0);
+
         if (m_transaction) {
             m_transaction.destroy();
         }
@@ -173,6 +205,7 @@ public:
             );
 
         m_engine.notify().request_started(m_transaction, prl);
+        charge(Benchmark::REQUEST_HEADER, start);
     }
 
     void request_header(const Input::HeaderEvent& event)
@@ -184,12 +217,14 @@ public:
             );
         }
 
+        ib_time_t start = now();
         adapt_header adaptor(m_transaction.memory_manager());
         m_engine.notify().request_header_data(
             m_transaction,
             boost::make_transform_iterator(event.headers.begin(), adaptor),
             boost::make_transform_iterator(event.headers.end(),   adaptor)
         );
+        charge(Benchmark::REQUEST_HEADER, start);
     }
 
     void request_header_finished(const Input::NullEvent& event)
@@ -200,7 +235,9 @@ public:
                 "of connection lifetime."
             );
         }
+        ib_time_t start = now();
         m_engine.notify().request_header_finished(m_transaction);
+        charge(Benchmark::REQUEST_HEADER, start);
     }
 
     void request_body(const Input::DataEvent& event)
@@ -217,10 +254,12 @@ public:
             return;
         }
 
+        ib_time_t start = now();
         m_engine.notify().request_body_data(
             m_transaction,
             event.data.data, event.data.length
         );
+        charge(Benchmark::REQUEST_BODY, start);
     }
 
     void request_finished(const Input::NullEvent& event)
@@ -231,7 +270,9 @@ public:
                 "of transaction lifetime."
             );
         }
+        ib_time_t start = now();
         m_engine.notify().request_finished(m_transaction);
+        charge(Benchmark::REQUEST_BODY, start);
     }
 
     void response_started(const Input::ResponseEvent& event)
@@ -243,6 +284,7 @@ public:
             );
         }
 
+        ib_time_t start = now();
         IronBee::ParsedResponseLine prl =
             IronBee::ParsedResponseLine::create_alias(
                 m_transaction.memory_manager(),
@@ -253,6 +295,7 @@ public:
             );
 
         m_engine.notify().response_started(m_transaction, prl);
+        charge(Benchmark::RESPONSE, start);
     }
 
     void response_header(const Input::HeaderEvent& event)
@@ -264,12 +307,14 @@ public:
             );
         }
 
+        ib_time_t start = now();
         adapt_header adaptor(m_transaction.memory_manager());
         m_engine.notify().response_header_data(
             m_transaction,
             boost::make_transform_iterator(event.headers.begin(), adaptor),
             boost::make_transform_iterator(event.headers.end(),   adaptor)
         );
+        charge(Benchmark::RESPONSE, start);
     }
 
     void response_header_finished(const Input::NullEvent& event)
@@ -280,7 +325,9 @@ public:
                 "of connection lifetime."
             );
         }
+        ib_time_t start = now();
         m_engine.notify().response_header_finished(m_transaction);
+        charge(Benchmark::RESPONSE, start);
     }
 
     void response_body(const Input::DataEvent& event)
@@ -297,10 +344,12 @@ public:
             return;
         }
 
+        ib_time_t start = now();
         m_engine.notify().response_body_data(
             m_transaction,
             event.data.data, event.data.length
         );
+        charge(Benchmark::RESPONSE, start);
     }
 
     void response_finished(const Input::NullEvent& event)
@@ -312,16 +361,64 @@ public:
             );
         }
 
+        ib_time_t start = now();
         m_engine.notify().response_finished(m_transaction);
+        if (m_benchmark) {
+            record_transaction(start);
+        }
         m_transaction.destroy();
         m_transaction = IronBee::Transaction();
     }
 
 private:
+    //! Current time if benchmarking, else 0.
+    ib_time_t now() const
+    {
+        return m_benchmark ? ib_clock_get_time() : 0;
+    }
+
+    //! Charge time since @a start to @a phase of the current transaction.
+    void charge(Benchmark::phase_e phase, ib_time_t start)
+    {
+        if (m_benchmark) {
+            m_tx_phases[phase] += ib_clock_get_time() - start;
+        }
+    }
+
+    /**
+     * Record the current transaction.
+     *
+     * @param[in] start When the response finished notification started.
+     *                  Time up to post processing is charged to the
+     *                  response, the rest to post processing.
+     **/
+    void record_transaction(ib_time_t start)
+    {
+        ib_time_t end = ib_clock_get_time();
+        ib_time_t postprocess = m_benchmark->postprocess_started();
+
+        if (postprocess < start || postprocess > end) {
+            postprocess = end;
+        }
+        m_tx_phases[Benchmark::RESPONSE] += postprocess - start;
+        m_tx_phases[Benchmark::POSTPROCESS] += end - postprocess;
+        m_tx_phases[Benchmark::TRANSACTION] = end - m_transaction_started;
+
+        for (int i = Benchmark::TRANSACTION; i < Benchmark::NUM_PHASES; ++i) {
+            m_benchmark->record(Benchmark::phase_e(i), m_tx_phases[i]);
+        }
+        m_benchmark->record_tx_memory(ib_mpool_inuse(m_transaction.ib()->mp));
+    }
+
     IronBee::Engine      m_engine;
     IronBee::Connection  m_connection;
     IronBee::Transaction m_transaction;
     boost::mutex         m_mutex;
+
+    Benchmark*           m_benchmark;
+    ib_time_t            m_connection_started;
+    ib_time_t            m_transaction_started;
+    ib_time_t            m_tx_phases[Benchmark::NUM_PHASES];
 };
 
 void load_configuration(IronBee::Engine engine, const std::string& path)
@@ -465,109 +562,51 @@ ib_status_t clipp_close(
 
 } // extern "C"
 
-// Move to new file?
-template <typename WorkType>
-class FunctionWorkerPool :
-    private boost::noncopyable
+//! Latency at @a fraction of sorted @a latencies.
+ib_time_t percentile(const vector<ib_time_t>& latencies, double fraction)
 {
-    typedef boost::unique_lock<boost::mutex> lock_t;
-
-    void do_work()
-    {
-        WorkType local_work;
-        for (;;) {
-            {
-                lock_t lock(m_mutex);
-                ++m_num_workers_available;
-
-            }
-            m_worker_available_cv.notify_one();
-
-            {
-                lock_t lock(m_mutex);
-                while (! m_work_available) {
-                    m_work_available_cv.wait(lock);
-                    if (m_shutdown) {
-                        return;
-                    }
-                }
-
-                local_work = m_work;
-                m_work_available = false;
-                --m_num_workers_available;
-            }
-            m_work_accepted_barrier.wait();
-
-            m_work_function(local_work);
-        }
-    }
-
-public:
-    FunctionWorkerPool(
-        size_t                          num_workers,
-        boost::function<void(WorkType)> work_function
-    ) :
-        m_num_workers(num_workers),
-        m_work_function(work_function),
-        m_work_accepted_barrier(2),
-        m_num_workers_available(0),
-        m_work_available(false),
-        m_shutdown(false)
-    {
-        for (size_t i = 0; i < num_workers; ++i) {
-            m_thread_group.create_thread(boost::bind(
-                &FunctionWorkerPool::do_work,
-                this
-            ));
-        }
-    }
-
-    void operator()(WorkType work)
-    {
-        {
-            lock_t lock(m_mutex);
-
-            while (m_num_workers_available == 0) {
-                m_worker_available_cv.wait(lock);
-            }
-
-            m_work           = work;
-            m_work_available = true;
-
-            m_work_available_cv.notify_one();
-        }
-        m_work_accepted_barrier.wait();
-    }
-
-    void shutdown()
-    {
-        {
-            lock_t lock(m_mutex);
-            while (m_num_workers_available < m_num_workers) {
-                m_worker_available_cv.wait(lock);
-            }
-        }
-
-        m_shutdown = true;
-        m_work_available_cv.notify_all();
-
-        m_thread_group.join_all();
+    if (latencies.empty()) {
+        return 0;
     }
+    size_t index = static_cast<size_t>(fraction * (latencies.size() - 1));
+    return latencies[index];
+}
 
-private:
-    size_t                          m_num_workers;
-    boost::function<void(WorkType)> m_work_function;
-
-    boost::mutex                    m_mutex;
-    boost::condition_variable       m_worker_available_cv;
-    boost::condition_variable       m_work_available_cv;
-    boost::barrier                  m_work_accepted_barrier;
-    boost::thread_group             m_thread_group;
-    size_t                          m_num_workers_available;
-    bool                            m_work_available;
-    bool                            m_shutdown;
-    WorkType                        m_work;
-};
+//! Write per worker throughput and overall latencies of @a stats to @a out.
+template <typename StatsType>
+void report_worker_stats(
+    ostream&                 out,
+    const vector<StatsType>& stats,
+    ib_time_t                wall
+)
+{
+    vector<ib_time_t> all;
+    double            seconds = max(wall, ib_time_t(1)) / 1e6;
+
+    out << "Worker throughput over " << (wall / 1000) << " ms:" << endl;
+    for (size_t i = 0; i < stats.size(); ++i) {
+        const StatsType& s = stats[i];
+        out << boost::format("  worker %2d: %8d inputs %10.1f inputs/s "
+                             "%5.1f%% busy\n") %
+            i %
+            s.latencies.size() %
+            (s.latencies.size() / seconds) %
+            (100.0 * s.busy / max(wall, ib_time_t(1)));
+        all.insert(all.end(), s.latencies.begin(), s.latencies.end());
+    }
+    sort(all.begin(), all.end());
+
+    out << boost::format("  total:     %8d inputs %10.1f inputs/s\n") %
+        all.size() %
+        (all.size() / seconds);
+    out << boost::format("Input latency (us): p50 %d p90 %d p99 %d "
+                         "p99.9 %d max %d\n") %
+        percentile(all, 0.5) %
+        percentile(all, 0.9) %
+        percentile(all, 0.99) %
+        percentile(all, 0.999) %
+        percentile(all, 1.0);
+}
 
 } // Anonymous
 
@@ -576,10 +615,14 @@ struct IronBeeConsumer::State
     boost::function<bool(Input::input_p&)> modifier;
 };
 
-IronBeeConsumer::IronBeeConsumer(const string& config_path) :
+IronBeeConsumer::IronBeeConsumer(const string& config_path, bool benchmark) :
     m_state(boost::make_shared<State>())
 {
-    m_state->modifier = IronBeeModifier(config_path);
+    m_state->modifier = IronBeeModifier(
+        config_path,
+        IronBeeModifier::ALLOW,
+        benchmark
+    );
 }
 
 bool IronBeeConsumer::operator()(const Input::input_p& input)
@@ -604,24 +647,39 @@ struct IronBeeModifier::State
 
     ~State()
     {
+        if (benchmark) {
+            benchmark->report(cout);
+        }
         engine.destroy();
         IronBee::shutdown();
     }
 
-    behavior_e           behavior;
-    action_e             current_action;
-    IronBee::Engine      engine;
-    IronBee::ServerValue server_value;
+    behavior_e                    behavior;
+    action_e                      current_action;
+    IronBee::Engine               engine;
+    IronBee::ServerValue          server_value;
+    boost::scoped_ptr<Benchmark>  benchmark;
 };
 
 IronBeeModifier::IronBeeModifier(
     const string& config_path,
-    behavior_e    behavior
+    behavior_e    behavior,
+    bool          benchmark
 ) :
     m_state(boost::make_shared<State>())
 {
     m_state->behavior = behavior;
 
+    if (benchmark) {
+        m_state->benchmark.reset(new Benchmark());
+        m_state->engine.register_hooks().handle_postprocess(
+            boost::bind(
+                &Benchmark::mark_postprocess,
+                m_state->benchmark.get()
+            )
+        );
+    }
+
     m_state->server_value.get().ib()->hdr_fn = clipp_header;
     m_state->server_value.get().ib()->err_fn = clipp_error;
     m_state->server_value.get().ib()->err_hdr_fn = clipp_error_header;
@@ -647,7 +705,7 @@ bool IronBeeModifier::operator()(Input::input_p& input)
         return true;
     }
 
-    IronBeeDelegate delegate(m_state->engine);
+    IronBeeDelegate delegate(m_state->engine, m_state->benchmark.get());
 
     switch (m_state->behavior) {
         case ALLOW: m_state->current_action = ACTION_ALLOW;  break;
@@ -679,18 +737,23 @@ struct IronBeeThreadedConsumer::State
         input->connection.dispatch(delegate, true);
     }
 
-    explicit
-    State(size_t num_workers) :
+    State(
+        size_t num_workers,
+        size_t queue_depth,
+        size_t batch_size
+    ) :
         worker_pool(
             num_workers,
             boost::bind(
                 &IronBeeThreadedConsumer::State::process_input,
                 this,
                 _1
-            )
+            ),
+            queue_depth,
+            batch_size
         ),
-        server_value(__FILE__, "clipp")
-
+        server_value(__FILE__, "clipp"),
+        start(0)
     {
         IronBee::initialize();
         engine = IronBee::Engine::create(server_value.get());
@@ -700,27 +763,42 @@ struct IronBeeThreadedConsumer::State
     {
         worker_pool.shutdown();
 
+        if (start != 0) {
+            report_worker_stats(
+                cout,
+                worker_pool.stats(),
+                ib_clock_get_time() - start
+            );
+        }
+
         engine.destroy();
         IronBee::shutdown();
     }
 
+    WorkerPool<Input::input_p> worker_pool;
+    IronBee::Engine            engine;
+    IronBee::ServerValue       server_value;
 
-    FunctionWorkerPool<Input::input_p> worker_pool;
-    IronBee::Engine      engine;
-    IronBee::ServerValue server_value;
+    //! Time of the first input or 0.
+    ib_time_t                  start;
 };
 
 IronBeeThreadedConsumer::IronBeeThreadedConsumer(
     const string& config_path,
-    size_t        num_workers
+    size_t        num_workers,
+    size_t        queue_depth,
+    size_t        batch_size
 ) :
-    m_state(boost::make_shared<State>(num_workers))
+    m_state(boost::make_shared<State>(num_workers, queue_depth, batch_size))
 {
     load_configuration(m_state->engine, config_path);
 }
 
 bool IronBeeThreadedConsumer::operator()(const Input::input_p& input)
 {
+    if (m_state->start == 0) {
+        m_state->start = ib_clock_get_time();
+    }
     m_state->worker_pool(input);
 
     return true;
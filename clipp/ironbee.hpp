@@ -49,8 +49,18 @@ namespace CLIPP {
 class IronBeeConsumer
 {
 public:
+    /**
+     * Constructor.
+     *
+     * @param[in] config_path Path to IronBee configuration.
+     * @param[in] benchmark   If true, time spent in IronBee is recorded and
+     *                        reported to standard out on destruction.
+     **/
     explicit
-    IronBeeConsumer(const std::string& config_path);
+    IronBeeConsumer(
+        const std::string& config_path,
+        bool               benchmark = false
+    );
 
     bool operator()(const Input::input_p& input);
 
@@ -63,15 +73,26 @@ private:
  * CLIPP consumer that feeds inputs to an internal threaded IronBee Engine.
  *
  * This consumer is as IronBeeConsumer except that it will spawn multiple
- * threads to feed data to IronBee.  It will wait until at least one thread
- * is free, and then pass on the input and return.
+ * threads to feed data to IronBee.  Inputs are queued in batches of
+ * @a batch_size; the consumer only waits when @a queue_depth batches are
+ * already queued.
+ *
+ * When destroyed, it waits for all inputs to be processed and writes the
+ * throughput of each thread and input latency percentiles to standard out.
  **/
 class IronBeeThreadedConsumer
 {
 public:
+    //! Default maximum number of queued batches.
+    static const size_t default_queue_depth = 64;
+    //! Default number of inputs per batch.
+    static const size_t default_batch_size = 16;
+
     IronBeeThreadedConsumer(
         const std::string& config_path,
-        size_t             num_inputs
+        size_t             num_workers,
+        size_t             queue_depth = default_queue_depth,
+        size_t             batch_size  = default_batch_size
     );
 
     bool operator()(const Input::input_p& input);
@@ -99,9 +120,19 @@ public:
         BLOCK
     };
 
+    /**
+     * Constructor.
+     *
+     * @param[in] config_path Path to IronBee configuration.
+     * @param[in] behavior    Behavior in absence of @c clipp rule actions.
+     * @param[in] benchmark   If true, time spent in IronBee per connection,
+     *                        transaction and phase is recorded and reported
+     *                        to standard out on destruction.
+     **/
     IronBeeModifier(
         const std::string& config_path,
-        behavior_e         behavior = ALLOW
+        behavior_e         behavior = ALLOW,
+        bool               benchmark = false
     );
 
     bool operator()(Input::input_p& input);
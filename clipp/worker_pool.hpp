@@ -0,0 +1,201 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronBee --- CLIPP Worker Pool.
+ */
+
+#ifndef __IRONBEE_CLIPP__WORKER_POOL__
+#define __IRONBEE_CLIPP__WORKER_POOL__
+
+#include <ironbee/clock.h>
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+namespace IronBee {
+namespace CLIPP {
+
+/**
+ * Pool of threads calling a function on work items.
+ *
+ * Work is handed to the workers in batches through a bounded queue.  The
+ * producer only blocks when the queue holds @a queue_depth batches, and
+ * producer and workers touch the queue lock once per batch rather than
+ * once per item.
+ *
+ * Each worker records how long every item took; see stats().
+ **/
+template <typename WorkType>
+class WorkerPool :
+    private boost::noncopyable
+{
+public:
+    //! Function to call on each work item.
+    typedef boost::function<void(WorkType)> work_function_t;
+
+    //! Statistics of a single worker.
+    struct stats_t
+    {
+        //! Time spent in the work function in microseconds.
+        ib_time_t busy;
+
+        //! Time each item took in microseconds, in completion order.
+        std::vector<ib_time_t> latencies;
+    };
+
+    /**
+     * Constructor.
+     *
+     * @param[in] num_workers   Number of worker threads.
+     * @param[in] work_function Function to call on each item.
+     * @param[in] queue_depth   Maximum number of queued batches.
+     * @param[in] batch_size    Number of items per batch.
+     **/
+    WorkerPool(
+        size_t          num_workers,
+        work_function_t work_function,
+        size_t          queue_depth,
+        size_t          batch_size
+    ) :
+        m_work_function(work_function),
+        m_queue_depth(std::max(queue_depth, size_t(1))),
+        m_batch_size(std::max(batch_size, size_t(1))),
+        m_shutdown(false),
+        m_stats(num_workers)
+    {
+        m_batch.reserve(m_batch_size);
+        for (size_t i = 0; i < num_workers; ++i) {
+            m_thread_group.create_thread(boost::bind(
+                &WorkerPool::do_work,
+                this,
+                i
+            ));
+        }
+    }
+
+    //! Queue @a work, blocking if the queue is full.
+    void operator()(WorkType work)
+    {
+        m_batch.push_back(work);
+        if (m_batch.size() >= m_batch_size) {
+            push_batch();
+        }
+    }
+
+    //! Finish all queued work and stop the workers.
+    void shutdown()
+    {
+        if (! m_batch.empty()) {
+            push_batch();
+        }
+        {
+            lock_t lock(m_mutex);
+            m_shutdown = true;
+        }
+        m_not_empty_cv.notify_all();
+
+        m_thread_group.join_all();
+    }
+
+    //! Statistics of each worker.  Only valid after shutdown().
+    const std::vector<stats_t>& stats() const
+    {
+        return m_stats;
+    }
+
+private:
+    typedef boost::unique_lock<boost::mutex> lock_t;
+    typedef std::vector<WorkType>            batch_t;
+
+    void push_batch()
+    {
+        {
+            lock_t lock(m_mutex);
+            while (m_queue.size() >= m_queue_depth) {
+                m_not_full_cv.wait(lock);
+            }
+            m_queue.push_back(batch_t());
+            m_queue.back().swap(m_batch);
+        }
+        m_not_empty_cv.notify_one();
+        m_batch.reserve(m_batch_size);
+    }
+
+    void do_work(size_t index)
+    {
+        stats_t& stats = m_stats[index];
+        batch_t  batch;
+
+        stats.busy = 0;
+        for (;;) {
+            {
+                lock_t lock(m_mutex);
+                while (m_queue.empty() && ! m_shutdown) {
+                    m_not_empty_cv.wait(lock);
+                }
+                if (m_queue.empty()) {
+                    return;
+                }
+                batch.swap(m_queue.front());
+                m_queue.pop_front();
+            }
+            m_not_full_cv.notify_one();
+
+            for (
+                typename batch_t::iterator i = batch.begin();
+                i != batch.end();
+                ++i
+            ) {
+                ib_time_t start = ib_clock_get_time();
+                m_work_function(*i);
+                ib_time_t elapsed = ib_clock_get_time() - start;
+                stats.busy += elapsed;
+                stats.latencies.push_back(elapsed);
+            }
+            batch.clear();
+        }
+    }
+
+    work_function_t           m_work_function;
+    size_t                    m_queue_depth;
+    size_t                    m_batch_size;
+
+    boost::mutex              m_mutex;
+    boost::condition_variable m_not_full_cv;
+    boost::condition_variable m_not_empty_cv;
+    std::deque<batch_t>       m_queue;
+    bool                      m_shutdown;
+
+    //! Batch being filled by the producer; only touched by it.
+    batch_t                   m_batch;
+
+    boost::thread_group       m_thread_group;
+    std::vector<stats_t>      m_stats;
+};
+
+} // CLIPP
+} // IronBee
+
+#endif
@@ -196,6 +196,7 @@ CANONICAL_INCLUDE_ORDER = [
   '<ironbee/context.h>',
   '<ironbee/context_selection.h>',
   '<ironbee/core.h>',
+  '<ironbee/counters.h>',
   '<ironbee/decode.h>',
   '<ironbee/dso.h>',
   '<ironbee/engine.h>',
@@ -213,6 +214,8 @@ CANONICAL_INCLUDE_ORDER = [
   '<ironbee/json.h>',
   '<ironbee/kvstore.h>',
   '<ironbee/kvstore_filesystem.h>',
+  '<ironbee/kvstore_log.h>',
+  '<ironbee/kvstore_shm.h>',
   '<ironbee/list.h>',
   '<ironbee/lock.h>',
   '<ironbee/log.h>',
@@ -243,6 +246,7 @@ CANONICAL_INCLUDE_ORDER = [
   '<ironbee/stringset.h>',
   '<ironbee/string_assembly.h>',
   '<ironbee/string_lower.h>',
+  '<ironbee/string_scan.h>',
   '<ironbee/string_trim.h>',
   '<ironbee/string_whitespace.h>',
   '<ironbee/stream.h>',
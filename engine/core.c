@@ -46,6 +46,7 @@
 #include <ironbee/field.h>
 #include <ironbee/flags.h>
 #include <ironbee/json.h>
+#include <ironbee/lock.h>
 #include <ironbee/logevent.h>
 #include <ironbee/mm.h>
 #include <ironbee/rule_defs.h>
@@ -297,37 +298,35 @@ static ib_status_t ib_auditlog_part_add(ib_auditlog_t *log,
 
 /* -- Logger API Implementations -- */
 
-static void core_logger_element(void *element, void *cbdata)
-{
-    assert(element != NULL);
-    assert(cbdata  != NULL);
-
-    ib_logger_standard_msg_t *msg = (ib_logger_standard_msg_t *)element;
-    ib_core_cfg_t            *cfg = (ib_core_cfg_t *)cbdata;
-
-    fprintf(
-        cfg->log_fp,
-        "%s %.*s\n",
-        msg->prefix,
-        (int)msg->msg_sz,
-        (char *)msg->msg);
-    fflush(cfg->log_fp);
-}
-
 /**
  * Logger callback that writes log records to core's file descriptor.
  *
  * @param[in] logger The logger.
- * @param[in] writer The writer with the queued log messages.
+ * @param[in] records The batch of @ref ib_logger_standard_msg_t records.
+ * @param[in] nrecords The number of @a records.
  * @param[in] cbdata Callback data. The @ref ib_core_cfg_t.
  */
-static ib_status_t core_logger_record(
-    ib_logger_t        *logger,
-    ib_logger_writer_t *writer,
-    void               *cbdata
+static ib_status_t core_logger_batch(
+    ib_logger_t  *logger,
+    void * const *records,
+    size_t        nrecords,
+    void         *cbdata
 )
 {
-    return ib_logger_dequeue(logger, writer, core_logger_element, cbdata);
+    assert(cbdata != NULL);
+
+    ib_core_cfg_t *cfg = (ib_core_cfg_t *)cbdata;
+    ib_status_t    rc;
+
+    /* A writer thread may write while the engine closes the log file. */
+    rc = ib_lock_lock(cfg->log_fp_lck);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    rc = ib_logger_standard_msg_write_batch(cfg->log_fp, records, nrecords);
+    ib_lock_unlock(cfg->log_fp_lck);
+
+    return rc;
 }
 
 /**
@@ -361,7 +360,7 @@ static ib_status_t core_add_core_logger(
         return rc;
     }
 
-    rc = ib_logger_writer_add(
+    rc = ib_logger_writer_add_batched(
         ib_engine_logger_get(ib),
         NULL, /* Open. */
         NULL,
@@ -370,7 +369,7 @@ static ib_status_t core_add_core_logger(
         NULL, /* Reopen. */
         NULL,
         fmt,
-        core_logger_record,
+        core_logger_batch,
         corecfg
     );
     if (rc != IB_OK) {
@@ -392,12 +391,15 @@ static void core_log_file_close(ib_engine_t *ib,
     assert(ib != NULL);
     assert(config != NULL);
 
-    if (config->log_fp == NULL) {
-        config->log_fp = stderr;
-    }
-    else if (config->log_fp != stderr) {
-        fclose(config->log_fp);
-        config->log_fp = stderr;
+    FILE *log_fp;
+
+    ib_lock_lock(config->log_fp_lck);
+    log_fp = config->log_fp;
+    config->log_fp = stderr;
+    ib_lock_unlock(config->log_fp_lck);
+
+    if (log_fp != NULL && log_fp != stderr) {
+        fclose(log_fp);
     }
 }
 
@@ -444,26 +446,15 @@ static ib_status_t audit_write_log(ib_engine_t *ib, ib_auditlog_t *log)
     /* Open the log if required. This is thread safe. */
     rc = core_audit_open(ib, log);
     if (rc != IB_OK) {
-        if (log->ctx->auditlog->index != NULL) {
-            ib_lock_unlock(log->ctx->auditlog->index_fp_lock);
-        }
         return rc;
     }
 
-    /* Lock to write. */
-    if (log->ctx->auditlog->index != NULL) {
-        rc = ib_lock_lock(log->ctx->auditlog->index_fp_lock);
-        if (rc != IB_OK) {
-            ib_log_error(ib, "Failed to lock \"%s\" for write.",
-                         log->ctx->auditlog->index);
-            return rc;
-        }
-    }
+    /* The header, parts and footer are buffered in the transaction's
+     * audit log and written by core_audit_close(), so no lock is needed. */
 
     /* Write the header if required. */
     rc = core_audit_write_header(ib, log);
     if (rc != IB_OK) {
-        ib_lock_unlock(log->ctx->auditlog->index_fp_lock);
         return rc;
     }
 
@@ -481,18 +472,11 @@ static ib_status_t audit_write_log(ib_engine_t *ib, ib_auditlog_t *log)
     /* Write the footer if required. */
     rc = core_audit_write_footer(ib, log);
     if (rc != IB_OK) {
-        if (log->ctx->auditlog->index != NULL) {
-            ib_lock_unlock(log->ctx->auditlog->index_fp_lock);
-        }
         return rc;
     }
 
-    /* Writing is done. Unlock. Close is thread-safe. */
-    if (log->ctx->auditlog->index != NULL) {
-        ib_lock_unlock(log->ctx->auditlog->index_fp_lock);
-    }
-
-    /* Close the audit log and write to the index file. */
+    /* Write the audit log, close it and queue the index line. Close is
+     * thread-safe. */
     rc = core_audit_close(ib, log);
     if (rc != IB_OK) {
         return rc;
@@ -1845,7 +1829,12 @@ static ib_status_t auditing_hook(ib_engine_t *ib,
     }
 
     /* Create a unique MIME tx->audit_log_id. */
-    rc = ib_uuid_create_v4(tx->audit_log_id);
+    if (ib->time_ordered_ids) {
+        rc = ib_uuid_create_v7(tx->audit_log_id);
+    }
+    else {
+        rc = ib_uuid_create_v4(tx->audit_log_id);
+    }
     if (rc != IB_OK) {
         return rc;
     }
@@ -3007,6 +2996,17 @@ static ib_status_t core_dir_param1(ib_cfgparser_t *cp,
         rc = ib_context_set_string(ctx, "auditlog_index_fmt", p1_unescaped);
         return rc;
     }
+    else if (strcasecmp("AuditLogIndexMaxLatency", name) == 0) {
+        ib_num_t latency;
+        rc = ib_type_atoi(p1_unescaped, 10, &latency);
+        if ( (rc != IB_OK) || (latency < 0) ) {
+            ib_log_error(ib, "Invalid latency: %s \"%s\"",
+                         name, p1_unescaped);
+            return IB_EINVAL;
+        }
+        rc = ib_context_set_num(ctx, "auditlog_index_latency", latency);
+        return rc;
+    }
     else if (strcasecmp("AuditLogDirMode", name) == 0) {
         long lmode = strtol(p1_unescaped, NULL, 0);
 
@@ -3106,6 +3106,22 @@ static ib_status_t core_dir_param1(ib_cfgparser_t *cp,
         /* ib_module_load will report errors. */
         return rc;
     }
+    else if (strcasecmp("LogWriterThread", name) == 0) {
+        if (strcasecmp("On", p1_unescaped) == 0) {
+            rc = ib_logger_writer_threads_start(ib_engine_logger_get(ib));
+            if (rc != IB_OK) {
+                ib_log_error(ib, "Failed to start log writer threads: %s",
+                             ib_status_to_string(rc));
+            }
+            return rc;
+        }
+        else if (strcasecmp("Off", p1_unescaped) == 0) {
+            return IB_OK;
+        }
+
+        ib_log_error(ib, "Invalid value for %s: %s", name, p1_unescaped);
+        return IB_EINVAL;
+    }
     else if (strcasecmp("RequestBuffering", name) == 0) {
         if (strcasecmp("On", p1_unescaped) == 0) {
             rc = ib_context_set_num(ctx, "buffer_req", 1);
@@ -3142,6 +3158,19 @@ static ib_status_t core_dir_param1(ib_cfgparser_t *cp,
 
         return IB_OK;
     }
+    else if (strcasecmp("IdFormat", name) == 0) {
+        if (strcasecmp("Random", p1_unescaped) == 0) {
+            ib->time_ordered_ids = false;
+            return IB_OK;
+        }
+        else if (strcasecmp("TimeOrdered", p1_unescaped) == 0) {
+            ib->time_ordered_ids = true;
+            return IB_OK;
+        }
+
+        ib_log_error(ib, "Invalid value for %s: %s", name, p1_unescaped);
+        return IB_EINVAL;
+    }
     else if (strcasecmp("SensorName", name) == 0) {
         ib->sensor_name = ib_mm_strdup(ib_engine_mm_config_get(ib),
                                        p1_unescaped);
@@ -3314,6 +3343,73 @@ static ib_status_t core_dir_loglevel(ib_cfgparser_t *cp,
     return IB_EINVAL;
 }
 
+/**
+ * Map of logger queue overflow policy names.
+ */
+static IB_STRVAL_MAP(core_logoverflow_map) = {
+    IB_STRVAL_PAIR("dropnewest", IB_LOGGER_OVERFLOW_DROP_NEWEST),
+    IB_STRVAL_PAIR("dropoldest", IB_LOGGER_OVERFLOW_DROP_OLDEST),
+    IB_STRVAL_PAIR("block", IB_LOGGER_OVERFLOW_BLOCK),
+    IB_STRVAL_PAIR_LAST
+};
+
+/**
+ * Handle the LogQueueOverflow directive.
+ *
+ * @param cp Config parser
+ * @param name Directive name
+ * @param vars Policy name and optional timeout in milliseconds
+ * @param cbdata Callback data (from directive registration)
+ *
+ * @returns Status code
+ */
+static ib_status_t core_dir_logqueueoverflow(ib_cfgparser_t *cp,
+                                             const char *name,
+                                             const ib_list_t *vars,
+                                             void *cbdata)
+{
+    assert(cp != NULL);
+    assert(cp->ib != NULL);
+    assert(name != NULL);
+    assert(vars != NULL);
+
+    const ib_list_node_t *node;
+    ib_num_t policy;
+    ib_num_t timeout = IB_LOGGER_OVERFLOW_TIMEOUT_MS;
+    ib_status_t rc;
+
+    node = ib_list_first_const(vars);
+    if (node == NULL) {
+        ib_cfg_log_error(cp, "%s requires a policy.", name);
+        return IB_EINVAL;
+    }
+    rc = ib_config_strval_pair_lookup(
+        (const char *)ib_list_node_data_const(node),
+        core_logoverflow_map,
+        &policy);
+    if (rc != IB_OK) {
+        ib_cfg_log_error(cp, "Invalid %s policy: %s", name,
+                         (const char *)ib_list_node_data_const(node));
+        return IB_EINVAL;
+    }
+
+    node = ib_list_node_next_const(node);
+    if (node != NULL) {
+        rc = ib_type_atoi(
+            (const char *)ib_list_node_data_const(node), 10, &timeout);
+        if (rc != IB_OK || timeout < 0) {
+            ib_cfg_log_error(cp, "Invalid %s timeout: %s", name,
+                             (const char *)ib_list_node_data_const(node));
+            return IB_EINVAL;
+        }
+    }
+
+    ib_logger_overflow_set(ib_engine_logger_get(cp->ib),
+                           (ib_logger_overflow_t)policy,
+                           (uint32_t)timeout);
+    return IB_OK;
+}
+
 /**
  * Handle single parameter directives.
  *
@@ -3960,6 +4056,11 @@ static IB_DIRMAP_INIT_STRUCTURE(core_directive_map) = {
         core_dir_param1,
         NULL
     ),
+    IB_DIRMAP_INIT_PARAM1(
+        "IdFormat",
+        core_dir_param1,
+        NULL
+    ),
 
     /* Buffering */
     IB_DIRMAP_INIT_PARAM1(
@@ -4011,6 +4112,16 @@ static IB_DIRMAP_INIT_STRUCTURE(core_directive_map) = {
         core_dir_loglevel,
         core_loglevels_map
     ),
+    IB_DIRMAP_INIT_LIST(
+        "LogQueueOverflow",
+        core_dir_logqueueoverflow,
+        NULL
+    ),
+    IB_DIRMAP_INIT_PARAM1(
+        "LogWriterThread",
+        core_dir_param1,
+        NULL
+    ),
     IB_DIRMAP_INIT_PARAM1(
         "Log",
         core_dir_param1,
@@ -4095,6 +4206,11 @@ static IB_DIRMAP_INIT_STRUCTURE(core_directive_map) = {
         core_dir_param1,
         NULL
     ),
+    IB_DIRMAP_INIT_PARAM1(
+        "AuditLogIndexMaxLatency",
+        core_dir_param1,
+        NULL
+    ),
     IB_DIRMAP_INIT_PARAM1(
         "AuditLogDirMode",
         core_dir_param1,
@@ -4429,6 +4545,12 @@ static ib_status_t core_init(ib_engine_t *ib,
         return rc;
     }
 
+    rc = ib_lock_create(&(corecfg->log_fp_lck), mm);
+    if (rc != IB_OK) {
+        ib_log_error(ib, "Failed to create core log file lock.");
+        return rc;
+    }
+
     /* Set defaults */
     corecfg->log_fp               = stderr;
     corecfg->log_uri              = "";
@@ -4441,6 +4563,7 @@ static ib_status_t core_init(ib_engine_t *ib,
     corecfg->auditlog_dir         = "/var/log/ironbee";
     corecfg->auditlog_sdir_fmt    = "";
     corecfg->auditlog_index_fmt   = IB_LOGFORMAT_DEFAULT;
+    corecfg->auditlog_index_latency = 100;
     corecfg->audit                = MODULE_NAME_STR;
     corecfg->data                 = MODULE_NAME_STR;
     corecfg->module_base_path     = X_MODULE_BASE_PATH;
@@ -4644,6 +4767,12 @@ static IB_CFGMAP_INIT_STRUCTURE(core_config_map) = {
         ib_core_cfg_t,
         audit_engine
     ),
+    IB_CFGMAP_INIT_ENTRY(
+        "auditlog_index_latency",
+        IB_FTYPE_NUM,
+        ib_core_cfg_t,
+        auditlog_index_latency
+    ),
     IB_CFGMAP_INIT_ENTRY(
         "auditlog_dmode",
         IB_FTYPE_NUM,
@@ -38,10 +38,15 @@
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdarg.h>
 #include <stdlib.h>
+#include <time.h>
 #include <unistd.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 
 /* POSIX doesn't define O_BINARY */
 #ifndef O_BINARY
@@ -60,6 +65,436 @@ typedef struct {
 static const char * const ib_pipe_shell = "/bin/sh";
 static const size_t LOGFORMAT_MAX_LINE_LENGTH = 8192;
 
+/* Pending index bytes at which the flusher writes without waiting. */
+static const size_t CORE_AUDIT_INDEX_BATCH = 65536;
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+/**
+ * Queue of audit log index lines waiting to be written.
+ *
+ * Transactions append their index line to @c buf and a flusher thread
+ * writes everything that has accumulated with a single write, waiting at
+ * most @c latency_ms after the first line is queued.  This replaces a write
+ * and flush per transaction with one write per group of transactions.
+ */
+typedef struct core_audit_index_t core_audit_index_t;
+struct core_audit_index_t {
+    ib_engine_t     *ib;         /**< Engine, for error reporting. */
+    int              fd;         /**< Index file descriptor. */
+    ib_num_t         latency_ms; /**< Max delay; 0 to write immediately. */
+    bool             running;    /**< Flusher thread started? */
+    bool             stop;       /**< Flusher should exit once empty. */
+    int              error;      /**< errno of a failed write; 0 if none. */
+    pthread_t        thread;     /**< Flusher thread. */
+    pthread_mutex_t  mutex;      /**< Protects all below. */
+    pthread_cond_t   cond;       /**< Signals lines queued or stop. */
+    char            *buf;        /**< Queued lines. */
+    size_t           len;        /**< Length of queued lines. */
+    size_t           size;       /**< Allocated size of buf. */
+};
+
+/**
+ * Write all @a len bytes of @a buf to @a fd.
+ *
+ * @param[in] fd File descriptor.
+ * @param[in] buf Data to write.
+ * @param[in] len Length of @a buf.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EOTHER On write error; see errno.
+ */
+static ib_status_t core_audit_write_all(int fd, const char *buf, size_t len)
+{
+    while (len > 0) {
+        ssize_t written = write(fd, buf, len);
+
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return IB_EOTHER;
+        }
+        buf += written;
+        len -= written;
+    }
+
+    return IB_OK;
+}
+
+/**
+ * Write all @a iovcnt buffers of @a iov to @a fd.
+ *
+ * Issues as few writev() calls as IOV_MAX and partial writes allow.  The
+ * contents of @a iov are modified.
+ *
+ * @param[in] fd File descriptor.
+ * @param[in] iov Buffers to write.
+ * @param[in] iovcnt Number of buffers in @a iov.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EOTHER On write error; see errno.
+ */
+static ib_status_t core_audit_writev_all(int fd,
+                                         struct iovec *iov,
+                                         size_t iovcnt)
+{
+    while (iovcnt > 0) {
+        int n = (iovcnt > IOV_MAX) ? IOV_MAX : (int)iovcnt;
+        ssize_t written = writev(fd, iov, n);
+
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return IB_EOTHER;
+        }
+
+        /* Skip what was written. */
+        while (iovcnt > 0 && (size_t)written >= iov->iov_len) {
+            written -= iov->iov_len;
+            ++iov;
+            --iovcnt;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+
+    return IB_OK;
+}
+
+/**
+ * Flusher thread: write queued index lines in groups.
+ *
+ * @param[in] arg The core_audit_index_t.
+ *
+ * @returns NULL
+ */
+static void *core_audit_index_thread(void *arg)
+{
+    core_audit_index_t *queue = (core_audit_index_t *)arg;
+    char *out = NULL;
+    size_t out_size = 0;
+
+    pthread_mutex_lock(&queue->mutex);
+    for (;;) {
+        struct timespec deadline;
+        char *buf;
+        size_t size;
+        size_t len;
+
+        while (queue->len == 0 && ! queue->stop) {
+            pthread_cond_wait(&queue->cond, &queue->mutex);
+        }
+        if (queue->len == 0) {
+            break;
+        }
+
+        /* Give other transactions up to the latency to join this write. */
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += queue->latency_ms / 1000;
+        deadline.tv_nsec += (queue->latency_ms % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec += 1;
+            deadline.tv_nsec -= 1000000000;
+        }
+        while (! queue->stop && queue->len < CORE_AUDIT_INDEX_BATCH) {
+            if (pthread_cond_timedwait(&queue->cond, &queue->mutex,
+                                       &deadline) == ETIMEDOUT)
+            {
+                break;
+            }
+        }
+
+        /* Swap buffers so transactions can queue while this one is
+         * written. */
+        buf = queue->buf;
+        size = queue->size;
+        len = queue->len;
+        queue->buf = out;
+        queue->size = out_size;
+        queue->len = 0;
+        out = buf;
+        out_size = size;
+
+        pthread_mutex_unlock(&queue->mutex);
+        if (core_audit_write_all(queue->fd, out, len) != IB_OK) {
+            int sys_rc = errno;
+            ib_log_error(queue->ib,
+                         "Error writing to audit log index: %s (%d)",
+                         strerror(sys_rc), sys_rc);
+
+            /* Leave it to the next transaction to close and reopen the
+             * index; lines queued meanwhile are refused. */
+            pthread_mutex_lock(&queue->mutex);
+            queue->error = sys_rc;
+            queue->len = 0;
+            break;
+        }
+        pthread_mutex_lock(&queue->mutex);
+    }
+    pthread_mutex_unlock(&queue->mutex);
+
+    free(out);
+    return NULL;
+}
+
+/**
+ * Create an index queue writing to @a fd.
+ *
+ * @param[out] queue Created queue.
+ * @param[in] ib IronBee engine.
+ * @param[in] fd Index file descriptor.
+ * @param[in] latency_ms Maximum time lines are queued; 0 writes each line
+ *            as it is queued.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC On allocation failure.
+ * - IB_EOTHER If the flusher thread could not be started.
+ */
+static ib_status_t core_audit_index_create(core_audit_index_t **queue,
+                                           ib_engine_t *ib,
+                                           int fd,
+                                           ib_num_t latency_ms)
+{
+    core_audit_index_t *q;
+
+    q = (core_audit_index_t *)calloc(1, sizeof(*q));
+    if (q == NULL) {
+        return IB_EALLOC;
+    }
+
+    q->ib = ib;
+    q->fd = fd;
+    q->latency_ms = (latency_ms > 0) ? latency_ms : 0;
+    if (pthread_mutex_init(&q->mutex, NULL) != 0) {
+        free(q);
+        return IB_EALLOC;
+    }
+    if (pthread_cond_init(&q->cond, NULL) != 0) {
+        pthread_mutex_destroy(&q->mutex);
+        free(q);
+        return IB_EALLOC;
+    }
+
+    if (q->latency_ms > 0) {
+        if (pthread_create(&q->thread, NULL, core_audit_index_thread, q) != 0)
+        {
+            ib_log_error(ib,
+                         "Failed to start audit log index flusher; "
+                         "writing index lines immediately.");
+            q->latency_ms = 0;
+        }
+        else {
+            q->running = true;
+        }
+    }
+
+    *queue = q;
+    return IB_OK;
+}
+
+/**
+ * Queue @a len bytes of @a line for writing to the index.
+ *
+ * @param[in] queue Index queue.
+ * @param[in] line Line to write.
+ * @param[in] len Length of @a line.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC On allocation failure.
+ * - IB_EOTHER If the line or an earlier group of lines could not be
+ *   written; errno is set.
+ */
+static ib_status_t core_audit_index_queue(core_audit_index_t *queue,
+                                          const char *line,
+                                          size_t len)
+{
+    ib_status_t rc = IB_OK;
+
+    pthread_mutex_lock(&queue->mutex);
+
+    if (queue->error != 0) {
+        errno = queue->error;
+        pthread_mutex_unlock(&queue->mutex);
+        return IB_EOTHER;
+    }
+
+    if (! queue->running) {
+        rc = core_audit_write_all(queue->fd, line, len);
+        pthread_mutex_unlock(&queue->mutex);
+        return rc;
+    }
+
+    if (queue->len + len > queue->size) {
+        size_t size = (queue->size == 0) ? 4096 : queue->size;
+        char *buf;
+
+        while (size < queue->len + len) {
+            size *= 2;
+        }
+        buf = (char *)realloc(queue->buf, size);
+        if (buf == NULL) {
+            pthread_mutex_unlock(&queue->mutex);
+            return IB_EALLOC;
+        }
+        queue->buf = buf;
+        queue->size = size;
+    }
+
+    memcpy(queue->buf + queue->len, line, len);
+    queue->len += len;
+
+    /* Wake the flusher to start its wait, or early if the batch is full. */
+    if (queue->len == len || queue->len >= CORE_AUDIT_INDEX_BATCH) {
+        pthread_cond_signal(&queue->cond);
+    }
+
+    pthread_mutex_unlock(&queue->mutex);
+
+    return rc;
+}
+
+/**
+ * Write all queued lines and destroy @a queue.
+ *
+ * @param[in] queue Index queue to destroy.
+ */
+static void core_audit_index_destroy(core_audit_index_t *queue)
+{
+    if (queue->running) {
+        pthread_mutex_lock(&queue->mutex);
+        queue->stop = true;
+        pthread_cond_signal(&queue->cond);
+        pthread_mutex_unlock(&queue->mutex);
+        pthread_join(queue->thread, NULL);
+    }
+
+    pthread_cond_destroy(&queue->cond);
+    pthread_mutex_destroy(&queue->mutex);
+    free(queue->buf);
+    free(queue);
+}
+
+void core_audit_index_close(ib_auditlog_cfg_t *auditlog)
+{
+    assert(auditlog != NULL);
+
+    if (auditlog->index_queue != NULL) {
+        core_audit_index_destroy(auditlog->index_queue);
+        auditlog->index_queue = NULL;
+    }
+    if (auditlog->index_fp != NULL) {
+        fclose(auditlog->index_fp);
+        auditlog->index_fp = NULL;
+    }
+}
+
+/**
+ * Memory manager cleanup: close the index of an audit log configuration.
+ *
+ * @param[in] cbdata The ib_auditlog_cfg_t.
+ */
+static void core_audit_index_cleanup(void *cbdata)
+{
+    core_audit_index_close((ib_auditlog_cfg_t *)cbdata);
+}
+
+/**
+ * Buffer @a len bytes of @a data to be written to the audit log of @a log.
+ *
+ * @a data is referenced, not copied, and must remain valid until
+ * core_audit_close() is called.
+ *
+ * @param[in] log Audit log.
+ * @param[in] data Data to buffer.
+ * @param[in] len Length of @a data.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC On allocation failure.
+ */
+static ib_status_t core_audit_buffer(ib_auditlog_t *log,
+                                     const void *data,
+                                     size_t len)
+{
+    ib_core_audit_cfg_t *cfg = (ib_core_audit_cfg_t *)log->cfg_data;
+
+    if (len == 0) {
+        return IB_OK;
+    }
+
+    if (cfg->iov_count == cfg->iov_size) {
+        size_t size = (cfg->iov_size == 0) ? 32 : cfg->iov_size * 2;
+        struct iovec *iov;
+
+        iov = (struct iovec *)ib_mm_alloc(log->mm, size * sizeof(*iov));
+        if (iov == NULL) {
+            return IB_EALLOC;
+        }
+        if (cfg->iov_count > 0) {
+            memcpy(iov, cfg->iov, cfg->iov_count * sizeof(*iov));
+        }
+        cfg->iov = iov;
+        cfg->iov_size = size;
+    }
+
+    cfg->iov[cfg->iov_count].iov_base = (void *)data;
+    cfg->iov[cfg->iov_count].iov_len = len;
+    ++cfg->iov_count;
+
+    return IB_OK;
+}
+
+/**
+ * Format a string and buffer it to be written to the audit log of @a log.
+ *
+ * @param[in] log Audit log.
+ * @param[in] fmt Format string.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC On allocation failure.
+ * - IB_EINVAL On format error.
+ */
+static ib_status_t core_audit_buffer_printf(ib_auditlog_t *log,
+                                            const char *fmt, ...)
+    PRINTF_ATTRIBUTE(2, 3);
+
+static ib_status_t core_audit_buffer_printf(ib_auditlog_t *log,
+                                            const char *fmt, ...)
+{
+    va_list ap;
+    char *str;
+    int len;
+
+    va_start(ap, fmt);
+    len = vsnprintf(NULL, 0, fmt, ap);
+    va_end(ap);
+    if (len < 0) {
+        return IB_EINVAL;
+    }
+
+    str = (char *)ib_mm_alloc(log->mm, len + 1);
+    if (str == NULL) {
+        return IB_EALLOC;
+    }
+
+    va_start(ap, fmt);
+    vsnprintf(str, len + 1, fmt, ap);
+    va_end(ap);
+
+    return core_audit_buffer(log, str, len);
+}
+
 ib_status_t core_audit_open_auditfile(ib_engine_t *ib,
                                       ib_auditlog_t *log,
                                       ib_core_audit_cfg_t *cfg,
@@ -241,6 +676,13 @@ ib_status_t core_audit_open_auditindexfile(ib_engine_t *ib,
      * log->ctx->auditlog->index_fp at the bottom of this block. */
     ib_lock_lock(log->ctx->auditlog->index_fp_lock);
 
+    /* Another transaction may have opened it while we waited. */
+    if (log->ctx->auditlog->index_fp != NULL) {
+        cfg->index_fp = log->ctx->auditlog->index_fp;
+        ib_lock_unlock(log->ctx->auditlog->index_fp_lock);
+        return IB_OK;
+    }
+
     if (log->ctx->auditlog->index[0] == '/') {
         index_file_sz = strlen(log->ctx->auditlog->index) + 1;
 
@@ -376,6 +818,27 @@ ib_status_t core_audit_open_auditindexfile(ib_engine_t *ib,
         }
     }
 
+    /* Queue index lines to be written by a flusher. */
+    ib_rc = core_audit_index_create(&(log->ctx->auditlog->index_queue),
+                                    log->ib,
+                                    fileno(cfg->index_fp),
+                                    corecfg->auditlog_index_latency);
+    if (ib_rc == IB_OK && ! log->ctx->auditlog->index_cleanup) {
+        ib_rc = ib_mm_register_cleanup(log->ctx->auditlog->owner->mm,
+                                       core_audit_index_cleanup,
+                                       log->ctx->auditlog);
+        log->ctx->auditlog->index_cleanup = (ib_rc == IB_OK);
+    }
+    if (ib_rc != IB_OK) {
+        ib_log_error(log->ib, "Error creating audit log index queue: %s",
+                     ib_status_to_string(ib_rc));
+        log->ctx->auditlog->index_fp = cfg->index_fp;
+        core_audit_index_close(log->ctx->auditlog);
+        cfg->index_fp = NULL;
+        ib_lock_unlock(log->ctx->auditlog->index_fp_lock);
+        return ib_rc;
+    }
+
     log->ctx->auditlog->index_fp = cfg->index_fp;
     ib_lock_unlock(log->ctx->auditlog->index_fp_lock);
 
@@ -478,30 +941,22 @@ ib_status_t core_audit_write_header(ib_engine_t *ib,
                                     ib_auditlog_t *log)
 {
     ib_core_audit_cfg_t *cfg = (ib_core_audit_cfg_t *)log->cfg_data;
-    char header[256];
-    size_t hlen;
-    int ret = snprintf(header, sizeof(header),
-                       "MIME-Version: 1.0\r\n"
-                       "Content-Type: multipart/mixed; boundary=%s\r\n"
-                       "X-IronBee-AuditLog: type=multipart; version=%d\r\n"
-                       "\r\n"
-                       "This is a multi-part message in MIME format.\r\n"
-                       "\r\n",
-                       cfg->boundary,
-                       IB_AUDITLOG_VERSION);
-    if ((size_t)ret >= sizeof(header)) {
-        /* Did not fit in buffer.  Since this is currently a more-or-less
-         * fixed size, we abort here as this is a programming error.
-         */
-        abort();
-    }
+    ib_status_t rc;
 
-    hlen = strlen(header);
-    if (fwrite(header, hlen, 1, cfg->fp) != 1) {
+    rc = core_audit_buffer_printf(
+        log,
+        "MIME-Version: 1.0\r\n"
+        "Content-Type: multipart/mixed; boundary=%s\r\n"
+        "X-IronBee-AuditLog: type=multipart; version=%d\r\n"
+        "\r\n"
+        "This is a multi-part message in MIME format.\r\n"
+        "\r\n",
+        cfg->boundary,
+        IB_AUDITLOG_VERSION);
+    if (rc != IB_OK) {
         ib_log_error(ib,  "Failed to write audit log header.");
         return IB_EUNKNOWN;
     }
-    fflush(cfg->fp);
 
     return IB_OK;
 }
@@ -513,31 +968,34 @@ ib_status_t core_audit_write_part(ib_engine_t *ib,
     ib_core_audit_cfg_t *cfg = (ib_core_audit_cfg_t *)log->cfg_data;
     const uint8_t *chunk;
     size_t chunk_size;
+    ib_status_t rc;
 
     /* Write the MIME boundary and part header */
-    fprintf(cfg->fp,
-            "\r\n--%s"
-            "\r\nContent-Disposition: audit-log-part; name=\"%s\""
-            "\r\nContent-Transfer-Encoding: binary"
-            "\r\nContent-Type: %s"
-            "\r\n\r\n",
-            cfg->boundary,
-            part->name,
-            part->content_type);
+    rc = core_audit_buffer_printf(
+        log,
+        "\r\n--%s"
+        "\r\nContent-Disposition: audit-log-part; name=\"%s\""
+        "\r\nContent-Transfer-Encoding: binary"
+        "\r\nContent-Type: %s"
+        "\r\n\r\n",
+        cfg->boundary,
+        part->name,
+        part->content_type);
+    if (rc != IB_OK) {
+        ib_log_error(ib,  "Failed to write audit log part.");
+        return IB_EUNKNOWN;
+    }
 
     /* Write the part data. */
     while((chunk_size = part->fn_gen(part, &chunk)) != 0) {
-        if (fwrite(chunk, chunk_size, 1, cfg->fp) != 1) {
+        rc = core_audit_buffer(log, chunk, chunk_size);
+        if (rc != IB_OK) {
             ib_log_error(ib,  "Failed to write audit log part.");
-            fflush(cfg->fp);
             return IB_EUNKNOWN;
         }
         cfg->parts_written++;
     }
 
-    /* Finish the part. */
-    fflush(cfg->fp);
-
     return IB_OK;
 }
 
@@ -547,7 +1005,8 @@ ib_status_t core_audit_write_footer(ib_engine_t *ib,
     ib_core_audit_cfg_t *cfg = (ib_core_audit_cfg_t *)log->cfg_data;
 
     if (cfg->parts_written > 0) {
-        fprintf(cfg->fp, "\r\n--%s--\r\n", cfg->boundary);
+        return core_audit_buffer_printf(log, "\r\n--%s--\r\n",
+                                        cfg->boundary);
     }
 
     return IB_OK;
@@ -691,9 +1150,25 @@ ib_status_t core_audit_close(ib_engine_t *ib, ib_auditlog_t *log)
         goto cleanup;
     }
 
-    /* Close the audit log. */
+    /* Write the buffered audit log and close it. */
     if (cfg->fp != NULL) {
+        ib_rc = core_audit_writev_all(fileno(cfg->fp),
+                                      cfg->iov, cfg->iov_count);
+        if (ib_rc != IB_OK) {
+            sys_rc = errno;
+            ib_log_error(log->ib,
+                         "Error writing auditlog %s: %s (%d)",
+                         cfg->temp_path,
+                         strerror(sys_rc), sys_rc);
+        }
+        cfg->iov_count = 0;
         fclose(cfg->fp);
+        cfg->fp = NULL;
+        if (ib_rc != IB_OK) {
+            /* Neither publish nor index a partial audit log. */
+            unlink(cfg->temp_path);
+            goto cleanup;
+        }
         // Rename temp to real
         sys_rc = rename(cfg->temp_path, cfg->full_path);
         if (sys_rc != 0) {
@@ -705,15 +1180,10 @@ ib_status_t core_audit_close(ib_engine_t *ib, ib_auditlog_t *log)
             ib_rc = IB_EOTHER;
             goto cleanup;
         }
-        cfg->fp = NULL;
     }
 
-    /* Write to the index file if using one. */
+    /* Queue the index line if using an index file. */
     if ((cfg->index_fp != NULL) && (cfg->parts_written > 0)) {
-        size_t written;
-
-        ib_lock_lock(log->ctx->auditlog->index_fp_lock);
-
         ib_rc = core_audit_get_index_line(ib, log, line,
                                           LOGFORMAT_MAX_LINE_LENGTH,
                                           &len);
@@ -721,29 +1191,33 @@ ib_status_t core_audit_close(ib_engine_t *ib, ib_auditlog_t *log)
         line[len + 1] = '\0';
 
         if ( (ib_rc != IB_ETRUNC) && (ib_rc != IB_OK) ) {
-            ib_lock_unlock(log->ctx->auditlog->index_fp_lock);
             goto cleanup;
         }
+        ib_rc = IB_OK;
+
+        ib_lock_lock(log->ctx->auditlog->index_fp_lock);
 
-        written = fwrite(line, len, 1, cfg->index_fp);
+        if (log->ctx->auditlog->index_queue == NULL) {
+            ib_lock_unlock(log->ctx->auditlog->index_fp_lock);
+            goto cleanup;
+        }
 
-        if (written == 0) {
+        ib_rc = core_audit_index_queue(log->ctx->auditlog->index_queue,
+                                       line, len);
+        if (ib_rc != IB_OK) {
             sys_rc = errno;
             ib_log_error(log->ib,
                          "Error writing to audit log index: %s (%d)",
                          strerror(sys_rc), sys_rc);
 
             /// @todo Should retry (a piped logger may have died)
-            fclose(cfg->index_fp);
+            core_audit_index_close(log->ctx->auditlog);
             cfg->index_fp = NULL;
 
-            log->ctx->auditlog->index_fp = cfg->index_fp;
-
             ib_lock_unlock(log->ctx->auditlog->index_fp_lock);
             goto cleanup;
         }
 
-        fflush(cfg->index_fp);
         ib_lock_unlock(log->ctx->auditlog->index_fp_lock);
     }
 
@@ -25,6 +25,8 @@
 #ifndef _IB_CORE_AUDIT_PRIVATE_H_
 #define _IB_CORE_AUDIT_PRIVATE_H_
 
+#include "engine_private.h"
+
 #include <ironbee/core.h>
 
 #include <stdio.h>
@@ -65,6 +67,18 @@ ib_status_t core_audit_open_auditindexfile(ib_engine_t *ib,
                                            ib_core_audit_cfg_t *cfg,
                                            ib_core_cfg_t *corecfg);
 
+/**
+ * Flush pending index lines of @a auditlog and close its index file.
+ *
+ * Stops the background index flusher, if any, after it has written all
+ * queued lines.  The caller must hold @a auditlog's index_fp_lock or
+ * otherwise ensure no transaction is writing to the index.  Does nothing if
+ * the index is not open.
+ *
+ * @param[in] auditlog Audit log configuration owning the index.
+ */
+void core_audit_index_close(ib_auditlog_cfg_t *auditlog);
+
 /**
  * If required, open the log files.
  *
@@ -72,6 +86,11 @@ ib_status_t core_audit_open_auditindexfile(ib_engine_t *ib,
  * The other is the shared audit log index file. This index file is
  * protected by a lock during open and close calls but not writes.
  *
+ * Index lines are not written immediately, but are queued and written
+ * together by a background flusher at most
+ * ib_core_cfg_t::auditlog_index_latency milliseconds after being queued.
+ * If that latency is 0, each line is written as the audit log is closed.
+ *
  * This and core_audit_close are thread-safe.
  *
  * @param[in] ib IronBee engine.
@@ -85,8 +104,12 @@ ib_status_t core_audit_open(ib_engine_t *ib,
                             ib_auditlog_t *log);
 
 /**
- * Write audit log header. This is not thread-safe and should be protected
- * with a lock.
+ * Write audit log header.
+ *
+ * The header, like all parts and the footer, is buffered in memory and
+ * written to the audit log file with a single vectored write by
+ * core_audit_close().  Buffered data is referenced rather than copied, so
+ * chunks returned by part generators must remain valid until then.
  *
  * @param[in] ib IronBee engine.
  * @param[in] log The log record.
@@ -96,7 +119,7 @@ ib_status_t core_audit_write_header(ib_engine_t *ib,
                                     ib_auditlog_t *log);
 
 /**
- * Write part of a audit log. This call should be protected by a lock.
+ * Write part of a audit log.
  *
  * @param[in] ib IronBee engine.
  * @param[in] part The log record.
@@ -106,7 +129,7 @@ ib_status_t core_audit_write_part(ib_engine_t *ib,
                                   ib_auditlog_part_t *part);
 
 /**
- * Write an audit log footer. This call should be protected by a lock.
+ * Write an audit log footer.
  *
  * @param[in] ib IronBee engine.
  * @param[in] log The log record.
@@ -116,13 +139,17 @@ ib_status_t core_audit_write_footer(ib_engine_t *ib,
                                     ib_auditlog_t *log);
 
 /**
- * Close the audit log file and write to the index file.
+ * Write the buffered audit log, close it and queue its index line.
+ *
+ * If the audit log cannot be written, its temporary file is removed and
+ * no index line is queued.
  *
  * @param[in] ib IronBee engine.
  * @param[in] log The audit log we've just written to a file.
  *
  * @returns
  * - IB_OK On success.
+ * - IB_EOTHER If the audit log cannot be written or renamed.
  * - Other on failure.
  */
 ib_status_t core_audit_close(ib_engine_t *ib, ib_auditlog_t *log);
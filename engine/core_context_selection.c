@@ -41,6 +41,7 @@
 #include <ironbee/util.h>
 
 #include <assert.h>
+#include <ctype.h>
 #include <inttypes.h>
 #include <strings.h>
 #include <unistd.h>
@@ -67,6 +68,12 @@
  *    allows the selection to avoid looking at the other fields in the
  *    structure.
  *
+ * 4. At finalize time the selectors are compiled into character tries (see
+ *    core_selector_index_t): hostnames are indexed reversed and lowercased so
+ *    that wildcard suffixes become prefixes, and each site's location paths
+ *    are indexed by prefix.  Every indexed value carries its list ordinal, so
+ *    the selection still picks the first match in configuration order.
+ *
  * Note that the code does not enforce that the last item in the lists be
  * a default; it is possible to create a configuration without a default site,
  * or with a default site in the middle of the list, or a default service /
@@ -74,12 +81,24 @@
  * do that.  If you do, the site selection will not do what you expect.
  */
 
+/** Character trie node used by the compiled site selector */
+typedef struct core_trie_node_t core_trie_node_t;
+struct core_trie_node_t {
+    core_trie_node_t      *child;        /**< First child node */
+    core_trie_node_t      *sibling;      /**< Next sibling node */
+    ib_list_t             *prefix;       /**< Values matching keys through here */
+    ib_list_t             *exact;        /**< Values matching keys ending here */
+    unsigned char          c;            /**< Character leading to this node */
+};
+
 /** Core context selection site structure */
 typedef struct core_site_t {
     ib_site_t              site;         /**< Site data */
     ib_list_t             *hosts;        /**< List of core_host_t* */
     ib_list_t             *services;     /**< List of core_service_t* */
     ib_list_t             *locations;    /**< List of core_location_t* */
+    core_trie_node_t      *location_trie;/**< Compiled location paths */
+    const struct core_location_t *location_any; /**< First 'match any' */
 } core_site_t;
 
 /** Core context selection host name entity */
@@ -101,6 +120,7 @@ typedef struct core_service_t {
 typedef struct core_location_t {
     ib_site_location_t     location;     /**< Site location data */
     size_t                 path_len;     /**< Length of path string */
+    size_t                 index;        /**< Position in the site's list */
     bool                   match_any;    /** Is this a 'match any' location? */
 } core_location_t;
 
@@ -110,8 +130,27 @@ typedef struct core_site_selector_t {
     const core_service_t  *service;      /**< Service (IP/Port) */
     const ib_list_t       *hosts;        /**< List of core_host_t* */
     const ib_list_t       *locations;    /**< List of core_location_t* */
+    size_t                 index;        /**< Position in the selector list */
 } core_site_selector_t;
 
+/**
+ * Compiled site selector index
+ *
+ * Selectors are partitioned by how their hosts can match.  Selectors without
+ * a host list match any transaction; selectors with a 'match any' host match
+ * any transaction that has a hostname; all others are found by walking the
+ * reversed, lowercased transaction hostname through @a host_trie, collecting
+ * the @a prefix lists (wildcard suffixes) along the way and the @a exact list
+ * (full hostnames) at the end.  All lists are in selector order.
+ */
+struct core_selector_index_t {
+    ib_mm_t                mm;           /**< Memory manager for the index */
+    core_trie_node_t      *host_trie;    /**< Reversed hostname trie */
+    ib_list_t             *any_host;     /**< Selectors with a '*' host */
+    ib_list_t             *all_hosts;    /**< Selectors without hosts */
+};
+typedef struct core_selector_index_t core_selector_index_t;
+
 
 /**
  * Find the first 'match any' location for the given site
@@ -142,140 +181,378 @@ static const core_location_t *core_ctxsel_matchany_location(
 }
 
 /**
- * Check for a matching host within a host list
+ * Create a trie node
  *
- * This function takes a list of hosts, and attempts to find the first
- * host that matches the transaction.  This function is intended to aid in
- * the development of context selection functions, but it's use is optional.
- * It is used by the core site selector.
+ * @param[in] mm Memory manager
+ * @param[in] c Character leading to the node
  *
- * @param[in] ib IronBee engine
+ * @returns New node or NULL on allocation failure
+ */
+static core_trie_node_t *core_trie_node_create(
+    ib_mm_t       mm,
+    unsigned char c)
+{
+    core_trie_node_t *node;
+
+    node = ib_mm_calloc(mm, sizeof(*node), 1);
+    if (node != NULL) {
+        node->c = c;
+    }
+    return node;
+}
+
+/**
+ * Find the child of @a node reached by @a c
+ *
+ * @param[in] node Parent node
+ * @param[in] c Character
+ *
+ * @returns Child node or NULL
+ */
+static const core_trie_node_t *core_trie_child(
+    const core_trie_node_t *node,
+    unsigned char           c)
+{
+    const core_trie_node_t *child;
+
+    for (child = node->child; child != NULL; child = child->sibling) {
+        if (child->c == c) {
+            return child;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Add a value to the trie
+ *
+ * The key is walked from its last character to its first if @a reverse is
+ * set, and is lowercased if @a nocase is set.
+ *
+ * @param[in] mm Memory manager
+ * @param[in] root Root node
+ * @param[in] key Key to add
+ * @param[in] len Length of @a key
+ * @param[in] reverse Walk the key backwards?
+ * @param[in] nocase Lowercase the key?
+ * @param[in] exact Add to the exact list (else the prefix list)
+ * @param[in] value Value to add
+ *
+ * @returns IB_OK, IB_EALLOC or errors from ib_list_create() / ib_list_push()
+ */
+static ib_status_t core_trie_add(
+    ib_mm_t           mm,
+    core_trie_node_t *root,
+    const char       *key,
+    size_t            len,
+    bool              reverse,
+    bool              nocase,
+    bool              exact,
+    void             *value)
+{
+    assert(root != NULL);
+    assert(key != NULL || len == 0);
+
+    core_trie_node_t *node = root;
+    ib_list_t **plist;
+    ib_status_t rc;
+    size_t n;
+
+    for (n = 0; n < len; ++n) {
+        unsigned char c =
+            (unsigned char)key[reverse ? (len - n - 1) : n];
+        core_trie_node_t *child;
+
+        if (nocase) {
+            c = (unsigned char)tolower(c);
+        }
+        child = (core_trie_node_t *)core_trie_child(node, c);
+        if (child == NULL) {
+            child = core_trie_node_create(mm, c);
+            if (child == NULL) {
+                return IB_EALLOC;
+            }
+            child->sibling = node->child;
+            node->child = child;
+        }
+        node = child;
+    }
+
+    plist = exact ? &(node->exact) : &(node->prefix);
+    if (*plist == NULL) {
+        rc = ib_list_create(plist, mm);
+        if (rc != IB_OK) {
+            return rc;
+        }
+    }
+    return ib_list_push(*plist, value);
+}
+
+/**
+ * Check if a service matches the connection
+ *
+ * @param[in] conn Connection
+ * @param[in] ip_len Length of the connection's local IP string
+ * @param[in] service Service to check (can be NULL)
+ *
+ * @returns true if the service matches
+ */
+static bool core_ctxsel_match_service(
+    const ib_conn_t      *conn,
+    size_t                ip_len,
+    const core_service_t *service)
+{
+    if ( (service == NULL) || service->match_any ) {
+        return true;
+    }
+
+    /* Check that the port matches the service (if specified) */
+    if ( (service->service.port >= 0) &&
+         (service->service.port != conn->local_port) ) {
+        return false;
+    }
+    /* Check that the address matches the service (if specified) */
+    if ( (service->service.ipstr != NULL) &&
+         (service->ip_len == ip_len) &&
+         (strcmp(service->service.ipstr, conn->local_ipstr) != 0) )
+    {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Find the first location of a site that matches the transaction path
+ *
+ * The compiled location trie is walked along the transaction path; of all
+ * the locations found (plus the first 'match any' location), the one that
+ * appears first in the site's location list is returned.
+ *
+ * @param[in] site Site
  * @param[in] tx Transaction to match
- * @param[in] hosts List of ib_core_host_t
- * @param[out] match true if a match was found, else false
  *
- * @returns IB_OK
+ * @returns Matched location or NULL
  */
-static ib_status_t core_ctxsel_match_host(
-    const ib_engine_t *ib,
-    const ib_tx_t *tx,
-    const ib_list_t *hosts,
-    bool *match)
+static const core_location_t *core_ctxsel_match_location(
+    const core_site_t *site,
+    const ib_tx_t     *tx)
 {
-    assert(ib != NULL);
+    assert(site != NULL);
     assert(tx != NULL);
-    assert(match != NULL);
 
+    const core_location_t *best = site->location_any;
+    const core_trie_node_t *node = site->location_trie;
+    const char *path = tx->path;
+
+    while (node != NULL) {
+        if (node->prefix != NULL) {
+            const core_location_t *location = (const core_location_t *)
+                ib_list_node_data_const(ib_list_first_const(node->prefix));
+            if ( (best == NULL) || (location->index < best->index) ) {
+                best = location;
+            }
+        }
+        if ( (path == NULL) || (*path == '\0') ) {
+            break;
+        }
+        node = core_trie_child(node, (unsigned char)*path);
+        ++path;
+    }
+
+    return best;
+}
+
+/**
+ * Scan a candidate selector list for a better match
+ *
+ * Lists are in selector order, so the scan stops at the first selector that
+ * either matches or comes after the current best match.
+ *
+ * @param[in] conn Connection
+ * @param[in] tx Transaction
+ * @param[in] ip_len Length of the connection's local IP string
+ * @param[in] candidates List of core_site_selector_t*
+ * @param[in,out] best Best selector so far (or NULL)
+ * @param[in,out] best_location Location of @a best
+ */
+static void core_ctxsel_scan_candidates(
+    const ib_conn_t              *conn,
+    const ib_tx_t                *tx,
+    size_t                        ip_len,
+    const ib_list_t              *candidates,
+    const core_site_selector_t  **best,
+    const core_location_t       **best_location)
+{
     const ib_list_node_t *node;
-    size_t len;
 
-    /* If no hosts in the list, we have an automatic match */
-    if (hosts == NULL) {
-        *match = true;
+    IB_LIST_LOOP_CONST(candidates, node) {
+        const core_site_selector_t *selector =
+            (const core_site_selector_t *)ib_list_node_data_const(node);
+        const core_location_t *location;
+
+        if ( (*best != NULL) && (selector->index >= (*best)->index) ) {
+            return;
+        }
+        if (! core_ctxsel_match_service(conn, ip_len, selector->service)) {
+            continue;
+        }
+        location = core_ctxsel_match_location(selector->site, tx);
+        if (location == NULL) {
+            continue;
+        }
+        *best = selector;
+        *best_location = location;
+        return;
+    }
+}
+
+/**
+ * Compile a site's locations into its location trie
+ *
+ * @param[in] mm Memory manager
+ * @param[in,out] site Site
+ *
+ * @returns IB_OK or errors from core_trie_add()
+ */
+static ib_status_t core_ctxsel_compile_locations(
+    ib_mm_t      mm,
+    core_site_t *site)
+{
+    const ib_list_node_t *node;
+    ib_status_t rc;
+
+    site->location_any = NULL;
+    site->location_trie = core_trie_node_create(mm, '\0');
+    if (site->location_trie == NULL) {
+        return IB_EALLOC;
+    }
+    if (site->locations == NULL) {
         return IB_OK;
     }
 
-    /* Now, loop through the list of hostnames */
-    if (tx->hostname != NULL) {
-        len = strlen(tx->hostname);
-        IB_LIST_LOOP_CONST(hosts, node) {
-            const core_host_t *core_host =
-                (const core_host_t *)ib_list_node_data_const(node);
-            const ib_site_host_t *host = &(core_host->host);
-
-            /* If this is a "match any" host entry? */
-            if (core_host->match_any) {
-                ib_log_debug2_tx(tx, "Host %s matched wildcard.",
-                                 tx->hostname);
-                *match = true;
-                return IB_OK;
-            }
+    IB_LIST_LOOP_CONST(site->locations, node) {
+        core_location_t *location =
+            (core_location_t *)ib_list_node_data_const(node);
 
-            /* Check the suffix */
-            if ( (host->suffix != NULL) && (len >= core_host->suffix_len) ) {
-                ib_log_debug2_tx(tx, "Host %s matched suffix: %s",
-                                 tx->hostname, host->suffix);
-                const char *suffix = tx->hostname + len - core_host->suffix_len;
-                if (strcasecmp(host->suffix, suffix) == 0) {
-                    *match = true;
-                    return IB_OK;
-                }
+        if (location->match_any) {
+            if (site->location_any == NULL) {
+                site->location_any = location;
             }
+            continue;
+        }
+        rc = core_trie_add(mm, site->location_trie,
+                           location->location.path, location->path_len,
+                           false, false, false, location);
+        if (rc != IB_OK) {
+            return rc;
+        }
+    }
+
+    return IB_OK;
+}
 
-            /* Finally, do a full hostname match */
-            if ( (core_host->hostname_len == len) &&
-                 (strcasecmp(host->hostname, tx->hostname) == 0) )
-            {
-                ib_log_debug2_tx(tx, "Host %s matched full hostname: %s",
-                                 tx->hostname, host->hostname);
-                *match = true;
-                return IB_OK;
+/**
+ * Add a selector to the compiled selector index
+ *
+ * @param[in,out] index Selector index
+ * @param[in] selector Selector to add
+ *
+ * @returns IB_OK or errors from core_trie_add() / ib_list_push()
+ */
+static ib_status_t core_ctxsel_index_add(
+    core_selector_index_t *index,
+    core_site_selector_t  *selector)
+{
+    const ib_list_node_t *node;
+    ib_status_t rc;
+
+    if (selector->hosts == NULL) {
+        return ib_list_push(index->all_hosts, selector);
+    }
+
+    IB_LIST_LOOP_CONST(selector->hosts, node) {
+        const core_host_t *host =
+            (const core_host_t *)ib_list_node_data_const(node);
+
+        if (host->match_any) {
+            rc = ib_list_push(index->any_host, selector);
+            if (rc != IB_OK) {
+                return rc;
             }
+            continue;
+        }
+        if (host->host.suffix != NULL) {
+            rc = core_trie_add(index->mm, index->host_trie,
+                               host->host.suffix, host->suffix_len,
+                               true, true, false, selector);
+            if (rc != IB_OK) {
+                return rc;
+            }
+        }
+        rc = core_trie_add(index->mm, index->host_trie,
+                           host->host.hostname, host->hostname_len,
+                           true, true, true, selector);
+        if (rc != IB_OK) {
+            return rc;
         }
     }
 
-    /* No matches */
-    *match = false;
     return IB_OK;
 }
 
 /**
- * Check for a matching location within a location list
- *
- * This function takes a list of locations, and attempts to find the first
- * location that matches the transaction.  This function is intended to aid in
- * the development of context selection functions, but it's use is optional.
- * It is used by the core site selector.
+ * Compile the site selector list into a selector index
  *
  * @param[in] ib IronBee engine
- * @param[in] tx Transaction to match
- * @param[in] locations List of ib_ctxsel_location_t
- * @param[out] match Pointer to matched location (or NULL)
+ * @param[in,out] core_data Core module data
  *
- * @returns IB_OK
+ * @returns IB_OK, IB_EALLOC or errors from the functions above
  */
-static ib_status_t core_ctxsel_match_location(
-    const ib_engine_t *ib,
-    const ib_tx_t *tx,
-    const ib_list_t *locations,
-    const core_location_t **match)
+static ib_status_t core_ctxsel_compile(
+    const ib_engine_t     *ib,
+    ib_core_module_data_t *core_data)
 {
-    assert(ib != NULL);
-    assert(tx != NULL);
-    assert(locations != NULL);
-    assert(match != NULL);
-
+    ib_mm_t mm = ib_engine_mm_main_get(ib);
+    core_selector_index_t *index;
     const ib_list_node_t *node;
-    size_t len;
+    ib_status_t rc;
 
-    /* Now, loop through the list of locations */
-    len = strlen(tx->path);
-    IB_LIST_LOOP_CONST(locations, node) {
-        const core_location_t *core_location =
-            (const core_location_t *)ib_list_node_data_const(node);
-        const ib_site_location_t *location = &(core_location->location);
-
-        /* Is this a "match any" location? */
-        if (core_location->match_any) {
-            ib_log_debug2_tx(tx, "Location %s matched root.",
-                             tx->path);
-            *match = core_location;
-            return IB_OK;
+    index = ib_mm_calloc(mm, sizeof(*index), 1);
+    if (index == NULL) {
+        return IB_EALLOC;
+    }
+    index->mm = mm;
+    index->host_trie = core_trie_node_create(mm, '\0');
+    if (index->host_trie == NULL) {
+        return IB_EALLOC;
+    }
+    rc = ib_list_create(&(index->any_host), mm);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    rc = ib_list_create(&(index->all_hosts), mm);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    IB_LIST_LOOP_CONST(core_data->site_list, node) {
+        core_site_t *site = (core_site_t *)ib_list_node_data_const(node);
+        rc = core_ctxsel_compile_locations(mm, site);
+        if (rc != IB_OK) {
+            return rc;
         }
+    }
 
-        /* Check the path */
-        if ( (core_location->path_len <= len) &&
-             (strncmp(location->path, tx->path, core_location->path_len) == 0) )
-        {
-            ib_log_debug2_tx(tx, "Location %s matched: %s",
-                             tx->path, location->path);
-            *match = core_location;
-            return IB_OK;
+    IB_LIST_LOOP_CONST(core_data->selector_list, node) {
+        core_site_selector_t *selector =
+            (core_site_selector_t *)ib_list_node_data_const(node);
+        rc = core_ctxsel_index_add(index, selector);
+        if (rc != IB_OK) {
+            return rc;
         }
     }
 
-    /* No matches */
-    *match = NULL;
+    core_data->selector_index = index;
     return IB_OK;
 }
 
@@ -310,6 +587,7 @@ static ib_status_t core_create_site_selector(
     object->hosts = site->hosts;
     object->locations = site->locations;
     object->site = site;
+    object->index = ib_list_elements(core_data->selector_list);
 
     /* Add it to the site selector list */
     rc = ib_list_push(core_data->selector_list, object);
@@ -408,6 +686,14 @@ static ib_status_t core_ctxsel_finalize(
         }
     }
 
+    /* Compile the selectors into the selector index */
+    rc = core_ctxsel_compile(ib, core_data);
+    if (rc != IB_OK) {
+        ib_log_error(ib, "Error compiling core site selector index: %s",
+                     ib_status_to_string(rc));
+        return rc;
+    }
+
     return IB_OK;
 }
 
@@ -436,9 +722,14 @@ static ib_status_t core_ctxsel_select(
     assert(common_cb_data != NULL);
     assert(pctx != NULL);
 
-    const ib_list_node_t *node;
+    const core_site_selector_t *selector = NULL;
+    const core_location_t *location = NULL;
+    const core_trie_node_t *trie;
+    const core_site_t *site;
+    const core_selector_index_t *index;
+    ib_context_t *ctx;
     size_t ip_len;
-    ib_status_t rc;
+    size_t n;
     ib_core_module_data_t *core_data = (ib_core_module_data_t *)common_cb_data;
 
     /* Verify that we're the current selector */
@@ -446,7 +737,8 @@ static ib_status_t core_ctxsel_select(
         return IB_EINVAL;
     }
 
-    if (core_data->selector_list == NULL) {
+    index = core_data->selector_index;
+    if ( (core_data->selector_list == NULL) || (index == NULL) ) {
         ib_log_notice(ib, "No site selection list: Using main context");
         goto select_main_context;
     }
@@ -460,64 +752,41 @@ static ib_status_t core_ctxsel_select(
     ip_len = strlen(conn->local_ipstr);
 
     /*
-     * Walk through the list of site selectors, return when the first matching
-     * selector is found.  At any point in the loop if a non-match is found,
-     * we continue to the top of the loop, and try the next selector.
+     * Scan the candidate selector lists for the first selector (in
+     * configuration order) that matches the connection's service and has a
+     * matching location.  Selectors without hosts always apply; host-based
+     * selectors only apply if the transaction has a hostname, in which case
+     * the reversed hostname is walked through the host trie.
      */
-    IB_LIST_LOOP_CONST(core_data->selector_list, node) {
-        const core_site_selector_t *selector =
-            (const core_site_selector_t *)ib_list_node_data_const(node);
-        const core_service_t *service = selector->service;
-        const core_site_t *site = selector->site;
-        const core_location_t *location;
-        ib_context_t *ctx;
-        bool match;
-
-        ib_log_debug2(ib, "Looking for matching context against site=%s(%s)",
-                      (site ? site->site.id : "none"),
-                      (site ? site->site.name : "none"));
-
-        /*
-         * Check if the service matches the connection data.
-         */
-        if ( (service != NULL) && (! service->match_any) ) {
-            /* Check that the port matches the service (if specified) */
-            if ( (service->service.port >= 0) &&
-                 (service->service.port != conn->local_port) ) {
-                continue;
+    core_ctxsel_scan_candidates(conn, tx, ip_len, index->all_hosts,
+                                &selector, &location);
+    if (tx->hostname != NULL) {
+        const char *hostname = tx->hostname;
+        size_t len = strlen(hostname);
+
+        core_ctxsel_scan_candidates(conn, tx, ip_len, index->any_host,
+                                    &selector, &location);
+        trie = index->host_trie;
+        for (n = 0; trie != NULL; ++n) {
+            if (trie->prefix != NULL) {
+                core_ctxsel_scan_candidates(conn, tx, ip_len, trie->prefix,
+                                            &selector, &location);
             }
-            /* Check that the address matches the service (if specified) */
-            if ( (service->service.ipstr != NULL) &&
-                 (service->ip_len == ip_len) &&
-                 (strcmp(service->service.ipstr, conn->local_ipstr) != 0) )
-            {
-                continue;
+            if (n == len) {
+                if (trie->exact != NULL) {
+                    core_ctxsel_scan_candidates(conn, tx, ip_len, trie->exact,
+                                                &selector, &location);
+                }
+                break;
             }
+            trie = core_trie_child(
+                trie,
+                (unsigned char)tolower((unsigned char)hostname[len - n - 1]));
         }
-        ib_log_debug2(ib, "Connection %s:%d matched context service.",
-                      conn->local_ipstr, conn->local_port);
-
-        /* Check if the hostname matches the transaction data. */
-        rc = core_ctxsel_match_host(ib, tx, selector->hosts, &match);
-        if (rc != IB_OK) {
-            /* todo: What is the right thing to do here? */
-            continue;
-        }
-        if (! match) {
-            continue;
-        }
-
-        /* Check if the location matches the transaction data. */
-        rc = core_ctxsel_match_location(ib, tx, selector->locations, &location);
-        if (rc != IB_OK) {
-            /* todo: What is the right thing to do here? */
-            continue;
-        }
-        if (location == NULL) {
-            continue;
-        }
+    }
 
-        /* Everything matches.  Use this selector's context. */
+    if (selector != NULL) {
+        site = selector->site;
         ctx = location->location.context;
 
         ib_log_debug2(ib, "Selected context \"%s\" site=%s(%s) location=%s",
@@ -656,6 +925,7 @@ static ib_status_t core_ctxsel_location_create(
 
     /* Fill in the context selection specific parts */
     core_location->path_len = strlen(location_str);
+    core_location->index = ib_list_elements(core_site->locations);
     core_location->match_any = (strcmp(location_str, "/") == 0);
 
     /* And, add it to the locations list */
@@ -45,6 +45,7 @@ typedef struct {
 typedef struct {
     ib_list_t            *site_list;      /**< List: ib_site_t */
     ib_list_t            *selector_list;  /**< List: core_site_selector_t */
+    struct core_selector_index_t *selector_index; /**< Compiled selectors */
     ib_context_t         *cur_ctx;        /**< Current context */
     ib_site_t            *cur_site;       /**< Current site */
     ib_site_location_t   *cur_location;   /**< Current location */
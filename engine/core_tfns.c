@@ -36,6 +36,7 @@
 #include <ironbee/path.h>
 #include <ironbee/string.h>
 #include <ironbee/string_lower.h>
+#include <ironbee/string_scan.h>
 #include <ironbee/string_trim.h>
 #include <ironbee/string_whitespace.h>
 #include <ironbee/transformation.h>
@@ -45,6 +46,7 @@
 #include <assert.h>
 #include <ctype.h>
 #include <math.h>
+#include <string.h>
 
 /**
  * Function adapter for many string functions.
@@ -58,6 +60,9 @@ typedef ib_status_t (*ib_strmod_fn_t)(
 /**
  * String modification transformation core
  *
+ * If @a fn returns its input unchanged, @a fin itself is the output and
+ * nothing is allocated.
+ *
  * @param[in] mm Memory manager to use for allocations.
  * @param[in] fn Transformation function
  * @param[in] fin Input field.
@@ -116,6 +121,10 @@ static ib_status_t tfn_strmod(
         if (rc != IB_OK) {
             return rc;
         }
+        if (dout == din && dlen == ib_bytestr_length(bs)) {
+            *fout = fin;
+            return IB_OK;
+        }
         rc = ib_field_create_bytestr_alias(&fnew, mm,
                                            fin->name, fin->nlen,
                                            dout, dlen);
@@ -133,6 +142,29 @@ static ib_status_t tfn_strmod(
     return IB_OK;
 }
 
+/**
+ * Does @a data contain two adjacent whitespace characters?
+ *
+ * @param[in] data Data.
+ * @param[in] dlen Length of @a data.
+ *
+ * @returns true if ib_str_whitespace_compress() would change @a data.
+ */
+static bool has_whitespace_run(const uint8_t *data, size_t dlen)
+{
+    size_t i = ib_str_scan_space(data, dlen);
+
+    while (i + 1 < dlen) {
+        if (isspace(data[i + 1])) {
+            return true;
+        }
+        i += 2;
+        i += ib_str_scan_space(data + i, dlen - i);
+    }
+
+    return false;
+}
+
 /** Adapt ib_strlower() to ib_strmod_fn_t(). */
 static ib_status_t adapt_lower(
     ib_mm_t mm,
@@ -140,6 +172,12 @@ static ib_status_t adapt_lower(
     const uint8_t **data_out, size_t *dlen_out
 )
 {
+    if (ib_str_scan_upper(data_in, dlen_in) == dlen_in) {
+        *data_out = data_in;
+        *dlen_out = dlen_in;
+        return IB_OK;
+    }
+
     uint8_t *out;
     ib_status_t rc = ib_strlower(mm, data_in, dlen_in, &out);
     if (rc == IB_OK) {
@@ -188,6 +226,12 @@ static ib_status_t adapt_whitespace_remove(
     const uint8_t **data_out, size_t *dlen_out
 )
 {
+    if (ib_str_scan_space(data_in, dlen_in) == dlen_in) {
+        *data_out = data_in;
+        *dlen_out = dlen_in;
+        return IB_OK;
+    }
+
     uint8_t *out = NULL;
     ib_status_t rc;
     rc = ib_str_whitespace_remove(mm, data_in, dlen_in, &out, dlen_out);
@@ -203,6 +247,12 @@ static ib_status_t adapt_whitespace_compress(
     const uint8_t **data_out, size_t *dlen_out
 )
 {
+    if (! has_whitespace_run(data_in, dlen_in)) {
+        *data_out = data_in;
+        *dlen_out = dlen_in;
+        return IB_OK;
+    }
+
     uint8_t *out = NULL;
     ib_status_t rc;
     rc = ib_str_whitespace_compress(mm, data_in, dlen_in, &out, dlen_out);
@@ -777,6 +827,7 @@ static ib_status_t tfn_url_decode(
         const uint8_t      *din;
         uint8_t            *dout;
         size_t              dlen;
+        size_t              first;
 
         rc = ib_field_value(fin, ib_ftype_bytestr_out(&bs));
         if (rc != IB_OK) {
@@ -793,20 +844,28 @@ static ib_status_t tfn_url_decode(
             *fout = fin;
             return IB_OK;
         }
+        if (din == NULL) {
+            return IB_EINVAL;
+        }
+
+        /* Nothing to decode before the first '%' or '+'. */
+        first = ib_str_scan_bytes(din, dlen, '%', '+');
+        if (first == dlen) {
+            *fout = fin;
+            return IB_OK;
+        }
 
         dout = ib_mm_alloc(mm, dlen + 1);
         if (dout == NULL) {
             return IB_EALLOC;
         }
-        if (din == NULL && dlen > 0) {
-            return IB_EINVAL;
-        }
-        if (din != NULL) {
-            rc = ib_util_decode_url(din, dlen, dout, &dlen);
-            if (rc != IB_OK) {
-                return rc;
-            }
+        memcpy(dout, din, first);
+        rc = ib_util_decode_url(din + first, dlen - first,
+                                dout + first, &dlen);
+        if (rc != IB_OK) {
+            return rc;
         }
+        dlen += first;
         rc = ib_field_create_bytestr_alias(&fnew, mm,
                                            fin->name, fin->nlen,
                                            dout, dlen);
@@ -859,6 +918,7 @@ static ib_status_t tfn_html_entity_decode(
         const uint8_t      *din;
         uint8_t            *dout;
         size_t              dlen;
+        size_t              first;
 
         rc = ib_field_value(fin, ib_ftype_bytestr_out(&bs));
         if (rc != IB_OK) {
@@ -879,15 +939,24 @@ static ib_status_t tfn_html_entity_decode(
             return IB_EINVAL;
         }
 
+        /* Entities start with '&'; there is nothing to decode before it. */
+        first = ib_str_scan_bytes(din, dlen, '&', '&');
+        if (first == dlen) {
+            *fout = fin;
+            return IB_OK;
+        }
+
         dout = ib_mm_alloc(mm, dlen);
         if (dout == NULL) {
             return IB_EALLOC;
         }
-
-        rc = ib_util_decode_html_entity(din, dlen, dout, &dlen);
+        memcpy(dout, din, first);
+        rc = ib_util_decode_html_entity(din + first, dlen - first,
+                                        dout + first, &dlen);
         if (rc != IB_OK) {
             return rc;
         }
+        dlen += first;
         rc = ib_field_create_bytestr_alias(&fnew, mm,
                                            fin->name, fin->nlen,
                                            dout, dlen);
@@ -1595,6 +1664,258 @@ static ib_status_t tfn_first(
     return rc;
 }
 
+/**
+ * Signature of the substring functions in string_trim.h.
+ */
+typedef ib_status_t (*substr_fn_t)(
+    const uint8_t  *data_in,  size_t  dlen_in,
+    const uint8_t **data_out, size_t *dlen_out
+);
+
+/**
+ * Fuse function core of the trim transformations.
+ *
+ * @param[in] fn Substring function.
+ * @param[in] data_in Input data.
+ * @param[in] dlen_in Length of @a data_in.
+ * @param[out] data_out Output buffer or NULL.
+ * @param[out] dlen_out Length of @a data_out.
+ *
+ * @returns IB_OK if trimmed, IB_DECLINED if not.
+ */
+static ib_status_t fuse_substr(
+    substr_fn_t     fn,
+    const uint8_t  *data_in,  size_t  dlen_in,
+    uint8_t        *data_out, size_t *dlen_out
+)
+{
+    const uint8_t *sub;
+    size_t         sub_len;
+    ib_status_t    rc;
+
+    rc = fn(data_in, dlen_in, &sub, &sub_len);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    if (sub == data_in && sub_len == dlen_in) {
+        return IB_DECLINED;
+    }
+    if (data_out != NULL) {
+        memmove(data_out, sub, sub_len);
+        *dlen_out = sub_len;
+    }
+
+    return IB_OK;
+}
+
+/** Fuse function of lowercase. */
+static ib_status_t fuse_lowercase(
+    const uint8_t  *data_in,  size_t  dlen_in,
+    uint8_t        *data_out, size_t *dlen_out,
+    void           *instdata,
+    void           *cbdata
+)
+{
+    size_t first = ib_str_scan_upper(data_in, dlen_in);
+
+    if (first == dlen_in) {
+        return IB_DECLINED;
+    }
+    if (data_out != NULL) {
+        if (data_out != data_in) {
+            memcpy(data_out, data_in, first);
+        }
+        ib_str_lower_copy(data_in + first, dlen_in - first, data_out + first);
+        *dlen_out = dlen_in;
+    }
+
+    return IB_OK;
+}
+
+/** Fuse function of trimLeft. */
+static ib_status_t fuse_trim_left(
+    const uint8_t  *data_in,  size_t  dlen_in,
+    uint8_t        *data_out, size_t *dlen_out,
+    void           *instdata,
+    void           *cbdata
+)
+{
+    return fuse_substr(ib_strtrim_left,
+                       data_in, dlen_in, data_out, dlen_out);
+}
+
+/** Fuse function of trimRight. */
+static ib_status_t fuse_trim_right(
+    const uint8_t  *data_in,  size_t  dlen_in,
+    uint8_t        *data_out, size_t *dlen_out,
+    void           *instdata,
+    void           *cbdata
+)
+{
+    return fuse_substr(ib_strtrim_right,
+                       data_in, dlen_in, data_out, dlen_out);
+}
+
+/** Fuse function of trim. */
+static ib_status_t fuse_trim(
+    const uint8_t  *data_in,  size_t  dlen_in,
+    uint8_t        *data_out, size_t *dlen_out,
+    void           *instdata,
+    void           *cbdata
+)
+{
+    return fuse_substr(ib_strtrim_lr,
+                       data_in, dlen_in, data_out, dlen_out);
+}
+
+/** Fuse function of removeWhitespace. */
+static ib_status_t fuse_wspc_remove(
+    const uint8_t  *data_in,  size_t  dlen_in,
+    uint8_t        *data_out, size_t *dlen_out,
+    void           *instdata,
+    void           *cbdata
+)
+{
+    if (ib_str_scan_space(data_in, dlen_in) == dlen_in) {
+        return IB_DECLINED;
+    }
+    if (data_out == NULL) {
+        return IB_OK;
+    }
+
+    return ib_str_whitespace_remove_ex(data_in, dlen_in, data_out, dlen_out);
+}
+
+/** Fuse function of compressWhitespace. */
+static ib_status_t fuse_wspc_compress(
+    const uint8_t  *data_in,  size_t  dlen_in,
+    uint8_t        *data_out, size_t *dlen_out,
+    void           *instdata,
+    void           *cbdata
+)
+{
+    if (! has_whitespace_run(data_in, dlen_in)) {
+        return IB_DECLINED;
+    }
+    if (data_out == NULL) {
+        return IB_OK;
+    }
+
+    return ib_str_whitespace_compress_ex(data_in, dlen_in, data_out, dlen_out);
+}
+
+/**
+ * Fuse function core of the decoding transformations.
+ *
+ * Decodes from the first of @a c1 or @a c2 on; everything before it is
+ * copied as is.
+ *
+ * @param[in] decode Decode function.
+ * @param[in] c1 First byte that starts an encoding.
+ * @param[in] c2 Second byte that starts an encoding.
+ * @param[in] data_in Input data.
+ * @param[in] dlen_in Length of @a data_in.
+ * @param[out] data_out Output buffer or NULL.
+ * @param[out] dlen_out Length of @a data_out.
+ *
+ * @returns IB_OK if decoded, IB_DECLINED if there is nothing to decode.
+ */
+static ib_status_t fuse_decode(
+    ib_status_t   (*decode)(const uint8_t *, size_t, uint8_t *, size_t *),
+    uint8_t         c1,
+    uint8_t         c2,
+    const uint8_t  *data_in,  size_t  dlen_in,
+    uint8_t        *data_out, size_t *dlen_out
+)
+{
+    size_t      first = ib_str_scan_bytes(data_in, dlen_in, c1, c2);
+    size_t      len;
+    ib_status_t rc;
+
+    if (first == dlen_in) {
+        return IB_DECLINED;
+    }
+    if (data_out == NULL) {
+        return IB_OK;
+    }
+
+    if (data_out != data_in) {
+        memcpy(data_out, data_in, first);
+    }
+    rc = decode(data_in + first, dlen_in - first, data_out + first, &len);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    *dlen_out = first + len;
+
+    return IB_OK;
+}
+
+/** Fuse function of urlDecode. */
+static ib_status_t fuse_url_decode(
+    const uint8_t  *data_in,  size_t  dlen_in,
+    uint8_t        *data_out, size_t *dlen_out,
+    void           *instdata,
+    void           *cbdata
+)
+{
+    return fuse_decode(ib_util_decode_url, '%', '+',
+                       data_in, dlen_in, data_out, dlen_out);
+}
+
+/** Fuse function of htmlEntityDecode. */
+static ib_status_t fuse_html_entity_decode(
+    const uint8_t  *data_in,  size_t  dlen_in,
+    uint8_t        *data_out, size_t *dlen_out,
+    void           *instdata,
+    void           *cbdata
+)
+{
+    return fuse_decode(ib_util_decode_html_entity, '&', '&',
+                       data_in, dlen_in, data_out, dlen_out);
+}
+
+/**
+ * Create and register a fusable byte string transformation.
+ *
+ * @param[in] ib IronBee engine.
+ * @param[in] name Name.
+ * @param[in] execute_fn Execute function.
+ * @param[in] fuse_fn Fuse function.
+ *
+ * @returns Status code.
+ */
+static ib_status_t register_fusable(
+    ib_engine_t                    *ib,
+    const char                     *name,
+    ib_transformation_execute_fn_t  execute_fn,
+    ib_transformation_fuse_fn_t     fuse_fn
+)
+{
+    ib_transformation_t *tfn;
+    ib_status_t          rc;
+
+    rc = ib_transformation_create(
+        &tfn,
+        ib_engine_mm_main_get(ib),
+        name,
+        false,
+        NULL,       NULL,
+        NULL,       NULL,
+        execute_fn, NULL
+    );
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    rc = ib_transformation_fuse_fn_set(tfn, fuse_fn, NULL);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    return ib_transformation_register(ib, tfn);
+}
+
 /**
  * Initialize the core transformations
  **/
@@ -1630,80 +1951,34 @@ ib_status_t ib_core_transformations_init(ib_engine_t *ib, ib_module_t *mod)
     }
 
     /* Define transformations. */
-    rc = ib_transformation_create_and_register(
-        NULL,
-        ib,
-        "lowercase",
-        false,
-        NULL,          NULL,
-        NULL,          NULL,
-        tfn_lowercase, NULL
-    );
+    rc = register_fusable(ib, "lowercase", tfn_lowercase, fuse_lowercase);
     if (rc != IB_OK) {
         return rc;
     }
 
-    rc = ib_transformation_create_and_register(
-        NULL,
-        ib,
-        "trimLeft",
-        false,
-        NULL, NULL,
-        NULL, NULL,
-        tfn_trim_left, NULL
-    );
+    rc = register_fusable(ib, "trimLeft", tfn_trim_left, fuse_trim_left);
     if (rc != IB_OK) {
         return rc;
     }
 
-    rc = ib_transformation_create_and_register(
-        NULL,
-        ib,
-        "trimRight",
-        false,
-        NULL, NULL,
-        NULL, NULL,
-        tfn_trim_right, NULL
-    );
+    rc = register_fusable(ib, "trimRight", tfn_trim_right, fuse_trim_right);
     if (rc != IB_OK) {
         return rc;
     }
 
-    rc = ib_transformation_create_and_register(
-        NULL,
-        ib,
-        "trim",
-        false,
-        NULL, NULL,
-        NULL, NULL,
-        tfn_trim, NULL
-    );
+    rc = register_fusable(ib, "trim", tfn_trim, fuse_trim);
     if (rc != IB_OK) {
         return rc;
     }
 
-    rc = ib_transformation_create_and_register(
-        NULL,
-        ib,
-        "removeWhitespace",
-        false,
-        NULL, NULL,
-        NULL, NULL,
-        tfn_wspc_remove, NULL
-    );
+    rc = register_fusable(
+        ib, "removeWhitespace", tfn_wspc_remove, fuse_wspc_remove);
     if (rc != IB_OK) {
         return rc;
     }
 
-    rc = ib_transformation_create_and_register(
-        NULL,
-        ib,
-        "compressWhitespace",
-        false,
-        NULL, NULL,
-        NULL, NULL,
-        tfn_wspc_compress, NULL
-    );
+    rc = register_fusable(
+        ib, "compressWhitespace", tfn_wspc_compress, fuse_wspc_compress);
     if (rc != IB_OK) {
         return rc;
     }
@@ -1760,28 +2035,13 @@ ib_status_t ib_core_transformations_init(ib_engine_t *ib, ib_module_t *mod)
         return rc;
     }
 
-    rc = ib_transformation_create_and_register(
-        NULL,
-        ib,
-        "urlDecode",
-        false,
-        NULL, NULL,
-        NULL, NULL,
-        tfn_url_decode, NULL
-    );
+    rc = register_fusable(ib, "urlDecode", tfn_url_decode, fuse_url_decode);
     if (rc != IB_OK) {
         return rc;
     }
 
-    rc = ib_transformation_create_and_register(
-        NULL,
-        ib,
-        "htmlEntityDecode",
-        false,
-        NULL, NULL,
-        NULL, NULL,
-        tfn_html_entity_decode, NULL
-    );
+    rc = register_fusable(
+        ib, "htmlEntityDecode", tfn_html_entity_decode, fuse_html_entity_decode);
     if (rc != IB_OK) {
         return rc;
     }
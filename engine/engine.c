@@ -29,6 +29,7 @@
 #include <ironbee/engine.h>
 #include "engine_private.h"
 
+#include "core_audit_private.h"
 #include "core_private.h"
 #include "module_private.h"
 #include "rule_engine_private.h"
@@ -465,6 +466,12 @@ ib_status_t ib_engine_create(ib_engine_t **pib,
         goto failed;
     }
 
+    /* Create a hash to share fused transformation chains */
+    rc = ib_hash_create(&(ib->tfn_fusions), mm);
+    if (rc != IB_OK) {
+        goto failed;
+    }
+
     /* Create a hash to hold operators by name */
     rc = ib_hash_create_nocase(&(ib->operators), mm);
     if (rc != IB_OK) {
@@ -513,6 +520,12 @@ ib_status_t ib_engine_create(ib_engine_t **pib,
         goto failed;
     }
 
+    /* Create the statistics counters. */
+    rc = ib_counters_create(&(ib->counters), mm, IB_ENGINE_COUNTER_NUM);
+    if (rc != IB_OK) {
+        goto failed;
+    }
+
     /* Initialize block pre-hooks list. */
     rc = ib_list_create(&(ib->block_pre_hooks), mm);
     if (rc != IB_OK) {
@@ -958,8 +971,68 @@ const char *ib_engine_instance_id(
     return ib->instance_id;
 }
 
+/**
+ * Convert a summed counter to an unsigned statistic.
+ *
+ * Levels raised and lowered by different threads can briefly sum to less
+ * than zero when read without synchronization.
+ *
+ * @param[in] value Counter sum.
+ *
+ * @returns @a value or 0 if it is negative.
+ */
+static uint64_t engine_stat(int64_t value)
+{
+    return (value < 0) ? 0 : (uint64_t)value;
+}
+
+void ib_engine_stats_get(
+    const ib_engine_t *ib,
+    ib_engine_stats_t *stats
+)
+{
+    assert(ib != NULL);
+    assert(ib->counters != NULL);
+    assert(stats != NULL);
+
+    int64_t values[IB_ENGINE_COUNTER_NUM];
+
+    ib_counters_get(ib->counters, values);
+
+    stats->conns_active =
+        engine_stat(values[IB_ENGINE_COUNTER_CONNS_ACTIVE]);
+    stats->conns = engine_stat(values[IB_ENGINE_COUNTER_CONNS]);
+    stats->conn_pool_bytes =
+        engine_stat(values[IB_ENGINE_COUNTER_CONN_POOL_BYTES]);
+    stats->txs_active = engine_stat(values[IB_ENGINE_COUNTER_TXS_ACTIVE]);
+    stats->txs = engine_stat(values[IB_ENGINE_COUNTER_TXS]);
+    stats->tx_pool_bytes =
+        engine_stat(values[IB_ENGINE_COUNTER_TX_POOL_BYTES]);
+
+    for (int phase = 0; phase < IB_RULE_PHASE_COUNT; ++phase) {
+        ib_engine_phase_stats_t *phase_stats = &(stats->phases[phase]);
+
+        phase_stats->runs =
+            engine_stat(values[IB_ENGINE_COUNTER_PHASE_RUNS + phase]);
+        phase_stats->rules =
+            engine_stat(values[IB_ENGINE_COUNTER_PHASE_RULES + phase]);
+        phase_stats->usec =
+            engine_stat(values[IB_ENGINE_COUNTER_PHASE_USEC + phase]);
+    }
+
+    stats->pool_bytes =
+        ib_mpool_inuse(ib->mp) +
+        ib_mpool_inuse(ib->config_mp) +
+        ib_mpool_inuse(ib->temp_mp);
+
+    ib_logger_stats_get(ib->logger, &(stats->logger));
+}
+
 ib_status_t ib_conn_generate_id(ib_conn_t *conn)
 {
+    if (conn->ib->time_ordered_ids) {
+        return ib_uuid_create_v7(conn->id);
+    }
     return ib_uuid_create_v4(conn->id);
 }
 
@@ -1011,6 +1084,9 @@ ib_status_t ib_conn_create(ib_engine_t *ib,
         goto failed;
     }
 
+    ib_counters_add(ib->counters, IB_ENGINE_COUNTER_CONNS_ACTIVE, 1);
+    ib_counters_add(ib->counters, IB_ENGINE_COUNTER_CONNS, 1);
+
     *pconn = conn;
 
     return IB_OK;
@@ -1064,6 +1140,21 @@ void ib_conn_destroy(ib_conn_t *conn)
 {
     /// @todo Probably need to update state???
     if ( conn != NULL && conn->mp != NULL ) {
+        ib_counters_t *counters = conn->ib->counters;
+
+        /* Transactions not destroyed on their own go with the pool. */
+        for (const ib_tx_t *tx = conn->tx_first; tx != NULL; tx = tx->next) {
+            ib_counters_add(counters, IB_ENGINE_COUNTER_TXS_ACTIVE, -1);
+            ib_counters_add(
+                counters,
+                IB_ENGINE_COUNTER_TX_POOL_BYTES,
+                ib_mpool_inuse(tx->mp));
+        }
+        ib_counters_add(counters, IB_ENGINE_COUNTER_CONNS_ACTIVE, -1);
+        ib_counters_add(
+            counters,
+            IB_ENGINE_COUNTER_CONN_POOL_BYTES,
+            ib_mpool_inuse(conn->mp));
         ib_engine_pool_destroy(conn->ib, conn->mp);
         /* Don't do this: conn->mp = NULL; conn is now freed memory! */
     }
@@ -1071,6 +1162,9 @@ void ib_conn_destroy(ib_conn_t *conn)
 
 ib_status_t ib_tx_generate_id(ib_tx_t *tx)
 {
+    if (tx->ib->time_ordered_ids) {
+        return ib_uuid_create_v7(tx->id);
+    }
     return ib_uuid_create_v4(tx->id);
 }
 
@@ -1206,6 +1300,9 @@ ib_status_t ib_tx_create(ib_tx_t **ptx,
         ib_tx_flags_set(tx, IB_TX_FPIPELINED);
     }
 
+    ib_counters_add(ib->counters, IB_ENGINE_COUNTER_TXS_ACTIVE, 1);
+    ib_counters_add(ib->counters, IB_ENGINE_COUNTER_TXS, 1);
+
     /* Only when we are successful, commit changes to output variable. */
     *ptx = tx;
 
@@ -1385,6 +1482,12 @@ void ib_tx_destroy(ib_tx_t *tx)
         prev->next = tx->next;
     }
 
+    ib_counters_add(tx->ib->counters, IB_ENGINE_COUNTER_TXS_ACTIVE, -1);
+    ib_counters_add(
+        tx->ib->counters,
+        IB_ENGINE_COUNTER_TX_POOL_BYTES,
+        ib_mpool_inuse(tx->mp));
+
     /// @todo Probably need to update state???
     ib_engine_pool_destroy(tx->ib, tx->mp);
 }
@@ -2304,10 +2407,7 @@ ib_status_t ib_context_set_auditlog_index(ib_context_t *ctx,
         }
 
         /* Close the audit log file if it is open. */
-        if (ctx->auditlog->index_fp != NULL) {
-            fclose(ctx->auditlog->index_fp);
-            ctx->auditlog->index_fp = NULL;
-        }
+        core_audit_index_close(ctx->auditlog);
 
         if (unlock) {
             ib_lock_unlock(ctx->auditlog->index_fp_lock);
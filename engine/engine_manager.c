@@ -44,6 +44,7 @@
 #include <inttypes.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <sched.h>
 #include <stdlib.h>
 #include <unistd.h>
 
@@ -87,15 +88,41 @@ struct ib_manager_t {
     /**
      * A list of all engines, including the current engine.
      *
-     * This is ib_manager_t::max_engines long. The list is compacted
-     * so indexes 0 through ib_manager_t::engine_count-1 have
-     * engines.
+     * This is ib_manager_t::max_engines long. Slots are stable: an engine
+     * stays in the slot it was registered in until it is destroyed and
+     * empty slots are NULL. This allows ib_manager_engine_release() to
+     * scan the list as a reader without holding ib_manager_t::manager_lck.
      */
-    ib_manager_engine_t **engine_list;
+    ib_manager_engine_t * volatile *engine_list;
     size_t                engine_count;   /**< Current count of engines */
     size_t                max_engines;    /**< The maximum number of engines */
-    ib_manager_engine_t  *engine_current; /**< Current IronBee engine */
-    ib_lock_t            *manager_lck;    /**< Protect access to the mgr. */
+
+    /**
+     * Current IronBee engine.
+     *
+     * This is only written while holding ib_manager_t::manager_lck, but
+     * is read without any lock by ib_manager_engine_acquire() and
+     * ib_manager_engine_release().
+     */
+    ib_manager_engine_t * volatile engine_current;
+
+    /**
+     * Reader epoch.
+     *
+     * Lock-free readers of ib_manager_t::engine_current register themselves
+     * in ib_manager_t::epoch_readers under the parity of this value.
+     * Before destroying engines, wait_for_readers() advances the epoch and
+     * waits for the readers of the previous epoch to drain.
+     */
+    volatile size_t       epoch;
+
+    /**
+     * Number of in-flight readers of ib_manager_t::engine_current,
+     * indexed by epoch parity.
+     */
+    volatile size_t       epoch_readers[2];
+
+    ib_lock_t            *manager_lck;    /**< Serialize engine changes. */
 
     /**
      * Option module function to create a module to add to the engine.
@@ -127,10 +154,85 @@ struct ib_manager_engine_t {
      * represents the manager's use of that engine as the current engine.
      * Other engines may have a reference count as low as zero. If an
      * engine's reference count is zero, it may be cleaned up.
+     *
+     * This is only modified with atomic operations.
      */
-    size_t        ref_count;
+    volatile size_t ref_count;
 };
 
+/**
+ * Enter a lock-free read of ib_manager_t::engine_current.
+ *
+ * The returned epoch must be passed to reader_exit().
+ *
+ * @param[in] manager IronBee engine manager.
+ *
+ * @returns The epoch the reader is registered in.
+ */
+static size_t reader_enter(
+    ib_manager_t *manager
+)
+{
+    assert(manager != NULL);
+
+    for (;;) {
+        size_t epoch = manager->epoch;
+
+        __sync_add_and_fetch(&(manager->epoch_readers[epoch & 1]), 1);
+
+        /* If the epoch moved before we registered, a concurrent
+         * wait_for_readers() may have missed us. Try again. */
+        if (__sync_fetch_and_add(&(manager->epoch), 0) == epoch) {
+            return epoch;
+        }
+
+        __sync_sub_and_fetch(&(manager->epoch_readers[epoch & 1]), 1);
+    }
+}
+
+/**
+ * Leave a lock-free read of ib_manager_t::engine_current.
+ *
+ * @param[in] manager IronBee engine manager.
+ * @param[in] epoch The epoch returned by reader_enter().
+ */
+static void reader_exit(
+    ib_manager_t *manager,
+    size_t        epoch
+)
+{
+    assert(manager != NULL);
+
+    __sync_sub_and_fetch(&(manager->epoch_readers[epoch & 1]), 1);
+}
+
+/**
+ * Wait until no reader can hold an unreferenced engine pointer.
+ *
+ * After this returns, every reader that loaded ib_manager_t::engine_current
+ * before the call has either taken a reference on that engine or finished.
+ * Reference counts of non-current engines are therefore stable at zero.
+ *
+ * This function assumes that the engine list lock has been locked by the
+ * caller.
+ *
+ * @param[in] manager IronBee engine manager.
+ */
+static void wait_for_readers(
+    ib_manager_t *manager
+)
+{
+    assert(manager != NULL);
+
+    size_t epoch = __sync_fetch_and_add(&(manager->epoch), 1);
+
+    /* Readers never block inside an epoch, so this is brief. */
+    while (__sync_fetch_and_add(&(manager->epoch_readers[epoch & 1]), 0) != 0)
+    {
+        sched_yield();
+    }
+}
+
 /**
  * Destroy IronBee engines with a reference count of zero.
  *
@@ -145,58 +247,37 @@ static void destroy_inactive_engines(
 )
 {
     assert(manager != NULL);
-    const size_t list_sz = manager->engine_count;
+
+    /* Make reference counts of non-current engines trustworthy. */
+    wait_for_readers(manager);
 
     /* Destroy all non-current engines with zero reference count */
-    for (size_t num = 0; num < list_sz; ++num) {
+    for (size_t num = 0; num < manager->max_engines; ++num) {
 
         /* Get and check the wrapper for the IronBee engine. */
-        const ib_manager_engine_t *wrapper = manager->engine_list[num];
-        assert(wrapper != NULL);
+        ib_manager_engine_t *wrapper = manager->engine_list[num];
+        if (wrapper == NULL) {
+            continue;
+        }
 
         /* Get and check the engine. */
         ib_engine_t *engine = wrapper->engine;
         assert(engine != NULL);
 
-        if ( wrapper->ref_count == 0) {
+        if (
+            wrapper != manager->engine_current &&
+            __sync_fetch_and_add(&(wrapper->ref_count), 0) == 0
+        ) {
             --(manager->engine_count);
 
-            /* Note: This will destroy the engine wrapper object, too */
-            ib_engine_destroy(engine);
-
-            /* NULL out it's place in the list -- we'll consolidate the
-             * list at the bottom */
+            /* Empty the slot and let readers that may have loaded it
+             * drain before the wrapper memory goes away. */
             manager->engine_list[num] = NULL;
-        }
-    }
+            __sync_synchronize();
+            wait_for_readers(manager);
 
-    /* If any engines were destroyed, there is a NULL in the list
-     * where they where. Collapse the list, removing NULLs. */
-    if (list_sz > manager->engine_count) {
-
-        /* Iterator i walks the list.
-         *
-         * Non-null elements are copied to the iterator, j, which
-         * starts equal to i, but will lag behind i when the first
-         * NULL entry is seen.
-         *
-         * When i increases to and beyond new_engine_count, we know
-         * that those array slots will not be used in the new list
-         * and should be cleared.
-         */
-        for (size_t i = 0, j = 0; i < list_sz; ++i) {
-
-            /* If i is not null, copy it to j. */
-            if (manager->engine_list[i] != NULL) {
-
-                manager->engine_list[j] = manager->engine_list[i];
-                ++j;
-
-                /* If is is beyond the new list, NULL the source elements. */
-                if (i >= manager->engine_count) {
-                    manager->engine_list[i] = NULL;
-                }
-            }
+            /* Note: This will destroy the engine wrapper object, too */
+            ib_engine_destroy(engine);
         }
     }
 }
@@ -387,9 +468,13 @@ void ib_manager_destroy(
     assert(manager != NULL);
 
     /* Destroy engines */
-    for (size_t num = 0; num < manager->engine_count; ++num) {
+    for (size_t num = 0; num < manager->max_engines; ++num) {
         const ib_manager_engine_t *manager_engine = manager->engine_list[num];
 
+        if (manager_engine == NULL) {
+            continue;
+        }
+
         /* Note: This will destroy the engine wrapper object, too */
         ib_engine_destroy(manager_engine->engine);
     }
@@ -424,26 +509,36 @@ static void register_engine(
     assert(manager->engine_count < manager->max_engines);
 
     ib_manager_engine_t *previous_engine;
+    size_t               num;
 
-    /* Store the engine in the list of all engines. */
-    manager->engine_list[manager->engine_count] = engine;
+    /* Store the engine in the first free slot of the list of all engines. */
+    for (num = 0; num < manager->max_engines; ++num) {
+        if (manager->engine_list[num] == NULL) {
+            break;
+        }
+    }
+    assert(num < manager->max_engines);
+    manager->engine_list[num] = engine;
     ++(manager->engine_count);
 
     /* Store a reference to the previous engine. */
     previous_engine = manager->engine_current;
 
-    /* Promote engine to the current engine (demoting the previous one. */
-    manager->engine_current = engine;
+    /* Add a reference count to the new engine for the manager. */
+    __sync_add_and_fetch(&(engine->ref_count), 1);
 
-    /* Add a reference count to the current engine for the manager. */
-    ++(manager->engine_current->ref_count);
+    /* Promote engine to the current engine (demoting the previous one).
+     * The barrier publishes the initialized engine before readers see it. */
+    __sync_synchronize();
+    manager->engine_current = engine;
+    __sync_synchronize();
 
     /* If there was a previous engine, clean it up. */
     if (previous_engine != NULL) {
         ib_status_t rc;
 
         /* Remove the engine manager's reference to the engine. */
-        --(previous_engine->ref_count);
+        __sync_sub_and_fetch(&(previous_engine->ref_count), 1);
 
         /* Tell the engine that we would like to shut down. */
         rc = ib_state_notify_engine_shutdown_initiated(
@@ -711,6 +806,7 @@ ib_status_t ib_manager_disable(
     if (manager->engine_current != NULL) {
         previous_engine         = manager->engine_current->engine;
         manager->engine_current = NULL;
+        __sync_synchronize();
     }
 
     manager->enabled = false;
@@ -757,19 +853,18 @@ ib_status_t ib_manager_engine_acquire(
 
     ib_status_t          rc;
     ib_manager_engine_t *engine = NULL;
+    size_t               epoch;
 
-    /* Grab the engine list lock */
-    rc = ib_lock_lock(manager->manager_lck);
-    if (rc != IB_OK) {
-        return rc;
-    }
+    /* Register as a reader so the engine is not destroyed between
+     * loading it and taking a reference on it. */
+    epoch = reader_enter(manager);
 
     /* Get the current engine; If there is no current engine, decline. */
     engine = manager->engine_current;
     if (engine != NULL) {
 
         /* Increment and return the engine. */
-        ++(engine->ref_count);
+        __sync_add_and_fetch(&(engine->ref_count), 1);
         *pengine = engine->engine;
 
         rc = IB_OK;
@@ -778,7 +873,7 @@ ib_status_t ib_manager_engine_acquire(
         rc = IB_DECLINED;
     }
 
-    ib_lock_unlock(manager->manager_lck);
+    reader_exit(manager, epoch);
     return rc;
 }
 
@@ -790,30 +885,28 @@ ib_status_t ib_manager_engine_release(
     assert(manager != NULL);
     assert(engine != NULL);
 
-    ib_status_t          rc;
     ib_manager_engine_t *managed_engine = NULL;
+    ib_manager_engine_t *current;
+    size_t               epoch;
 
-    /* Grab the engine list lock */
-    rc = ib_lock_lock(manager->manager_lck);
-    if (rc != IB_OK) {
-        return rc;
-    }
+    /* Register as a reader so that no wrapper we load, including
+     * unreferenced ones, is destroyed while we look at it. */
+    epoch = reader_enter(manager);
 
     /* Happy path: The current engine is being released. */
-    if (
-        manager->engine_current != NULL &&
-        engine == manager->engine_current->engine
-    ) {
-        managed_engine = manager->engine_current;
+    current = manager->engine_current;
+    if (current != NULL && engine == current->engine) {
+        managed_engine = current;
     }
 
-    /* More work to find an old engine that's being released. */
+    /* More work to find an old engine that's being released. Slots are
+     * stable, so an engine the caller holds a reference to cannot move. */
     else {
-        for (size_t num = 0; num < manager->engine_count; ++num) {
+        for (size_t num = 0; num < manager->max_engines; ++num) {
             ib_manager_engine_t *cur = manager->engine_list[num];
 
             /* Decrement the reference count if the engine matches. */
-            if (engine == cur->engine) {
+            if (cur != NULL && engine == cur->engine) {
                 managed_engine = cur;
 
                 /* Leave the loop as we won't find engine a second time. */
@@ -822,28 +915,20 @@ ib_status_t ib_manager_engine_release(
         }
     }
 
-
-    /* Found the engine in this manager. Release it. */
-    if (managed_engine != NULL) {
-
-        /* Quick sanity check. Never release an unowned engine. */
-        assert(managed_engine->ref_count > 0);
-
-        /* Release the engine. */
-        --(managed_engine->ref_count);
-
-        rc = IB_OK;
-    }
-
     /* The user passed us an engine not from this manager. */
-    else {
-        rc = IB_EINVAL;
+    if (managed_engine == NULL) {
+        reader_exit(manager, epoch);
+        return IB_EINVAL;
     }
 
-    /* Release the lock. */
-    ib_lock_unlock(manager->manager_lck);
+    /* Quick sanity check. Never release an unowned engine. */
+    assert(managed_engine->ref_count > 0);
 
-    return rc;
+    /* Release the engine. */
+    __sync_sub_and_fetch(&(managed_engine->ref_count), 1);
+
+    reader_exit(manager, epoch);
+    return IB_OK;
 }
 
 ib_status_t ib_manager_engine_cleanup(
@@ -874,6 +959,39 @@ size_t ib_manager_engine_count(
     return manager->engine_count;
 }
 
+ib_status_t ib_manager_engine_visit(
+    ib_manager_t                 *manager,
+    ib_manager_engine_visit_fn_t  fn,
+    void                         *cbdata
+)
+{
+    assert(manager != NULL);
+    assert(fn != NULL);
+
+    ib_status_t rc;
+
+    rc = ib_lock_lock(manager->manager_lck);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    for (size_t num = 0; num < manager->max_engines; ++num) {
+        ib_manager_engine_t *wrapper = manager->engine_list[num];
+
+        if (wrapper != NULL) {
+            fn(
+                wrapper->engine,
+                __sync_fetch_and_add(&(wrapper->ref_count), 0),
+                wrapper == manager->engine_current,
+                cbdata);
+        }
+    }
+
+    ib_lock_unlock(manager->manager_lck);
+
+    return IB_OK;
+}
+
 ib_status_t ib_manager_engine_postconfig_fn_add(
     ib_manager_t                      *manager,
     ib_manager_engine_postconfig_fn_t  postconfig_fn,
@@ -26,11 +26,15 @@
 
 #include <ironbee/engine_manager_control_channel.h>
 
+#include <ironbee/engine.h>
 #include <ironbee/engine_manager.h>
 #include <ironbee/hash.h>
+#include <ironbee/kvstore.h>
 #include <ironbee/mm.h>
 #include <ironbee/mm_mpool_lite.h>
+#include <ironbee/mpool.h>
 #include <ironbee/mpool_lite.h>
+#include <ironbee/rule_engine.h>
 
 #ifdef HAVE_VALGRIND
 #include <valgrind/memcheck.h>
@@ -39,6 +43,9 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdio.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/socket.h>
@@ -352,6 +359,214 @@ static ib_status_t manager_cmd_cleanup(
     return ib_manager_engine_cleanup(manager);
 }
 
+/**
+ * Response being built by manager_cmd_stats().
+ */
+typedef struct {
+    char       *buf;     /**< Response text. */
+    size_t      len;     /**< String length of @a buf. */
+    const char *prefix;  /**< Only report names starting with this. */
+    size_t      engines; /**< Number of engines reported so far. */
+} stats_response_t;
+
+/**
+ * Append a line to a stats response.
+ *
+ * Lines that do not start with the response prefix or that do not fit in
+ * the response are dropped.
+ *
+ * @param[in] resp The response.
+ * @param[in] fmt Printf style format of the line, without the newline.
+ */
+static void stats_line(
+    stats_response_t *resp,
+    const char       *fmt,
+    ...
+)
+PRINTF_ATTRIBUTE(2, 3);
+
+static void stats_line(
+    stats_response_t *resp,
+    const char       *fmt,
+    ...
+)
+{
+    assert(resp != NULL);
+    assert(fmt != NULL);
+
+    const size_t avail = IB_ENGINE_MANAGER_CONTROL_CHANNEL_MAX_RESP_SZ -
+                         resp->len;
+    va_list ap;
+    int     n;
+
+    va_start(ap, fmt);
+    n = vsnprintf(resp->buf + resp->len, avail, fmt, ap);
+    va_end(ap);
+
+    /* Keep only whole, selected lines that fit along with their newline. */
+    if (
+        n >= 0 &&
+        (size_t)n + 1 < avail &&
+        strncmp(resp->buf + resp->len, resp->prefix, strlen(resp->prefix))
+            == 0
+    ) {
+        resp->len += n;
+        resp->buf[resp->len++] = '\n';
+    }
+    resp->buf[resp->len] = '\0';
+}
+
+/**
+ * Report the statistics of one engine. Called by ib_manager_engine_visit().
+ *
+ * @param[in] engine The engine.
+ * @param[in] ref_count References to @a engine.
+ * @param[in] current Is @a engine the current engine?
+ * @param[in] cbdata The @ref stats_response_t.
+ */
+static void stats_engine(
+    ib_engine_t *engine,
+    size_t       ref_count,
+    bool         current,
+    void        *cbdata
+)
+{
+    assert(engine != NULL);
+    assert(cbdata != NULL);
+
+    stats_response_t  *resp = (stats_response_t *)cbdata;
+    ib_engine_stats_t  stats;
+    size_t             n = resp->engines++;
+
+    ib_engine_stats_get(engine, &stats);
+
+    stats_line(resp, "engine.%zu.id %s", n, ib_engine_instance_id(engine));
+    stats_line(resp, "engine.%zu.current %d", n, current ? 1 : 0);
+    stats_line(resp, "engine.%zu.refcount %zu", n, ref_count);
+    stats_line(resp, "engine.%zu.conns.active %" PRIu64,
+               n, stats.conns_active);
+    stats_line(resp, "engine.%zu.conns.total %" PRIu64, n, stats.conns);
+    stats_line(resp, "engine.%zu.conns.pool_bytes %" PRIu64,
+               n, stats.conn_pool_bytes);
+    stats_line(resp, "engine.%zu.txs.active %" PRIu64, n, stats.txs_active);
+    stats_line(resp, "engine.%zu.txs.total %" PRIu64, n, stats.txs);
+    stats_line(resp, "engine.%zu.txs.pool_bytes %" PRIu64,
+               n, stats.tx_pool_bytes);
+    stats_line(resp, "engine.%zu.pool_bytes %" PRIu64, n, stats.pool_bytes);
+
+    for (int phase = 0; phase < IB_RULE_PHASE_COUNT; ++phase) {
+        const ib_engine_phase_stats_t *phase_stats = &(stats.phases[phase]);
+        const char *name = ib_rule_phase_name(phase);
+
+        /* Only report phases that have been reached. */
+        if (name == NULL || phase_stats->runs == 0) {
+            continue;
+        }
+
+        stats_line(resp, "engine.%zu.phase.%s.runs %" PRIu64,
+                   n, name, phase_stats->runs);
+        stats_line(resp, "engine.%zu.phase.%s.rules %" PRIu64,
+                   n, name, phase_stats->rules);
+        stats_line(resp, "engine.%zu.phase.%s.usec %" PRIu64,
+                   n, name, phase_stats->usec);
+    }
+
+    stats_line(resp, "engine.%zu.logger.depth %zu", n, stats.logger.depth);
+    stats_line(resp, "engine.%zu.logger.max_depth %zu",
+               n, stats.logger.max_depth);
+    stats_line(resp, "engine.%zu.logger.capacity %zu",
+               n, stats.logger.capacity);
+    stats_line(resp, "engine.%zu.logger.enqueued %zu",
+               n, stats.logger.enqueued);
+    stats_line(resp, "engine.%zu.logger.dropped %zu",
+               n, stats.logger.dropped);
+    stats_line(resp, "engine.%zu.logger.blocked %zu",
+               n, stats.logger.blocked);
+}
+
+/**
+ * Report live statistics.
+ *
+ * Engine counters are kept per thread and summed here, so this is the
+ * only place that pays for them.
+ *
+ * @param[in] mm Memory manager for allocations of @a result and other
+ *            allocations that should live until the response is sent.
+ * @param[in] name The name this command is called by.
+ * @param[in] args Optional prefix of the names to report, such as
+ *            "engine.0.phase." or "kvstore.".
+ * @param[out] result Lines of "name value".
+ * @param[in] cbdata The @ref ib_manager_t * to report on.
+ *
+ * @sa ib_engine_stats_get()
+ * @sa ib_kvstore_stats_get()
+ * @sa ib_mpool_page_cache_stats_get()
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC On allocation failure.
+ * - Other if the manager lock cannot be taken.
+ */
+static ib_status_t manager_cmd_stats(
+    ib_mm_t      mm,
+    const char  *name,
+    const char  *args,
+    const char **result,
+    void        *cbdata
+)
+{
+    assert(args != NULL);
+    assert(result != NULL);
+    assert(cbdata != NULL);
+
+    ib_manager_t                *manager = (ib_manager_t *)cbdata;
+    stats_response_t             resp;
+    ib_kvstore_stats_t           kvstore;
+    ib_mpool_page_cache_stats_t  page_cache;
+    ib_status_t                  rc;
+
+    resp.buf = ib_mm_alloc(mm, IB_ENGINE_MANAGER_CONTROL_CHANNEL_MAX_RESP_SZ);
+    if (resp.buf == NULL) {
+        return IB_EALLOC;
+    }
+    resp.buf[0] = '\0';
+    resp.len = 0;
+    resp.prefix = args;
+    resp.engines = 0;
+
+    rc = ib_manager_engine_visit(manager, stats_engine, &resp);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    ib_kvstore_stats_get(&kvstore);
+    stats_line(&resp, "kvstore.gets %" PRIu64, kvstore.gets);
+    stats_line(&resp, "kvstore.get_misses %" PRIu64, kvstore.get_misses);
+    stats_line(&resp, "kvstore.get_usec %" PRIu64, kvstore.get_usec);
+    stats_line(&resp, "kvstore.sets %" PRIu64, kvstore.sets);
+    stats_line(&resp, "kvstore.set_usec %" PRIu64, kvstore.set_usec);
+    stats_line(&resp, "kvstore.removes %" PRIu64, kvstore.removes);
+    stats_line(&resp, "kvstore.remove_usec %" PRIu64, kvstore.remove_usec);
+    stats_line(&resp, "kvstore.errors %" PRIu64, kvstore.errors);
+
+    ib_mpool_page_cache_stats_get(&page_cache);
+    stats_line(&resp, "mpool.page_hits %zu", page_cache.page_hits);
+    stats_line(&resp, "mpool.page_misses %zu", page_cache.page_misses);
+    stats_line(&resp, "mpool.cached_pages %zu", page_cache.cached_pages);
+    stats_line(&resp, "mpool.depot_pages %zu", page_cache.depot_pages);
+
+    stats_line(&resp, "engines %zu", resp.engines);
+
+    /* The client adds its own final newline. */
+    if (resp.len > 0) {
+        resp.buf[--resp.len] = '\0';
+    }
+
+    *result = resp.buf;
+
+    return IB_OK;
+}
+
 /**
  * Log an error message through the current IronBee engine.
  *
@@ -812,7 +1027,7 @@ ib_status_t ib_engine_manager_control_send(
     /* Allocate after sending the message to the server.
      * It is more likely that the server is down, so we defer allocating mem as
      * that should almost always succeed. */
-    resp = ib_mm_alloc(mm, IB_ENGINE_MANAGER_CONTROL_CHANNEL_MAX_MSG_SZ+1);
+    resp = ib_mm_alloc(mm, IB_ENGINE_MANAGER_CONTROL_CHANNEL_MAX_RESP_SZ+1);
     if (resp == NULL) {
         rc = IB_EALLOC;
         goto cleanup;
@@ -821,7 +1036,7 @@ ib_status_t ib_engine_manager_control_send(
     ssz = recvfrom(
         sock,
         resp,
-        IB_ENGINE_MANAGER_CONTROL_CHANNEL_MAX_MSG_SZ,
+        IB_ENGINE_MANAGER_CONTROL_CHANNEL_MAX_RESP_SZ,
         0,
         NULL,
         NULL);
@@ -905,6 +1120,7 @@ ib_status_t ib_engine_manager_control_manager_ctrl_register(
         { "disable",       manager_cmd_disable },
         { "cleanup",       manager_cmd_cleanup },
         { "engine_create", manager_cmd_engine_create },
+        { "stats",         manager_cmd_stats },
         { NULL,            NULL }
     };
 
@@ -29,6 +29,7 @@
 
 #include <ironbee/array.h>
 #include <ironbee/context_selection.h>
+#include <ironbee/counters.h>
 #include <ironbee/lock.h>
 #include <ironbee/logger.h>
 #include <ironbee/stream_typedef.h>
@@ -57,6 +58,8 @@ struct ib_auditlog_cfg_t {
     char         *index;         /**< Index file name. */
     FILE         *index_fp;      /**< Index file pointer. */
     ib_lock_t    *index_fp_lock; /**< Lock to protect index_fp. */
+    struct core_audit_index_t *index_queue; /**< Pending index lines. */
+    bool          index_cleanup; /**< Index close registered with owner? */
     ib_context_t *owner;         /**< Owning context. Only owner should edit. */
 };
 
@@ -141,6 +144,30 @@ struct ib_block_post_hook_t
 };
 typedef struct ib_block_post_hook_t ib_block_post_hook_t;
 
+/**
+ * Indexes of the engine counters.
+ *
+ * Each IB_ENGINE_COUNTER_PHASE_* index is the first of IB_RULE_PHASE_COUNT
+ * counters indexed by phase number.
+ *
+ * @sa ib_engine_stats_get()
+ */
+enum {
+    IB_ENGINE_COUNTER_CONNS_ACTIVE,
+    IB_ENGINE_COUNTER_CONNS,
+    IB_ENGINE_COUNTER_CONN_POOL_BYTES,
+    IB_ENGINE_COUNTER_TXS_ACTIVE,
+    IB_ENGINE_COUNTER_TXS,
+    IB_ENGINE_COUNTER_TX_POOL_BYTES,
+    IB_ENGINE_COUNTER_PHASE_RUNS,
+    IB_ENGINE_COUNTER_PHASE_RULES =
+        IB_ENGINE_COUNTER_PHASE_RUNS + IB_RULE_PHASE_COUNT,
+    IB_ENGINE_COUNTER_PHASE_USEC =
+        IB_ENGINE_COUNTER_PHASE_RULES + IB_RULE_PHASE_COUNT,
+    IB_ENGINE_COUNTER_NUM =
+        IB_ENGINE_COUNTER_PHASE_USEC + IB_RULE_PHASE_COUNT
+};
+
 /**
  * Engine handle.
  */
@@ -157,6 +184,7 @@ struct ib_engine_t {
     const char            *sensor_version;  /**< Sensor version string */
     const char            *sensor_hostname; /**< Sensor hostname */
     char                   instance_id[IB_UUID_LENGTH]; /**< Engine instance UUID */
+    bool                   time_ordered_ids; /**< Use v7 conn/tx UUIDs */
     ib_cfgparser_t        *cfgparser;       /**< Our configuration parser */
 
     /// @todo Only these should be private
@@ -165,12 +193,14 @@ struct ib_engine_t {
     ib_list_t             *contexts;        /**< Configuration contexts */
     ib_hash_t             *dirmap;          /**< Hash tracking directive map */
     ib_hash_t             *tfns;            /**< Hash tracking transforms */
+    ib_hash_t             *tfn_fusions;     /**< Fused transforms by chain */
     ib_hash_t             *operators;       /**< Operators by name */
     ib_hash_t             *stream_operators;/**< Stream operators by name*/
     ib_hash_t             *actions;         /**< Hash tracking rules */
     ib_rule_engine_t      *rule_engine;     /**< Rule engine data */
     ib_logger_t           *logger;          /**< The engine log object. */
     ib_var_config_t       *var_config;      /**< Data configuration. */
+    ib_counters_t         *counters;        /**< Statistics counters. */
 
     /* Hooks */
     ib_list_t *hooks[IB_STATE_NUM + 1]; /**< Registered hook callbacks */
@@ -30,7 +30,49 @@
 #include <ironbee/type_convert.h>
 
 #include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdlib.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * The depth of the message ring in a @ref ib_logger_writer_t.
+ *
+ * Must be a power of two.
+ */
+#define LOGGER_RING_DEPTH 1024
+
+/**
+ * The most records handed to a @ref ib_logger_batch_fn_t at once.
+ */
+#define LOGGER_BATCH_MAX 256
+
+/**
+ * A slot in a @ref logger_ring_t.
+ */
+typedef struct logger_ring_slot_t {
+    volatile size_t  seq; /**< Sequence number gating access to @a rec. */
+    void            *rec; /**< The formatted record. */
+} logger_ring_slot_t;
+
+/**
+ * Bounded lock-free ring of formatted records.
+ *
+ * This is a sequence-numbered ring: any number of threads may push
+ * records and any number may pop them without a lock. Each slot's
+ * sequence number tells a producer (seq == position) or a consumer
+ * (seq == position + 1) that it may claim the slot.
+ */
+typedef struct logger_ring_t {
+    logger_ring_slot_t *slots;            /**< LOGGER_RING_DEPTH slots. */
+    volatile size_t     head;             /**< Next position to push. */
+    char                pad[64];          /**< Keep head and tail apart. */
+    volatile size_t     tail;             /**< Next position to pop. */
+} logger_ring_t;
 
 /**
  * A collection of callbacks and function pointer that implement a logger.
@@ -45,8 +87,43 @@ struct ib_logger_writer_t {
     ib_logger_format_t    *format;      /**< Format a message.  */
     ib_logger_record_fn_t  record_fn;   /**< Signal a record is ready. */
     void                  *record_data; /**< Callback data. */
-    ib_queue_t            *records;     /**< Records for the log writer. */
-    ib_lock_t             *records_lck; /**< Guard the queue. */
+    logger_ring_t          records;     /**< Records for the log writer. */
+    ib_lock_t             *records_lck; /**< Serialize record consumers. */
+
+    /**
+     * Records pushed but not yet taken by a consumer.
+     *
+     * Producers count a record after it is pushed; consumers uncount it
+     * after it is popped. The producer that moves this from 0 calls
+     * ib_logger_writer_t::record_fn. This may briefly go negative.
+     */
+    volatile ssize_t       pending;
+    volatile size_t        enqueued;    /**< Records accepted. */
+    volatile size_t        dropped;     /**< Records dropped on overflow. */
+    volatile size_t        blocked;     /**< Producers that had to wait. */
+
+    /**
+     * Batch writer for writers added by ib_logger_writer_add_batched().
+     *
+     * NULL for writers added by ib_logger_writer_add().
+     */
+    ib_logger_batch_fn_t   batch_fn;
+    void                  *batch_data;  /**< Callback data. */
+
+    /* Background writer thread. Only used if batch_fn is set. */
+    pthread_t              thread;      /**< The writer thread. */
+    pthread_mutex_t        thread_mtx;  /**< Guards the fields below. */
+    pthread_cond_t         thread_cnd;  /**< Wakes the writer thread. */
+    bool                   thread_run;  /**< Is the thread running? */
+    bool                   thread_sig;  /**< Are records waiting? */
+    bool                   thread_stop; /**< Should the thread exit? */
+
+    /**
+     * Next batched writer in the process-wide registry.
+     *
+     * The registry lets the fork handlers reset writer state in the child.
+     */
+    ib_logger_writer_t    *fork_next;
 };
 
 //! Identify the type of a logger callback function.
@@ -83,6 +160,25 @@ typedef struct logger_callback_fn_t logger_callback_fn_t;
 struct ib_logger_t {
     ib_logger_level_t    level;       /**< The log level. */
 
+    /**
+     * What to do with a record when a writer's queue is full.
+     */
+    ib_logger_overflow_t overflow;
+
+    /**
+     * Do batched writers write from a thread?
+     *
+     * Set by ib_logger_writer_threads_start(). Writers without a running
+     * thread, because they were added later or the process forked, start
+     * one on their next record.
+     */
+    bool                 threads;
+
+    /**
+     * Longest time to block for @ref IB_LOGGER_OVERFLOW_BLOCK.
+     */
+    uint32_t             overflow_timeout_ms;
+
     /**
      * Memory manager defining lifetime of the logger.
      */
@@ -203,18 +299,246 @@ typedef struct logger_write_cbdata_t {
 } logger_write_cbdata_t;
 
 /**
- * The maximum depth of a message queue in a @ref ib_logger_writer_t.
+ * Initialize @a ring.
+ *
+ * @param[out] ring The ring.
+ * @param[in] mm Memory manager the slots are allocated from.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC On allocation failure.
+ */
+static ib_status_t logger_ring_init(logger_ring_t *ring, ib_mm_t mm)
+{
+    assert(ring != NULL);
+
+    size_t i;
+
+    ring->slots = ib_mm_alloc(mm, sizeof(*ring->slots) * LOGGER_RING_DEPTH);
+    if (ring->slots == NULL) {
+        return IB_EALLOC;
+    }
+    for (i = 0; i < LOGGER_RING_DEPTH; ++i) {
+        ring->slots[i].seq = i;
+        ring->slots[i].rec = NULL;
+    }
+    ring->head = 0;
+    ring->tail = 0;
+
+    return IB_OK;
+}
+
+/**
+ * Push @a rec onto @a ring.
+ *
+ * @param[in] ring The ring.
+ * @param[in] rec The record.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EAGAIN If the ring is full.
+ */
+static ib_status_t logger_ring_push(logger_ring_t *ring, void *rec)
+{
+    assert(ring != NULL);
+
+    logger_ring_slot_t *slot;
+    size_t              pos = ring->head;
+
+    for (;;) {
+        ssize_t diff;
+
+        slot = &(ring->slots[pos & (LOGGER_RING_DEPTH - 1)]);
+        diff = (ssize_t)slot->seq - (ssize_t)pos;
+        if (diff == 0) {
+            if (__sync_bool_compare_and_swap(&(ring->head), pos, pos + 1)) {
+                break;
+            }
+        }
+        else if (diff < 0) {
+            return IB_EAGAIN;
+        }
+        pos = ring->head;
+    }
+
+    slot->rec = rec;
+    __sync_synchronize();
+    slot->seq = pos + 1;
+
+    return IB_OK;
+}
+
+/**
+ * Pop the oldest record from @a ring.
+ *
+ * @param[in] ring The ring.
+ * @param[out] rec The record.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_ENOENT If the ring is empty.
  */
-static const size_t MAX_QUEUE_DEPTH = 1000;
+static ib_status_t logger_ring_pop(logger_ring_t *ring, void **rec)
+{
+    assert(ring != NULL);
+    assert(rec != NULL);
+
+    logger_ring_slot_t *slot;
+    size_t              pos = ring->tail;
+
+    for (;;) {
+        ssize_t diff;
+
+        slot = &(ring->slots[pos & (LOGGER_RING_DEPTH - 1)]);
+        diff = (ssize_t)slot->seq - (ssize_t)(pos + 1);
+        if (diff == 0) {
+            if (__sync_bool_compare_and_swap(&(ring->tail), pos, pos + 1)) {
+                break;
+            }
+        }
+        else if (diff < 0) {
+            return IB_ENOENT;
+        }
+        pos = ring->tail;
+    }
+
+    __sync_synchronize();
+    *rec = slot->rec;
+    slot->rec = NULL;
+    __sync_synchronize();
+    slot->seq = pos + LOGGER_RING_DEPTH;
+
+    return IB_OK;
+}
+
+/**
+ * Approximate number of records in @a ring.
+ *
+ * @param[in] ring The ring.
+ *
+ * @returns The number of records, which may be stale on return.
+ */
+static size_t logger_ring_depth(const logger_ring_t *ring)
+{
+    assert(ring != NULL);
+
+    size_t tail = ring->tail;
+    size_t head = ring->head;
+
+    return (head > tail) ? (head - tail) : 0;
+}
+
+/**
+ * Free a record formatted by @a writer.
+ *
+ * @param[in] logger The logger.
+ * @param[in] writer The writer that formatted @a rec.
+ * @param[in] rec The record.
+ */
+static void logger_free_rec(
+    ib_logger_t        *logger,
+    ib_logger_writer_t *writer,
+    void               *rec
+)
+{
+    if (writer->format->format_free_fn != NULL) {
+        writer->format->format_free_fn(
+            logger,
+            rec,
+            writer->format->format_free_cbdata);
+    }
+}
+
+/**
+ * Free a record that will not be handed to the writer.
+ *
+ * @param[in] logger The logger.
+ * @param[in] writer The writer that formatted @a rec.
+ * @param[in] rec The record.
+ */
+static void logger_drop(
+    ib_logger_t        *logger,
+    ib_logger_writer_t *writer,
+    void               *rec
+)
+{
+    (void)__sync_add_and_fetch(&(writer->dropped), 1);
+    logger_free_rec(logger, writer, rec);
+}
+
+/**
+ * Handle a full writer ring according to the logger's overflow policy.
+ *
+ * @param[in] logger The logger.
+ * @param[in] writer The writer whose ring is full.
+ * @param[in] rec The record that could not be pushed.
+ *
+ * @returns
+ * - IB_OK If @a rec was pushed.
+ * - IB_DECLINED If @a rec was dropped (and freed).
+ */
+static ib_status_t logger_write_overflow(
+    ib_logger_t        *logger,
+    ib_logger_writer_t *writer,
+    void               *rec
+)
+{
+    switch (logger->overflow) {
+        case IB_LOGGER_OVERFLOW_DROP_OLDEST: {
+            size_t attempt;
+
+            /* Make room by discarding the oldest records. Give up and
+             * drop the newest if consumers and producers keep racing us. */
+            for (attempt = 0; attempt < LOGGER_RING_DEPTH; ++attempt) {
+                void *old_rec;
+
+                if (logger_ring_pop(&(writer->records), &old_rec) == IB_OK) {
+                    (void)__sync_sub_and_fetch(&(writer->pending), 1);
+                    logger_drop(logger, writer, old_rec);
+                }
+                if (logger_ring_push(&(writer->records), rec) == IB_OK) {
+                    return IB_OK;
+                }
+            }
+            break;
+        }
+
+        case IB_LOGGER_OVERFLOW_BLOCK: {
+            ib_time_t       deadline = ib_clock_get_time() +
+                (ib_time_t)logger->overflow_timeout_ms * 1000;
+            struct timespec backoff = { 0, 50000 };
+
+            (void)__sync_add_and_fetch(&(writer->blocked), 1);
+            do {
+                nanosleep(&backoff, NULL);
+                if (logger_ring_push(&(writer->records), rec) == IB_OK) {
+                    return IB_OK;
+                }
+                if (backoff.tv_nsec < 1000000) {
+                    backoff.tv_nsec *= 2;
+                }
+            } while (ib_clock_get_time() < deadline);
+            break;
+        }
+
+        case IB_LOGGER_OVERFLOW_DROP_NEWEST:
+        default:
+            break;
+    }
+
+    logger_drop(logger, writer, rec);
+    return IB_DECLINED;
+}
 
 /**
  * The implementation for logger_log().
  *
  * This function will
  * - Format the message stored in @a cbdata as a @ref logger_write_cbdata_t.
- * - Lock the message queue.
- * - Enqueue the formatted message.
- * - If the message is the only message in the queue,
+ * - Push the formatted message onto the writer's ring without locking.
+ *   If the ring is full, the logger's @ref ib_logger_overflow_t policy
+ *   decides whether the message waits, replaces the oldest or is dropped.
+ * - If no other records were pending,
  *   ib_logger_writer_t::record_fn is called to signal the
  *   writer that at least one record is available.
  *
@@ -258,43 +582,24 @@ static ib_status_t logger_write(
         return rc;
     }
 
-    rc = ib_lock_lock(writer->records_lck);
-    if (rc != IB_OK) {
-        return rc;
-    }
-
-    /* Busy-wait until the queue has space available.
-     * This is emergency code to avoid a crash at the cost of a slowdown. */
-    while (ib_queue_size(writer->records) >= MAX_QUEUE_DEPTH) {
-        rc = ib_lock_unlock(writer->records_lck);
-        if (rc != IB_OK) {
-            return rc;
-        }
-
-        /* TODO - The number of times we need to sleep should be
-         *        audited. It is a good indicator of excessive logging or
-         *        proxy load. */
-        sleep(1);
-        rc = ib_lock_lock(writer->records_lck);
-        if (rc != IB_OK) {
-            return rc;
+    rc = logger_ring_push(&(writer->records), rec);
+    if (rc == IB_EAGAIN) {
+        rc = logger_write_overflow(logger, writer, rec);
+        if (rc == IB_DECLINED) {
+            return IB_OK;
         }
     }
-
-    rc = ib_queue_push_front(writer->records, rec);
     if (rc != IB_OK) {
         return rc;
     }
+    (void)__sync_add_and_fetch(&(writer->enqueued), 1);
 
-    /* If the queue is size=1, unlock and notify writers. */
-    if (ib_queue_size(writer->records) == 1) {
-        ib_lock_unlock(writer->records_lck);
-        rc = writer->record_fn(logger, writer, writer->record_data);
-        return rc;
+    /* If nothing else was pending, notify the writer. */
+    if (__sync_fetch_and_add(&(writer->pending), 1) == 0) {
+        return writer->record_fn(logger, writer, writer->record_data);
     }
 
-    ib_lock_unlock(writer->records_lck);
-    return rc;
+    return IB_OK;
 }
 
 /**
@@ -632,6 +937,8 @@ ib_status_t ib_logger_create(
     }
 
     l->level = level;
+    l->overflow = IB_LOGGER_OVERFLOW_BLOCK;
+    l->overflow_timeout_ms = IB_LOGGER_OVERFLOW_TIMEOUT_MS;
     l->mm = mm;
     rc = ib_list_create(&(l->writers), mm);
     if (rc != IB_OK) {
@@ -655,7 +962,29 @@ ib_status_t ib_logger_create(
     return IB_OK;
 }
 
-ib_status_t ib_logger_writer_add(
+/**
+ * Create a writer for @a logger.
+ *
+ * The caller adds the writer to ib_logger_t::writers.
+ *
+ * @param[in] logger The logger.
+ * @param[in] open_fn Open function.
+ * @param[in] open_data Callback data.
+ * @param[in] close_fn Close function.
+ * @param[in] close_data Callback data.
+ * @param[in] reopen_fn Reopen function.
+ * @param[in] reopen_data Callback data.
+ * @param[in] format Format functions.
+ * @param[in] record_fn Record function.
+ * @param[in] record_data Callback data.
+ * @param[out] pwriter The new writer.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC On allocation failure.
+ * - Other on lock failures.
+ */
+static ib_status_t logger_writer_create(
     ib_logger_t           *logger,
     ib_logger_open_fn_t    open_fn,
     void                  *open_data,
@@ -665,16 +994,18 @@ ib_status_t ib_logger_writer_add(
     void                  *reopen_data,
     ib_logger_format_t    *format,
     ib_logger_record_fn_t  record_fn,
-    void                  *record_data
+    void                  *record_data,
+    ib_logger_writer_t   **pwriter
 )
 {
     assert(logger != NULL);
     assert(logger->writers != NULL);
+    assert(pwriter != NULL);
 
     ib_status_t         rc;
     ib_logger_writer_t *writer;
 
-    writer = (ib_logger_writer_t *)ib_mm_alloc(logger->mm, sizeof(*writer));
+    writer = (ib_logger_writer_t *)ib_mm_calloc(logger->mm, 1, sizeof(*writer));
     if (writer == NULL) {
         return IB_EALLOC;
     }
@@ -688,27 +1019,531 @@ ib_status_t ib_logger_writer_add(
     writer->format      = format;
     writer->record_fn   = record_fn;
     writer->record_data = record_data;
-    rc = ib_queue_create(&(writer->records), logger->mm, IB_QUEUE_NEVER_SHRINK);
+    rc = logger_ring_init(&(writer->records), logger->mm);
     if (rc != IB_OK) {
         return rc;
     }
-    writer->records_lck = ib_mm_alloc(
-        logger->mm,
-        sizeof(*(writer->records_lck)));
-    if (writer->records_lck == NULL) {
-        return IB_EALLOC;
+    rc = ib_lock_create(&(writer->records_lck), logger->mm);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    *pwriter = writer;
+    return IB_OK;
+}
+
+ib_status_t ib_logger_writer_add(
+    ib_logger_t           *logger,
+    ib_logger_open_fn_t    open_fn,
+    void                  *open_data,
+    ib_logger_close_fn_t   close_fn,
+    void                  *close_data,
+    ib_logger_reopen_fn_t  reopen_fn,
+    void                  *reopen_data,
+    ib_logger_format_t    *format,
+    ib_logger_record_fn_t  record_fn,
+    void                  *record_data
+)
+{
+    ib_status_t         rc;
+    ib_logger_writer_t *writer;
+
+    rc = logger_writer_create(
+        logger,
+        open_fn, open_data,
+        close_fn, close_data,
+        reopen_fn, reopen_data,
+        format,
+        record_fn, record_data,
+        &writer);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    return ib_list_push(logger->writers, writer);
+}
+
+/**
+ * Drain a batched writer's ring into its ib_logger_writer_t::batch_fn.
+ *
+ * Records are handed over in batches of up to @ref LOGGER_BATCH_MAX
+ * and freed after each batch. Like ib_logger_dequeue(), this keeps
+ * draining until every pending record is taken.
+ *
+ * @param[in] logger The logger.
+ * @param[in] writer The writer.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - The first error returned by the batch function or lock.
+ */
+static ib_status_t logger_drain_batches(
+    ib_logger_t        *logger,
+    ib_logger_writer_t *writer
+)
+{
+    assert(logger != NULL);
+    assert(writer != NULL);
+    assert(writer->batch_fn != NULL);
+
+    ib_status_t rc;
+    ib_status_t batch_rc = IB_OK;
+    ssize_t     remaining;
+    void       *batch[LOGGER_BATCH_MAX];
+
+    rc = ib_lock_lock(writer->records_lck);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    do {
+        ssize_t count = 0;
+        size_t  n;
+
+        do {
+            ib_status_t trc;
+
+            for (n = 0; n < LOGGER_BATCH_MAX; ++n) {
+                if (logger_ring_pop(&(writer->records), &batch[n]) != IB_OK) {
+                    break;
+                }
+            }
+            if (n == 0) {
+                break;
+            }
+
+            trc = writer->batch_fn(logger, batch, n, writer->batch_data);
+            if (trc != IB_OK && batch_rc == IB_OK) {
+                batch_rc = trc;
+            }
+            for (size_t i = 0; i < n; ++i) {
+                logger_free_rec(logger, writer, batch[i]);
+            }
+            count += n;
+        } while (n == LOGGER_BATCH_MAX);
+
+        remaining = __sync_sub_and_fetch(&(writer->pending), count);
+        if (remaining > 0 && count == 0) {
+            sched_yield();
+        }
+    } while (remaining > 0);
+
+    ib_lock_unlock(writer->records_lck);
+
+    return batch_rc;
+}
+
+/**
+ * Background writer thread for a batched writer.
+ *
+ * @param[in] arg The @ref ib_logger_writer_t. Its ib_logger_writer_t::record_data
+ *            is the @ref ib_logger_t.
+ *
+ * @returns NULL.
+ */
+static void *logger_writer_thread(void *arg)
+{
+    ib_logger_writer_t *writer = (ib_logger_writer_t *)arg;
+    ib_logger_t        *logger = (ib_logger_t *)writer->record_data;
+    bool                stop;
+
+    do {
+        pthread_mutex_lock(&(writer->thread_mtx));
+        while (! writer->thread_sig && ! writer->thread_stop) {
+            pthread_cond_wait(&(writer->thread_cnd), &(writer->thread_mtx));
+        }
+        writer->thread_sig = false;
+        stop = writer->thread_stop;
+        pthread_mutex_unlock(&(writer->thread_mtx));
+
+        logger_drain_batches(logger, writer);
+    } while (! stop);
+
+    return NULL;
+}
+
+/**
+ * Start the thread of @a writer if it is not running.
+ *
+ * The caller holds ib_logger_writer_t::thread_mtx.
+ *
+ * @param[in] writer The writer.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EOTHER If the thread could not be created.
+ */
+static ib_status_t logger_writer_thread_start(ib_logger_writer_t *writer)
+{
+    assert(writer != NULL);
+    assert(writer->batch_fn != NULL);
+
+    if (! writer->thread_run) {
+        writer->thread_sig = true;
+        writer->thread_stop = false;
+        writer->thread_run = (pthread_create(
+            &(writer->thread), NULL, logger_writer_thread, writer) == 0);
+    }
+
+    return writer->thread_run ? IB_OK : IB_EOTHER;
+}
+
+/**
+ * Record function of batched writers.
+ *
+ * Wakes the writer thread if it is running, starting it first if the
+ * logger uses threads; otherwise drains the records in the calling
+ * thread.
+ *
+ * @param[in] logger The logger.
+ * @param[in] writer The writer.
+ * @param[in] data The logger. Unused.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - Other on batch function failure when writing inline.
+ */
+static ib_status_t logger_batch_record(
+    ib_logger_t        *logger,
+    ib_logger_writer_t *writer,
+    void               *data
+)
+{
+    bool run;
+
+    pthread_mutex_lock(&(writer->thread_mtx));
+    if (logger->threads) {
+        /* Not started yet, or lost in a fork(). On failure write inline. */
+        logger_writer_thread_start(writer);
+    }
+    run = writer->thread_run;
+    if (run) {
+        writer->thread_sig = true;
+        pthread_cond_signal(&(writer->thread_cnd));
+    }
+    pthread_mutex_unlock(&(writer->thread_mtx));
+
+    if (run) {
+        return IB_OK;
+    }
+    return logger_drain_batches(logger, writer);
+}
+
+/**
+ * Stop a batched writer's thread, if any, and write what is left.
+ *
+ * @param[in] logger The logger.
+ * @param[in] writer The writer.
+ */
+static void logger_writer_thread_stop(
+    ib_logger_t        *logger,
+    ib_logger_writer_t *writer
+)
+{
+    bool run;
+
+    if (writer->batch_fn == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&(writer->thread_mtx));
+    run = writer->thread_run;
+    writer->thread_stop = true;
+    pthread_cond_signal(&(writer->thread_cnd));
+    pthread_mutex_unlock(&(writer->thread_mtx));
+
+    if (run) {
+        pthread_join(writer->thread, NULL);
+        pthread_mutex_lock(&(writer->thread_mtx));
+        writer->thread_run = false;
+        writer->thread_stop = false;
+        pthread_mutex_unlock(&(writer->thread_mtx));
+    }
+
+    logger_drain_batches(logger, writer);
+}
+
+/**
+ * @name Fork handling.
+ *
+ * Writer threads do not exist in the child of a fork().  The handlers
+ * hold every batched writer's locks across the fork, so that no record is
+ * half taken, and then mark the writers of the child as having no thread.
+ * Records queued in the parent are left to the parent to write.
+ */
+/**@{*/
+
+/** Registers the fork handlers.  */
+static pthread_once_t      g_logger_fork_once = PTHREAD_ONCE_INIT;
+/** Are the fork handlers registered? */
+static bool                g_logger_fork_valid = false;
+/** Guards @ref g_logger_fork_writers. */
+static pthread_mutex_t     g_logger_fork_lck = PTHREAD_MUTEX_INITIALIZER;
+/** Registry of batched writers. */
+static ib_logger_writer_t *g_logger_fork_writers = NULL;
+
+/** Prepare fork handler. */
+static void logger_atfork_prepare(void)
+{
+    ib_logger_writer_t *writer;
+
+    pthread_mutex_lock(&g_logger_fork_lck);
+    for (
+        writer = g_logger_fork_writers;
+        writer != NULL;
+        writer = writer->fork_next
+    )
+    {
+        ib_lock_lock(writer->records_lck);
+        pthread_mutex_lock(&(writer->thread_mtx));
+    }
+}
+
+/** Parent fork handler. */
+static void logger_atfork_parent(void)
+{
+    ib_logger_writer_t *writer;
+
+    for (
+        writer = g_logger_fork_writers;
+        writer != NULL;
+        writer = writer->fork_next
+    )
+    {
+        pthread_mutex_unlock(&(writer->thread_mtx));
+        ib_lock_unlock(writer->records_lck);
+    }
+    pthread_mutex_unlock(&g_logger_fork_lck);
+}
+
+/** Child fork handler. */
+static void logger_atfork_child(void)
+{
+    ib_logger_writer_t *writer;
+
+    for (
+        writer = g_logger_fork_writers;
+        writer != NULL;
+        writer = writer->fork_next
+    )
+    {
+        ib_logger_t *logger = (ib_logger_t *)writer->record_data;
+        void        *rec;
+        ssize_t      count = 0;
+
+        while (logger_ring_pop(&(writer->records), &rec) == IB_OK) {
+            logger_free_rec(logger, writer, rec);
+            ++count;
+        }
+        writer->pending -= count;
+
+        /* The thread that waited on the condition is gone.  Destroying
+         * the condition would wait for it, so it is only reinitialized. */
+        pthread_cond_init(&(writer->thread_cnd), NULL);
+        writer->thread_run = false;
+        writer->thread_sig = false;
+        writer->thread_stop = false;
+
+        pthread_mutex_unlock(&(writer->thread_mtx));
+        ib_lock_unlock(writer->records_lck);
+    }
+    pthread_mutex_unlock(&g_logger_fork_lck);
+}
+
+/** Register the fork handlers.  Called via pthread_once(). */
+static void logger_atfork_register(void)
+{
+    g_logger_fork_valid = pthread_atfork(
+        logger_atfork_prepare,
+        logger_atfork_parent,
+        logger_atfork_child) == 0;
+}
+
+/**
+ * Add @a writer to the registry of batched writers.
+ *
+ * @param[in] writer The writer.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EOTHER If the fork handlers could not be registered.
+ */
+static ib_status_t logger_fork_register(ib_logger_writer_t *writer)
+{
+    assert(writer != NULL);
+
+    pthread_once(&g_logger_fork_once, logger_atfork_register);
+    if (! g_logger_fork_valid) {
+        return IB_EOTHER;
     }
-    rc = ib_lock_create(&(writer->records_lck), logger->mm)
-    ;
+
+    pthread_mutex_lock(&g_logger_fork_lck);
+    writer->fork_next = g_logger_fork_writers;
+    g_logger_fork_writers = writer;
+    pthread_mutex_unlock(&g_logger_fork_lck);
+
+    return IB_OK;
+}
+
+/**
+ * Remove @a writer from the registry of batched writers.
+ *
+ * @param[in] writer The writer.
+ */
+static void logger_fork_unregister(ib_logger_writer_t *writer)
+{
+    assert(writer != NULL);
+
+    ib_logger_writer_t **next;
+
+    pthread_mutex_lock(&g_logger_fork_lck);
+    for (
+        next = &g_logger_fork_writers;
+        *next != NULL;
+        next = &((*next)->fork_next)
+    )
+    {
+        if (*next == writer) {
+            *next = writer->fork_next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_logger_fork_lck);
+}
+
+/**@}*/
+
+/**
+ * Memory manager cleanup of a batched writer.
+ *
+ * @param[in] cbdata The @ref ib_logger_writer_t.
+ */
+static void logger_writer_cleanup(void *cbdata)
+{
+    ib_logger_writer_t *writer = (ib_logger_writer_t *)cbdata;
+
+    logger_writer_thread_stop((ib_logger_t *)writer->record_data, writer);
+    logger_fork_unregister(writer);
+    pthread_cond_destroy(&(writer->thread_cnd));
+    pthread_mutex_destroy(&(writer->thread_mtx));
+}
+
+ib_status_t ib_logger_writer_add_batched(
+    ib_logger_t           *logger,
+    ib_logger_open_fn_t    open_fn,
+    void                  *open_data,
+    ib_logger_close_fn_t   close_fn,
+    void                  *close_data,
+    ib_logger_reopen_fn_t  reopen_fn,
+    void                  *reopen_data,
+    ib_logger_format_t    *format,
+    ib_logger_batch_fn_t   batch_fn,
+    void                  *batch_data
+)
+{
+    assert(logger != NULL);
+    assert(format != NULL);
+    assert(batch_fn != NULL);
+
+    ib_status_t         rc;
+    ib_logger_writer_t *writer;
+
+    rc = logger_writer_create(
+        logger,
+        open_fn, open_data,
+        close_fn, close_data,
+        reopen_fn, reopen_data,
+        format,
+        logger_batch_record, logger,
+        &writer);
     if (rc != IB_OK) {
         return rc;
     }
 
-    rc = ib_list_push(logger->writers, writer);
+    if (pthread_mutex_init(&(writer->thread_mtx), NULL) != 0) {
+        return IB_EALLOC;
+    }
+    if (pthread_cond_init(&(writer->thread_cnd), NULL) != 0) {
+        pthread_mutex_destroy(&(writer->thread_mtx));
+        return IB_EALLOC;
+    }
+    rc = logger_fork_register(writer);
+    if (rc != IB_OK) {
+        pthread_cond_destroy(&(writer->thread_cnd));
+        pthread_mutex_destroy(&(writer->thread_mtx));
+        return rc;
+    }
+    rc = ib_mm_register_cleanup(logger->mm, logger_writer_cleanup, writer);
     if (rc != IB_OK) {
+        logger_fork_unregister(writer);
+        pthread_cond_destroy(&(writer->thread_cnd));
+        pthread_mutex_destroy(&(writer->thread_mtx));
         return rc;
     }
 
+    writer->batch_data = batch_data;
+    writer->batch_fn   = batch_fn;
+
+    if (logger->threads) {
+        pthread_mutex_lock(&(writer->thread_mtx));
+        rc = logger_writer_thread_start(writer);
+        pthread_mutex_unlock(&(writer->thread_mtx));
+        if (rc != IB_OK) {
+            return rc;
+        }
+    }
+
+    return ib_list_push(logger->writers, writer);
+}
+
+ib_status_t ib_logger_writer_threads_start(
+    ib_logger_t *logger
+)
+{
+    assert(logger != NULL);
+    assert(logger->writers != NULL);
+
+    const ib_list_node_t *node;
+
+    logger->threads = true;
+
+    IB_LIST_LOOP_CONST(logger->writers, node) {
+        ib_logger_writer_t *writer =
+            (ib_logger_writer_t *)ib_list_node_data_const(node);
+        ib_status_t         rc;
+
+        if (writer->batch_fn == NULL) {
+            continue;
+        }
+
+        pthread_mutex_lock(&(writer->thread_mtx));
+        rc = logger_writer_thread_start(writer);
+        pthread_mutex_unlock(&(writer->thread_mtx));
+
+        if (rc != IB_OK) {
+            return rc;
+        }
+    }
+
+    return IB_OK;
+}
+
+/**
+ * Stop the writer thread of @a writer, if any.
+ *
+ * @param[in] logger The logger.
+ * @param[in] writer The writer.
+ * @param[in] data Callback data. NULL.
+ *
+ * @returns IB_OK.
+ */
+static ib_status_t logger_thread_stop(
+    ib_logger_t        *logger,
+    ib_logger_writer_t *writer,
+    void               *data
+)
+{
+    logger_writer_thread_stop(logger, writer);
     return IB_OK;
 }
 
@@ -719,6 +1554,7 @@ ib_status_t ib_logger_writer_clear(
     assert(logger != NULL);
     assert(logger->writers != NULL);
 
+    for_each_writer(logger, logger_thread_stop, NULL);
     ib_list_clear(logger->writers);
 
     return IB_OK;
@@ -795,6 +1631,10 @@ ib_status_t ib_logger_close(
 {
     assert(logger != NULL);
 
+    /* Write out everything queued before closing. */
+    logger->threads = false;
+    for_each_writer(logger, logger_thread_stop, NULL);
+
     return for_each_writer(logger, logger_close, NULL);
 }
 
@@ -872,9 +1712,9 @@ ib_status_t ib_logger_dequeue(
 {
     assert(logger != NULL);
     assert(writer != NULL);
-    assert(writer->records != NULL);
 
     ib_status_t rc;
+    ssize_t remaining;
     logger_handler_cbdata_t logger_handler_cbdata = {
         .logger    = logger,
         .user_fn   = handler,
@@ -888,14 +1728,67 @@ ib_status_t ib_logger_dequeue(
         return rc;
     }
 
-    rc = ib_queue_dequeue_all_to_function(
-        writer->records,
-        logger_handler,
-        &logger_handler_cbdata);
+    /* Drain until every record counted in pending has been taken.
+     * A record pushed after our last pop but counted before our
+     * subtraction leaves pending positive, so we go around again. */
+    do {
+        ssize_t count = 0;
+        void *rec;
+
+        while (logger_ring_pop(&(writer->records), &rec) == IB_OK) {
+            logger_handler(rec, &logger_handler_cbdata);
+            ++count;
+        }
+        remaining = __sync_sub_and_fetch(&(writer->pending), count);
+        if (remaining > 0 && count == 0) {
+            sched_yield();
+        }
+    } while (remaining > 0);
 
     ib_lock_unlock(writer->records_lck);
 
-    return rc;
+    return IB_OK;
+}
+
+void ib_logger_overflow_set(
+    ib_logger_t          *logger,
+    ib_logger_overflow_t  overflow,
+    uint32_t              timeout_ms
+)
+{
+    assert(logger != NULL);
+
+    logger->overflow = overflow;
+    logger->overflow_timeout_ms = timeout_ms;
+}
+
+void ib_logger_stats_get(
+    ib_logger_t       *logger,
+    ib_logger_stats_t *stats
+)
+{
+    assert(logger != NULL);
+    assert(logger->writers != NULL);
+    assert(stats != NULL);
+
+    const ib_list_node_t *node;
+
+    memset(stats, 0, sizeof(*stats));
+
+    IB_LIST_LOOP_CONST(logger->writers, node) {
+        const ib_logger_writer_t *writer =
+            (const ib_logger_writer_t *)ib_list_node_data_const(node);
+        size_t depth = logger_ring_depth(&(writer->records));
+
+        stats->depth += depth;
+        if (depth > stats->max_depth) {
+            stats->max_depth = depth;
+        }
+        stats->enqueued += writer->enqueued;
+        stats->dropped  += writer->dropped;
+        stats->blocked  += writer->blocked;
+    }
+    stats->capacity = LOGGER_RING_DEPTH;
 }
 
 size_t ib_logger_writer_count(ib_logger_t *logger) {
@@ -1135,36 +2028,116 @@ out_of_mem:
     return IB_EALLOC;
 }
 
-static void default_log_writer(void *record, void *cbdata) {
-    assert(record != NULL);
-    assert(cbdata != NULL);
+/**
+ * Write all of @a iov to @a fd, retrying partial and interrupted writes.
+ *
+ * @param[in] fd File descriptor.
+ * @param[in,out] iov The vectors. Modified as data is written.
+ * @param[in] iovcnt The number of vectors.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EOTHER On write failure.
+ */
+static ib_status_t logger_writev_all(int fd, struct iovec *iov, int iovcnt)
+{
+    while (iovcnt > 0) {
+        ssize_t written = writev(fd, iov, iovcnt);
 
-    default_logger_cfg_t     *cfg = (default_logger_cfg_t *)cbdata;
-    ib_logger_standard_msg_t *msg = (ib_logger_standard_msg_t *)record;
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return IB_EOTHER;
+        }
 
-    fprintf(
-        cfg->file,
-        "%s %.*s\n",
-        msg->prefix,
-        (int)msg->msg_sz,
-        (char *)msg->msg);
-    fflush(cfg->file);
+        /* Skip what was written. */
+        while (iovcnt > 0 && (size_t)written >= iov->iov_len) {
+            written -= iov->iov_len;
+            ++iov;
+            --iovcnt;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+
+    return IB_OK;
+}
+
+ib_status_t ib_logger_standard_msg_write_batch(
+    FILE         *file,
+    void * const *records,
+    size_t        nrecords
+)
+{
+    assert(file != NULL);
+    assert(records != NULL);
+
+    /* Four vectors per record: prefix, space, message and newline. */
+    static const size_t c_iov_per_rec = 4;
+    static char         c_space[] = " ";
+    static char         c_newline[] = "\n";
+    struct iovec        iov[LOGGER_BATCH_MAX * 4];
+    size_t              max_recs = LOGGER_BATCH_MAX;
+    int                 fd = fileno(file);
+
+    if (max_recs * c_iov_per_rec > IOV_MAX) {
+        max_recs = IOV_MAX / c_iov_per_rec;
+    }
+
+    /* Anything written through stdio must come first. */
+    fflush(file);
+
+    while (nrecords > 0) {
+        size_t      n = (nrecords < max_recs) ? nrecords : max_recs;
+        size_t      i;
+        ib_status_t rc;
+
+        for (i = 0; i < n; ++i) {
+            const ib_logger_standard_msg_t *msg =
+                (const ib_logger_standard_msg_t *)records[i];
+            struct iovec *v = &iov[i * c_iov_per_rec];
+
+            v[0].iov_base = msg->prefix;
+            v[0].iov_len  = strlen(msg->prefix);
+            v[1].iov_base = c_space;
+            v[1].iov_len  = 1;
+            v[2].iov_base = msg->msg;
+            v[2].iov_len  = msg->msg_sz;
+            v[3].iov_base = c_newline;
+            v[3].iov_len  = 1;
+        }
+
+        rc = logger_writev_all(fd, iov, (int)(n * c_iov_per_rec));
+        if (rc != IB_OK) {
+            return rc;
+        }
+
+        records  += n;
+        nrecords -= n;
+    }
+
+    return IB_OK;
 }
 
 /**
- * The default logger's record call.
+ * The default logger's batch call.
  */
-static ib_status_t default_logger_record(
-    ib_logger_t        *logger,
-    ib_logger_writer_t *writer,
-    void               *data
+static ib_status_t default_logger_batch(
+    ib_logger_t  *logger,
+    void * const *records,
+    size_t        nrecords,
+    void         *data
 )
 {
     assert(logger != NULL);
-    assert(writer != NULL);
     assert(data != NULL);
 
-    return ib_logger_dequeue(logger, writer, default_log_writer, data);
+    default_logger_cfg_t *cfg = (default_logger_cfg_t *)data;
+
+    return ib_logger_standard_msg_write_batch(cfg->file, records, nrecords);
 }
 
 ib_status_t ib_logger_writer_add_default(
@@ -1183,7 +2156,7 @@ ib_status_t ib_logger_writer_add_default(
 
     cfg->file = logfile;
 
-    return ib_logger_writer_add(
+    return ib_logger_writer_add_batched(
         logger,
         NULL, /* Open. */
         NULL,
@@ -1192,7 +2165,7 @@ ib_status_t ib_logger_writer_add_default(
         NULL, /* Reopen. */
         NULL,
         &default_format,
-        default_logger_record,
+        default_logger_batch,
         cfg
     );
 }
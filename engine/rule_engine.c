@@ -49,6 +49,8 @@
 
 #include <assert.h>
 #include <inttypes.h>
+#include <limits.h>
+#include <string.h>
 
 /**
  * Phase Flags
@@ -598,6 +600,9 @@ static ib_status_t rule_exec_create(ib_tx_t *tx,
     exec->rule_status = IB_OK;
     exec->rule_result = 0;
     exec->exec_log = NULL;
+    exec->tfn_cache = NULL;
+    exec->tfn_cache_hits = 0;
+    exec->tfn_cache_misses = 0;
 
 #ifdef IB_RULE_TRACE
     exec->traces = ib_mm_calloc(
@@ -809,16 +814,454 @@ static ib_status_t execute_tfn_single(const ib_rule_exec_t  *rule_exec,
     return IB_OK;
 }
 
+/**
+ * Longest transformation cache key, in bytes.
+ *
+ * Chains with longer keys (very long parameters) are not cached.
+ */
+#define TFN_CACHE_KEY_MAX 512
+
+/**
+ * Longest transformation chain that is cached.
+ */
+#define TFN_CACHE_DEPTH_MAX 32
+
+/**
+ * Transformation cache source value identity.
+ *
+ * This is the leading part of every transformation cache key.  Besides
+ * the identity of the value it records enough of its contents (data
+ * pointer and length, or number) that a value modified in place during the
+ * transaction does not match stale results.
+ */
+typedef struct {
+    const void *identity; /**< Field. */
+    const void *data;     /**< Data pointer, if any. */
+    uint64_t    length;   /**< Length or number. */
+    ib_ftype_t  type;     /**< Field type. */
+} tfn_cache_source_t;
+
+/**
+ * Describe @a value as a transformation cache source.
+ *
+ * @param[in] value The untransformed value.
+ * @param[out] source The source description; zeroed before filling so it
+ *             can be compared bytewise.
+ *
+ * @returns true if @a value can be cached, false otherwise.
+ */
+static bool tfn_cache_source(
+    const ib_field_t   *value,
+    tfn_cache_source_t *source
+)
+{
+    assert(value != NULL);
+    assert(source != NULL);
+
+    ib_status_t rc;
+
+    memset(source, 0, sizeof(*source));
+
+    /* The getter of a dynamic field may return anything. */
+    if (ib_field_is_dynamic(value)) {
+        return false;
+    }
+
+    source->identity = value;
+    source->type     = value->type;
+
+    switch (value->type) {
+    case IB_FTYPE_BYTESTR: {
+        const ib_bytestr_t *bs;
+
+        rc = ib_field_value(value, ib_ftype_bytestr_out(&bs));
+        if (rc != IB_OK || bs == NULL) {
+            return false;
+        }
+        source->data   = ib_bytestr_const_ptr(bs);
+        source->length = ib_bytestr_length(bs);
+        return true;
+    }
+    case IB_FTYPE_NULSTR: {
+        const char *s;
+
+        rc = ib_field_value(value, ib_ftype_nulstr_out(&s));
+        if (rc != IB_OK || s == NULL) {
+            return false;
+        }
+        source->data   = s;
+        source->length = strlen(s);
+        return true;
+    }
+    case IB_FTYPE_NUM: {
+        ib_num_t n;
+
+        rc = ib_field_value(value, ib_ftype_num_out(&n));
+        if (rc != IB_OK) {
+            return false;
+        }
+        source->length = (uint64_t)n;
+        return true;
+    }
+    case IB_FTYPE_TIME: {
+        ib_time_t t;
+
+        rc = ib_field_value(value, ib_ftype_time_out(&t));
+        if (rc != IB_OK) {
+            return false;
+        }
+        source->length = (uint64_t)t;
+        return true;
+    }
+    default:
+        /* Lists, such as a whole collection, are not cached as a whole:
+         * actions such as setvar replace or modify their elements in
+         * place, leaving neither the list nor its size changed.  Their
+         * elements are cached by execute_tfns_list(). */
+        return false;
+    }
+}
+
+/**
+ * Build the transformation cache key for a target's transformation chain.
+ *
+ * The key is the source description followed by, for each transformation
+ * instance, its transformation and parameters.  The key of the first @a n
+ * transformations is the first @a prefix_lengths[@a n - 1] bytes of @a key,
+ * so that instances created by different rules share cache entries.
+ *
+ * @param[in] source Source description.
+ * @param[in] tfn_list List of @ref ib_transformation_inst_t.
+ * @param[out] key Buffer of TFN_CACHE_KEY_MAX bytes.
+ * @param[out] prefix_lengths Array of TFN_CACHE_DEPTH_MAX key lengths.
+ *
+ * @returns true if the key fits, false if the chain is not cacheable.
+ */
+static bool tfn_cache_key(
+    const tfn_cache_source_t *source,
+    const ib_list_t          *tfn_list,
+    char                     *key,
+    size_t                   *prefix_lengths
+)
+{
+    assert(source != NULL);
+    assert(tfn_list != NULL);
+    assert(key != NULL);
+    assert(prefix_lengths != NULL);
+
+    const ib_list_node_t *node;
+    size_t                length = sizeof(*source);
+    size_t                n = 0;
+
+    if (ib_list_elements(tfn_list) > TFN_CACHE_DEPTH_MAX) {
+        return false;
+    }
+
+    memcpy(key, source, sizeof(*source));
+
+    IB_LIST_LOOP_CONST(tfn_list, node) {
+        const ib_transformation_inst_t *tfn_inst =
+            (const ib_transformation_inst_t *)ib_list_node_data_const(node);
+        const ib_transformation_t *tfn =
+            ib_transformation_inst_transformation(tfn_inst);
+        const char *params = ib_transformation_inst_parameters(tfn_inst);
+        size_t      params_length = (params == NULL) ? 0 : strlen(params);
+
+        if (
+            length + sizeof(tfn) + params_length + 1 > TFN_CACHE_KEY_MAX
+        ) {
+            return false;
+        }
+
+        memcpy(key + length, &tfn, sizeof(tfn));
+        length += sizeof(tfn);
+        memcpy(key + length, params == NULL ? "" : params, params_length + 1);
+        length += params_length + 1;
+
+        prefix_lengths[n++] = length;
+    }
+
+    return true;
+}
+
+/**
+ * Can @a tfn_list be applied to a list one element at a time?
+ *
+ * True if no transformation in the chain handles lists itself, as
+ * ib_transformation_inst_execute() then applies each to every element.
+ */
+static bool tfn_chain_elementwise(const ib_list_t *tfn_list)
+{
+    assert(tfn_list != NULL);
+
+    const ib_list_node_t *node;
+
+    IB_LIST_LOOP_CONST(tfn_list, node) {
+        const ib_transformation_inst_t *tfn_inst =
+            (const ib_transformation_inst_t *)ib_list_node_data_const(node);
+
+        if (
+            ib_transformation_handle_list(
+                ib_transformation_inst_transformation(tfn_inst))
+        ) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Wrap @a n fields in a list field named as @a like.
+ *
+ * @param[in] rule_exec The rule execution object
+ * @param[in] like Field whose name to use.
+ * @param[in] fields Fields to wrap.
+ * @param[in] n Number of @a fields.
+ * @param[out] result The list field.
+ *
+ * @returns Status code
+ */
+static ib_status_t tfn_list_field(
+    const ib_rule_exec_t  *rule_exec,
+    const ib_field_t      *like,
+    const ib_field_t     **fields,
+    size_t                 n,
+    const ib_field_t     **result
+)
+{
+    ib_status_t  rc;
+    ib_list_t   *list;
+    ib_field_t  *field;
+
+    rc = ib_list_create(&list, rule_exec->tx->mm);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    for (size_t i = 0; i < n; ++i) {
+        rc = ib_list_push(list, (void *)fields[i]);
+        if (rc != IB_OK) {
+            return rc;
+        }
+    }
+    rc = ib_field_create(&field, rule_exec->tx->mm,
+                         like->name, like->nlen,
+                         IB_FTYPE_LIST, ib_ftype_list_in(list));
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    *result = field;
+    return IB_OK;
+}
+
+/**
+ * Execute an element-wise list of transformations on each element of a list.
+ *
+ * The result is that of running the chain on the list, but each element
+ * is looked up in and added to ib_rule_exec_t::tfn_cache as a value of its
+ * own.  Later rules targeting the same collection, such as ARGS, then
+ * reuse the results for every element that has not changed.
+ *
+ * @param[in] rule_exec The rule execution object
+ * @param[in] tfn_list Transformations; see tfn_chain_elementwise().
+ * @param[in] value List field.
+ * @param[out] result Pointer to field in which to store the result
+ *
+ * @returns Status code
+ */
+static ib_status_t execute_tfns_list(ib_rule_exec_t *rule_exec,
+                                     const ib_list_t *tfn_list,
+                                     const ib_field_t *value,
+                                     const ib_field_t **result)
+{
+    assert(rule_exec != NULL);
+    assert(tfn_list != NULL);
+    assert(value != NULL);
+    assert(result != NULL);
+
+    ib_status_t           rc;
+    ib_mm_t               mm = rule_exec->tx->mm;
+    const ib_list_t      *elements;
+    const ib_list_node_t *node;
+    const ib_field_t    **cur;
+    tfn_cache_source_t   *sources;
+    size_t               *cached;
+    const ib_field_t     *in_field = value;
+    const ib_field_t     *out = NULL;
+    tfn_cache_source_t    no_source;
+    char                  key[TFN_CACHE_KEY_MAX];
+    size_t                prefix_lengths[TFN_CACHE_DEPTH_MAX];
+    bool                  cacheable;
+    size_t                reused = 0;
+    size_t                num = 0;
+    size_t                n;
+    size_t                i;
+
+    rc = ib_field_value(value, ib_ftype_list_out(&elements));
+    if (rc != IB_OK) {
+        return rc;
+    }
+    n = ib_list_elements(elements);
+
+    cur = ib_mm_alloc(mm, (n + 1) * sizeof(*cur));
+    sources = ib_mm_alloc(mm, (n + 1) * sizeof(*sources));
+    cached = ib_mm_calloc(mm, n + 1, sizeof(*cached));
+    if (cur == NULL || sources == NULL || cached == NULL) {
+        return IB_EALLOC;
+    }
+
+    /* The chain part of the key is shared; each element's source is
+     * copied over its start before use. */
+    memset(&no_source, 0, sizeof(no_source));
+    cacheable = tfn_cache_key(&no_source, tfn_list, key, prefix_lengths);
+
+    if (cacheable && rule_exec->tfn_cache == NULL) {
+        rc = ib_hash_create(&(rule_exec->tfn_cache), mm);
+        if (rc != IB_OK) {
+            ib_rule_log_warn(rule_exec,
+                             "Failed to create transformation cache: %s",
+                             ib_status_to_string(rc));
+            cacheable = false;
+        }
+    }
+
+    /* Find the longest chain prefix already computed for each element. */
+    i = 0;
+    IB_LIST_LOOP_CONST(elements, node) {
+        cur[i] = (const ib_field_t *)ib_list_node_data_const(node);
+        if (cacheable && tfn_cache_source(cur[i], &sources[i])) {
+            memcpy(key, &sources[i], sizeof(sources[i]));
+            for (
+                cached[i] = ib_list_elements(tfn_list);
+                cached[i] > 0;
+                --cached[i]
+            ) {
+                rc = ib_hash_get_ex(rule_exec->tfn_cache, &out,
+                                    key, prefix_lengths[cached[i] - 1]);
+                if (rc == IB_OK) {
+                    break;
+                }
+            }
+            if (cached[i] > 0) {
+                ++reused;
+            }
+        }
+        else {
+            /* Never stored or looked up. */
+            cached[i] = SIZE_MAX;
+        }
+        ++i;
+    }
+
+    /* Apply each transformation to every element. */
+    IB_LIST_LOOP_CONST(tfn_list, node) {
+        const ib_transformation_inst_t  *tfn_inst =
+            (const ib_transformation_inst_t *)ib_list_node_data_const(node);
+        bool all_cached = (n > 0);
+
+        ++num;
+        ib_rule_log_exec_tfn_inst_add(rule_exec->exec_log, tfn_inst);
+
+        for (i = 0; i < n; ++i) {
+            bool store = (cached[i] != SIZE_MAX);
+
+            /* Reuse a result computed by an earlier rule. */
+            if (store && num <= cached[i]) {
+                ++(rule_exec->tfn_cache_hits);
+
+                /* Only intermediate results are needed for the log. */
+                if (rule_exec->exec_log == NULL && num < cached[i]) {
+                    continue;
+                }
+                memcpy(key, &sources[i], sizeof(sources[i]));
+                rc = ib_hash_get_ex(rule_exec->tfn_cache, &out,
+                                    key, prefix_lengths[num - 1]);
+                if (rc != IB_OK) {
+                    return rc;
+                }
+                ib_rule_log_exec_tfn_value(rule_exec->exec_log,
+                                           cur[i], out, IB_OK);
+                cur[i] = out;
+                continue;
+            }
+
+            all_cached = false;
+            if (store) {
+                ++(rule_exec->tfn_cache_misses);
+            }
+
+            rc = execute_tfn_single(rule_exec, tfn_inst, cur[i], &out);
+            if (rc != IB_OK) {
+                ib_rule_log_error(
+                    rule_exec,
+                    "Error executing target transformation %s: %s",
+                    ib_transformation_name(
+                        ib_transformation_inst_transformation(tfn_inst)
+                    ),
+                    ib_status_to_string(rc)
+                );
+                ib_rule_log_exec_tfn_inst_fin(
+                    rule_exec->exec_log, tfn_inst, in_field, NULL, rc);
+                return rc;
+            }
+
+            /* Remember the result for later rules. */
+            if (store) {
+                char *stored_key;
+
+                memcpy(key, &sources[i], sizeof(sources[i]));
+                stored_key = ib_mm_memdup(mm, key, prefix_lengths[num - 1]);
+                if (stored_key != NULL) {
+                    ib_hash_set_ex(rule_exec->tfn_cache,
+                                   stored_key, prefix_lengths[num - 1],
+                                   (void *)out);
+                }
+            }
+            cur[i] = out;
+        }
+
+        /* Whole lists are only built for the log between steps. */
+        if (rule_exec->exec_log != NULL) {
+            rc = tfn_list_field(rule_exec, value, cur, n, &out);
+            if (rc != IB_OK) {
+                return rc;
+            }
+            if (all_cached) {
+                ib_rule_log_exec_tfn_inst_cached(rule_exec->exec_log);
+            }
+            ib_rule_log_exec_tfn_inst_fin(
+                rule_exec->exec_log, tfn_inst, in_field, out, IB_OK);
+            in_field = out;
+        }
+    }
+
+    if (reused > 0) {
+        ib_rule_log_trace(rule_exec,
+                          "Reused cached transformations of %zu of %zu "
+                          "elements",
+                          reused, n);
+    }
+
+    return tfn_list_field(rule_exec, value, cur, n, result);
+}
+
 /**
  * Execute list of transformations on a target.
  *
+ * Results of every prefix of the transformation chain are remembered in
+ * ib_rule_exec_t::tfn_cache, so a later rule applying the same
+ * transformations to the same value continues from the longest prefix
+ * already computed in this transaction.  Lists are cached per element by
+ * execute_tfns_list() when the chain allows it.
+ *
  * @param[in] rule_exec The rule execution object
  * @param[in] value Initial value of the target field
  * @param[out] result Pointer to field in which to store the result
  *
  * @returns Status code
  */
-static ib_status_t execute_tfns(const ib_rule_exec_t *rule_exec,
+static ib_status_t execute_tfns(ib_rule_exec_t *rule_exec,
                                 const ib_field_t *value,
                                 const ib_field_t **result)
 {
@@ -829,6 +1272,13 @@ static ib_status_t execute_tfns(const ib_rule_exec_t *rule_exec,
     const ib_list_node_t *node = NULL;
     const ib_field_t     *in_field;
     const ib_field_t     *out = NULL;
+    tfn_cache_source_t    source;
+    char                  key[TFN_CACHE_KEY_MAX];
+    size_t                prefix_lengths[TFN_CACHE_DEPTH_MAX];
+    bool                  cacheable;
+    size_t                cached = 0;
+    size_t                num = 0;
+    const ib_list_t      *tfn_list;
 
     /* No transformations?  Do nothing. */
     if (value == NULL) {
@@ -841,17 +1291,87 @@ static ib_status_t execute_tfns(const ib_rule_exec_t *rule_exec,
         return IB_OK;
     }
 
-    ib_rule_log_trace(rule_exec, "Executing %zd transformations",
-                      ib_list_elements(rule_exec->target->tfn_list));
+    /* Run the fused chain if the rule has been registered. */
+    tfn_list = rule_exec->target->tfn_fused;
+    if (tfn_list == NULL) {
+        tfn_list = rule_exec->target->tfn_list;
+    }
+
+    ib_rule_log_trace(rule_exec, "Executing %zu transformations",
+                      ib_list_elements(tfn_list));
+
+    if (value->type == IB_FTYPE_LIST && tfn_chain_elementwise(tfn_list)) {
+        return execute_tfns_list(rule_exec, tfn_list, value, result);
+    }
+
+    cacheable =
+        tfn_cache_source(value, &source) &&
+        tfn_cache_key(&source, tfn_list, key, prefix_lengths);
+
+    if (cacheable && rule_exec->tfn_cache == NULL) {
+        rc = ib_hash_create(&(rule_exec->tfn_cache), rule_exec->tx->mm);
+        if (rc != IB_OK) {
+            ib_rule_log_warn(rule_exec,
+                             "Failed to create transformation cache: %s",
+                             ib_status_to_string(rc));
+            cacheable = false;
+        }
+    }
+
+    /* Find the longest chain prefix already computed for this value. */
+    if (cacheable) {
+        for (
+            cached = ib_list_elements(tfn_list);
+            cached > 0;
+            --cached
+        ) {
+            rc = ib_hash_get_ex(rule_exec->tfn_cache, &out,
+                                key, prefix_lengths[cached - 1]);
+            if (rc == IB_OK) {
+                break;
+            }
+        }
+    }
 
     /*
      * Loop through all of the target's transformations.
      */
     in_field = value;
-    IB_LIST_LOOP_CONST(rule_exec->target->tfn_list, node) {
+    IB_LIST_LOOP_CONST(tfn_list, node) {
         const ib_transformation_inst_t  *tfn_inst =
             (const ib_transformation_inst_t *)ib_list_node_data_const(node);
 
+        ++num;
+
+        /* Reuse a result computed by an earlier rule. */
+        if (num <= cached) {
+            ++(rule_exec->tfn_cache_hits);
+
+            /* Only intermediate results are needed for the log. */
+            if (rule_exec->exec_log == NULL && num < cached) {
+                continue;
+            }
+            rc = ib_hash_get_ex(rule_exec->tfn_cache, &out,
+                                key, prefix_lengths[num - 1]);
+            if (rc != IB_OK) {
+                return rc;
+            }
+            ib_rule_log_exec_tfn_inst_add(rule_exec->exec_log, tfn_inst);
+            ib_rule_log_exec_tfn_value(rule_exec->exec_log,
+                                       in_field, out, IB_OK);
+            ib_rule_log_exec_tfn_inst_cached(rule_exec->exec_log);
+            ib_rule_log_exec_tfn_inst_fin(
+                rule_exec->exec_log,
+                tfn_inst,
+                in_field,
+                out,
+                IB_OK);
+            in_field = out;
+            continue;
+        }
+
+        ++(rule_exec->tfn_cache_misses);
+
         /* Run it */
         ib_rule_log_trace(
             rule_exec,
@@ -890,10 +1410,28 @@ static ib_status_t execute_tfns(const ib_rule_exec_t *rule_exec,
             return IB_EINVAL;
         }
 
+        /* Remember the result for later rules. */
+        if (cacheable && rc == IB_OK) {
+            char *stored_key = ib_mm_memdup(rule_exec->tx->mm,
+                                            key, prefix_lengths[num - 1]);
+            if (stored_key != NULL) {
+                ib_hash_set_ex(rule_exec->tfn_cache,
+                               stored_key, prefix_lengths[num - 1],
+                               (void *)out);
+            }
+        }
+
         /* The output of the operator is now input for the next field op. */
         in_field = out;
     }
 
+    if (cached > 0) {
+        ib_rule_log_trace(rule_exec,
+                          "Reused %zu of %zu cached transformations",
+                          cached,
+                          ib_list_elements(tfn_list));
+    }
+
     /* The output of the final operator is the result */
     *result = out;
 
@@ -2079,26 +2617,6 @@ cleanup:
     return rc;
 }
 
-/**
- * Check if the current rule is runnable
- *
- * @param[in] ctx_rule Context rule data
- *
- * @returns true if the rule is runnable, otherwise false
- */
-static bool rule_is_runnable(const ib_rule_ctx_data_t *ctx_rule)
-{
-    /* Skip invalid / disabled rules */
-    if (! ib_flags_all(ctx_rule->flags, IB_RULECTX_FLAG_ENABLED)) {
-        return false;
-    }
-    if (! ib_flags_all(ctx_rule->rule->flags, IB_RULE_FLAG_VALID)) {
-        return false;
-    }
-
-    return true;
-}
-
 /**
  * Check if allow affects the current rule
  *
@@ -2242,37 +2760,73 @@ static ib_status_t inject_rules(const ib_engine_t *ib,
 }
 
 /**
- * Append context rules onto the rule execution object's phase rule list
+ * Fetch the next rule to execute in a phase.
  *
- * @param[in] ib IronBee engine
- * @param[in] phase_meta Phase meta data
- * @param[in] rule_list List of context rules to append
- * @param[in,out] rule_exec Rule execution object
+ * Rules injected into the rule execution object's phase rule list run
+ * first, followed by the context's compiled rules for the phase.
  *
- * @returns Status code
+ * @param[in] ruleset_phase Context ruleset for the phase
+ * @param[in,out] node Next injected rule node
+ * @param[in,out] index Index of the next compiled rule
+ *
+ * @returns The next rule or NULL if there are none left
  */
-static ib_status_t append_context_rules(const ib_engine_t *ib,
-                                        const ib_rule_phase_meta_t *phase_meta,
-                                        const ib_list_t *rule_list,
-                                        ib_rule_exec_t *rule_exec)
+static const ib_rule_t *next_phase_rule(
+    const ib_ruleset_phase_t  *ruleset_phase,
+    const ib_list_node_t     **node,
+    size_t                    *index
+)
 {
-    assert(ib != NULL);
-    assert(phase_meta != NULL);
-    assert(rule_exec != NULL);
-    assert(rule_list != NULL);
+    assert(ruleset_phase != NULL);
+    assert(node != NULL);
+    assert(index != NULL);
 
-    const ib_list_node_t *node;
+    const ib_rule_t *rule;
 
-    IB_LIST_LOOP_CONST(rule_list, node) {
-        const ib_rule_ctx_data_t *ctx_rule =
-            (const ib_rule_ctx_data_t *)ib_list_node_data_const(node);
+    if (*node != NULL) {
+        rule = (const ib_rule_t *)ib_list_node_data_const(*node);
+        *node = ib_list_node_next_const(*node);
+        return rule;
+    }
 
-        if (rule_is_runnable(ctx_rule)) {
-            ib_list_push(rule_exec->phase_rules, ctx_rule->rule);
+    /* Skip rules invalidated after the context was closed. */
+    while (*index < ruleset_phase->rule_count) {
+        rule = ruleset_phase->rules[*index];
+        ++(*index);
+        if (ib_flags_all(rule->flags, IB_RULE_FLAG_VALID)) {
+            return rule;
         }
     }
 
-    return IB_OK;
+    return NULL;
+}
+
+/**
+ * Count a run of the rules of a phase in the engine statistics.
+ *
+ * @param[in] ib Engine.
+ * @param[in] phase_num Phase that was run.
+ * @param[in] num_executed Number of rules executed.
+ * @param[in] start When the run started.
+ */
+static void count_phase(
+    ib_engine_t         *ib,
+    ib_rule_phase_num_t  phase_num,
+    size_t               num_executed,
+    ib_time_t            start
+)
+{
+    assert(ib != NULL);
+    assert(phase_num >= 0 && phase_num < IB_RULE_PHASE_COUNT);
+
+    ib_counters_add(
+        ib->counters, IB_ENGINE_COUNTER_PHASE_RUNS + phase_num, 1);
+    ib_counters_add(
+        ib->counters, IB_ENGINE_COUNTER_PHASE_RULES + phase_num,
+        num_executed);
+    ib_counters_add(
+        ib->counters, IB_ENGINE_COUNTER_PHASE_USEC + phase_num,
+        ib_clock_get_time() - start);
 }
 
 /**
@@ -2318,20 +2872,21 @@ static ib_status_t run_phase_rules(ib_engine_t *ib,
     ib_context_t               *ctx = tx->ctx;
     const ib_ruleset_phase_t   *ruleset_phase;
     ib_rule_exec_t             *rule_exec = tx->rule_exec;
-    const ib_list_t            *rules;
     const ib_list_node_t       *node = NULL;
+    const ib_rule_t            *rule;
+    size_t                      index = 0;
+    size_t                      num_executed = 0;
+    ib_time_t                   start = ib_clock_get_time();
     ib_status_t                 rc = IB_OK;
 
     ruleset_phase = &(ctx->rules->ruleset.phases[meta->phase_num]);
     assert(ruleset_phase != NULL);
-    rules = ruleset_phase->rule_list;
-    assert(rules != NULL);
 
     /* Log the transaction event start */
     ib_rule_log_tx_event_start(rule_exec, state);
     ib_rule_log_phase(rule_exec,
                       meta->phase_num, phase_name(meta),
-                      ib_list_elements(rules));
+                      ruleset_phase->rule_count);
 
     /* Check if this phase should be skipped. */
     if (rule_allow(tx, meta, true)) {
@@ -2387,14 +2942,11 @@ static ib_status_t run_phase_rules(ib_engine_t *ib,
         return IB_EINVAL;
     }
 
-    /* Add all of the enabled "normal" rules to the list */
-    rc = append_context_rules(ib, meta, rules, rule_exec);
-    if (rc != IB_OK) {
-        return IB_EINVAL;
-    }
-
-    /* Walk through the rules & execute them */
-    if (ib_list_elements(rule_exec->phase_rules) == 0) {
+    /* Walk through the rules & execute them.  The phase array may hold
+     * invalidated rules, so look for a live one rather than counting. */
+    node = ib_list_first_const(rule_exec->phase_rules);
+    rule = next_phase_rule(ruleset_phase, &node, &index);
+    if (rule == NULL) {
         ib_rule_log_tx_debug(tx,
                              "No rules for phase %d/\"%s\" in context \"%s\"",
                              meta->phase_num, phase_name(meta),
@@ -2402,12 +2954,6 @@ static ib_status_t run_phase_rules(ib_engine_t *ib,
         rc = IB_OK;
         goto finish;
     }
-    ib_rule_log_tx_debug(tx,
-                         "Executing %zd rules for phase %d/\"%s\" "
-                         "in context \"%s\"",
-                         ib_list_elements(rule_exec->phase_rules),
-                         meta->phase_num, phase_name(meta),
-                         ib_context_full_get(ctx));
 
     /*
      * Loop through all of the rules for this phase, execute them.
@@ -2416,9 +2962,12 @@ static ib_status_t run_phase_rules(ib_engine_t *ib,
      * returns an error.  This needs further discussion to determine what the
      * correct behavior should be.
      */
-    IB_LIST_LOOP_CONST(rule_exec->phase_rules, node) {
-        const ib_rule_t *rule =
-            (const ib_rule_t *)ib_list_node_data_const(node);
+    for (
+        ;
+        rule != NULL;
+        rule = next_phase_rule(ruleset_phase, &node, &index)
+    )
+    {
         ib_status_t      rule_rc;
 
         assert(
@@ -2433,6 +2982,7 @@ static ib_status_t run_phase_rules(ib_engine_t *ib,
 
         /* Execute the rule, it's actions and chains */
         rule_rc = execute_phase_rule(rule_exec, rule, MAX_CHAIN_RECURSION);
+        ++num_executed;
 
         /* Handle declined return code. Did this block? */
         if (ib_flags_all(tx->flags, IB_TX_FBLOCK_IMMEDIATE) ) {
@@ -2477,7 +3027,16 @@ static ib_status_t run_phase_rules(ib_engine_t *ib,
 
     /* Log the end of the tx event */
 finish:
+    if (num_executed > 0) {
+        ib_rule_log_tx_debug(tx,
+                             "Executed %zu rules for phase %d/\"%s\" "
+                             "in context \"%s\"",
+                             num_executed,
+                             meta->phase_num, phase_name(meta),
+                             ib_context_full_get(ctx));
+    }
     ib_rule_log_tx_event_end(rule_exec, state);
+    count_phase(ib, meta->phase_num, num_executed, start);
 
     /* Clear the phase allow flag. */
     ib_flags_clear(tx->flags, IB_TX_FALLOW_PHASE);
@@ -2711,8 +3270,11 @@ static ib_status_t run_stream_rules(ib_engine_t *ib,
     ib_context_t             *ctx = tx->ctx;
     const ib_ruleset_phase_t *ruleset_phase =
         &(ctx->rules->ruleset.phases[meta->phase_num]);
-    ib_list_t                *rules = ruleset_phase->rule_list;
     const ib_list_node_t     *node = NULL;
+    const ib_rule_t          *rule;
+    size_t                    index = 0;
+    size_t                    num_executed = 0;
+    ib_time_t                 start;
     ib_rule_exec_t           *rule_exec = tx->rule_exec;
     ib_status_t               rc;
 
@@ -2720,7 +3282,7 @@ static ib_status_t run_stream_rules(ib_engine_t *ib,
     ib_rule_log_tx_event_start(rule_exec, state);
     ib_rule_log_phase(rule_exec,
                       meta->phase_num, phase_name(meta),
-                      ib_list_elements(rules));
+                      ruleset_phase->rule_count);
 
     /* Allow (skip) this phase? Perhaps the whole TX is allowed? */
     if (rule_allow(tx, meta, false)) {
@@ -2747,26 +3309,16 @@ static ib_status_t run_stream_rules(ib_engine_t *ib,
         return IB_EINVAL;
     }
 
-    /* Add all of the enabled "normal" rules to the list */
-    rc = append_context_rules(ib, meta, rules, rule_exec);
-    if (rc != IB_OK) {
-        return IB_EINVAL;
-    }
-
-    /* Are there any rules?  If not, do a quick exit */
-    if (ib_list_elements(rule_exec->phase_rules) == 0) {
+    /* Are there any live rules?  If not, do a quick exit */
+    node = ib_list_first_const(rule_exec->phase_rules);
+    rule = next_phase_rule(ruleset_phase, &node, &index);
+    if (rule == NULL) {
         ib_rule_log_debug(rule_exec,
                           "No rules for stream %d/\"%s\" in context \"%s\"",
                           meta->phase_num, phase_name(meta),
                           ib_context_full_get(ctx));
         return IB_OK;
     }
-    ib_rule_log_debug(rule_exec,
-                      "Executing %zd rules for stream %d/\"%s\" "
-                      "in context \"%s\"",
-                      ib_list_elements(rule_exec->phase_rules),
-                      meta->phase_num, phase_name(meta),
-                      ib_context_full_get(ctx));
 
     /*
      * Loop through all of the rules for this phase, execute them.
@@ -2775,9 +3327,13 @@ static ib_status_t run_stream_rules(ib_engine_t *ib,
      * returns an error.  This needs further discussion to determine what the
      * correct behavior should be.
      */
-    IB_LIST_LOOP_CONST(rule_exec->phase_rules, node) {
-        const ib_rule_t    *rule =
-            (const ib_rule_t *)ib_list_node_data_const(node);
+    start = ib_clock_get_time();
+    for (
+        ;
+        rule != NULL;
+        rule = next_phase_rule(ruleset_phase, &node, &index)
+    )
+    {
         ib_status_t         trc;
 
         /* Reset status */
@@ -2812,12 +3368,21 @@ static ib_status_t run_stream_rules(ib_engine_t *ib,
                               ib_status_to_string(rc));
         }
 
+        ++num_executed;
+
         ib_rule_log_execution(rule_exec);
         rc = rule_exec_pop_rule(rule_exec);
         if (rc != IB_OK) {
             break;
         }
     }
+    count_phase(ib, meta->phase_num, num_executed, start);
+    ib_rule_log_debug(rule_exec,
+                      "Executed %zu rules for stream %d/\"%s\" "
+                      "in context \"%s\"",
+                      num_executed,
+                      meta->phase_num, phase_name(meta),
+                      ib_context_full_get(ctx));
 
     if (ib_flags_all(tx->flags, IB_TX_FBLOCK_PHASE) ) {
         rc = ib_tx_block(rule_exec->tx);
@@ -3051,23 +3616,8 @@ static ib_status_t init_ruleset(ib_engine_t *ib,
                          ib_status_to_string(rc));
             return rc;
         }
-
-        rc = ib_list_create(&(ruleset_phase->rule_list), mm);
-        if (rc != IB_OK) {
-            ib_log_error(ib,
-                         "Error creating phase ruleset list: %s",
-                         ib_status_to_string(rc));
-            return rc;
-        }
-    }
-
-    /* Create a hash to hold rules indexed by ID */
-    rc = ib_hash_create_nocase(&(ctx_rules->rule_hash), mm);
-    if (rc != IB_OK) {
-        ib_log_error(ib,
-                     "Error creating ruleset hash: %s",
-                     ib_status_to_string(rc));
-        return rc;
+        ruleset_phase->rules = NULL;
+        ruleset_phase->rule_count = 0;
     }
 
     return IB_OK;
@@ -3217,6 +3767,15 @@ static ib_status_t create_rule_engine(const ib_engine_t *ib,
         return rc;
     }
 
+    /* Create the compiled phase rules hash */
+    rc = ib_hash_create(&(rule_engine->compiled_rules), mm);
+    if (rc != IB_OK) {
+        ib_log_error(ib,
+                     "Error creating rule engine compiled rules hash: %s",
+                     ib_status_to_string(rc));
+        return rc;
+    }
+
     /* Create the ownership cb list */
     rc = ib_list_create(&(rule_engine->ownership_cbs), mm);
     if (rc != IB_OK) {
@@ -3292,16 +3851,21 @@ static ib_status_t create_rule_engine(const ib_engine_t *ib,
 }
 
 /**
- * Initialize a context's rule object.
+ * Create a rule context object.
+ *
+ * A location context shares the rule list, rule hash and enable list of
+ * its parent until either of them modifies them.
  *
  * @param[in] ib Engine
  * @param[in] mm Memory manager to use for allocations
+ * @param[in,out] parent_rules Parent's rule context object to share, or NULL
  * @param[out] p_ctx_rules Pointer to new rule context object
  *
  * @returns Status code
  */
 static ib_status_t create_rule_context(const ib_engine_t *ib,
                                        ib_mm_t mm,
+                                       ib_rule_context_t *parent_rules,
                                        ib_rule_context_t **p_ctx_rules)
 {
     assert(ib != NULL);
@@ -3317,6 +3881,19 @@ static ib_status_t create_rule_context(const ib_engine_t *ib,
         return IB_EALLOC;
     }
 
+    /* Share the parent's rules */
+    if (parent_rules != NULL) {
+        ctx_rules->rule_list = parent_rules->rule_list;
+        ctx_rules->rule_hash = parent_rules->rule_hash;
+        ctx_rules->enable_list = parent_rules->enable_list;
+        ctx_rules->shared =
+            IB_RULE_CONTEXT_SHARED_RULES | IB_RULE_CONTEXT_SHARED_ENABLE;
+        ib_flags_set(parent_rules->shared, ctx_rules->shared);
+
+        *p_ctx_rules = ctx_rules;
+        return IB_OK;
+    }
+
     /* Create the rule list */
     rc = ib_list_create(&(ctx_rules->rule_list), mm);
     if (rc != IB_OK) {
@@ -3326,6 +3903,15 @@ static ib_status_t create_rule_context(const ib_engine_t *ib,
         return rc;
     }
 
+    /* Create a hash to hold rules indexed by ID */
+    rc = ib_hash_create_nocase(&(ctx_rules->rule_hash), mm);
+    if (rc != IB_OK) {
+        ib_log_error(ib,
+                     "Error creating ruleset hash: %s",
+                     ib_status_to_string(rc));
+        return rc;
+    }
+
     /* Create the rule enable/disable lists */
     rc = ib_list_create(&(ctx_rules->enable_list), mm);
     if (rc != IB_OK) {
@@ -3403,63 +3989,112 @@ static ib_status_t copy_rule_hash(const ib_context_t *ctx,
 }
 
 /**
- * Import a rule's context from it's parent
+ * Give @a ctx its own copy of shared rule collections before modifying them.
  *
- * @param[in] ctx Context being imported to
- * @param[in] parent_rules Parent's rule context object
- * @param[in,out] ctx_rules Rule context object
+ * @param[in] ctx Context about to modify its rule collections
+ * @param[in] which Collections to copy if shared (IB_RULE_CONTEXT_SHARED_xx)
  *
  * @returns Status code
  */
-static ib_status_t import_rule_context(const ib_context_t *ctx,
-                                       const ib_rule_context_t *parent_rules,
-                                       ib_rule_context_t *ctx_rules)
+static ib_status_t unshare_rule_context(const ib_context_t *ctx,
+                                        ib_flags_t which)
 {
-    assert(parent_rules != NULL);
-    assert(ctx_rules != NULL);
-    ib_status_t rc;
+    assert(ctx != NULL);
+    assert(ctx->rules != NULL);
 
-    /* Copy rules list */
-    rc = copy_rule_list(parent_rules->rule_list, ctx_rules->rule_list);
-    if (rc != IB_OK) {
-        return rc;
-    }
+    ib_rule_context_t *ctx_rules = ctx->rules;
+    ib_status_t        rc;
 
-    /* Copy enable list */
-    rc = copy_rule_list(parent_rules->enable_list, ctx_rules->enable_list);
-    if (rc != IB_OK) {
-        return rc;
+    which &= ctx_rules->shared;
+
+    if (ib_flags_all(which, IB_RULE_CONTEXT_SHARED_RULES)) {
+        ib_list_t *rule_list;
+        ib_hash_t *rule_hash;
+
+        rc = ib_list_create(&rule_list, ctx->mm);
+        if (rc != IB_OK) {
+            return rc;
+        }
+        rc = copy_rule_list(ctx_rules->rule_list, rule_list);
+        if (rc != IB_OK) {
+            return rc;
+        }
+        rc = ib_hash_create_nocase(&rule_hash, ctx->mm);
+        if (rc != IB_OK) {
+            return rc;
+        }
+        rc = copy_rule_hash(ctx, ctx_rules->rule_hash, rule_hash);
+        if (rc != IB_OK) {
+            return rc;
+        }
+        ctx_rules->rule_list = rule_list;
+        ctx_rules->rule_hash = rule_hash;
     }
 
-    /* Copy rule hash */
-    rc = copy_rule_hash(ctx, parent_rules->rule_hash, ctx_rules->rule_hash);
-    if (rc != IB_OK) {
-        return rc;
+    if (ib_flags_all(which, IB_RULE_CONTEXT_SHARED_ENABLE)) {
+        ib_list_t *enable_list;
+
+        rc = ib_list_create(&enable_list, ctx->mm);
+        if (rc != IB_OK) {
+            return rc;
+        }
+        rc = copy_rule_list(ctx_rules->enable_list, enable_list);
+        if (rc != IB_OK) {
+            return rc;
+        }
+        ctx_rules->enable_list = enable_list;
     }
+
+    ib_flags_clear(ctx_rules->shared, which);
+
     return IB_OK;
 }
 
+/** Number of rules per word of a rule enable bitmap. */
+#define RULE_ENABLE_BITS (sizeof(size_t) * CHAR_BIT)
 
 /**
  * Enable/disable an individual rule
  *
  * @param[in] enable true:Enable, false:Disable
- * @param[in,out] ctx_rule Context rule to enable/disable
+ * @param[in,out] enabled Rule enable bitmap
+ * @param[in] index Index of the rule in @a enabled
  */
 static void set_rule_enable(bool enable,
-                            ib_rule_ctx_data_t *ctx_rule)
+                            size_t *enabled,
+                            size_t index)
 {
-    assert(ctx_rule != NULL);
+    assert(enabled != NULL);
+
+    size_t bit = (size_t)1 << (index % RULE_ENABLE_BITS);
 
     if (enable) {
-        ib_flags_set(ctx_rule->flags, IB_RULECTX_FLAG_ENABLED);
+        enabled[index / RULE_ENABLE_BITS] |= bit;
     }
     else {
-        ib_flags_clear(ctx_rule->flags, IB_RULECTX_FLAG_ENABLED);
+        enabled[index / RULE_ENABLE_BITS] &= ~bit;
     }
     return;
 }
 
+/**
+ * Check if a rule is enabled
+ *
+ * @param[in] enabled Rule enable bitmap
+ * @param[in] index Index of the rule in @a enabled
+ *
+ * @returns true if the rule is enabled
+ */
+static bool is_rule_enabled(const size_t *enabled,
+                            size_t index)
+{
+    assert(enabled != NULL);
+
+    return
+        (enabled[index / RULE_ENABLE_BITS] &
+         ((size_t)1 << (index % RULE_ENABLE_BITS))) != 0;
+}
+
 /* Rule enable functions. */
 static ib_status_t rule_enable_all(const ib_rule_t *rule, void *cbdata) {
     assert(rule != NULL);
@@ -3603,7 +4238,9 @@ static ib_status_t rule_enable_by_tag_prefix(
  * @param[in] ib IronBee engine
  * @param[in] ctx Current IronBee context
  * @param[in] match Enable match data
- * @param[in,out] ctx_rule_list List of rules to search for matches to @a enable
+ * @param[in] rules Array of rules to search for matches to @a enable
+ * @param[in] num_rules Number of @a rules
+ * @param[in,out] enabled Enable bitmap of @a rules
  *
  * @returns Status code
  */
@@ -3611,27 +4248,28 @@ static ib_status_t enable_rules(
     ib_engine_t            *ib,
     ib_context_t           *ctx,
     const ib_rule_enable_t *match,
-    ib_list_t              *ctx_rule_list
+    ib_rule_t             **rules,
+    size_t                  num_rules,
+    size_t                 *enabled
 )
 {
     assert(ib != NULL);
     assert(ctx != NULL);
     assert(match != NULL);
-    assert(ctx_rule_list != NULL);
+    assert(rules != NULL || num_rules == 0);
+    assert(enabled != NULL);
 
-    ib_list_node_t *node;
+    size_t          n;
     unsigned int    matches = 0;
     const char     *lcname = match->enable ? "enable" : "disable";
 
-    IB_LIST_LOOP(ctx_rule_list, node) {
-        ib_rule_ctx_data_t *ctx_rule;
-        ctx_rule = (ib_rule_ctx_data_t *)ib_list_node_data(node);
+    for (n = 0; n < num_rules; ++n) {
         ib_status_t rc;
-        rc = match->rule_enable_fn(ctx_rule->rule, match->rule_enable_cbdata);
+        rc = match->rule_enable_fn(rules[n], match->rule_enable_cbdata);
 
         if (rc == IB_OK) {
             matches++;
-            set_rule_enable(match->enable, ctx_rule);
+            set_rule_enable(match->enable, enabled, n);
         }
     }
 
@@ -3669,6 +4307,51 @@ bool ib_rule_is_marked(const ib_rule_t *rule) {
     return ib_flags_any(rule->flags, IB_RULE_FLAG_MARK);
 }
 
+/**
+ * Find or store a compiled phase rule array.
+ *
+ * Contexts that enable the same rules for a phase share one array
+ * allocated from the engine's main memory manager.
+ *
+ * @param[in] ib IronBee engine
+ * @param[in] rules Array of rules (temporary)
+ * @param[in] count Number of @a rules
+ * @param[out] compiled Shared array with the contents of @a rules
+ *
+ * @returns Status code
+ */
+static ib_status_t intern_phase_rules(ib_engine_t      *ib,
+                                      const ib_rule_t **rules,
+                                      size_t            count,
+                                      const ib_rule_t ***compiled)
+{
+    assert(ib != NULL);
+    assert(rules != NULL);
+    assert(compiled != NULL);
+
+    ib_hash_t        *hash = ib->rule_engine->compiled_rules;
+    size_t            size = sizeof(*rules) * count;
+    const ib_rule_t **copy;
+    ib_status_t       rc;
+
+    rc = ib_hash_get_ex(hash, compiled, (const char *)rules, size);
+    if (rc != IB_ENOENT) {
+        return rc;
+    }
+
+    copy = ib_mm_memdup(ib_engine_mm_main_get(ib), rules, size);
+    if (copy == NULL) {
+        return IB_EALLOC;
+    }
+    rc = ib_hash_set_ex(hash, (const char *)copy, size, copy);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    *compiled = copy;
+    return IB_OK;
+}
+
 /**
  * Close a context for the rule engine.
  *
@@ -3690,23 +4373,35 @@ static ib_status_t rule_engine_ctx_close(ib_engine_t *ib,
     assert(state == context_close_state);
     assert(cbdata == NULL);
 
-    ib_list_t      *all_rules;
-    ib_list_node_t *node;
-    ib_context_t   *main_ctx = ib_context_main(ib);
-    ib_status_t     rc;
+    ib_list_node_t      *node;
+    ib_context_t        *main_ctx = ib_context_main(ib);
+    ib_mm_t              tmp_mm = ib_engine_mm_temp_get(ib);
+    ib_rule_t          **rules;
+    size_t              *enabled;
+    size_t               max_rules;
+    size_t               num_rules = 0;
+    size_t               phase_counts[IB_RULE_PHASE_COUNT] = { 0 };
+    size_t               n;
+    ib_status_t          rc;
 
     /* Don't enable rules for non-location contexts */
     if (ctx->ctype != IB_CTYPE_LOCATION) {
         return IB_OK;
     }
 
-    /* Create the list of all rules */
-    rc = ib_list_create(&all_rules, ctx->mm);
-    if (rc != IB_OK) {
-        ib_log_error(ib,
-                     "Error initializing rule engine rule list: %s",
-                     ib_status_to_string(rc));
-        return rc;
+    /* Create the array of all rules and its enable bitmap.  These are
+     * only needed until the phase rules are compiled. */
+    max_rules =
+        ib_list_elements(main_ctx->rules->rule_list) +
+        ib_list_elements(ctx->rules->rule_list);
+    rules = ib_mm_alloc(tmp_mm, sizeof(*rules) * (max_rules + 1));
+    enabled = ib_mm_calloc(
+        tmp_mm,
+        max_rules / RULE_ENABLE_BITS + 1,
+        sizeof(*enabled));
+    if (rules == NULL || enabled == NULL) {
+        ib_log_error(ib, "Error initializing rule engine rule list.");
+        return IB_EALLOC;
     }
 
     /* Step 1: Unmark all rules in the context's rule list */
@@ -3720,7 +4415,6 @@ static ib_status_t rule_engine_ctx_close(ib_engine_t *ib,
     IB_LIST_LOOP(main_ctx->rules->rule_list, node) {
         ib_rule_t          *ref = (ib_rule_t *)ib_list_node_data(node);
         ib_rule_t          *rule = NULL;
-        ib_rule_ctx_data_t *ctx_rule = NULL;
 
         /* If it's a chained rule, skip it */
         if (ib_rule_is_chained(ref)) {
@@ -3735,47 +4429,29 @@ static ib_status_t rule_engine_ctx_close(ib_engine_t *ib,
             return rc;
         }
 
-        /* Create a rule ctx object for it, store it in the list */
-        ctx_rule = ib_mm_alloc(ctx->mm, sizeof(*ctx_rule));
-        if (ctx_rule == NULL) {
-            return IB_EALLOC;
-        }
-        ctx_rule->rule = rule;
+        /* Store it in the array */
+        rules[num_rules] = rule;
         if (! ib_flags_all(rule->flags, IB_RULE_FLAG_MAIN_CTX)) {
-            ctx_rule->flags = IB_RULECTX_FLAG_ENABLED;
+            set_rule_enable(true, enabled, num_rules);
             ib_flags_set(rule->flags, IB_RULE_FLAG_MARK);
         }
-        else {
-            ctx_rule->flags = IB_RULECTX_FLAG_NONE;
-        }
-        rc = ib_list_push(all_rules, ctx_rule);
-        if (rc != IB_OK) {
-            return IB_EALLOC;
-        }
+        ++num_rules;
     }
 
     /* Step 3: Loop through all of the context's rules, add them
      * to the list of all rules if they're not marked... */
     IB_LIST_LOOP(ctx->rules->rule_list, node) {
         ib_rule_t          *rule = (ib_rule_t *)ib_list_node_data(node);
-        ib_rule_ctx_data_t *ctx_rule;
 
         /* If the rule is chained or marked */
         if (ib_rule_is_chained(rule) || ib_rule_is_marked(rule)) {
             continue;
         }
 
-        /* Create a ctx object for it, store it in the list */
-        ctx_rule = ib_mm_alloc(ctx->mm, sizeof(*ctx_rule));
-        if (ctx_rule == NULL) {
-            return IB_EALLOC;
-        }
-        ctx_rule->rule = rule;
-        ib_flags_set(ctx_rule->flags, IB_RULECTX_FLAG_ENABLED);
-        rc = ib_list_push(all_rules, ctx_rule);
-        if (rc != IB_OK) {
-            return IB_EALLOC;
-        }
+        /* Store it in the array */
+        rules[num_rules] = rule;
+        set_rule_enable(true, enabled, num_rules);
+        ++num_rules;
     }
 
     /* Step 4: Enable / Disable rules. */
@@ -3783,7 +4459,7 @@ static ib_status_t rule_engine_ctx_close(ib_engine_t *ib,
         const ib_rule_enable_t *enable;
         enable = (const ib_rule_enable_t *)ib_list_node_data(node);
 
-        rc = enable_rules(ib, ctx, enable, all_rules);
+        rc = enable_rules(ib, ctx, enable, rules, num_rules, enabled);
         if (rc != IB_OK) {
             ib_cfg_log_notice_ex(ib, enable->file, enable->lineno,
                                  "Error apply rule enable/disable "
@@ -3792,23 +4468,16 @@ static ib_status_t rule_engine_ctx_close(ib_engine_t *ib,
         }
     }
 
-    /* Step 5: Add all enabled rules to the appropriate execution list */
-    IB_LIST_LOOP(all_rules, node) {
-        ib_rule_ctx_data_t   *ctx_rule;
-        ib_ruleset_phase_t   *ruleset_phase;
-        ib_list_t            *phase_rule_list;
+    /* Step 5: Count the enabled rules of each phase */
+    for (n = 0; n < num_rules; ++n) {
         ib_rule_phase_num_t   phase_num;
-        ib_rule_t            *rule;
+        ib_rule_t            *rule = rules[n];
         const ib_list_node_t *onode;
         size_t                owners = 0;
         const char           *owner_name = NULL;
 
-        ctx_rule = (ib_rule_ctx_data_t *)ib_list_node_data(node);
-        assert(ctx_rule != NULL);
-        rule = ctx_rule->rule;
-
         /* If it's not enabled, skip to the next rule */
-        if (! ib_flags_all(ctx_rule->flags, IB_RULECTX_FLAG_ENABLED)) {
+        if (! is_rule_enabled(enabled, n)) {
             continue;
         }
 
@@ -3858,6 +4527,7 @@ static ib_status_t rule_engine_ctx_close(ib_engine_t *ib,
             }
         }
         if (owners > 0) {
+            set_rule_enable(false, enabled, n);
             continue;
         }
 
@@ -3872,25 +4542,10 @@ static ib_status_t rule_engine_ctx_close(ib_engine_t *ib,
             return IB_EINVAL;
         }
         assert (rule->meta.phase == rule->phase_meta->phase_num);
+        assert(ctx->rules->ruleset.phases[phase_num].phase_meta ==
+               rule->phase_meta);
 
-        /* Determine what phase list to add it into */
-        ruleset_phase = &(ctx->rules->ruleset.phases[phase_num]);
-        assert(ruleset_phase != NULL);
-        assert(ruleset_phase->phase_meta == rule->phase_meta);
-        phase_rule_list = ruleset_phase->rule_list;
-
-        /* Add it to the list */
-        rc = ib_list_push(phase_rule_list, (void *)ctx_rule);
-        if (rc != IB_OK) {
-            ib_log_error(ib,
-                         "Error adding rule type=\"%s\" phase=%d "
-                         "context=\"%s\": %s",
-                         rule->phase_meta->is_stream ? "Stream" : "Normal",
-                         phase_num,
-                         ib_context_full_get(ctx),
-                         ib_status_to_string(rc));
-            return rc;
-        }
+        ++phase_counts[phase_num];
 
         ib_log_debug(ib,
                      "Enabled rule \"%s\" rev=%u type=\"%s\" phase=%d/\"%s\" "
@@ -3901,6 +4556,50 @@ static ib_status_t rule_engine_ctx_close(ib_engine_t *ib,
                      ib_context_full_get(ctx));
     }
 
+    /* Step 6: Compile the enabled rules of each phase into an array,
+     * sharing it with other contexts that have the same rules */
+    for (int phase_num = IB_PHASE_NONE;
+         phase_num < IB_RULE_PHASE_COUNT;
+         ++phase_num)
+    {
+        ib_ruleset_phase_t  *ruleset_phase =
+            &(ctx->rules->ruleset.phases[phase_num]);
+        const ib_rule_t    **phase_rules;
+        size_t               count = 0;
+
+        if (phase_counts[phase_num] == 0) {
+            continue;
+        }
+
+        phase_rules = ib_mm_alloc(
+            tmp_mm,
+            sizeof(*phase_rules) * phase_counts[phase_num]);
+        if (phase_rules == NULL) {
+            return IB_EALLOC;
+        }
+        for (n = 0; n < num_rules; ++n) {
+            if (
+                is_rule_enabled(enabled, n) &&
+                rules[n]->meta.phase == (ib_rule_phase_num_t)phase_num
+            ) {
+                phase_rules[count] = rules[n];
+                ++count;
+            }
+        }
+        assert(count == phase_counts[phase_num]);
+
+        rc = intern_phase_rules(ib, phase_rules, count, &(ruleset_phase->rules));
+        if (rc != IB_OK) {
+            ib_log_error(ib,
+                         "Error adding rules for phase=%d context=\"%s\": %s",
+                         phase_num,
+                         ib_context_full_get(ctx),
+                         ib_status_to_string(rc));
+            return rc;
+        }
+        ruleset_phase->rule_count = count;
+    }
+
     /* Initialize var sources */
     {
         ib_rule_engine_t *re = ib->rule_engine;
@@ -4008,8 +4707,12 @@ static ib_status_t rule_engine_ctx_open(ib_engine_t *ib,
         return IB_OK;
     }
 
-    /* Create the rule engine object */
-    rc = create_rule_context(ib, ctx->mm, &(ctx->rules));
+    /* Create the rule engine object.  A location context shares its
+     * parent's rules. */
+    rc = create_rule_context(
+        ib, ctx->mm,
+        (ctx->ctype == IB_CTYPE_LOCATION) ? ctx->parent->rules : NULL,
+        &(ctx->rules));
     if (rc != IB_OK) {
         ib_log_error(ib,
                      "Error initializing rule engine context rules: %s",
@@ -4026,17 +4729,6 @@ static ib_status_t rule_engine_ctx_open(ib_engine_t *ib,
         return rc;
     }
 
-    /* If this is a location context, import our parents context info */
-    if (ctx->ctype == IB_CTYPE_LOCATION) {
-        rc = import_rule_context(ctx, ctx->parent->rules, ctx->rules);
-        if (rc != IB_OK) {
-            ib_log_error(ib,
-                         "Error importing rule engine context from parent: %s",
-                         ib_status_to_string(rc));
-            return rc;
-        }
-    }
-
     return IB_OK;
 }
 
@@ -4557,6 +5249,36 @@ static ib_status_t gen_full_id(ib_engine_t *ib,
     return IB_OK;
 }
 
+/**
+ * Fuse the transformation chain of each of a rule's targets.
+ *
+ * @param[in] ib IronBee engine.
+ * @param[in,out] rule Rule whose targets to compile.
+ *
+ * @returns Status code.
+ */
+static ib_status_t fuse_target_tfns(ib_engine_t *ib, ib_rule_t *rule)
+{
+    assert(ib != NULL);
+    assert(rule != NULL);
+
+    ib_list_node_t *node;
+    ib_status_t     rc;
+
+    IB_LIST_LOOP(rule->target_fields, node) {
+        ib_rule_target_t *target = (ib_rule_target_t *)ib_list_node_data(node);
+
+        rc = ib_transformation_fuse_chain(ib, ib_rule_mm(ib),
+                                          target->tfn_list,
+                                          &(target->tfn_fused));
+        if (rc != IB_OK) {
+            return rc;
+        }
+    }
+
+    return IB_OK;
+}
+
 ib_status_t ib_rule_register(ib_engine_t *ib,
                              ib_context_t *ctx,
                              ib_rule_t *rule)
@@ -4625,6 +5347,14 @@ ib_status_t ib_rule_register(ib_engine_t *ib,
         return IB_EINVAL;
     }
 
+    /* Compile the transformation chains of the targets */
+    rc = fuse_target_tfns(ib, rule);
+    if (rc != IB_OK) {
+        ib_log_error(ib, "Error fusing rule transformations: %s",
+                     ib_status_to_string(rc));
+        return rc;
+    }
+
     /* If either of the chain flags is are, the chain ID is the rule's ID */
     if (ib_flags_any(rule->flags, IB_RULE_FLAG_CHAIN)) {
         if (rule->chained_from != NULL) {
@@ -4711,6 +5441,18 @@ ib_status_t ib_rule_register(ib_engine_t *ib,
         return IB_EEXIST;
     }
 
+    /* Copy the rules shared with the parent before changing them */
+    rc = unshare_rule_context(ctx, IB_RULE_CONTEXT_SHARED_RULES);
+    if (rc != IB_OK) {
+        ib_cfg_log_error_ex(ib,
+                            rule->meta.config_file,
+                            rule->meta.config_line,
+                            "Error copying rules of context=\"%s\": %s",
+                            ib_context_full_get(ctx),
+                            ib_status_to_string(rc));
+        return rc;
+    }
+
     /* Remove the old version from the hash */
     if (lookup != NULL) {
         ib_hash_remove(context_rules->rule_hash, NULL, rule->meta.id);
@@ -4820,7 +5562,10 @@ ib_status_t ib_rule_enable(
     item->rule_enable_cbdata = enable_data;
 
     /* Add the item to the appropriate list */
-    rc = ib_list_push(ctx->rules->enable_list, item);
+    rc = unshare_rule_context(ctx, IB_RULE_CONTEXT_SHARED_ENABLE);
+    if (rc == IB_OK) {
+        rc = ib_list_push(ctx->rules->enable_list, item);
+    }
     if (rc != IB_OK) {
         ib_cfg_log_error_ex(ib, file, lineno,
                             "Error adding \"%s\" to context=\"%s\" list: %s",
@@ -5431,6 +6176,9 @@ ib_status_t ib_rule_target_add_tfn(ib_engine_t *ib,
         return rc;
     }
 
+    /* Any fused chain is stale now; it is rebuilt at registration. */
+    target->tfn_fused = NULL;
+
     return IB_OK;
 }
 
@@ -31,28 +31,21 @@
 #include <ironbee/rule_engine.h>
 #include <ironbee/types.h>
 
-/**
- * Context-specific rule object.  This is the type of the objects
- * stored in the 'rule_list' field of ib_ruleset_phase_t.
- */
-typedef struct {
-    ib_rule_t  *rule;  /**< The rule itself */
-    ib_flags_t  flags; /**< Rule flags (IB_RULECTX_FLAG_xx) */
-} ib_rule_ctx_data_t;
-
 /**
  * Ruleset for a single phase.
- *  rule_list is a list of pointers to ib_rule_ctx_data_t objects.
+ *
+ * rules is the array of enabled rules compiled when the context is
+ * closed.  Contexts whose compiled rules are identical share one array.
  */
 typedef struct {
     ib_rule_phase_num_t         phase_num;   /**< Phase number */
     const ib_rule_phase_meta_t *phase_meta;  /**< Rule phase meta-data */
-    ib_list_t                  *rule_list;   /**< Rules to execute in phase */
+    const ib_rule_t           **rules;       /**< Array of enabled rules */
+    size_t                      rule_count;  /**< Number of @a rules */
 } ib_ruleset_phase_t;
 
 /**
  * Set of rules for all phases.
- * The elements of the phases list are ib_rule_ctx_data_t objects.
  */
 typedef struct {
     ib_ruleset_phase_t phases[IB_RULE_PHASE_COUNT];
@@ -67,8 +60,19 @@ struct ib_rule_context_t {
     ib_hash_t             *rule_hash;    /**< Hash of rules (by rule-id) */
     ib_list_t             *enable_list;  /**< Enable All/IDs/tags */
     ib_rule_parser_data_t  parser_data;  /**< Rule parser specific data */
+
+    /**
+     * Which of the above are shared with another context and must be
+     * copied before they are modified (IB_RULE_CONTEXT_SHARED_xx).
+     */
+    ib_flags_t             shared;
 };
 
+/** rule_list and rule_hash are shared. */
+#define IB_RULE_CONTEXT_SHARED_RULES  (1 << 0)
+/** enable_list is shared. */
+#define IB_RULE_CONTEXT_SHARED_ENABLE (1 << 1)
+
 /**
  * Rule target fields
  */
@@ -76,6 +80,7 @@ struct ib_rule_target_t {
     ib_var_target_t *target;
     const char      *target_str; /**< The target string */
     ib_list_t       *tfn_list;   /**< List of transformations */
+    const ib_list_t *tfn_fused;  /**< tfn_list fused; NULL until registered */
 };
 
 
@@ -89,6 +94,13 @@ struct ib_rule_engine_t {
     ib_list_t *ownership_cbs;    /**< List of ownership callbacks. */
     size_t     index_limit;      /**< One more than highest rule index. */
 
+    /**
+     * Compiled phase rule arrays, keyed by their contents.
+     *
+     * Lets contexts with identical phase rules share one array.
+     */
+    ib_hash_t *compiled_rules;
+
     /**
      * Rule injection callbacks.
      */
@@ -933,11 +933,28 @@ ib_status_t ib_rule_log_exec_tfn_inst_add(ib_rule_log_exec_t *exec_log,
     }
     object->tfn_inst = tfn_inst;
     object->value_list = value_list;
+    object->cached = false;
     tgt->tfn_cur = object;
 
     return rc;
 }
 
+ib_status_t ib_rule_log_exec_tfn_inst_cached(ib_rule_log_exec_t *exec_log)
+{
+    ib_rule_log_tgt_t *tgt;
+
+    if (exec_log == NULL) {
+        return IB_OK;
+    }
+    tgt = exec_log->tgt_cur;
+    if ( (tgt == NULL) || (tgt->tfn_cur == NULL) ) {
+        return IB_OK;
+    }
+    tgt->tfn_cur->cached = true;
+
+    return IB_OK;
+}
+
 ib_status_t ib_rule_log_exec_tfn_value(ib_rule_log_exec_t *exec_log,
                                        const ib_field_t *in,
                                        const ib_field_t *out,
@@ -1220,6 +1237,11 @@ static void log_tx_end(
     if ( (ib_flags_all(rule_exec->tx_log->flags, IB_RULE_LOG_FLAG_TX)) &&
          (!rule_exec->tx_log->empty_tx) )
     {
+        if (ib_flags_all(rule_exec->tx_log->flags, IB_RULE_LOG_FLAG_TFN)) {
+            rule_log_exec(rule_exec, "TFN_CACHE %zu hits %zu misses",
+                          rule_exec->tfn_cache_hits,
+                          rule_exec->tfn_cache_misses);
+        }
         rule_log_exec(rule_exec, "TX_END");
     }
     return;
@@ -1534,7 +1556,7 @@ static void log_tfns(
                 }
 
                 rule_log_exec(rule_exec,
-                              "TFN %s() %s \"%.*s:%.*s\" %s %s",
+                              "TFN %s() %s \"%.*s:%.*s\" %s %s%s",
                               ib_transformation_name(ib_transformation_inst_transformation(tfn->tfn_inst)),
                               ib_field_type_name(value->in->type),
                               (tgt->original ? (int)tgt->original->nlen : 0),
@@ -1542,7 +1564,8 @@ static void log_tfns(
                               (int)value->in->nlen, value->in->name,
                               buf,
                               ( value->status == IB_OK ?
-                                  "" : ib_status_to_string(value->status)));
+                                  "" : ib_status_to_string(value->status)),
+                              (tfn->cached ? "CACHED" : ""));
             }
         }
         else {
@@ -1554,14 +1577,15 @@ static void log_tfns(
             if (tgt->original) {
                 rule_log_exec(
                     rule_exec,
-                    "TFN %s() %s \"%.*s\" %s %s",
+                    "TFN %s() %s \"%.*s\" %s %s%s",
                     ib_transformation_name(ib_transformation_inst_transformation(tfn->tfn_inst)),
                     ib_field_type_name(tgt->original->type),
                     (int)tgt->original->nlen,
                     tgt->original->name,
                     buf,
                     ( tfn->value.status == IB_OK ?
-                        "" : ib_status_to_string(tfn->value.status))
+                        "" : ib_status_to_string(tfn->value.status)),
+                    (tfn->cached ? "CACHED" : "")
                 );
             }
         }
@@ -51,6 +51,7 @@ struct ib_rule_log_tfn_t {
     ib_rule_log_tfn_val_t           value;       /**< In, out & status */
     const ib_transformation_inst_t *tfn_inst;    /**< Transformation */
     ib_list_t                      *value_list;  /**< List of ib_rule_log_tfn_val_t */
+    bool                            cached;      /**< Result was cached? */
 };
 typedef struct ib_rule_log_tfn_t ib_rule_log_tfn_t;
 
@@ -341,6 +342,16 @@ ib_status_t ib_rule_log_exec_tfn_value(
     const ib_field_t           *out,
     ib_status_t                 status);
 
+/**
+ * Mark the current transformation's result as taken from the cache
+ *
+ * @param[in,out] exec_log The execution logging object
+ *
+ * @returns IB_OK on success
+ */
+ib_status_t ib_rule_log_exec_tfn_inst_cached(
+    ib_rule_log_exec_t         *exec_log);
+
 /**
  * Finish a transformation for a rule execution log
  *
@@ -69,4 +69,83 @@ class TestCore < CLIPPTest::TestCase
 
 
   end
+
+  # Write the index of 5 event transactions with the given latency and
+  # check that every audit log is indexed once.
+  def audit_index_lines(name, latency)
+    eventdir = File.join(BUILDDIR, name)
+    eventidx = File.join(eventdir, 'idx')
+    FileUtils.rm_rf(eventdir)
+    FileUtils.mkdir_p(eventdir)
+
+    clipp(
+      config: """
+        AuditEngine EventsOnly
+        AuditLogBaseDir #{eventdir}
+        AuditLogParts all
+        AuditLogIndex #{eventidx}
+        AuditLogIndexMaxLatency #{latency}
+      """,
+      default_site_config: <<-EOS
+        Rule REQUEST_LINE @contains "foo" id:1 phase:REQUEST_HEADER event "msg:Oh no."
+      EOS
+    ) do
+      5.times do
+        transaction do |t|
+          t.request(raw: "GET /foobar/a\nHost: foo.com\n\n")
+          t.response(raw: "HTTP/1.1 200 OK\n\n")
+        end
+      end
+    end
+
+    assert_clean_exit
+
+    lines = File.open(eventidx).read.split("\n")
+    assert_equal(5, lines.length)
+    logfiles = lines.map {|line| line.split(" ")[-1]}
+    assert_equal(5, logfiles.uniq.length)
+    logfiles.each do |logfile|
+      assert(File.exist?(File.join(eventdir, logfile)), "#{logfile} missing")
+    end
+  end
+
+  def test_audit_index_batched
+    # Lines are held for up to a second, so they are written together when
+    # the engine shuts down.
+    audit_index_lines('audit_index_batched', 1000)
+  end
+
+  def test_audit_index_immediate
+    audit_index_lines('audit_index_immediate', 0)
+  end
+
+  def test_audit_index_write_error
+    eventdir = File.join(BUILDDIR, 'audit_index_write_error')
+    FileUtils.rm_rf(eventdir)
+    FileUtils.mkdir_p(eventdir)
+
+    clipp(
+      config: """
+        AuditEngine EventsOnly
+        AuditLogBaseDir #{eventdir}
+        AuditLogParts all
+        AuditLogIndex /dev/full
+        AuditLogIndexMaxLatency 0
+      """,
+      default_site_config: <<-EOS
+        Rule REQUEST_LINE @contains "foo" id:1 phase:REQUEST_HEADER event "msg:Oh no."
+      EOS
+    ) do
+      3.times do
+        transaction do |t|
+          t.request(raw: "GET /foobar/a\nHost: foo.com\n\n")
+          t.response(raw: "HTTP/1.1 200 OK\n\n")
+        end
+      end
+    end
+
+    # Every transaction reopens the index after the previous one closed it.
+    assert_clean_exit
+    assert_equal(3, log.scan(/Error writing to audit log index/).length)
+  end
 end
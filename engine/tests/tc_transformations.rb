@@ -95,5 +95,93 @@ class TestTransformations < CLIPPTest::TestCase
     # Check that we didn't crash, but just failed to configure the engine.
     assert_log_match 'Failed to configure the IronBee engine.'
   end
+
+  def test_tfn_cache_shared_prefix
+    clipp(
+      :input_hashes => [simple_hash("GET /foobar/a\n")],
+      :config => <<-EOS,
+        RuleEngineLogLevel INFO
+        RuleEngineLogData all
+      EOS
+      :default_site_config => <<-EOS
+        Action id:1 rev:1 phase:REQUEST_HEADER setvar:x=AbC
+        Rule x.lowercase() @streq abc id:2 rev:1 phase:REQUEST_HEADER clipp_announce:result2
+        Rule x.lowercase().length() @eq 3 id:3 rev:1 phase:REQUEST_HEADER clipp_announce:result3
+      EOS
+    )
+    assert_no_issues
+    assert_log_match /CLIPP ANNOUNCE: result2/
+    assert_log_match /CLIPP ANNOUNCE: result3/
+    assert_log_match /TFN lowercase\(\) .* CACHED/
+    assert_log_match /TFN_CACHE 1 hits 2 misses/
+  end
+
+  def test_tfn_cache_value_changed
+    clipp(
+      :input_hashes => [simple_hash("GET /foobar/a\n")],
+      :default_site_config => <<-EOS
+        Action id:1 rev:1 phase:REQUEST_HEADER setvar:x=AbC
+        Rule x.lowercase() @streq abc id:2 rev:1 phase:REQUEST_HEADER clipp_announce:result2
+        Action id:3 rev:1 phase:REQUEST_HEADER setvar:x=DeF
+        Rule x.lowercase() @streq def id:4 rev:1 phase:REQUEST_HEADER clipp_announce:result4
+      EOS
+    )
+    assert_no_issues
+    assert_log_match /CLIPP ANNOUNCE: result2/
+    assert_log_match /CLIPP ANNOUNCE: result4/
+  end
+
+  def test_tfn_cache_collection_changed
+    clipp(
+      :input_hashes => [simple_hash("GET /foobar/a\n")],
+      :default_site_config => <<-EOS
+        Action id:1 rev:1 phase:REQUEST_HEADER setvar:list:element1=AbC
+        Rule list.first().lowercase() @streq abc id:2 rev:1 phase:REQUEST_HEADER clipp_announce:result2
+        Action id:3 rev:1 phase:REQUEST_HEADER setvar:list:element1=DeF
+        Rule list.first().lowercase() @streq def id:4 rev:1 phase:REQUEST_HEADER clipp_announce:result4
+      EOS
+    )
+    assert_no_issues
+    assert_log_match /CLIPP ANNOUNCE: result2/
+    assert_log_match /CLIPP ANNOUNCE: result4/
+  end
+
+  def test_tfn_cache_collection_number_changed
+    clipp(
+      :input_hashes => [simple_hash("GET /foobar/a\n")],
+      :default_site_config => <<-EOS
+        Action id:1 rev:1 phase:REQUEST_HEADER setvar:list:element1=1
+        Rule list.first() @eq 1 id:2 rev:1 phase:REQUEST_HEADER clipp_announce:result2
+        Action id:3 rev:1 phase:REQUEST_HEADER setvar:list:element1=2
+        Rule list.first() @eq 2 id:4 rev:1 phase:REQUEST_HEADER clipp_announce:result4
+      EOS
+    )
+    assert_no_issues
+    assert_log_match /CLIPP ANNOUNCE: result2/
+    assert_log_match /CLIPP ANNOUNCE: result4/
+  end
+
+  def test_tfn_cache_collection_elements
+    clipp(
+      :modhtp => true,
+      :config => <<-EOS,
+        RuleEngineLogLevel INFO
+        RuleEngineLogData all
+      EOS
+      :default_site_config => <<-EOS
+        Rule ARGS.lowercase() @streq abc id:1 rev:1 phase:REQUEST_HEADER clipp_announce:result1
+        Rule ARGS.lowercase() @streq def id:2 rev:1 phase:REQUEST_HEADER clipp_announce:result2
+      EOS
+    ) do
+      transaction do |t|
+        t.request(raw: "GET /foobar/a?x=AbC&y=DeF HTTP/1.0")
+      end
+    end
+    assert_no_issues
+    assert_log_match /CLIPP ANNOUNCE: result1/
+    assert_log_match /CLIPP ANNOUNCE: result2/
+    assert_log_match /TFN lowercase\(\) .* CACHED/
+    assert_log_match /TFN_CACHE 2 hits 2 misses/
+  end
 end
 
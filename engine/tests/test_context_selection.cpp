@@ -0,0 +1,169 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief Tests of the core context selection
+ */
+
+/* Testing fixture. */
+#include "base_fixture.h"
+
+/* Header of what we are testing. */
+#include <ironbee/clock.h>
+#include <ironbee/context.h>
+#include <ironbee/context_selection.h>
+#include <ironbee/site.h>
+
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+const size_t c_num_sites = 10000;
+
+}
+
+/**
+ * Context selection against a large number of sites.
+ */
+class ContextSelection : public BaseFixture
+{
+public:
+    void SetUp()
+    {
+        BaseFixture::SetUp();
+
+        std::ostringstream config;
+        config << "LogLevel 3\n"
+               << "SensorId B9C1B52B-C24A-4309-B9F9-0EF4CD577A3E\n"
+               << "SensorName UnitTesting\n"
+               << "SensorHostname unit-testing.sensor.tld\n"
+               << "AuditEngine Off\n";
+
+        for (size_t i = 0; i < c_num_sites; ++i) {
+            char id[64];
+            snprintf(id, sizeof(id),
+                     "AAAABBBB-1111-2222-3333-%012zu", i);
+            config << "<Site site-" << i << ">\n"
+                   << "SiteId " << id << "\n"
+                   << "Hostname www.site-" << i << ".com\n"
+                   << "Hostname *.wild-" << i << ".org\n"
+                   << "<Location /api>\n"
+                   << "</Location>\n"
+                   << "</Site>\n";
+        }
+        configureIronBeeByString(config.str());
+
+        ib_conn = buildIronBeeConnection();
+        ib_tx = buildIronBeeTransaction(ib_conn);
+    }
+
+    /**
+     * Select a context for @a hostname and @a path.
+     */
+    ib_context_t *select(const char *hostname, const char *path)
+    {
+        ib_context_t *ctx = NULL;
+
+        ib_tx->hostname = hostname;
+        ib_tx->path = path;
+        if (ib_ctxsel_select_context(ib_engine, ib_conn, ib_tx, &ctx) !=
+            IB_OK)
+        {
+            throw std::runtime_error("Context selection failed.");
+        }
+        return ctx;
+    }
+
+    /**
+     * Name of the site of @a ctx or "" if none.
+     */
+    std::string site_name(const ib_context_t *ctx)
+    {
+        const ib_site_t *site = NULL;
+
+        ib_context_site_get(ctx, &site);
+        return (site == NULL) ? "" : site->name;
+    }
+
+    /**
+     * Path of the location of @a ctx or "" if none.
+     */
+    std::string location_path(const ib_context_t *ctx)
+    {
+        const ib_site_location_t *location = NULL;
+
+        ib_context_location_get(ctx, &location);
+        return (location == NULL) ? "" : location->path;
+    }
+
+    ib_conn_t *ib_conn;
+    ib_tx_t   *ib_tx;
+};
+
+TEST_F(ContextSelection, Matching)
+{
+    ib_context_t *ctx;
+
+    ctx = select("www.site-9999.com", "/index.html");
+    EXPECT_EQ("site-9999", site_name(ctx));
+    EXPECT_EQ("/", location_path(ctx));
+
+    ctx = select("WWW.Site-42.COM", "/api/v1");
+    EXPECT_EQ("site-42", site_name(ctx));
+    EXPECT_EQ("/api", location_path(ctx));
+
+    ctx = select("foo.bar.wild-7.org", "/");
+    EXPECT_EQ("site-7", site_name(ctx));
+
+    ctx = select("wild-7.org", "/");
+    EXPECT_EQ(ib_context_main(ib_engine), ctx);
+
+    ctx = select("www.site-10000.com", "/");
+    EXPECT_EQ(ib_context_main(ib_engine), ctx);
+
+    ctx = select(NULL, "/");
+    EXPECT_EQ(ib_context_main(ib_engine), ctx);
+}
+
+TEST_F(ContextSelection, Benchmark)
+{
+    static const size_t c_iterations = 100000;
+    static const char *c_hosts[] = {
+        "www.site-0.com",
+        "www.site-5000.com",
+        "www.site-9999.com",
+        "a.b.wild-1234.org",
+        "unknown.example.com"
+    };
+    static const size_t c_num_hosts = sizeof(c_hosts) / sizeof(*c_hosts);
+
+    ib_time_t start = ib_clock_get_time();
+    for (size_t i = 0; i < c_iterations; ++i) {
+        select(c_hosts[i % c_num_hosts], "/api/v1/resource");
+    }
+    ib_time_t usec = ib_clock_get_time() - start;
+
+    std::cout << c_iterations << " selections over " << c_num_sites
+              << " sites: " << usec << "us ("
+              << (static_cast<double>(usec) * 1000.0 / c_iterations)
+              << "ns/selection)" << std::endl;
+
+    EXPECT_EQ("site-5000", site_name(select(c_hosts[1], "/")));
+}
@@ -121,3 +121,286 @@ INSTANTIATE_TEST_CASE_P(
         "normalizePathWin"
     )
 );
+
+class TransformationUnchangedTest :
+    public TransformationTest,
+    public ::testing::WithParamInterface<std::pair<const char*, const char*> >
+{
+};
+
+TEST_P(TransformationUnchangedTest, InputIsReturned) {
+    const char* tfn_name = GetParam().first;
+    const char* value = GetParam().second;
+    const ib_transformation_t *tfn;
+    ib_transformation_inst_t  *tfn_inst;
+
+    ib_field_t   *fin;
+    const ib_field_t   *fout;
+    ib_bytestr_t *bs;
+
+    ASSERT_EQ(
+        IB_OK,
+        ib_bytestr_alias_nulstr(&bs, MainMM(), value)
+    );
+    ASSERT_EQ(
+        IB_OK,
+        ib_field_create(
+            &fin,
+            MainMM(),
+            IB_S2SL("unchanged string"),
+            IB_FTYPE_BYTESTR,
+            ib_ftype_bytestr_in(bs)
+        )
+    );
+    ASSERT_EQ(
+        IB_OK,
+        ib_transformation_lookup(ib_engine, IB_S2SL(tfn_name), &tfn)
+    );
+    ASSERT_EQ(
+        IB_OK,
+        ib_transformation_inst_create(&tfn_inst, MainMM(), tfn, NULL)
+    );
+    ASSERT_EQ(
+        IB_OK,
+        ib_transformation_inst_execute(tfn_inst, MainMM(), fin, &fout)
+    );
+
+    ASSERT_EQ(fin, fout);
+}
+
+INSTANTIATE_TEST_CASE_P(
+    TransformationsWithUnchangedString,
+    TransformationUnchangedTest,
+    ::testing::Values(
+        std::make_pair("lowercase", "session_id=a81f9c0e7d2b4c11-x"),
+        std::make_pair("trimLeft", "value  "),
+        std::make_pair("trimRight", "  value"),
+        std::make_pair("trim", "some value"),
+        std::make_pair("removeWhitespace", "/search/results.php?q=iron"),
+        std::make_pair("compressWhitespace", "one two\tthree\nfour five six"),
+        std::make_pair("urlDecode", "/static/css/site.min.css?v=20140612"),
+        std::make_pair("htmlEntityDecode", "<b>plain text; no entities</b>")
+    )
+);
+
+TEST_F(TransformationTest, ChangedAfterLongPrefix) {
+    static const char *c_tfns[][3] = {
+        { "lowercase",
+          "abcdefghijklmnopqrstuvwxyz0123456789-QUERY",
+          "abcdefghijklmnopqrstuvwxyz0123456789-query" },
+        { "compressWhitespace",
+          "abcdefghijklmnopqrstuvwxyz 0123456789 \t\r\nend",
+          "abcdefghijklmnopqrstuvwxyz 0123456789 end" },
+        { "removeWhitespace",
+          "abcdefghijklmnopqrstuvwxyz0123456789 e n d",
+          "abcdefghijklmnopqrstuvwxyz0123456789end" },
+        { "urlDecode",
+          "abcdefghijklmnopqrstuvwxyz0123456789%41+%2",
+          "abcdefghijklmnopqrstuvwxyz0123456789A %2" },
+        { "htmlEntityDecode",
+          "abcdefghijklmnopqrstuvwxyz0123456789&lt;&#65;",
+          "abcdefghijklmnopqrstuvwxyz0123456789<A" }
+    };
+
+    for (size_t i = 0; i < sizeof(c_tfns) / sizeof(*c_tfns); ++i) {
+        const ib_transformation_t *tfn;
+        ib_transformation_inst_t  *tfn_inst;
+        ib_field_t                *fin;
+        const ib_field_t          *fout;
+        ib_bytestr_t              *bs;
+        const ib_bytestr_t        *bs_out;
+
+        ASSERT_EQ(
+            IB_OK,
+            ib_bytestr_alias_nulstr(&bs, MainMM(), c_tfns[i][1]));
+        ASSERT_EQ(
+            IB_OK,
+            ib_field_create(
+                &fin, MainMM(), IB_S2SL("changed"),
+                IB_FTYPE_BYTESTR, ib_ftype_bytestr_in(bs)));
+        ASSERT_EQ(
+            IB_OK,
+            ib_transformation_lookup(
+                ib_engine, IB_S2SL(c_tfns[i][0]), &tfn));
+        ASSERT_EQ(
+            IB_OK,
+            ib_transformation_inst_create(&tfn_inst, MainMM(), tfn, NULL));
+        ASSERT_EQ(
+            IB_OK,
+            ib_transformation_inst_execute(tfn_inst, MainMM(), fin, &fout));
+        ASSERT_NE(fin, fout) << c_tfns[i][0];
+        ASSERT_EQ(IB_OK, ib_field_value(fout, ib_ftype_bytestr_out(&bs_out)));
+        EXPECT_EQ(
+            std::string(c_tfns[i][2]),
+            std::string(
+                reinterpret_cast<const char *>(ib_bytestr_const_ptr(bs_out)),
+                ib_bytestr_length(bs_out))) << c_tfns[i][0];
+    }
+}
+
+class TransformationFusionTest : public TransformationTest
+{
+protected:
+    //! Build a chain of instances of @a names, without parameters.
+    ib_list_t *chain(const char **names, size_t num)
+    {
+        ib_list_t *tfn_insts;
+
+        if (ib_list_create(&tfn_insts, MainMM()) != IB_OK) {
+            throw std::runtime_error("Failed to create list.");
+        }
+        for (size_t i = 0; i < num; ++i) {
+            const ib_transformation_t *tfn;
+            ib_transformation_inst_t  *tfn_inst;
+
+            if (
+                ib_transformation_lookup(
+                    ib_engine, IB_S2SL(names[i]), &tfn) != IB_OK ||
+                ib_transformation_inst_create(
+                    &tfn_inst, MainMM(), tfn, NULL) != IB_OK ||
+                ib_list_push(tfn_insts, tfn_inst) != IB_OK
+            ) {
+                throw std::runtime_error("Failed to build chain.");
+            }
+        }
+        return tfn_insts;
+    }
+
+    //! Run @a tfn_insts one by one over @a value.
+    const ib_field_t *run(const ib_list_t *tfn_insts, const ib_field_t *value)
+    {
+        const ib_list_node_t *node;
+
+        IB_LIST_LOOP_CONST(tfn_insts, node) {
+            if (
+                ib_transformation_inst_execute(
+                    (const ib_transformation_inst_t *)
+                        ib_list_node_data_const(node),
+                    MainMM(), value, &value) != IB_OK
+            ) {
+                throw std::runtime_error("Transformation failed.");
+            }
+        }
+        return value;
+    }
+
+    const ib_field_t *bytestr_field(const char *s)
+    {
+        ib_bytestr_t *bs;
+        ib_field_t   *f;
+
+        if (
+            ib_bytestr_alias_nulstr(&bs, MainMM(), s) != IB_OK ||
+            ib_field_create(&f, MainMM(), IB_S2SL("value"),
+                            IB_FTYPE_BYTESTR, ib_ftype_bytestr_in(bs)) !=
+                IB_OK
+        ) {
+            throw std::runtime_error("Failed to create field.");
+        }
+        return f;
+    }
+
+    std::string value(const ib_field_t *f)
+    {
+        const ib_bytestr_t *bs;
+
+        if (ib_field_value(f, ib_ftype_bytestr_out(&bs)) != IB_OK) {
+            throw std::runtime_error("Not a byte string.");
+        }
+        return std::string(
+            reinterpret_cast<const char *>(ib_bytestr_const_ptr(bs)),
+            ib_bytestr_length(bs));
+    }
+};
+
+TEST_F(TransformationFusionTest, FusesRuns) {
+    static const char *c_names[] = {
+        "lowercase", "urlDecode", "compressWhitespace", "trim",
+        "length",
+        "trimLeft",
+        "name",
+        "htmlEntityDecode", "removeWhitespace"
+    };
+    ib_list_t       *tfn_insts = chain(c_names, 9);
+    const ib_list_t *fused;
+    const ib_list_t *fused_again;
+
+    ASSERT_EQ(
+        IB_OK,
+        ib_transformation_fuse_chain(ib_engine, MainMM(), tfn_insts, &fused));
+    ASSERT_EQ(5U, ib_list_elements(fused));
+
+    const ib_transformation_inst_t *first =
+        (const ib_transformation_inst_t *)ib_list_node_data_const(
+            ib_list_first_const(fused));
+    EXPECT_STREQ(
+        "lowercase+urlDecode+compressWhitespace+trim",
+        ib_transformation_name(ib_transformation_inst_transformation(first)));
+    const ib_transformation_inst_t *last =
+        (const ib_transformation_inst_t *)ib_list_node_data_const(
+            ib_list_last_const(fused));
+    EXPECT_STREQ(
+        "htmlEntityDecode+removeWhitespace",
+        ib_transformation_name(ib_transformation_inst_transformation(last)));
+
+    /* The same chain, from other instances, shares the fused instances. */
+    ASSERT_EQ(
+        IB_OK,
+        ib_transformation_fuse_chain(
+            ib_engine, MainMM(), chain(c_names, 9), &fused_again));
+    EXPECT_EQ(
+        first,
+        ib_list_node_data_const(ib_list_first_const(fused_again)));
+
+    /* Nothing to fuse. */
+    ASSERT_EQ(
+        IB_OK,
+        ib_transformation_fuse_chain(
+            ib_engine, MainMM(), chain(c_names + 3, 3), &fused));
+    EXPECT_EQ(3U, ib_list_elements(fused));
+}
+
+TEST_F(TransformationFusionTest, MatchesUnfused) {
+    static const char *c_names[] = {
+        "lowercase", "urlDecode", "compressWhitespace", "trim",
+        "htmlEntityDecode", "removeWhitespace", "trimRight", "trimLeft"
+    };
+    static const char *c_values[] = {
+        "",
+        "plain",
+        "  SELECT%20*%20FROM+users  WHERE\t\tid=1  ",
+        "%3Cscript%3Ealert(1)%3C%2Fscript%3E",
+        "&lt;IMG SRC=&#106;avascript:alert(&#x27;XSS&#x27;)&gt;",
+        "  \t\n  ",
+        "100%",
+        "a+b%2"
+    };
+    static const size_t c_num_values = sizeof(c_values) / sizeof(*c_values);
+
+    /* Every chain prefix and suffix of at least two transformations. */
+    for (size_t start = 0; start < 7; ++start) {
+        for (size_t end = start + 2; end <= 8; ++end) {
+            ib_list_t       *tfn_insts = chain(c_names + start, end - start);
+            const ib_list_t *fused;
+
+            ASSERT_EQ(
+                IB_OK,
+                ib_transformation_fuse_chain(
+                    ib_engine, MainMM(), tfn_insts, &fused));
+            ASSERT_EQ(1U, ib_list_elements(fused));
+
+            for (size_t i = 0; i < c_num_values; ++i) {
+                const ib_field_t *in = bytestr_field(c_values[i]);
+                const ib_field_t *expected = run(tfn_insts, in);
+                const ib_field_t *actual = run(fused, in);
+
+                EXPECT_EQ(value(expected), value(actual))
+                    << "chain " << start << "-" << end
+                    << " value \"" << c_values[i] << "\"";
+                EXPECT_EQ(expected == in, actual == in)
+                    << "chain " << start << "-" << end
+                    << " value \"" << c_values[i] << "\"";
+            }
+        }
+    }
+}
@@ -25,8 +25,13 @@
 #include "gtest/gtest.h"
 #include "base_fixture.h"
 
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
 #include <fstream>
+#include <iostream>
 
+#include <ironbee/clock.h>
 #include <ironbee/engine_manager.h>
 
 /**
@@ -178,3 +183,98 @@ TEST_F(EngineManager, MaxEngines)
 
     ib_manager_destroy(m_manager);
 }
+
+namespace {
+
+/**
+ * Acquire and release the current engine @a loops times.
+ *
+ * @param[in] manager The engine manager.
+ * @param[in] loops Number of acquire/release pairs.
+ * @param[out] errors Count of failed calls.
+ * @param[out] usec Elapsed time in microseconds.
+ */
+void acquire_release_loop(
+    ib_manager_t *manager,
+    size_t        loops,
+    size_t       *errors,
+    ib_time_t    *usec
+)
+{
+    ib_time_t start = ib_clock_get_time();
+
+    for (size_t i = 0; i < loops; ++i) {
+        ib_engine_t *engine;
+
+        if (ib_manager_engine_acquire(manager, &engine) != IB_OK) {
+            ++(*errors);
+            continue;
+        }
+        if (ib_manager_engine_release(manager, engine) != IB_OK) {
+            ++(*errors);
+        }
+    }
+
+    *usec = ib_clock_get_time() - start;
+}
+
+}
+
+/**
+ * Benchmark concurrent acquire/release while engines are being replaced.
+ *
+ * Reports acquire/release pairs per second for each thread.
+ */
+TEST_F(EngineManager, AcquireReleaseThroughput)
+{
+    static const size_t loops   = 200000;
+    static const size_t reloads = 3;
+    size_t num_threads = boost::thread::hardware_concurrency();
+
+    if (num_threads < 2) {
+        num_threads = 2;
+    }
+
+    std::vector<size_t>    errors(num_threads, 0);
+    std::vector<ib_time_t> usecs(num_threads, 0);
+
+    ASSERT_EQ(
+        IB_OK,
+        ib_manager_engine_create(m_manager, createIronBeeConfig().c_str())
+    );
+
+    boost::thread_group threads;
+    for (size_t i = 0; i < num_threads; ++i) {
+        threads.create_thread(
+            boost::bind(
+                acquire_release_loop,
+                m_manager,
+                loops,
+                &(errors[i]),
+                &(usecs[i])));
+    }
+
+    /* Replace the current engine while the workers are running.  The
+     * workers are still using the manager, so do not return early. */
+    for (size_t i = 0; i < reloads; ++i) {
+        EXPECT_EQ(
+            IB_OK,
+            ib_manager_engine_create(m_manager, createIronBeeConfig().c_str())
+        );
+    }
+
+    threads.join_all();
+
+    for (size_t i = 0; i < num_threads; ++i) {
+        EXPECT_EQ(0U, errors[i]);
+        std::cout << "Thread " << i << ": "
+                  << (usecs[i] > 0 ? loops * 1000000 / usecs[i] : loops)
+                  << " acquire/release per second." << std::endl;
+    }
+
+    /* Only the current engine should survive a cleanup. */
+    ASSERT_EQ(IB_OK, ib_manager_engine_cleanup(m_manager));
+    ASSERT_EQ(1U, ib_manager_engine_count(m_manager));
+
+    ib_manager_destroy(m_manager);
+}
@@ -26,17 +26,30 @@ extern "C" {
 #include "util/kvstore_private.h"
 #include <ironbee/kvstore.h>
 #include <ironbee/kvstore_filesystem.h>
+#include <ironbee/kvstore_log.h>
+#include <ironbee/kvstore_shm.h>
 #include <ironbee/mm.h>
 #include <ironbee/util.h>
 #include <ironbee/uuid.h>
 #include <ironbee/mm_mpool.h>
 
+#include <dirent.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 }
 
 #include "gtest/gtest.h"
 
+#include <ironbee/clock.h>
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
 
 class TestKVStore : public testing::Test
 {
@@ -170,3 +183,596 @@ TEST_F(TestKVStore, test_removes) {
 
     ASSERT_FALSE(result);
 }
+
+TEST_F(TestKVStore, test_stats) {
+    ib_kvstore_key_t   *key;
+    ib_kvstore_value_t *val;
+    ib_kvstore_value_t *result;
+    ib_kvstore_stats_t  before;
+    ib_kvstore_stats_t  after;
+
+    ASSERT_EQ(
+        IB_OK,
+        ib_kvstore_key_create(
+            &key,
+            mm,
+            reinterpret_cast<const uint8_t *>("k4"), 2));
+    ASSERT_EQ(IB_OK, ib_kvstore_value_create(&val, mm));
+    ib_kvstore_value_value_set(
+        val,
+        reinterpret_cast<const uint8_t *>("A key"),
+        5);
+    ib_kvstore_value_type_set(val, "txt", 3);
+    ib_kvstore_value_expiration_set(val, 10 * 1000000LU);
+
+    ib_kvstore_stats_get(&before);
+    ASSERT_EQ(IB_OK, ib_kvstore_set(&kvstore, NULL, key, val));
+    ASSERT_EQ(IB_OK, ib_kvstore_get(&kvstore, NULL, mm, key, &result));
+    ASSERT_EQ(IB_OK, ib_kvstore_remove(&kvstore, key));
+    ASSERT_EQ(IB_ENOENT, ib_kvstore_get(&kvstore, NULL, mm, key, &result));
+    ib_kvstore_stats_get(&after);
+
+    EXPECT_EQ(before.sets + 1, after.sets);
+    EXPECT_EQ(before.gets + 2, after.gets);
+    EXPECT_EQ(before.get_misses + 1, after.get_misses);
+    EXPECT_EQ(before.removes + 1, after.removes);
+    EXPECT_EQ(before.errors, after.errors);
+    EXPECT_LE(before.get_usec, after.get_usec);
+}
+
+/**
+ * Base of fixtures for stores that keep one value per key.
+ */
+class KVStoreFixture : public testing::Test
+{
+    public:
+
+    ib_kvstore_t kvstore;
+    ib_mpool_t *mp;
+    ib_mm_t mm;
+
+    ib_kvstore_key_t *key(const char *k) {
+        ib_kvstore_key_t *key;
+
+        ib_kvstore_key_create(
+            &key, mm, reinterpret_cast<const uint8_t *>(k), strlen(k));
+        return key;
+    }
+
+    ib_status_t set(const char *k, const char *v, ib_time_t ttl) {
+        ib_kvstore_value_t *val;
+
+        ib_kvstore_value_create(&val, mm);
+        ib_kvstore_value_value_set(
+            val, reinterpret_cast<const uint8_t *>(v), strlen(v));
+        ib_kvstore_value_type_set(val, "txt", 3);
+        ib_kvstore_value_expiration_set(val, ttl);
+        return ib_kvstore_set(&kvstore, NULL, key(k), val);
+    }
+
+    std::string get(const char *k) {
+        ib_kvstore_value_t *result = NULL;
+        const uint8_t      *data;
+        size_t              data_length;
+
+        if (ib_kvstore_get(&kvstore, NULL, mm, key(k), &result) != IB_OK) {
+            return "";
+        }
+        ib_kvstore_value_value_get(result, &data, &data_length);
+        return std::string(reinterpret_cast<const char *>(data), data_length);
+    }
+
+    //! Time setting then getting @a n distinct keys; removes them after.
+    ib_time_t time_distinct_keys(int n) {
+        char      k[16];
+        ib_time_t start = ib_clock_get_time();
+
+        for (int i = 0; i < n; ++i) {
+            snprintf(k, sizeof(k), "b%d", i);
+            EXPECT_EQ(IB_OK, set(k, "a small value", 60 * 1000000LU));
+        }
+        for (int i = 0; i < n; ++i) {
+            snprintf(k, sizeof(k), "b%d", i);
+            EXPECT_EQ("a small value", get(k));
+        }
+        ib_time_t usec = ib_clock_get_time() - start;
+
+        for (int i = 0; i < n; ++i) {
+            snprintf(k, sizeof(k), "b%d", i);
+            ib_kvstore_remove(&kvstore, key(k));
+        }
+        return usec;
+    }
+};
+
+class TestKVStoreShm : public KVStoreFixture
+{
+    public:
+
+    virtual void SetUp() {
+        unlink("TestKVStoreShm.shm");
+        ASSERT_EQ(
+            IB_OK,
+            ib_kvstore_shm_init(&kvstore, "TestKVStoreShm.shm", 64, 128));
+        ASSERT_EQ(IB_OK, ib_kvstore_connect(&kvstore));
+        ib_mpool_create(&mp, "TestKVStoreShm", NULL);
+        mm = ib_mm_mpool(mp);
+    }
+
+    virtual void TearDown() {
+        ib_kvstore_destroy(&kvstore);
+        ib_mpool_destroy(mp);
+        unlink("TestKVStoreShm.shm");
+    }
+};
+
+TEST_F(TestKVStoreShm, test_reads_writes) {
+    ASSERT_EQ(IB_OK, set("k1", "A key", 0));
+    ASSERT_EQ(IB_OK, set("k2", "B key", 10 * 1000000LU));
+    EXPECT_EQ("A key", get("k1"));
+    EXPECT_EQ("B key", get("k2"));
+
+    ASSERT_EQ(IB_OK, set("k1", "Another key", 0));
+    EXPECT_EQ("Another key", get("k1"));
+
+    ASSERT_EQ(IB_OK, ib_kvstore_remove(&kvstore, key("k1")));
+    EXPECT_EQ("", get("k1"));
+    EXPECT_EQ("B key", get("k2"));
+}
+
+TEST_F(TestKVStoreShm, test_expiration) {
+    ASSERT_EQ(IB_OK, set("k1", "A key", 1000));
+    usleep(10000);
+    EXPECT_EQ("", get("k1"));
+}
+
+TEST_F(TestKVStoreShm, test_limits) {
+    std::string big(200, 'x');
+    char k[16];
+
+    EXPECT_EQ(IB_EINVAL, set("k1", big.c_str(), 0));
+
+    /* Fill the table; some stripe fills before all 64 slots are used. */
+    ib_status_t rc = IB_OK;
+    int i;
+    for (i = 0; i < 128 && rc == IB_OK; ++i) {
+        snprintf(k, sizeof(k), "k%d", i);
+        rc = set(k, "v", 0);
+    }
+    EXPECT_EQ(IB_EALLOC, rc);
+    EXPECT_GE(65, i);
+
+    /* Removing frees the slot for reuse. */
+    snprintf(k, sizeof(k), "k%d", i - 1);
+    for (int j = 0; j < i - 1; ++j) {
+        char r[16];
+        snprintf(r, sizeof(r), "k%d", j);
+        ASSERT_EQ(IB_OK, ib_kvstore_remove(&kvstore, key(r)));
+    }
+    EXPECT_EQ(IB_OK, set(k, "v", 0));
+}
+
+TEST_F(TestKVStoreShm, test_shared_across_processes) {
+    pid_t pid;
+    int   status;
+
+    pid = fork();
+    ASSERT_LE(0, pid);
+    if (pid == 0) {
+        ib_kvstore_t child;
+
+        if (
+            ib_kvstore_shm_init(&child, "TestKVStoreShm.shm", 64, 128) !=
+                IB_OK ||
+            ib_kvstore_connect(&child) != IB_OK
+        ) {
+            _exit(1);
+        }
+        kvstore = child;
+        for (int i = 0; i < 1000; ++i) {
+            set("counter", "child", 0);
+        }
+        _exit(0);
+    }
+    for (int i = 0; i < 1000; ++i) {
+        ASSERT_EQ(IB_OK, set("other", "parent", 0));
+    }
+    ASSERT_EQ(pid, waitpid(pid, &status, 0));
+    ASSERT_TRUE(WIFEXITED(status));
+    ASSERT_EQ(0, WEXITSTATUS(status));
+
+    EXPECT_EQ("child", get("counter"));
+    EXPECT_EQ("parent", get("other"));
+}
+
+TEST_F(TestKVStoreShm, test_truncated_file) {
+    ib_kvstore_t other;
+
+    /* A file too short to hold a header is rejected without reading it. */
+    unlink("TestKVStoreShm.short");
+    int fd = open("TestKVStoreShm.short", O_RDWR | O_CREAT, 0600);
+    ASSERT_LE(0, fd);
+    ASSERT_EQ(4, write(fd, "kvsh", 4));
+    close(fd);
+
+    ASSERT_EQ(
+        IB_OK,
+        ib_kvstore_shm_init(&other, "TestKVStoreShm.short", 64, 128));
+    EXPECT_EQ(IB_EINVAL, ib_kvstore_connect(&other));
+    ib_kvstore_destroy(&other);
+    unlink("TestKVStoreShm.short");
+}
+
+namespace {
+
+const char c_log_dir[] = "TestKVStoreLog.d";
+
+//! Segment file names in c_log_dir, sorted.
+std::vector<std::string> log_segments()
+{
+    std::vector<std::string> segments;
+    DIR *dir = opendir(c_log_dir);
+    struct dirent *entry;
+
+    while (dir != NULL && (entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] != '.') {
+            segments.push_back(std::string(c_log_dir) + "/" + entry->d_name);
+        }
+    }
+    if (dir != NULL) {
+        closedir(dir);
+    }
+    std::sort(segments.begin(), segments.end());
+    return segments;
+}
+
+}
+
+class TestKVStoreLog : public KVStoreFixture
+{
+    public:
+
+    virtual void SetUp() {
+        int mkdir_rc;
+
+        mkdir_rc = mkdir(c_log_dir, 0777);
+        ASSERT_TRUE(mkdir_rc == 0 || ( mkdir_rc == -1 && errno == EEXIST));
+        std::vector<std::string> segments = log_segments();
+        for (size_t i = 0; i < segments.size(); ++i) {
+            unlink(segments[i].c_str());
+        }
+        ib_mpool_create(&mp, "TestKVStoreLog", NULL);
+        mm = ib_mm_mpool(mp);
+        open(0);
+    }
+
+    virtual void TearDown() {
+        ib_kvstore_destroy(&kvstore);
+        ib_mpool_destroy(mp);
+    }
+
+    void open(size_t segment_size) {
+        ASSERT_EQ(IB_OK, ib_kvstore_log_init(&kvstore, c_log_dir));
+        if (segment_size > 0) {
+            ib_kvstore_log_set_segment_size(&kvstore, segment_size);
+        }
+        ib_kvstore_log_set_compaction(&kvstore, 0, 50);
+        ASSERT_EQ(IB_OK, ib_kvstore_connect(&kvstore));
+    }
+
+    void reopen(size_t segment_size = 0) {
+        ib_kvstore_destroy(&kvstore);
+        open(segment_size);
+    }
+};
+
+TEST_F(TestKVStoreLog, test_reads_writes) {
+    ASSERT_EQ(IB_OK, set("k1", "A key", 0));
+    ASSERT_EQ(IB_OK, set("k2", "B key", 10 * 1000000LU));
+    EXPECT_EQ("A key", get("k1"));
+    EXPECT_EQ("B key", get("k2"));
+
+    ASSERT_EQ(IB_OK, set("k1", "Another key", 0));
+    EXPECT_EQ("Another key", get("k1"));
+
+    ASSERT_EQ(IB_OK, ib_kvstore_remove(&kvstore, key("k1")));
+    EXPECT_EQ("", get("k1"));
+    EXPECT_EQ("B key", get("k2"));
+
+    ASSERT_EQ(IB_OK, set("k3", "", 0));
+    EXPECT_EQ("", get("k3"));
+}
+
+TEST_F(TestKVStoreLog, test_expiration) {
+    ASSERT_EQ(IB_OK, set("k1", "A key", 1000));
+    usleep(10000);
+    EXPECT_EQ("", get("k1"));
+}
+
+TEST_F(TestKVStoreLog, test_recovery) {
+    ASSERT_EQ(IB_OK, set("k1", "A key", 0));
+    ASSERT_EQ(IB_OK, set("k2", "B key", 0));
+    ASSERT_EQ(IB_OK, set("k1", "Another key", 0));
+    ASSERT_EQ(IB_OK, ib_kvstore_remove(&kvstore, key("k2")));
+    ASSERT_EQ(IB_OK, set("k3", "C key", 1000));
+    usleep(10000);
+
+    reopen();
+    EXPECT_EQ("Another key", get("k1"));
+    EXPECT_EQ("", get("k2"));
+    EXPECT_EQ("", get("k3"));
+}
+
+TEST_F(TestKVStoreLog, test_torn_write) {
+    struct stat sb;
+
+    ASSERT_EQ(IB_OK, set("k1", "A key", 0));
+    ib_kvstore_destroy(&kvstore);
+
+    /* Simulate a crash part way through appending a record. */
+    std::vector<std::string> segments = log_segments();
+    ASSERT_EQ(1U, segments.size());
+    ASSERT_EQ(0, stat(segments[0].c_str(), &sb));
+    int fd = ::open(segments[0].c_str(), O_WRONLY | O_APPEND);
+    ASSERT_LE(0, fd);
+    ASSERT_EQ(13, write(fd, "GLVK partial.", 13));
+    close(fd);
+
+    open(0);
+    EXPECT_EQ("A key", get("k1"));
+
+    struct stat sb2;
+    ASSERT_EQ(0, stat(segments[0].c_str(), &sb2));
+    EXPECT_EQ(sb.st_size, sb2.st_size);
+
+    ASSERT_EQ(IB_OK, set("k2", "B key", 0));
+    reopen();
+    EXPECT_EQ("A key", get("k1"));
+    EXPECT_EQ("B key", get("k2"));
+}
+
+TEST_F(TestKVStoreLog, test_compaction) {
+    char k[16];
+    char v[16];
+
+    reopen(1024);
+
+    /* Mostly overwrites, a removal and an expiring key. */
+    for (int i = 0; i < 1000; ++i) {
+        snprintf(k, sizeof(k), "k%d", i % 10);
+        snprintf(v, sizeof(v), "v%d", i);
+        ASSERT_EQ(IB_OK, set(k, v, 0));
+    }
+    ASSERT_EQ(IB_OK, set("expires", "soon", 1000));
+    ASSERT_EQ(IB_OK, set("removed", "soon", 0));
+    ASSERT_EQ(IB_OK, ib_kvstore_remove(&kvstore, key("removed")));
+    ASSERT_EQ(IB_OK, set("kept", "forever", 0));
+    usleep(10000);
+
+    size_t before = log_segments().size();
+    ASSERT_EQ(IB_OK, ib_kvstore_log_compact(&kvstore));
+    size_t after = log_segments().size();
+    EXPECT_GT(before, 10U);
+    EXPECT_GT(5U, after);
+
+    for (int i = 990; i < 1000; ++i) {
+        snprintf(k, sizeof(k), "k%d", i % 10);
+        snprintf(v, sizeof(v), "v%d", i);
+        EXPECT_EQ(v, get(k));
+    }
+    EXPECT_EQ("forever", get("kept"));
+
+    reopen(1024);
+    for (int i = 990; i < 1000; ++i) {
+        snprintf(k, sizeof(k), "k%d", i % 10);
+        snprintf(v, sizeof(v), "v%d", i);
+        EXPECT_EQ(v, get(k));
+    }
+    EXPECT_EQ("forever", get("kept"));
+    EXPECT_EQ("", get("removed"));
+    EXPECT_EQ("", get("expires"));
+}
+
+TEST_F(TestKVStoreLog, test_shared_directory) {
+    ib_kvstore_t other;
+
+    /* A second store of the directory, as during an engine reload. */
+    ASSERT_EQ(IB_OK, ib_kvstore_log_init(&other, "./TestKVStoreLog.d/"));
+    ASSERT_EQ(IB_OK, ib_kvstore_connect(&other));
+    ASSERT_EQ(kvstore.server, other.server);
+
+    ASSERT_EQ(IB_OK, set("k1", "A key", 0));
+    std::swap(kvstore, other);
+    EXPECT_EQ("A key", get("k1"));
+    ASSERT_EQ(IB_OK, set("k2", "B key", 0));
+    std::swap(kvstore, other);
+    EXPECT_EQ("B key", get("k2"));
+
+    /* The log stays open until the last store disconnects. */
+    ib_kvstore_disconnect(&other);
+    ib_kvstore_destroy(&other);
+    ASSERT_EQ(IB_OK, set("k3", "C key", 0));
+
+    reopen();
+    EXPECT_EQ("A key", get("k1"));
+    EXPECT_EQ("B key", get("k2"));
+    EXPECT_EQ("C key", get("k3"));
+}
+
+TEST_F(TestKVStoreLog, test_locked_by_other_process) {
+    static const char c_dir[] = "TestKVStoreLogLocked.d";
+    ib_kvstore_t      other;
+    int               to_child[2];
+    int               to_parent[2];
+    char              c;
+    pid_t             pid;
+    int               status;
+
+    int mkdir_rc = mkdir(c_dir, 0777);
+    ASSERT_TRUE(mkdir_rc == 0 || ( mkdir_rc == -1 && errno == EEXIST));
+    ASSERT_EQ(0, pipe(to_child));
+    ASSERT_EQ(0, pipe(to_parent));
+
+    pid = fork();
+    ASSERT_LE(0, pid);
+    if (pid == 0) {
+        ib_kvstore_t child;
+
+        if (
+            ib_kvstore_log_init(&child, c_dir) != IB_OK ||
+            ib_kvstore_connect(&child) != IB_OK
+        ) {
+            _exit(1);
+        }
+        kvstore = child;
+        if (set("k1", "child", 0) != IB_OK) {
+            _exit(1);
+        }
+        /* Hold the directory until the parent has tried it. */
+        if (write(to_parent[1], "x", 1) != 1 || read(to_child[0], &c, 1) != 1) {
+            _exit(2);
+        }
+        ib_kvstore_destroy(&child);
+        _exit(0);
+    }
+    ASSERT_EQ(1, read(to_parent[0], &c, 1));
+
+    /* Connecting does not open the log, so only use fails. */
+    ASSERT_EQ(IB_OK, ib_kvstore_log_init(&other, c_dir));
+    ASSERT_EQ(IB_OK, ib_kvstore_connect(&other));
+    std::swap(kvstore, other);
+    EXPECT_EQ(IB_EAGAIN, set("k2", "parent", 0));
+    std::swap(kvstore, other);
+
+    ASSERT_EQ(1, write(to_child[1], "x", 1));
+    ASSERT_EQ(pid, waitpid(pid, &status, 0));
+    ASSERT_TRUE(WIFEXITED(status));
+    ASSERT_EQ(0, WEXITSTATUS(status));
+
+    /* Released when the child closed the store. */
+    std::swap(kvstore, other);
+    EXPECT_EQ("child", get("k1"));
+    std::swap(kvstore, other);
+    ib_kvstore_destroy(&other);
+
+    close(to_child[0]);
+    close(to_child[1]);
+    close(to_parent[0]);
+    close(to_parent[1]);
+}
+
+TEST_F(TestKVStoreLog, test_connected_before_fork) {
+    pid_t pid;
+    int   status;
+
+    /* As in a forking server: connected at configuration, used by a
+     * child. */
+    pid = fork();
+    ASSERT_LE(0, pid);
+    if (pid == 0) {
+        if (set("k1", "child", 0) != IB_OK) {
+            _exit(1);
+        }
+        ib_kvstore_destroy(&kvstore);
+        _exit(0);
+    }
+    ASSERT_EQ(pid, waitpid(pid, &status, 0));
+    ASSERT_TRUE(WIFEXITED(status));
+    ASSERT_EQ(0, WEXITSTATUS(status));
+
+    EXPECT_EQ("child", get("k1"));
+}
+
+TEST_F(TestKVStoreLog, test_not_inherited_across_fork) {
+    pid_t pid;
+    int   status;
+
+    ASSERT_EQ(IB_OK, set("k1", "parent", 0));
+
+    /* The child must not append through the parent's index. */
+    pid = fork();
+    ASSERT_LE(0, pid);
+    if (pid == 0) {
+        if (set("k2", "child", 0) != IB_EAGAIN) {
+            _exit(1);
+        }
+        if (get("k1") != "") {
+            _exit(2);
+        }
+        ib_kvstore_destroy(&kvstore);
+        _exit(0);
+    }
+    ASSERT_EQ(pid, waitpid(pid, &status, 0));
+    ASSERT_TRUE(WIFEXITED(status));
+    ASSERT_EQ(0, WEXITSTATUS(status));
+
+    /* The child's exit left the parent's log and lock alone. */
+    ASSERT_EQ(IB_OK, set("k3", "parent", 0));
+    reopen();
+    EXPECT_EQ("parent", get("k1"));
+    EXPECT_EQ("", get("k2"));
+    EXPECT_EQ("parent", get("k3"));
+}
+
+TEST_F(TestKVStoreLog, test_sync) {
+    ib_kvstore_destroy(&kvstore);
+    ASSERT_EQ(IB_OK, ib_kvstore_log_init(&kvstore, c_log_dir));
+    ib_kvstore_log_set_sync(&kvstore, true);
+    ib_kvstore_log_set_compaction(&kvstore, 0, 50);
+    ASSERT_EQ(IB_OK, ib_kvstore_connect(&kvstore));
+
+    ASSERT_EQ(IB_OK, set("k1", "A key", 0));
+    ASSERT_EQ(IB_OK, set("k2", "B key", 0));
+    ASSERT_EQ(IB_OK, ib_kvstore_remove(&kvstore, key("k2")));
+
+    reopen();
+    EXPECT_EQ("A key", get("k1"));
+    EXPECT_EQ("", get("k2"));
+}
+
+TEST_F(TestKVStoreLog, Benchmark) {
+    static const int c_iterations = 100000;
+    char k[16];
+
+    ib_time_t start = ib_clock_get_time();
+    for (int i = 0; i < c_iterations; ++i) {
+        snprintf(k, sizeof(k), "k%d", i % 1000);
+        ASSERT_EQ(IB_OK, set(k, "a small value", 0));
+        ASSERT_EQ("a small value", get(k));
+    }
+    ib_time_t usec = ib_clock_get_time() - start;
+
+    std::cout << c_iterations << " set/get pairs: " << usec << "us ("
+              << (static_cast<double>(usec) * 1000.0 / c_iterations)
+              << "ns/pair)" << std::endl;
+}
+
+/**
+ * Log store against the filesystem store, each holding one value per key.
+ */
+TEST_F(TestKVStoreLog, BenchmarkAgainstFilesystem) {
+    static const int c_keys = 5000;
+    ib_kvstore_t     log_store = kvstore;
+    ib_time_t        log_usec;
+    ib_time_t        fs_usec;
+
+    log_usec = time_distinct_keys(c_keys);
+
+    int mkdir_rc = mkdir("TestKVStoreLogBench.d", 0777);
+    ASSERT_TRUE(mkdir_rc == 0 || ( mkdir_rc == -1 && errno == EEXIST));
+    ib_uuid_initialize();
+    ASSERT_EQ(
+        IB_OK,
+        ib_kvstore_filesystem_init(&kvstore, "TestKVStoreLogBench.d"));
+    fs_usec = time_distinct_keys(c_keys);
+    ib_kvstore_destroy(&kvstore);
+    ib_uuid_shutdown();
+    kvstore = log_store;
+
+    std::cout << c_keys << " distinct keys set then got: log "
+              << log_usec << "us ("
+              << (static_cast<double>(log_usec) * 1000.0 / c_keys)
+              << "ns/key), filesystem " << fs_usec << "us ("
+              << (static_cast<double>(fs_usec) * 1000.0 / c_keys)
+              << "ns/key)" << std::endl;
+}
@@ -0,0 +1,451 @@
+//////////////////////////////////////////////////////////////////////////////
+// Licensed to Qualys, Inc. (QUALYS) under one or more
+// contributor license agreements.  See the NOTICE file distributed with
+// this work for additional information regarding copyright ownership.
+// QUALYS licenses this file to You under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @file
+ * @brief IronBee --- Logger queue tests.
+ */
+
+#include "ironbee_config_auto.h"
+
+#include <ironbee/logger.h>
+#include <ironbee/mm_mpool.h>
+
+#include "gtest/gtest.h"
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include <cstdlib>
+#include <vector>
+
+#include <pthread.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+//! Writer state shared with the callbacks below.
+struct test_writer_t
+{
+    ib_logger_writer_t *writer;    //!< Set by the first record_fn call.
+    bool                drain;     //!< Dequeue from record_fn?
+    std::vector<int>    written;   //!< Records handled, in order.
+    size_t              freed;     //!< Records freed.
+};
+
+extern "C" {
+
+ib_status_t test_format(
+    ib_logger_t           *logger,
+    const ib_logger_rec_t *rec,
+    const uint8_t         *log_msg,
+    const size_t           log_msg_sz,
+    void                  *writer_record,
+    void                  *data
+)
+{
+    int *value = static_cast<int *>(malloc(sizeof(int)));
+    if (value == NULL) {
+        return IB_EALLOC;
+    }
+    *value = atoi(std::string(
+        reinterpret_cast<const char *>(log_msg), log_msg_sz).c_str());
+    *static_cast<int **>(writer_record) = value;
+    return IB_OK;
+}
+
+void test_free(ib_logger_t *logger, void *writer_record, void *data)
+{
+    test_writer_t *test_writer = static_cast<test_writer_t *>(data);
+
+    __sync_add_and_fetch(&(test_writer->freed), 1);
+    free(writer_record);
+}
+
+void test_handler(void *element, void *data)
+{
+    test_writer_t *test_writer = static_cast<test_writer_t *>(data);
+
+    test_writer->written.push_back(*static_cast<int *>(element));
+}
+
+ib_status_t test_record(
+    ib_logger_t        *logger,
+    ib_logger_writer_t *writer,
+    void               *data
+)
+{
+    test_writer_t *test_writer = static_cast<test_writer_t *>(data);
+
+    test_writer->writer = writer;
+    if (test_writer->drain) {
+        return ib_logger_dequeue(logger, writer, test_handler, test_writer);
+    }
+    return IB_OK;
+}
+
+}
+
+}
+
+class TestLogger : public testing::Test
+{
+public:
+    virtual void SetUp()
+    {
+        ASSERT_EQ(IB_OK, ib_mpool_create(&m_mp, "TestLogger", NULL));
+        ASSERT_EQ(
+            IB_OK,
+            ib_logger_create(&m_logger, IB_LOG_INFO, ib_mm_mpool(m_mp)));
+
+        m_test_writer.writer = NULL;
+        m_test_writer.drain = false;
+        m_test_writer.freed = 0;
+
+        ib_logger_format_t *format;
+        ASSERT_EQ(
+            IB_OK,
+            ib_logger_format_create(
+                m_logger, &format,
+                test_format, NULL,
+                test_free, &m_test_writer));
+        ASSERT_EQ(
+            IB_OK,
+            ib_logger_writer_add(
+                m_logger,
+                NULL, NULL, NULL, NULL, NULL, NULL,
+                format,
+                test_record, &m_test_writer));
+    }
+
+    virtual void TearDown()
+    {
+        ib_mpool_destroy(m_mp);
+    }
+
+    void log(int n)
+    {
+        ib_logger_log_va(
+            m_logger, IB_LOGGER_ERRORLOG_TYPE, __FILE__, __func__, __LINE__,
+            NULL, NULL, NULL, NULL, IB_LOG_INFO, "%d", n);
+    }
+
+    void drain()
+    {
+        ASSERT_TRUE(m_test_writer.writer != NULL);
+        ASSERT_EQ(
+            IB_OK,
+            ib_logger_dequeue(
+                m_logger, m_test_writer.writer, test_handler, &m_test_writer));
+    }
+
+    ib_mpool_t    *m_mp;
+    ib_logger_t   *m_logger;
+    test_writer_t  m_test_writer;
+};
+
+TEST_F(TestLogger, DropNewest)
+{
+    ib_logger_stats_t stats;
+
+    ib_logger_overflow_set(m_logger, IB_LOGGER_OVERFLOW_DROP_NEWEST, 0);
+    for (int i = 0; i < 1100; ++i) {
+        log(i);
+    }
+
+    ib_logger_stats_get(m_logger, &stats);
+    EXPECT_EQ(stats.capacity, stats.depth);
+    EXPECT_EQ(1100 - stats.capacity, stats.dropped);
+    EXPECT_EQ(stats.capacity, stats.enqueued);
+
+    drain();
+    ASSERT_EQ(stats.capacity, m_test_writer.written.size());
+    EXPECT_EQ(0, m_test_writer.written.front());
+    EXPECT_EQ(int(stats.capacity) - 1, m_test_writer.written.back());
+    EXPECT_EQ(1100U, m_test_writer.freed);
+
+    ib_logger_stats_get(m_logger, &stats);
+    EXPECT_EQ(0U, stats.depth);
+}
+
+TEST_F(TestLogger, DropOldest)
+{
+    ib_logger_stats_t stats;
+
+    ib_logger_overflow_set(m_logger, IB_LOGGER_OVERFLOW_DROP_OLDEST, 0);
+    for (int i = 0; i < 1100; ++i) {
+        log(i);
+    }
+
+    ib_logger_stats_get(m_logger, &stats);
+    EXPECT_EQ(1100 - stats.capacity, stats.dropped);
+
+    drain();
+    ASSERT_EQ(stats.capacity, m_test_writer.written.size());
+    EXPECT_EQ(int(1100 - stats.capacity), m_test_writer.written.front());
+    EXPECT_EQ(1099, m_test_writer.written.back());
+    EXPECT_EQ(1100U, m_test_writer.freed);
+
+    /* The writer is notified again once the queue has emptied. */
+    m_test_writer.drain = true;
+    log(1100);
+    EXPECT_EQ(1100, m_test_writer.written.back());
+}
+
+TEST_F(TestLogger, BlockTimeout)
+{
+    ib_logger_stats_t stats;
+
+    ib_logger_overflow_set(m_logger, IB_LOGGER_OVERFLOW_BLOCK, 1);
+    for (int i = 0; i < 1025; ++i) {
+        log(i);
+    }
+
+    ib_logger_stats_get(m_logger, &stats);
+    EXPECT_EQ(1U, stats.blocked);
+    EXPECT_EQ(1U, stats.dropped);
+
+    drain();
+    EXPECT_EQ(1024U, m_test_writer.written.size());
+}
+
+namespace {
+
+void log_loop(ib_logger_t *logger, int thread, int n)
+{
+    for (int i = 0; i < n; ++i) {
+        ib_logger_log_va(
+            logger, IB_LOGGER_ERRORLOG_TYPE, __FILE__, __func__, __LINE__,
+            NULL, NULL, NULL, NULL, IB_LOG_INFO, "%d", thread * n + i);
+    }
+}
+
+}
+
+TEST_F(TestLogger, ConcurrentProducers)
+{
+    static const int c_num_threads = 8;
+    static const int c_num_logs = 10000;
+    ib_logger_stats_t stats;
+    boost::thread_group threads;
+
+    m_test_writer.drain = true;
+    ib_logger_overflow_set(m_logger, IB_LOGGER_OVERFLOW_BLOCK, 10000);
+
+    for (int i = 0; i < c_num_threads; ++i) {
+        threads.create_thread(
+            boost::bind(log_loop, m_logger, i, c_num_logs));
+    }
+    threads.join_all();
+
+    ib_logger_stats_get(m_logger, &stats);
+    EXPECT_EQ(0U, stats.dropped);
+    EXPECT_EQ(0U, stats.depth);
+    EXPECT_EQ(size_t(c_num_threads * c_num_logs), stats.enqueued);
+    EXPECT_EQ(size_t(c_num_threads * c_num_logs),
+              m_test_writer.written.size());
+}
+
+namespace {
+
+//! Count the lines in @a file from the start.
+size_t count_lines(FILE *file)
+{
+    size_t lines = 0;
+    int c;
+
+    rewind(file);
+    while ((c = fgetc(file)) != EOF) {
+        if (c == '\n') {
+            ++lines;
+        }
+    }
+    return lines;
+}
+
+}
+
+class TestLoggerBatched : public testing::Test
+{
+public:
+    virtual void SetUp()
+    {
+        ASSERT_EQ(IB_OK, ib_mpool_create(&m_mp, "TestLoggerBatched", NULL));
+        ASSERT_EQ(
+            IB_OK,
+            ib_logger_create(&m_logger, IB_LOG_INFO, ib_mm_mpool(m_mp)));
+        m_file = tmpfile();
+        ASSERT_TRUE(m_file != NULL);
+        ASSERT_EQ(IB_OK, ib_logger_writer_add_default(m_logger, m_file));
+        ib_logger_overflow_set(m_logger, IB_LOGGER_OVERFLOW_BLOCK, 10000);
+    }
+
+    virtual void TearDown()
+    {
+        ib_mpool_destroy(m_mp);
+        fclose(m_file);
+    }
+
+    ib_mpool_t  *m_mp;
+    ib_logger_t *m_logger;
+    FILE        *m_file;
+};
+
+TEST_F(TestLoggerBatched, Inline)
+{
+    log_loop(m_logger, 0, 100);
+
+    EXPECT_EQ(100U, count_lines(m_file));
+}
+
+TEST_F(TestLoggerBatched, Thread)
+{
+    static const int c_num_threads = 4;
+    static const int c_num_logs = 5000;
+    ib_logger_stats_t stats;
+    boost::thread_group threads;
+
+    ASSERT_EQ(IB_OK, ib_logger_writer_threads_start(m_logger));
+    for (int i = 0; i < c_num_threads; ++i) {
+        threads.create_thread(
+            boost::bind(log_loop, m_logger, i, c_num_logs));
+    }
+    threads.join_all();
+
+    /* Closing stops the thread after writing everything queued. */
+    ASSERT_EQ(IB_OK, ib_logger_close(m_logger));
+
+    ib_logger_stats_get(m_logger, &stats);
+    EXPECT_EQ(0U, stats.depth);
+    EXPECT_EQ(0U, stats.dropped);
+    EXPECT_EQ(size_t(c_num_threads * c_num_logs), count_lines(m_file));
+}
+
+namespace {
+
+//! State of a batched writer that checks which thread writes.
+struct thread_writer_t
+{
+    pthread_t logging_thread; //!< The thread that logs.
+    size_t    records;        //!< Records written.
+    size_t    inline_batches; //!< Batches written by @c logging_thread.
+};
+
+extern "C" {
+
+ib_status_t thread_batch(
+    ib_logger_t  *logger,
+    void * const *records,
+    size_t        nrecords,
+    void         *data
+)
+{
+    thread_writer_t *thread_writer = static_cast<thread_writer_t *>(data);
+
+    thread_writer->records += nrecords;
+    if (pthread_equal(pthread_self(), thread_writer->logging_thread)) {
+        ++(thread_writer->inline_batches);
+    }
+    return IB_OK;
+}
+
+}
+
+}
+
+class TestLoggerThreadWriter : public TestLoggerBatched
+{
+public:
+    virtual void SetUp()
+    {
+        TestLoggerBatched::SetUp();
+
+        m_thread_writer.logging_thread = pthread_self();
+        m_thread_writer.records = 0;
+        m_thread_writer.inline_batches = 0;
+        m_test_writer.freed = 0;
+
+        ASSERT_EQ(
+            IB_OK,
+            ib_logger_format_create(
+                m_logger, &m_format,
+                test_format, NULL,
+                test_free, &m_test_writer));
+    }
+
+    void add_thread_writer()
+    {
+        ASSERT_EQ(
+            IB_OK,
+            ib_logger_writer_add_batched(
+                m_logger,
+                NULL, NULL, NULL, NULL, NULL, NULL,
+                m_format,
+                thread_batch, &m_thread_writer));
+    }
+
+    ib_logger_format_t *m_format;
+    test_writer_t       m_test_writer;
+    thread_writer_t     m_thread_writer;
+};
+
+TEST_F(TestLoggerThreadWriter, AddedAfterStart)
+{
+    ASSERT_EQ(IB_OK, ib_logger_writer_threads_start(m_logger));
+    add_thread_writer();
+
+    log_loop(m_logger, 0, 100);
+    ASSERT_EQ(IB_OK, ib_logger_close(m_logger));
+
+    EXPECT_EQ(100U, m_thread_writer.records);
+    EXPECT_EQ(0U, m_thread_writer.inline_batches);
+    EXPECT_EQ(100U, count_lines(m_file));
+}
+
+TEST_F(TestLoggerThreadWriter, Fork)
+{
+    int   status;
+    pid_t pid;
+
+    add_thread_writer();
+    ASSERT_EQ(IB_OK, ib_logger_writer_threads_start(m_logger));
+    log_loop(m_logger, 0, 10);
+
+    pid = fork();
+    ASSERT_NE(-1, pid);
+    if (pid == 0) {
+        /* The parent's thread is gone; a new one writes in the child. */
+        alarm(10);
+        m_thread_writer.records = 0;
+        m_thread_writer.logging_thread = pthread_self();
+        log_loop(m_logger, 1, 10);
+        ib_logger_close(m_logger);
+        _exit(
+            (m_thread_writer.records == 10 &&
+             m_thread_writer.inline_batches == 0) ? 0 : 1);
+    }
+
+    ASSERT_EQ(pid, waitpid(pid, &status, 0));
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(0, WEXITSTATUS(status));
+
+    log_loop(m_logger, 2, 10);
+    ASSERT_EQ(IB_OK, ib_logger_close(m_logger));
+    EXPECT_EQ(20U, m_thread_writer.records);
+    EXPECT_EQ(0U, m_thread_writer.inline_batches);
+}
@@ -0,0 +1,267 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief Tests of rules shared between location contexts
+ */
+
+/* Testing fixture. */
+#include "base_fixture.h"
+
+#include "engine_private.h"
+#include "rule_engine_private.h"
+
+#include <ironbee/clock.h>
+#include <ironbee/context_selection.h>
+
+#include <sys/resource.h>
+
+#include <cstdio>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+
+namespace {
+
+const size_t c_num_sites = 1000;
+const size_t c_num_rules = 1000;
+
+//! Maximum resident set size of the process in KiB.
+long max_rss()
+{
+    struct rusage usage;
+
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+}
+
+/**
+ * Many sites enabling a large main context rule set.
+ */
+class RuleContexts : public BaseFixture
+{
+public:
+    void SetUp()
+    {
+        BaseFixture::SetUp();
+
+        std::ostringstream config;
+        config << "LogLevel 3\n"
+               << "SensorId B9C1B52B-C24A-4309-B9F9-0EF4CD577A3E\n"
+               << "SensorName UnitTesting\n"
+               << "SensorHostname unit-testing.sensor.tld\n"
+               << "AuditEngine Off\n"
+               << "LoadModule \"ibmod_rules.so\"\n";
+
+        for (size_t i = 0; i < c_num_rules; ++i) {
+            config << "Rule REQUEST_METHOD @streq \"POST\" id:rule-" << i
+                   << " phase:REQUEST_HEADER\n";
+        }
+
+        for (size_t i = 0; i < c_num_sites; ++i) {
+            char id[64];
+            snprintf(id, sizeof(id),
+                     "AAAABBBB-1111-2222-3333-%012zu", i);
+            config << "<Site site-" << i << ">\n"
+                   << "SiteId " << id << "\n"
+                   << "Hostname www.site-" << i << ".com\n"
+                   << "RuleEnable all\n"
+                   << "<Location />\n";
+            if (i == 0) {
+                config << "RuleDisable id:rule-0\n";
+            }
+            config << "</Location>\n"
+                   << "</Site>\n";
+        }
+
+        long      rss = max_rss();
+        ib_time_t start = ib_clock_get_time();
+        configureIronBeeByString(config.str());
+        ib_time_t usec = ib_clock_get_time() - start;
+
+        std::cout << c_num_sites << " sites with " << c_num_rules
+                  << " rules: configured in " << usec << "us, max RSS grew "
+                  << (max_rss() - rss) << "KiB" << std::endl;
+
+        ib_conn = buildIronBeeConnection();
+        ib_tx = buildIronBeeTransaction(ib_conn);
+    }
+
+    /**
+     * Request header phase ruleset of the context selected for @a hostname.
+     */
+    const ib_ruleset_phase_t *phase_rules(const char *hostname)
+    {
+        ib_context_t *ctx = NULL;
+
+        ib_tx->hostname = hostname;
+        ib_tx->path = "/";
+        if (ib_ctxsel_select_context(ib_engine, ib_conn, ib_tx, &ctx) !=
+            IB_OK)
+        {
+            throw std::runtime_error("Context selection failed.");
+        }
+        return &(ctx->rules->ruleset.phases[IB_PHASE_REQUEST_HEADER]);
+    }
+
+    ib_conn_t *ib_conn;
+    ib_tx_t   *ib_tx;
+};
+
+TEST_F(RuleContexts, Sharing)
+{
+    const ib_ruleset_phase_t *site0 = phase_rules("www.site-0.com");
+    const ib_ruleset_phase_t *site1 = phase_rules("www.site-1.com");
+    const ib_ruleset_phase_t *site2 = phase_rules("www.site-999.com");
+
+    ASSERT_EQ(c_num_rules, site1->rule_count);
+    EXPECT_EQ(site1->rules, site2->rules);
+
+    ASSERT_EQ(c_num_rules - 1, site0->rule_count);
+    EXPECT_NE(site1->rules, site0->rules);
+    EXPECT_EQ(site1->rules[1], site0->rules[0]);
+}
+
+/**
+ * Rules registered in a location, or in a site after one of its locations.
+ */
+class RuleContextsUnshare : public BaseFixture
+{
+public:
+    void SetUp()
+    {
+        BaseFixture::SetUp();
+
+        configureIronBeeByString(
+            "LogLevel 3\n"
+            "SensorId B9C1B52B-C24A-4309-B9F9-0EF4CD577A3E\n"
+            "SensorName UnitTesting\n"
+            "SensorHostname unit-testing.sensor.tld\n"
+            "AuditEngine Off\n"
+            "LoadModule \"ibmod_rules.so\"\n"
+            "Rule REQUEST_METHOD @streq \"POST\" id:main-1 rev:1"
+            " phase:REQUEST_HEADER\n"
+            "Rule REQUEST_METHOD @streq \"POST\" id:main-2 rev:1"
+            " phase:REQUEST_HEADER\n"
+            "<Site a>\n"
+            "SiteId AAAABBBB-1111-2222-3333-000000000001\n"
+            "Hostname www.a.com\n"
+            "RuleEnable all\n"
+            "<Location /add>\n"
+            "Rule REQUEST_METHOD @streq \"POST\" id:loc-add rev:1"
+            " phase:REQUEST_HEADER\n"
+            "</Location>\n"
+            "<Location /override>\n"
+            "Rule REQUEST_METHOD @streq \"POST\" id:main-1 rev:2"
+            " phase:REQUEST_HEADER\n"
+            "</Location>\n"
+            "<Location /early>\n"
+            "</Location>\n"
+            "Rule REQUEST_METHOD @streq \"POST\" id:site-late rev:1"
+            " phase:REQUEST_HEADER\n"
+            "</Site>\n"
+            "<Site b>\n"
+            "SiteId AAAABBBB-1111-2222-3333-000000000002\n"
+            "Hostname www.b.com\n"
+            "RuleEnable all\n"
+            "<Location />\n"
+            "</Location>\n"
+            "</Site>\n"
+        );
+
+        ib_conn = buildIronBeeConnection();
+        ib_tx = buildIronBeeTransaction(ib_conn);
+    }
+
+    /**
+     * "id:rev" of each request header phase rule of a context.
+     */
+    std::set<std::string> rules(const char *hostname, const char *path)
+    {
+        ib_context_t          *ctx = NULL;
+        std::set<std::string>  result;
+
+        ib_tx->hostname = hostname;
+        ib_tx->path = path;
+        if (ib_ctxsel_select_context(ib_engine, ib_conn, ib_tx, &ctx) !=
+            IB_OK)
+        {
+            throw std::runtime_error("Context selection failed.");
+        }
+
+        const ib_ruleset_phase_t *phase =
+            &(ctx->rules->ruleset.phases[IB_PHASE_REQUEST_HEADER]);
+        for (size_t i = 0; i < phase->rule_count; ++i) {
+            std::ostringstream rule;
+            rule << phase->rules[i]->meta.id << ":"
+                 << phase->rules[i]->meta.revision;
+            result.insert(rule.str());
+        }
+        return result;
+    }
+
+    ib_conn_t *ib_conn;
+    ib_tx_t   *ib_tx;
+};
+
+namespace {
+
+std::set<std::string> rule_set(const char *r1, const char *r2, const char *r3)
+{
+    std::set<std::string> result;
+
+    result.insert(r1);
+    result.insert(r2);
+    if (r3 != NULL) {
+        result.insert(r3);
+    }
+    return result;
+}
+
+}
+
+TEST_F(RuleContextsUnshare, LocationAddsRule)
+{
+    EXPECT_EQ(rule_set("main-1:1", "main-2:1", "loc-add:1"),
+              rules("www.a.com", "/add"));
+    EXPECT_EQ(rule_set("main-1:1", "main-2:1", "site-late:1"),
+              rules("www.a.com", "/"));
+    EXPECT_EQ(rule_set("main-1:1", "main-2:1", NULL),
+              rules("www.b.com", "/"));
+}
+
+TEST_F(RuleContextsUnshare, LocationOverridesRule)
+{
+    EXPECT_EQ(rule_set("main-1:2", "main-2:1", NULL),
+              rules("www.a.com", "/override"));
+    EXPECT_EQ(rule_set("main-1:1", "main-2:1", NULL),
+              rules("www.b.com", "/"));
+}
+
+TEST_F(RuleContextsUnshare, SiteAddsRuleAfterLocation)
+{
+    EXPECT_EQ(rule_set("main-1:1", "main-2:1", "site-late:1"),
+              rules("www.a.com", "/"));
+    EXPECT_EQ(rule_set("main-1:1", "main-2:1", NULL),
+              rules("www.a.com", "/early"));
+    EXPECT_EQ(rule_set("main-1:1", "main-2:1", NULL),
+              rules("www.b.com", "/"));
+}
@@ -558,6 +558,74 @@ TEST(TestVar, Target)
     EXPECT_EQ("fooA", result_list.front().name_as_s());
 }
 
+TEST(TestVar, TargetFilterIndex)
+{
+    using namespace IronBee;
+
+    ScopedMemoryPool smp;
+    ib_status_t rc;
+    ib_mm_t mm = ib_mm_mpool(MemoryPool(smp).ib());
+    typedef List<IronBee::Field> field_list_t;
+    typedef ConstList<IronBee::Field> field_clist_t;
+    field_list_t data_list = field_list_t::create(smp);
+
+    data_list.push_back(Field::create_number(smp, "fooA", 4, 5));
+    data_list.push_back(Field::create_number(smp, "fooB", 4, 6));
+    data_list.push_back(Field::create_number(smp, "FOOa", 4, 7));
+
+    Field data_field =
+        Field::create_no_copy_list<Field>(smp, "data", 4, data_list);
+
+    ib_var_config_t *config = make_config(mm);
+    ASSERT_TRUE(config);
+    ib_var_source_t *source = make_source(config, "data");
+    ASSERT_TRUE(source);
+    ib_var_store_t *store = make_store(config);
+    rc = ib_var_source_set(source, store, data_field.ib());
+    ASSERT_EQ(IB_OK, rc);
+
+    ib_var_target_t *target;
+    const ib_list_t *result = NULL;
+    const ib_list_t *again = NULL;
+
+    rc = ib_var_target_acquire_from_string(&target, mm, config, "data:fooa", 9);
+    ASSERT_EQ(IB_OK, rc);
+    rc = ib_var_target_get(target, &result, mm, store);
+    ASSERT_EQ(IB_OK, rc);
+    EXPECT_EQ(2UL, field_clist_t(result).size());
+
+    /* Unchanged list: the same result is reused. */
+    rc = ib_var_target_get(target, &again, mm, store);
+    ASSERT_EQ(IB_OK, rc);
+    EXPECT_EQ(result, again);
+
+    /* Appending invalidates the index. */
+    data_list.push_back(Field::create_number(smp, "fooa", 4, 8));
+    rc = ib_var_target_get(target, &result, mm, store);
+    ASSERT_EQ(IB_OK, rc);
+    EXPECT_EQ(3UL, field_clist_t(result).size());
+    EXPECT_EQ(8, field_clist_t(result).back().value_as_number());
+
+    /* Removal invalidates the index. */
+    ib_var_filter_t *filter;
+    rc = ib_var_filter_acquire(&filter, mm, "foob", 4);
+    ASSERT_EQ(IB_OK, rc);
+    rc = ib_var_filter_remove(filter, NULL, IB_MM_NULL, data_field.ib());
+    ASSERT_EQ(IB_OK, rc);
+    rc = ib_var_target_acquire_from_string(&target, mm, config, "data:foob", 9);
+    ASSERT_EQ(IB_OK, rc);
+    rc = ib_var_target_get(target, &result, mm, store);
+    ASSERT_EQ(IB_OK, rc);
+    EXPECT_EQ(0UL, field_clist_t(result).size());
+
+    /* Missing names yield an empty result. */
+    rc = ib_var_target_acquire_from_string(&target, mm, config, "data:bar", 8);
+    ASSERT_EQ(IB_OK, rc);
+    rc = ib_var_target_get(target, &result, mm, store);
+    ASSERT_EQ(IB_OK, rc);
+    EXPECT_EQ(0UL, field_clist_t(result).size());
+}
+
 TEST(TestVar, TargetRemoveTrivial)
 {
     using namespace IronBee;
@@ -29,7 +29,12 @@
 
 #include "engine_private.h"
 
+#include <ironbee/bytestr.h>
+#include <ironbee/field.h>
+#include <ironbee/hash.h>
+
 #include <assert.h>
+#include <string.h>
 
 struct ib_transformation_t {
     /*! Name of the transformation. */
@@ -65,6 +70,12 @@ struct ib_transformation_t {
 
     /*! Execute callback data. */
     void *execute_cbdata;
+
+    /*! Fuse function; NULL if not fusable. */
+    ib_transformation_fuse_fn_t fuse_fn;
+
+    /*! Fuse callback data. */
+    void *fuse_cbdata;
 };
 
 struct ib_transformation_inst_t
@@ -79,6 +90,17 @@ struct ib_transformation_inst_t
     void *instance_data;
 };
 
+/**
+ * Instance data of a fused transformation instance.
+ */
+typedef struct {
+    /*! Fused instances, in order. */
+    const ib_transformation_inst_t **tfn_insts;
+
+    /*! Number of @ref tfn_insts. */
+    size_t num_tfn_insts;
+} tfn_fusion_t;
+
 ib_status_t ib_transformation_create(
     ib_transformation_t            **tfn,
     ib_mm_t                          mm,
@@ -113,12 +135,33 @@ ib_status_t ib_transformation_create(
     local_tfn->destroy_cbdata = destroy_cbdata;
     local_tfn->execute_fn     = execute_fn;
     local_tfn->execute_cbdata = execute_cbdata;
+    local_tfn->fuse_fn        = NULL;
+    local_tfn->fuse_cbdata    = NULL;
 
     *tfn = local_tfn;
 
     return IB_OK;
 }
 
+ib_status_t ib_transformation_fuse_fn_set(
+    ib_transformation_t         *tfn,
+    ib_transformation_fuse_fn_t  fuse_fn,
+    void                        *cbdata
+)
+{
+    assert(tfn     != NULL);
+    assert(fuse_fn != NULL);
+
+    if (tfn->handle_list) {
+        return IB_EINVAL;
+    }
+
+    tfn->fuse_fn     = fuse_fn;
+    tfn->fuse_cbdata = cbdata;
+
+    return IB_OK;
+}
+
 ib_status_t ib_transformation_register(
     ib_engine_t               *ib,
     const ib_transformation_t *tfn
@@ -216,6 +259,15 @@ bool ib_transformation_handle_list(
     return tfn->handle_list;
 }
 
+bool ib_transformation_fusable(
+    const ib_transformation_t *tfn
+)
+{
+    assert(tfn != NULL);
+
+    return tfn->fuse_fn != NULL;
+}
+
 /*! Cleanup function to destroy transformation. */
 static
 void cleanup_tfn(
@@ -414,3 +466,342 @@ ib_status_t ib_transformation_inst_execute(
 
     return IB_OK;
 }
+
+/**
+ * Run the instances of a fused transformation one at a time.
+ *
+ * Used for input that is not a byte string.
+ */
+static ib_status_t execute_unfused(
+    ib_mm_t             mm,
+    const tfn_fusion_t *fusion,
+    const ib_field_t   *fin,
+    const ib_field_t  **fout
+)
+{
+    assert(fusion != NULL);
+    assert(fin    != NULL);
+    assert(fout   != NULL);
+
+    const ib_field_t *value = fin;
+    ib_status_t       rc;
+
+    for (size_t i = 0; i < fusion->num_tfn_insts; ++i) {
+        rc = ib_transformation_inst_execute(
+            fusion->tfn_insts[i], mm, value, &value);
+        if (rc != IB_OK) {
+            return rc;
+        }
+    }
+    *fout = value;
+
+    return IB_OK;
+}
+
+/**
+ * Execute function of fused transformations.
+ *
+ * The first step that changes the input writes to a new buffer; later
+ * steps work in place in that buffer.
+ *
+ * @param[in]  mm            Memory manager.
+ * @param[in]  fin           Input field.
+ * @param[out] fout          Output field.
+ * @param[in]  instance_data The @ref tfn_fusion_t.
+ * @param[in]  cbdata        Unused.
+ *
+ * @returns Status code.
+ */
+static ib_status_t execute_fused(
+    ib_mm_t            mm,
+    const ib_field_t  *fin,
+    const ib_field_t **fout,
+    void              *instance_data,
+    void              *cbdata
+)
+{
+    assert(fin           != NULL);
+    assert(fout          != NULL);
+    assert(instance_data != NULL);
+
+    const tfn_fusion_t *fusion = (const tfn_fusion_t *)instance_data;
+    const ib_bytestr_t *bs;
+    const uint8_t      *data;
+    size_t              dlen;
+    uint8_t            *buf = NULL;
+    ib_field_t         *fnew;
+    ib_status_t         rc;
+
+    if (fin->type != IB_FTYPE_BYTESTR) {
+        return execute_unfused(mm, fusion, fin, fout);
+    }
+
+    rc = ib_field_value(fin, ib_ftype_bytestr_out(&bs));
+    if (rc != IB_OK) {
+        return rc;
+    }
+    if (bs == NULL) {
+        return IB_EINVAL;
+    }
+    data = ib_bytestr_const_ptr(bs);
+    dlen = ib_bytestr_length(bs);
+    if (data == NULL && dlen > 0) {
+        return IB_EINVAL;
+    }
+
+    for (size_t i = 0; i < fusion->num_tfn_insts && dlen > 0; ++i) {
+        const ib_transformation_inst_t *tfn_inst = fusion->tfn_insts[i];
+        const ib_transformation_t      *tfn = tfn_inst->tfn;
+        size_t                          out_len;
+
+        /* Nothing allocated until some step changes the input. */
+        if (buf == NULL) {
+            rc = tfn->fuse_fn(data, dlen, NULL, &out_len,
+                              tfn_inst->instance_data, tfn->fuse_cbdata);
+            if (rc == IB_DECLINED) {
+                continue;
+            }
+            if (rc != IB_OK) {
+                return rc;
+            }
+            buf = ib_mm_alloc(mm, dlen);
+            if (buf == NULL) {
+                return IB_EALLOC;
+            }
+        }
+
+        rc = tfn->fuse_fn(data, dlen, buf, &out_len,
+                          tfn_inst->instance_data, tfn->fuse_cbdata);
+        if (rc == IB_DECLINED) {
+            continue;
+        }
+        if (rc != IB_OK) {
+            return rc;
+        }
+        assert(out_len <= dlen);
+        data = buf;
+        dlen = out_len;
+    }
+
+    if (buf == NULL) {
+        *fout = fin;
+        return IB_OK;
+    }
+
+    rc = ib_field_create_bytestr_alias(&fnew, mm,
+                                       fin->name, fin->nlen,
+                                       buf, dlen);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    *fout = fnew;
+
+    return IB_OK;
+}
+
+/**
+ * Get the shared fused instance for a run of fusable instances.
+ *
+ * @param[in]  ib        IronBee engine.
+ * @param[in]  tfn_insts Run of fusable instances.
+ * @param[in]  num       Number of @a tfn_insts; at least 2.
+ * @param[out] fused     Fused instance.
+ *
+ * @returns
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation failure.
+ */
+static ib_status_t fuse_run(
+    ib_engine_t                     *ib,
+    const ib_transformation_inst_t **tfn_insts,
+    size_t                           num,
+    ib_transformation_inst_t       **fused
+)
+{
+    assert(ib        != NULL);
+    assert(tfn_insts != NULL);
+    assert(num       >= 2);
+    assert(fused     != NULL);
+
+    ib_mm_t                   mm = ib_engine_mm_main_get(ib);
+    ib_transformation_t      *tfn;
+    ib_transformation_inst_t *tfn_inst;
+    tfn_fusion_t             *fusion;
+    char                     *key;
+    char                     *name;
+    size_t                    key_len = 0;
+    size_t                    name_len = 0;
+    ib_status_t               rc;
+
+    /* The key is each transformation followed by its parameters. */
+    for (size_t i = 0; i < num; ++i) {
+        const char *params = tfn_insts[i]->parameters;
+
+        key_len += sizeof(tfn) + (params == NULL ? 0 : strlen(params)) + 1;
+        name_len += strlen(tfn_insts[i]->tfn->name) + 1;
+    }
+    key = ib_mm_alloc(mm, key_len);
+    name = ib_mm_alloc(mm, name_len);
+    if (key == NULL || name == NULL) {
+        return IB_EALLOC;
+    }
+    key_len = 0;
+    name_len = 0;
+    for (size_t i = 0; i < num; ++i) {
+        const ib_transformation_t *part = tfn_insts[i]->tfn;
+        const char *params = tfn_insts[i]->parameters;
+        size_t      len;
+
+        if (params == NULL) {
+            params = "";
+        }
+        len = strlen(params) + 1;
+        memcpy(key + key_len, &part, sizeof(part));
+        key_len += sizeof(part);
+        memcpy(key + key_len, params, len);
+        key_len += len;
+
+        len = strlen(part->name);
+        if (i > 0) {
+            name[name_len++] = '+';
+        }
+        memcpy(name + name_len, part->name, len);
+        name_len += len;
+    }
+    name[name_len] = '\0';
+
+    rc = ib_hash_get_ex(ib->tfn_fusions, fused, key, key_len);
+    if (rc == IB_OK) {
+        return IB_OK;
+    }
+
+    fusion = ib_mm_alloc(mm, sizeof(*fusion));
+    if (fusion == NULL) {
+        return IB_EALLOC;
+    }
+    fusion->tfn_insts = ib_mm_memdup(mm, tfn_insts, num * sizeof(*tfn_insts));
+    if (fusion->tfn_insts == NULL) {
+        return IB_EALLOC;
+    }
+    fusion->num_tfn_insts = num;
+
+    rc = ib_transformation_create(
+        &tfn, mm, name, false,
+        NULL, NULL,
+        NULL, NULL,
+        execute_fused, NULL
+    );
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    tfn_inst = ib_mm_alloc(mm, sizeof(*tfn_inst));
+    if (tfn_inst == NULL) {
+        return IB_EALLOC;
+    }
+    tfn_inst->tfn           = tfn;
+    tfn_inst->parameters    = NULL;
+    tfn_inst->instance_data = fusion;
+
+    rc = ib_hash_set_ex(ib->tfn_fusions, key, key_len, tfn_inst);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    *fused = tfn_inst;
+
+    return IB_OK;
+}
+
+ib_status_t ib_transformation_fuse_chain(
+    ib_engine_t      *ib,
+    ib_mm_t           mm,
+    const ib_list_t  *tfn_insts,
+    const ib_list_t **fused
+)
+{
+    assert(ib        != NULL);
+    assert(tfn_insts != NULL);
+    assert(fused     != NULL);
+
+    const ib_transformation_inst_t **run;
+    const ib_list_node_t            *node;
+    ib_list_t                       *out;
+    size_t                           run_len = 0;
+    size_t                           longest = 0;
+    ib_status_t                      rc;
+
+    /* Only build a new list if there is something to fuse. */
+    IB_LIST_LOOP_CONST(tfn_insts, node) {
+        const ib_transformation_inst_t *tfn_inst =
+            (const ib_transformation_inst_t *)ib_list_node_data_const(node);
+
+        run_len = ib_transformation_fusable(tfn_inst->tfn) ? run_len + 1 : 0;
+        if (run_len > longest) {
+            longest = run_len;
+        }
+    }
+    if (longest < 2) {
+        *fused = tfn_insts;
+        return IB_OK;
+    }
+
+    rc = ib_list_create(&out, mm);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    run = ib_mm_alloc(mm, longest * sizeof(*run));
+    if (run == NULL) {
+        return IB_EALLOC;
+    }
+
+    /* Collect runs; flush each at the first instance that ends it. */
+    run_len = 0;
+    node = ib_list_first_const(tfn_insts);
+    for (;;) {
+        const ib_transformation_inst_t *tfn_inst = NULL;
+
+        if (node != NULL) {
+            tfn_inst = (const ib_transformation_inst_t *)
+                ib_list_node_data_const(node);
+            if (ib_transformation_fusable(tfn_inst->tfn)) {
+                run[run_len++] = tfn_inst;
+                node = ib_list_node_next_const(node);
+                continue;
+            }
+        }
+
+        if (run_len == 1) {
+            rc = ib_list_push(out, (void *)run[0]);
+            if (rc != IB_OK) {
+                return rc;
+            }
+        }
+        else if (run_len > 1) {
+            ib_transformation_inst_t *fused_inst;
+
+            rc = fuse_run(ib, run, run_len, &fused_inst);
+            if (rc != IB_OK) {
+                return rc;
+            }
+            rc = ib_list_push(out, fused_inst);
+            if (rc != IB_OK) {
+                return rc;
+            }
+        }
+        run_len = 0;
+
+        if (node == NULL) {
+            break;
+        }
+        rc = ib_list_push(out, (void *)tfn_inst);
+        if (rc != IB_OK) {
+            return rc;
+        }
+        node = ib_list_node_next_const(node);
+    }
+
+    *fused = out;
+
+    return IB_OK;
+}
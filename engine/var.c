@@ -59,8 +59,37 @@ struct ib_var_store_t
     ib_hash_t *hash;
     /** Array of source index to value.  Value: `ib_field_t *` */
     ib_array_t *array;
+    /**
+     * Name indexes of list values, built on first filter.
+     *
+     * Key: `const ib_list_t *` (pointer bytes).  Value: `var_list_index_t *`.
+     * NULL until the first filter is applied to a non-dynamic list.
+     **/
+    ib_hash_t *list_indexes;
 };
 
+/**
+ * Case-insensitive name index of a non-dynamic list value.
+ *
+ * Indexes are built lazily by ib_var_target_get() and rebuilt whenever the
+ * list has changed since the index was built, as detected by the element
+ * count and tail node.  Lists only ever gain nodes by allocating new ones,
+ * so any append or removal changes at least one of these.
+ **/
+typedef struct
+{
+    /** Indexed list; the address of this member is the hash key. */
+    const ib_list_t *list;
+    /** Number of elements in @ref list when the index was built. */
+    size_t nelts;
+    /** Tail node of @ref list when the index was built. */
+    const ib_list_node_t *tail;
+    /** Name to matching fields.  Value: `ib_list_t *` of `ib_field_t *`. */
+    ib_hash_t *by_name;
+    /** Result for names with no match. */
+    ib_list_t *empty;
+} var_list_index_t;
+
 struct ib_var_source_t
 {
     /** Configuration */
@@ -282,8 +311,9 @@ ib_status_t ib_var_store_acquire(
         return IB_EALLOC;
     }
 
-    local_store->config = config;
-    local_store->mm     = mm;
+    local_store->config       = config;
+    local_store->mm           = mm;
+    local_store->list_indexes = NULL;
 
     rc = ib_hash_create_nocase(&local_store->hash, mm);
     if (rc != IB_OK) {
@@ -1099,6 +1129,165 @@ ib_status_t ib_var_target_type(
     return IB_OK;
 }
 
+/**
+ * Build a name index of @a list.
+ *
+ * @param[out] index Index to fill in.  var_list_index_t::list must be set.
+ * @param[in]  mm    Memory manager to allocate index from.
+ * @return
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation failure.
+ **/
+static
+ib_status_t list_index_build(
+    var_list_index_t *index,
+    ib_mm_t           mm
+)
+{
+    assert(index != NULL);
+    assert(index->list != NULL);
+
+    ib_status_t           rc;
+    const ib_list_node_t *node;
+
+    rc = ib_hash_create_nocase(&index->by_name, mm);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    rc = ib_list_create(&index->empty, mm);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    IB_LIST_LOOP_CONST(index->list, node) {
+        const ib_field_t *f =
+            (const ib_field_t *)ib_list_node_data_const(node);
+        ib_list_t *matches;
+
+        rc = ib_hash_get_ex(index->by_name, &matches, f->name, f->nlen);
+        if (rc == IB_ENOENT) {
+            rc = ib_list_create(&matches, mm);
+            if (rc != IB_OK) {
+                return rc;
+            }
+            rc = ib_hash_set_ex(index->by_name, f->name, f->nlen, matches);
+        }
+        if (rc != IB_OK) {
+            return rc;
+        }
+
+        /* Discard const because lists are const-generic. */
+        rc = ib_list_push(matches, (void *)f);
+        if (rc != IB_OK) {
+            return rc;
+        }
+    }
+
+    index->nelts = ib_list_elements(index->list);
+    index->tail  = ib_list_last_const(index->list);
+
+    return IB_OK;
+}
+
+/**
+ * Apply @a filter to the non-dynamic list field @a field using an index.
+ *
+ * The result is shared by all lookups of the same name until the list
+ * changes, so this performs no allocation once the index is built.
+ *
+ * @param[in]  filter Filter to apply.
+ * @param[out] result Results.  Lifetime is equal to @a store.
+ * @param[in]  field  Non-dynamic list field to apply filter to.
+ * @param[in]  store  Store to keep the index in.
+ * @return
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation failure.
+ **/
+static
+ib_status_t list_index_filter_apply(
+    const ib_var_filter_t  *filter,
+    const ib_list_t       **result,
+    const ib_field_t       *field,
+    ib_var_store_t         *store
+)
+{
+    assert(filter != NULL);
+    assert(result != NULL);
+    assert(field  != NULL);
+    assert(store  != NULL);
+    assert(field->type == IB_FTYPE_LIST);
+    assert(! ib_field_is_dynamic(field));
+
+    ib_status_t       rc;
+    const ib_list_t  *list;
+    var_list_index_t *index;
+    ib_list_t        *matches;
+
+    rc = ib_field_value(field, ib_ftype_list_out(&list));
+    /* Can only fail on dynamic field. */
+    assert(rc == IB_OK);
+
+    if (store->list_indexes == NULL) {
+        rc = ib_hash_create(&store->list_indexes, store->mm);
+        if (rc != IB_OK) {
+            return rc;
+        }
+    }
+
+    rc = ib_hash_get_ex(
+        store->list_indexes,
+        &index,
+        (const char *)&list, sizeof(list)
+    );
+    if (rc == IB_ENOENT) {
+        index = ib_mm_calloc(store->mm, 1, sizeof(*index));
+        if (index == NULL) {
+            return IB_EALLOC;
+        }
+        index->list = list;
+        rc = list_index_build(index, store->mm);
+        if (rc != IB_OK) {
+            return rc;
+        }
+        rc = ib_hash_set_ex(
+            store->list_indexes,
+            (const char *)&index->list, sizeof(index->list),
+            index
+        );
+        if (rc != IB_OK) {
+            return rc;
+        }
+    }
+    else if (rc != IB_OK) {
+        return rc;
+    }
+    else if (
+        index->nelts != ib_list_elements(list) ||
+        index->tail  != ib_list_last_const(list)
+    ) {
+        /* List changed since the index was built. */
+        rc = list_index_build(index, store->mm);
+        if (rc != IB_OK) {
+            return rc;
+        }
+    }
+
+    rc = ib_hash_get_ex(
+        index->by_name,
+        &matches,
+        filter->filter_string, filter->filter_string_length
+    );
+    if (rc == IB_ENOENT) {
+        matches = index->empty;
+    }
+    else if (rc != IB_OK) {
+        return rc;
+    }
+
+    *result = matches;
+    return IB_OK;
+}
+
 ib_status_t ib_var_target_get(
     ib_var_target_t  *target,
     const ib_list_t **result,
@@ -1134,7 +1323,23 @@ ib_status_t ib_var_target_get(
         return rc;
     }
 
-    if (filter != NULL) {
+    if (
+        filter != NULL &&
+        field->type == IB_FTYPE_LIST &&
+        ! ib_field_is_dynamic(field)
+    ) {
+        /* Filter list field by name via the store's index. */
+        rc = list_index_filter_apply(
+            filter,
+            &local_result,
+            field,
+            store
+        );
+        if (rc != IB_OK) {
+            return rc;
+        }
+    }
+    else if (filter != NULL) {
         /* Filter list field. */
         rc = ib_var_filter_apply(
             filter,
@@ -1185,7 +1390,11 @@ ib_status_t ib_var_target_get_const(
     assert(result != NULL);
     assert(store  != NULL);
 
-    /* Use non-const version; okay, as caller storing result in const. */
+    /* Use non-const version.  This may build or rebuild the name index of
+     * a list value in @a store, despite it being const.  That is safe: the
+     * index is a cache that does not change any value or result, and a
+     * store, like its transaction, is only used by one thread at a time.
+     * The caller stores the result in const. */
     return ib_var_target_get(
         (ib_var_target_t *)target,
         result,
@@ -113,6 +113,10 @@ void parse_options(
             "    Force a cleanup of old idle IronBee engines.\n"
             "  engine_create <ironbee configuration file>\n"
             "    Change the current IronBee engine being used.\n"
+            "  stats [name prefix]\n"
+            "    Report live counters of the engines and the process,\n"
+            "    one \"name value\" pair per line. Only names starting\n"
+            "    with the prefix are reported if one is given.\n"
             "Options"
         );
 
@@ -29,12 +29,14 @@
 
 #include <ironbee/build.h>
 #include <ironbee/engine_types.h>
+#include <ironbee/lock.h>
 #include <ironbee/logformat.h>
 #include <ironbee/module.h>
 #include <ironbee/rule_defs.h>
 #include <ironbee/types.h>
 
 #include <stdio.h>
+#include <sys/uio.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -80,6 +82,9 @@ struct ib_core_audit_cfg_t {
     const char          *full_path;     /**< Audit log full path */
     const char          *temp_path;     /**< Full path to temporary file */
     int                  parts_written; /**< Parts written so far */
+    struct iovec        *iov;           /**< Buffered audit log data */
+    size_t               iov_count;     /**< Buffers used in iov */
+    size_t               iov_size;      /**< Buffers allocated in iov */
     const char          *boundary;      /**< Audit log boundary */
     ib_tx_t             *tx;            /**< Transaction being logged */
     const ib_core_cfg_t *core_cfg;      /**< Core configuration */
@@ -172,6 +177,7 @@ typedef ib_status_t (*ib_core_auditlog_fn_t)(
 struct ib_core_cfg_t {
     const char       *log_uri;           /**< Log URI */
     FILE             *log_fp;            /**< File pointer for log. */
+    ib_lock_t        *log_fp_lck;        /**< Guards log_fp for log writers. */
     const char       *logevent;          /**< Active logevent provider key */
     ib_list_t        *initvar_list;      /**< List of ib_core_initvar_t for InitVar */
     ib_num_t          buffer_req;        /**< Request buffering options */
@@ -181,6 +187,7 @@ struct ib_core_cfg_t {
     ib_num_t          auditlog_fmode;    /**< Audit log file create mode */
     ib_num_t          auditlog_parts;    /**< Audit log parts */
     const char       *auditlog_index_fmt;/**< Audit log index format string */
+    ib_num_t          auditlog_index_latency; /**< Max index delay (ms) */
     const ib_logformat_t *auditlog_index_hp; /**< Audit log index fmt helper */
     const char       *auditlog_dir;      /**< Audit log base directory */
     const char       *auditlog_sdir_fmt; /**< Audit log sub-directory format */
@@ -0,0 +1,156 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+#ifndef _IB_COUNTERS_H_
+#define _IB_COUNTERS_H_
+
+/**
+ * @file
+ * @brief IronBee --- Per-Thread Counters
+ */
+
+#include <ironbee/build.h>
+#include <ironbee/mm.h>
+#include <ironbee/types.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @defgroup IronBeeUtilCounters Counters
+ * @ingroup IronBeeUtil
+ *
+ * Statistics counters that are cheap to update from many threads.
+ *
+ * A counter set is an array of signed 64 bit counters.  Each thread adds to
+ * its own copy of the array, so an update is a thread specific data lookup
+ * and a plain add with no atomic operation or shared cache line.  The
+ * copies are only summed when the counters are read.  Counters of exiting
+ * threads are folded into the set, so sums never go backwards.
+ *
+ * Because updates are signed, a counter can also track a level, such as
+ * the number of open connections, by adding one and subtracting one,
+ * possibly from different threads.
+ *
+ * @{
+ */
+
+/**
+ * A set of per-thread counters.
+ */
+typedef struct ib_counters_t ib_counters_t;
+
+/**
+ * Create a counter set destroyed with @a mm.
+ *
+ * @param[out] counters The counter set.
+ * @param[in] mm Memory manager.
+ * @param[in] num_counters Number of counters in the set.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC On allocation failure.
+ * - IB_EOTHER If the thread specific key cannot be created.
+ */
+ib_status_t DLL_PUBLIC ib_counters_create(
+    ib_counters_t **counters,
+    ib_mm_t         mm,
+    size_t          num_counters
+)
+NONNULL_ATTRIBUTE(1);
+
+/**
+ * Create a counter set when there is no memory manager available.
+ *
+ * The set must be destroyed with ib_counters_destroy_malloc().
+ *
+ * @param[out] counters The counter set.
+ * @param[in] num_counters Number of counters in the set.
+ *
+ * @returns As ib_counters_create().
+ */
+ib_status_t DLL_PUBLIC ib_counters_create_malloc(
+    ib_counters_t **counters,
+    size_t          num_counters
+)
+NONNULL_ATTRIBUTE(1);
+
+/**
+ * Destroy a counter set created by ib_counters_create_malloc().
+ *
+ * No thread may use @a counters during or after this call.
+ *
+ * @param[in] counters The counter set.
+ */
+void DLL_PUBLIC ib_counters_destroy_malloc(
+    ib_counters_t *counters
+);
+
+/**
+ * Add @a n to counter @a index of the calling thread.
+ *
+ * If the calling thread's counters cannot be allocated, the update is lost.
+ *
+ * @param[in] counters The counter set.
+ * @param[in] index Counter to update; less than the set size.
+ * @param[in] n Amount to add; may be negative.
+ */
+void DLL_PUBLIC ib_counters_add(
+    ib_counters_t *counters,
+    size_t         index,
+    int64_t        n
+)
+NONNULL_ATTRIBUTE(1);
+
+/**
+ * Sum the counters of all threads.
+ *
+ * Counters of running threads are read without synchronization, so
+ * updates made concurrently with this call may or may not be included.
+ *
+ * @param[in] counters The counter set.
+ * @param[out] values Array of as many values as there are counters.
+ */
+void DLL_PUBLIC ib_counters_get(
+    ib_counters_t *counters,
+    int64_t       *values
+)
+NONNULL_ATTRIBUTE(1, 2);
+
+/**
+ * Number of counters in a set.
+ *
+ * @param[in] counters The counter set.
+ *
+ * @returns The number of counters.
+ */
+size_t DLL_PUBLIC ib_counters_size(
+    const ib_counters_t *counters
+)
+NONNULL_ATTRIBUTE(1);
+
+/** @} IronBeeUtilCounters */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IB_COUNTERS_H_ */
@@ -166,6 +166,66 @@ ib_logger_t DLL_PUBLIC *ib_engine_logger_get(const ib_engine_t *ib);
  */
 const char DLL_PUBLIC *ib_engine_instance_id(const ib_engine_t *ib);
 
+/**
+ * Rule execution statistics of one phase.
+ *
+ * @sa ib_engine_stats_t
+ */
+typedef struct ib_engine_phase_stats_t ib_engine_phase_stats_t;
+
+/** See ib_engine_phase_stats_t */
+struct ib_engine_phase_stats_t {
+    /**
+     * Times rules of the phase were run.
+     *
+     * This is once per transaction for the normal phases and once per
+     * header or data chunk for the stream phases.
+     */
+    uint64_t runs;
+    uint64_t rules; /**< Rules executed. */
+    uint64_t usec;  /**< Microseconds spent executing rules. */
+};
+
+/**
+ * Live statistics of an engine.
+ *
+ * @sa ib_engine_stats_get()
+ */
+typedef struct ib_engine_stats_t ib_engine_stats_t;
+
+/** See ib_engine_stats_t */
+struct ib_engine_stats_t {
+    uint64_t conns_active;    /**< Connections created and not destroyed. */
+    uint64_t conns;           /**< Connections created. */
+    uint64_t conn_pool_bytes; /**< Pool bytes of destroyed connections. */
+    uint64_t txs_active;      /**< Transactions created and not destroyed. */
+    uint64_t txs;             /**< Transactions created. */
+    uint64_t tx_pool_bytes;   /**< Pool bytes of destroyed transactions. */
+    uint64_t pool_bytes;      /**< Bytes in use by the engine pools. */
+
+    /** Rule execution by phase, indexed by @ref ib_rule_phase_num_t. */
+    ib_engine_phase_stats_t phases[IB_RULE_PHASE_COUNT];
+
+    ib_logger_stats_t logger; /**< Logger queue statistics. */
+};
+
+/**
+ * Fetch live statistics of an engine.
+ *
+ * The engine keeps its counters per thread so that connections,
+ * transactions and phases update them without synchronization.  This call
+ * sums them, so it is meant to be called on demand rather than per
+ * transaction.  Values are read without locking and may be slightly stale.
+ *
+ * @param[in] ib Engine handle.
+ * @param[out] stats Statistics.
+ */
+void DLL_PUBLIC ib_engine_stats_get(
+    const ib_engine_t *ib,
+    ib_engine_stats_t *stats
+)
+NONNULL_ATTRIBUTE(1, 2);
+
 /**
  * Inform the engine that the configuration phase is starting
  *
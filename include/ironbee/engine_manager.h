@@ -74,6 +74,11 @@ extern "C" {
  * its reference count becomes zero), the manager will destroy all inactive
  * engines.
  *
+ * ib_manager_engine_acquire() and ib_manager_engine_release() are lock-free
+ * and are intended to be called once per connection or transaction from any
+ * number of threads. Only engine creation, cleanup, enable and disable
+ * serialize on the manager lock.
+ *
  */
 typedef struct ib_manager_t ib_manager_t;
 
@@ -389,6 +394,45 @@ size_t DLL_PUBLIC ib_manager_engine_count(
 )
 NONNULL_ATTRIBUTE(1);
 
+/**
+ * Callback function for ib_manager_engine_visit().
+ *
+ * @param[in] engine An engine of the manager.
+ * @param[in] ref_count The reference count of @a engine, including the
+ *            reference of the manager if @a current.
+ * @param[in] current Is @a engine the current engine?
+ * @param[in] cbdata Callback data.
+ */
+typedef void (*ib_manager_engine_visit_fn_t)(
+    ib_engine_t *engine,
+    size_t       ref_count,
+    bool         current,
+    void        *cbdata
+);
+
+/**
+ * Call @a fn for each engine of the manager.
+ *
+ * The manager lock is held during the calls, so no engine is created or
+ * destroyed until this returns.  @a fn must not call manager functions
+ * that take the lock, such as ib_manager_engine_create() or
+ * ib_manager_engine_cleanup().
+ *
+ * @param[in] manager IronBee engine manager.
+ * @param[in] fn Function to call.
+ * @param[in] cbdata Callback data for @a fn.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - Other if the manager lock cannot be taken.
+ */
+ib_status_t DLL_PUBLIC ib_manager_engine_visit(
+    ib_manager_t                 *manager,
+    ib_manager_engine_visit_fn_t  fn,
+    void                         *cbdata
+)
+NONNULL_ATTRIBUTE(1, 2);
+
 /**
  * Get the memory manager for this engine manager.
  *
@@ -40,6 +40,13 @@ extern "C" {
  */
 #define IB_ENGINE_MANAGER_CONTROL_CHANNEL_MAX_MSG_SZ 1024
 
+/**
+ * The largest response that can be received from the channel.
+ *
+ * Responses longer than this are truncated.
+ */
+#define IB_ENGINE_MANAGER_CONTROL_CHANNEL_MAX_RESP_SZ 65536
+
  /**
  * @defgroup IronBeeEngMgrCtrlChan IronBee Engine Manager Control Channel
  * @ingroup IronBee
@@ -243,6 +250,12 @@ NONNULL_ATTRIBUTE(1);
  * - cleanup - cleanup old IronBee engines in the manager.
  * - engine_create \<config file\> - Create a new engine.
  *   IronBee must not be disabled for this to succeed.
+ * - stats [\<name prefix\>] - report live counters as lines of
+ *   "name value": engines and their reference counts, connections,
+ *   transactions, rule execution by phase, pool bytes and logger queues of
+ *   each engine, and the key-value store and memory pool page cache counters
+ *   of the process.  If a prefix is given, only names starting with it are
+ *   reported.
  *
  * @param[in] channel The channel to register this command with.
  *
@@ -323,6 +336,8 @@ NONNULL_ATTRIBUTE(1,2);
  * @param[in] message The C-string message to send to the server.
  * @param[in] mm The memory manager used to allocate @a response from.
  * @param[out] response The response from the server is stored here.
+ *            It is truncated to
+ *            @ref IB_ENGINE_MANAGER_CONTROL_CHANNEL_MAX_RESP_SZ bytes.
  *
  * @returns
  * - IB_OK On successfully interacting with the server. If the server
@@ -183,6 +183,55 @@ uint32_t DLL_PUBLIC ib_hashfunc_djb2_nocase(
 )
 NONNULL_ATTRIBUTE(1);
 
+/**
+ * Word at a time hash function plus randomizer.
+ *
+ * Hashes eight bytes per step with a multiply and shift and finishes with
+ * the MurmurHash3 64 bit finalizer.  Much faster than ib_hashfunc_djb2()
+ * for all but the shortest keys and better distributed, which matters for
+ * open addressing.  This is the default hash function for
+ * ib_hash_create_open().
+ *
+ * @sa ib_hashfunc_fast_nocase().
+ *
+ * @param[in] key        The key to hash.
+ * @param[in] key_length Length of @a key.
+ * @param[in] randomizer Value to randomize hash function.
+ * @param[in] cbdata     Callback data; unused.
+ *
+ * @returns Hash value of @a key.
+ */
+uint32_t DLL_PUBLIC ib_hashfunc_fast(
+    const char *key,
+    size_t      key_length,
+    uint32_t    randomizer,
+    void       *cbdata
+)
+NONNULL_ATTRIBUTE(1);
+
+/**
+ * Word at a time hash function plus randomizer.  Case insensitive version.
+ *
+ * ASCII letters are downcased eight at a time before hashing.  This is the
+ * default hash function for ib_hash_create_open_nocase().
+ *
+ * @sa ib_hashfunc_fast().
+ *
+ * @param[in] key        The key to hash.
+ * @param[in] key_length Length of @a key.
+ * @param[in] randomizer Value to randomize hash function.
+ * @param[in] cbdata     Callback data; unused.
+ *
+ * @returns Hash value of @a key.
+ */
+uint32_t DLL_PUBLIC ib_hashfunc_fast_nocase(
+    const char *key,
+    size_t      key_length,
+    uint32_t    randomizer,
+    void       *cbdata
+)
+NONNULL_ATTRIBUTE(1);
+
 /**
  * Byte for byte equality predicate.
  *
@@ -310,6 +359,83 @@ ib_status_t DLL_PUBLIC ib_hash_create_nocase(
 )
 NONNULL_ATTRIBUTE(1);
 
+/**
+ * Create an open addressed hash table.
+ *
+ * As ib_hash_create_ex(), but entries are stored in the table itself rather
+ * than in per-slot lists.  Collisions are resolved by linear probing with
+ * Robin Hood displacement, and the hash value and key length of every slot
+ * are kept in a separate array, so most probes touch a single cache line and
+ * compare keys only on a likely match.  No memory is allocated per entry.
+ *
+ * The resulting hash supports the entire ib_hash API.  In addition to
+ * the usual invalidation of iterators by mutation, keys must be shorter
+ * than 4 GiB.  As only the predicates in this file are known to require
+ * equal lengths, other predicates are always called on hash value matches.
+ *
+ * @param[out] hash            The newly created hash table.
+ * @param[in]  mm              Memory manager to use.
+ * @param[in]  size            The initial number of slots in the hash
+ *                             table.  Must be a power of 2.
+ * @param[in]  hash_function   Hash function to use, e.g., ib_hashfunc_fast().
+ * @param[in]  hash_cbdata     Callback data for @a hash_function.
+ * @param[in]  equal_predicate Predicate to use for key equality.
+ * @param[in]  equal_cbdata    Callback data for @a equal_predicate.
+ *
+ * @returns
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation failure.
+ * - IB_EINVAL if @a size is not a power of 2, or pointers are NULL.
+ */
+ib_status_t DLL_PUBLIC ib_hash_create_open_ex(
+    ib_hash_t          **hash,
+    ib_mm_t              mm,
+    size_t               size,
+    ib_hash_function_t   hash_function,
+    void                *hash_cbdata,
+    ib_hash_equal_t      equal_predicate,
+    void                *equal_cbdata
+)
+NONNULL_ATTRIBUTE(1);
+
+/**
+ * Create an open addressed hash table with ib_hashfunc_fast(),
+ * ib_hashequal_default(), and a default size.
+ *
+ * @sa ib_hash_create_open_ex()
+ *
+ * @param[out] hash The newly created hash table.
+ * @param[in]  mm Memory manager to use.
+ *
+ * @returns
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation failure.
+ */
+ib_status_t DLL_PUBLIC ib_hash_create_open(
+    ib_hash_t  **hash,
+    ib_mm_t      mm
+)
+NONNULL_ATTRIBUTE(1);
+
+/**
+ * Create an open addressed hash table with ib_hashfunc_fast_nocase(),
+ * ib_hashequal_nocase(), and a default size.
+ *
+ * @sa ib_hash_create_open_ex()
+ *
+ * @param[out] hash The newly created hash table.
+ * @param[in]  mm Memory manager to use.
+ *
+ * @returns
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation failure.
+ */
+ib_status_t DLL_PUBLIC ib_hash_create_open_nocase(
+    ib_hash_t  **hash,
+    ib_mm_t      mm
+)
+NONNULL_ATTRIBUTE(1);
+
 /*@}*/
 
 /**
@@ -439,6 +565,8 @@ NONNULL_ATTRIBUTE(1, 2);
  * @returns
  * - IB_OK on success.
  * - IB_EALLOC if @a hash attempted to grow and failed.
+ * - IB_EINVAL if @a hash is open addressed and @a key_length is 4 GiB or
+ *   more.
  */
 ib_status_t DLL_PUBLIC ib_hash_set_ex(
     ib_hash_t  *hash,
@@ -195,6 +195,38 @@ ib_status_t ib_kvstore_remove(
 
 void ib_kvstore_destroy(ib_kvstore_t *kvstore);
 
+/**
+ * Statistics of all key-value stores in the process.
+ *
+ * Times are wall clock time spent in ib_kvstore_get(), ib_kvstore_set()
+ * and ib_kvstore_remove(), including failed calls.
+ *
+ * @sa ib_kvstore_stats_get()
+ */
+typedef struct ib_kvstore_stats_t ib_kvstore_stats_t;
+
+/** See ib_kvstore_stats_t */
+struct ib_kvstore_stats_t {
+    uint64_t gets;        /**< Calls to ib_kvstore_get(). */
+    uint64_t get_misses;  /**< Gets that found no value. */
+    uint64_t get_usec;    /**< Microseconds spent in gets. */
+    uint64_t sets;        /**< Calls to ib_kvstore_set(). */
+    uint64_t set_usec;    /**< Microseconds spent in sets. */
+    uint64_t removes;     /**< Calls to ib_kvstore_remove(). */
+    uint64_t remove_usec; /**< Microseconds spent in removes. */
+    uint64_t errors;      /**< Calls that failed other than by a miss. */
+};
+
+/**
+ * Fetch statistics of all key-value stores.
+ *
+ * The counters are kept per thread and summed by this call, so they cost
+ * the store operations two clock reads and no synchronization.
+ *
+ * @param[out] stats Statistics summed over all threads.
+ */
+void DLL_PUBLIC ib_kvstore_stats_get(ib_kvstore_stats_t *stats);
+
 /**
  * @name Key Functions
  * @{
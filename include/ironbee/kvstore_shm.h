@@ -0,0 +1,90 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+#ifndef __IRONBEE__KVSTORE_SHM_H
+#define __IRONBEE__KVSTORE_SHM_H
+
+#include <ironbee/kvstore.h>
+#include <ironbee/types.h>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+/**
+ * @file
+ * @brief IronBee --- Key-Value Shared Memory Store Interface
+ *
+ * A fixed size hash table in a memory mapped file that any number of
+ * processes and threads may open at once.  The table is split into
+ * stripes, each guarded by its own process shared mutex, so that updates
+ * to unrelated keys do not contend.  Expired entries are dropped when they
+ * are next encountered and their slots reused.
+ *
+ * Each entry occupies one slot; a key, type and value that do not fit in a
+ * slot cannot be stored.
+ */
+
+/**
+ * @addtogroup IronBeeKeyValueStore
+ * @ingroup IronBeeUtil
+ * @{
+ */
+
+/** Default number of slots. */
+#define IB_KVSTORE_SHM_DEFAULT_SLOTS 16384
+
+/** Default size of a slot in bytes, including its header. */
+#define IB_KVSTORE_SHM_DEFAULT_SLOT_SIZE 512
+
+/**
+ * Initializes kvstore that keeps entries in a shared memory mapped file.
+ *
+ * The file is created and sized by the first process to connect; later
+ * processes use the geometry recorded in it and ignore @a slots and
+ * @a slot_size.
+ *
+ * Values passed to ib_kvstore_set() carry their time to live in
+ * microseconds as the expiration, 0 meaning never; values returned by
+ * ib_kvstore_get() carry the absolute expiration time.
+ *
+ * @param[out] kvstore Initialized with kvserver and some defaults.
+ * @param[in] path The file to map.
+ * @param[in] slots Number of slots; 0 means IB_KVSTORE_SHM_DEFAULT_SLOTS.
+ * @param[in] slot_size Size of a slot; 0 means
+ *            IB_KVSTORE_SHM_DEFAULT_SLOT_SIZE.
+ * @returns
+ *   - IB_OK on success
+ *   - IB_EALLOC on memory allocation failure using malloc.
+ *   - IB_EINVAL if @a slot_size is too small to hold any entry.
+ */
+ib_status_t ib_kvstore_shm_init(
+    ib_kvstore_t *kvstore,
+    const char   *path,
+    size_t        slots,
+    size_t        slot_size);
+
+/**
+ * Set the file mode which the shared memory file is created with.
+ * @param[in] kvstore Key-Value store.
+ * @param[in] mode The mode.
+ */
+void ib_kvstore_shm_set_file_mode(ib_kvstore_t *kvstore, mode_t mode);
+
+ /**
+  * @}
+  */
+#endif /* __IRONBEE__KVSTORE_SHM_H */
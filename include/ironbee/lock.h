@@ -30,6 +30,7 @@
 #include <ironbee/mm.h>
 
 #include <pthread.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -68,6 +69,11 @@ typedef pthread_mutex_t ib_lock_t;
 ib_status_t DLL_PUBLIC ib_lock_create(ib_lock_t **lock, ib_mm_t mm);
 
 /**
+ * Acquire @a lock.
+ *
+ * If @a lock is held, the wait is reported to the contention hook; see
+ * ib_lock_contention_hook_set().
+ *
  * @param[in] lock The lock.
  */
 ib_status_t DLL_PUBLIC ib_lock_lock(ib_lock_t *lock);
@@ -95,6 +101,221 @@ ib_status_t DLL_PUBLIC ib_lock_create_malloc(ib_lock_t **lock);
  */
 void DLL_PUBLIC ib_lock_destroy_malloc(ib_lock_t *lock);
 
+/**
+ * Contention statistics of a lock.
+ *
+ * Counters are only updated on paths that are already slow (waiting) or
+ * already exclusive (holding a write or spin lock), so keeping them costs
+ * nothing measurable on the uncontended path.  They are read without
+ * synchronization and so are approximate while the lock is in use.
+ */
+typedef struct ib_lock_stats_t ib_lock_stats_t;
+struct ib_lock_stats_t {
+    uint64_t acquired;  /**< Exclusive (write or spin) acquisitions. */
+    uint64_t contended; /**< Acquisitions, of any mode, that had to wait. */
+    uint64_t wait_ns;   /**< Nanoseconds spent in contended acquisitions. */
+    uint64_t spins;     /**< Busy-wait iterations (spin locks only). */
+};
+
+/**
+ * Function called after every contended lock acquisition.
+ *
+ * Called with the lock held, so it must be fast and must not take the
+ * lock again.
+ *
+ * @param[in] lock    The lock acquired; an @ref ib_lock_t, @ref ib_rwlock_t
+ *                    or @ref ib_spinlock_t.
+ * @param[in] wait_ns Nanoseconds spent waiting for it.
+ * @param[in] cbdata  Callback data.
+ */
+typedef void (*ib_lock_contention_fn_t)(
+    const void *lock,
+    uint64_t    wait_ns,
+    void       *cbdata
+);
+
+/**
+ * Set the process wide contention hook.
+ *
+ * The hook is called after contended acquisitions of all locks in this
+ * file and can be used to find hot locks.  Pass NULL to remove it.  The
+ * hook should be set before threads that use locks are started.
+ *
+ * @param[in] fn     Hook function or NULL.
+ * @param[in] cbdata Callback data for @a fn.
+ */
+void DLL_PUBLIC ib_lock_contention_hook_set(
+    ib_lock_contention_fn_t  fn,
+    void                    *cbdata
+);
+
+/**
+ * @brief A reader/writer lock.
+ *
+ * Any number of readers may hold the lock at once, but writers hold it
+ * exclusively.  Use it for read-mostly shared state.  Where supported,
+ * writers are preferred, so a steady stream of readers cannot starve them.
+ */
+typedef struct ib_rwlock_t ib_rwlock_t;
+
+/**
+ * Create a new reader/writer lock using the given memory manager.
+ *
+ * The lock is destroyed when @a mm is.  As with ib_lock_create(), locks
+ * exist only as pointers.
+ *
+ * @param[out] lock The lock.
+ * @param[in] mm The memory manager.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC If the lock cannot be allocated or initialized.
+ * - IB_EOTHER If the lock cannot be schedule for destruction in @a mm.
+ */
+ib_status_t DLL_PUBLIC ib_rwlock_create(ib_rwlock_t **lock, ib_mm_t mm);
+
+/**
+ * Create a reader/writer lock when there is no memory manager available.
+ *
+ * @param[out] lock The lock.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC If the lock cannot be allocated or initialized.
+ */
+ib_status_t DLL_PUBLIC ib_rwlock_create_malloc(ib_rwlock_t **lock);
+
+/**
+ * Destroy a lock created by ib_rwlock_create_malloc().
+ *
+ * @param[in] lock The lock.
+ */
+void DLL_PUBLIC ib_rwlock_destroy_malloc(ib_rwlock_t *lock);
+
+/**
+ * Acquire @a lock for reading.
+ *
+ * @param[in] lock The lock.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EUNKNOWN On failure, e.g., too many readers.
+ */
+ib_status_t DLL_PUBLIC ib_rwlock_rdlock(ib_rwlock_t *lock);
+
+/**
+ * Acquire @a lock for writing.
+ *
+ * @param[in] lock The lock.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EUNKNOWN On failure, e.g., deadlock detected.
+ */
+ib_status_t DLL_PUBLIC ib_rwlock_wrlock(ib_rwlock_t *lock);
+
+/**
+ * Release @a lock, held for reading or writing.
+ *
+ * @param[in] lock The lock.
+ */
+ib_status_t DLL_PUBLIC ib_rwlock_unlock(ib_rwlock_t *lock);
+
+/**
+ * Get the contention statistics of @a lock.
+ *
+ * ib_lock_stats_t::spins is always 0 and ib_lock_stats_t::acquired counts
+ * only write acquisitions; counting reads would make readers contend.
+ *
+ * @param[in] lock The lock.
+ * @param[out] stats Statistics.
+ */
+void DLL_PUBLIC ib_rwlock_stats_get(
+    const ib_rwlock_t *lock,
+    ib_lock_stats_t   *stats
+);
+
+/**
+ * @brief An adaptive spin lock.
+ *
+ * For very short critical sections where sleeping in the kernel would cost
+ * more than the work protected.  A waiter busy-waits, with a CPU pause, for
+ * a number of iterations that adapts to how long it has recently taken to
+ * acquire the lock, and then yields its CPU between checks.  Do not hold a
+ * spin lock across anything that may block.
+ */
+typedef struct ib_spinlock_t ib_spinlock_t;
+
+/**
+ * Create a new spin lock using the given memory manager.
+ *
+ * @param[out] lock The lock.
+ * @param[in] mm The memory manager.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC If the lock cannot be allocated.
+ */
+ib_status_t DLL_PUBLIC ib_spinlock_create(ib_spinlock_t **lock, ib_mm_t mm);
+
+/**
+ * Create a spin lock when there is no memory manager available.
+ *
+ * @param[out] lock The lock.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC If the lock cannot be allocated.
+ */
+ib_status_t DLL_PUBLIC ib_spinlock_create_malloc(ib_spinlock_t **lock);
+
+/**
+ * Destroy a lock created by ib_spinlock_create_malloc().
+ *
+ * @param[in] lock The lock.
+ */
+void DLL_PUBLIC ib_spinlock_destroy_malloc(ib_spinlock_t *lock);
+
+/**
+ * Acquire @a lock.
+ *
+ * @param[in] lock The lock.
+ *
+ * @returns IB_OK.
+ */
+ib_status_t DLL_PUBLIC ib_spinlock_lock(ib_spinlock_t *lock);
+
+/**
+ * Acquire @a lock if it is free.
+ *
+ * @param[in] lock The lock.
+ *
+ * @returns
+ * - IB_OK If @a lock was acquired.
+ * - IB_EAGAIN If @a lock is held.
+ */
+ib_status_t DLL_PUBLIC ib_spinlock_trylock(ib_spinlock_t *lock);
+
+/**
+ * Release @a lock.
+ *
+ * @param[in] lock The lock.
+ *
+ * @returns IB_OK.
+ */
+ib_status_t DLL_PUBLIC ib_spinlock_unlock(ib_spinlock_t *lock);
+
+/**
+ * Get the contention statistics of @a lock.
+ *
+ * @param[in] lock The lock.
+ * @param[out] stats Statistics.
+ */
+void DLL_PUBLIC ib_spinlock_stats_get(
+    const ib_spinlock_t *lock,
+    ib_lock_stats_t     *stats
+);
+
 /**
  * @} IronBeeUtilLocking Locking
  */
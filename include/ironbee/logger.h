@@ -50,6 +50,14 @@ extern "C" {
  */
 #define IB_LOGGER_DEFAULT_FORMATTER_NAME "ib_logger_default_formatter_name"
 
+/**
+ * Default time in milliseconds to block a producer when a writer's
+ * queue is full.
+ *
+ * @sa ib_logger_overflow_set()
+ */
+#define IB_LOGGER_OVERFLOW_TIMEOUT_MS 100
+
 /**
  * Logger log level.
  **/
@@ -96,6 +104,31 @@ ib_logger_level_t DLL_PUBLIC ib_logger_string_to_level(
     ib_logger_level_t  dlevel
 );
 
+/**
+ * What to do with a log record when a writer's queue is full.
+ *
+ * @sa ib_logger_overflow_set()
+ */
+typedef enum {
+    IB_LOGGER_OVERFLOW_DROP_NEWEST, /**< Discard the new record. */
+    IB_LOGGER_OVERFLOW_DROP_OLDEST, /**< Discard the oldest queued record. */
+    IB_LOGGER_OVERFLOW_BLOCK        /**< Wait for space, then drop newest. */
+} ib_logger_overflow_t;
+
+/**
+ * Logger queue statistics, summed over all writers.
+ *
+ * @sa ib_logger_stats_get()
+ */
+typedef struct {
+    size_t depth;     /**< Records currently queued. */
+    size_t max_depth; /**< Deepest single writer queue. */
+    size_t capacity;  /**< Capacity of each writer queue. */
+    size_t enqueued;  /**< Records queued since creation. */
+    size_t dropped;   /**< Records dropped due to overflow. */
+    size_t blocked;   /**< Times a logging thread waited for space. */
+} ib_logger_stats_t;
+
 typedef struct ib_logger_t ib_logger_t;
 typedef struct ib_logger_rec_t ib_logger_rec_t;
 typedef struct ib_logger_writer_t ib_logger_writer_t;
@@ -166,6 +199,28 @@ typedef ib_status_t (*ib_logger_record_fn_t)(
     void               *data
 );
 
+/**
+ * Write a batch of records taken from a writer's queue.
+ *
+ * The records were produced by the writer's @ref ib_logger_format_fn_t
+ * and are freed by the logger after this returns.
+ *
+ * @param[in] logger The logger.
+ * @param[in] records The records, oldest first.
+ * @param[in] nrecords The number of @a records.
+ * @param[in] data Callback data.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - Other on error. Defined by the implementation.
+ */
+typedef ib_status_t (*ib_logger_batch_fn_t)(
+    ib_logger_t  *logger,
+    void * const *records,
+    size_t        nrecords,
+    void         *data
+);
+
 /**
  * Ask the log writer to format the message before it is written.
  *
@@ -469,6 +524,69 @@ ib_status_t ib_logger_writer_add(
     void                  *record_data
 );
 
+/**
+ * Add a writer that receives records in batches.
+ *
+ * Unlike ib_logger_writer_add(), the logger manages the queue: pending
+ * records are handed to @a batch_fn in groups, so that it can write them
+ * with a single call such as @c writev(). By default this happens in the
+ * logging thread that finds the queue empty. After
+ * ib_logger_writer_threads_start(), whether this writer was added before
+ * or after, it happens in a dedicated thread per writer, taking the write
+ * off the logging thread entirely.
+ *
+ * @param[in] logger The logger to add the writer to.
+ * @param[in] open_fn Signal the writer to open logging resources.
+ * @param[in] open_data Callback data.
+ * @param[in] close_fn Signal the writer to close logging resources.
+ * @param[in] close_data Callback data.
+ * @param[in] reopen_fn Signal the writer to reopen logging resources.
+ * @param[in] reopen_data Callback data.
+ * @param[in] format Format and free functions for records.
+ * @param[in] batch_fn Write a batch of records.
+ * @param[in] batch_data Callback data.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC On allocation failure.
+ * - Other on internal failure.
+ */
+ib_status_t DLL_PUBLIC ib_logger_writer_add_batched(
+    ib_logger_t           *logger,
+    ib_logger_open_fn_t    open_fn,
+    void                  *open_data,
+    ib_logger_close_fn_t   close_fn,
+    void                  *close_data,
+    ib_logger_reopen_fn_t  reopen_fn,
+    void                  *reopen_data,
+    ib_logger_format_t    *format,
+    ib_logger_batch_fn_t   batch_fn,
+    void                  *batch_data
+);
+
+/**
+ * Start a background writer thread for each batched writer.
+ *
+ * Writers added with ib_logger_writer_add_batched() that do not yet
+ * have a thread get one, as do writers added later. The threads are
+ * stopped, after writing all queued records, by ib_logger_close(),
+ * ib_logger_writer_clear() or the destruction of the logger's memory
+ * manager.
+ *
+ * Threads do not survive @c fork(). In the child, each writer starts a
+ * new thread on its first record. Records queued at the time of the
+ * fork are written by the parent only.
+ *
+ * @param[in] logger The logger.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EOTHER If a thread could not be created.
+ */
+ib_status_t DLL_PUBLIC ib_logger_writer_threads_start(
+    ib_logger_t *logger
+);
+
 /**
  * Add the default writer.
  *
@@ -516,6 +634,9 @@ ib_status_t ib_logger_open(
 /**
  * Close all logging resources. This is relayed to all writers.
  *
+ * Background writer threads are stopped first, after writing all
+ * queued records.
+ *
  * @param[in] logger The logger to commit messages in.
  *
  * @returns
@@ -564,6 +685,41 @@ ib_status_t DLL_PUBLIC ib_logger_dequeue(
     void                  *cbdata
 );
 
+/**
+ * Set the policy for records logged while a writer's queue is full.
+ *
+ * Logging threads never take a lock to queue a record. When a writer
+ * cannot keep up and its queue fills, the record is dropped, replaces
+ * the oldest queued record, or waits for up to @a timeout_ms and is
+ * dropped if no space appears. Drops are counted in
+ * ib_logger_stats_t::dropped.
+ *
+ * The default is @ref IB_LOGGER_OVERFLOW_BLOCK with a timeout of
+ * @ref IB_LOGGER_OVERFLOW_TIMEOUT_MS.
+ *
+ * @param[in] logger The logger.
+ * @param[in] overflow The overflow policy.
+ * @param[in] timeout_ms Longest wait for @ref IB_LOGGER_OVERFLOW_BLOCK.
+ */
+void DLL_PUBLIC ib_logger_overflow_set(
+    ib_logger_t          *logger,
+    ib_logger_overflow_t  overflow,
+    uint32_t              timeout_ms
+);
+
+/**
+ * Get queue depth and overflow statistics of all writers.
+ *
+ * The values are read without locking and may be slightly stale.
+ *
+ * @param[in] logger The logger.
+ * @param[out] stats Statistics summed over all writers.
+ */
+void DLL_PUBLIC ib_logger_stats_get(
+    ib_logger_t       *logger,
+    ib_logger_stats_t *stats
+);
+
 /**
  * A standard logger log message format.
  *
@@ -606,6 +762,27 @@ void DLL_PUBLIC ib_logger_standard_msg_free(
     void        *cbdata
 );
 
+/**
+ * Write a batch of standard messages to @a file with @c writev().
+ *
+ * Each message is written as its prefix, a space, the message and a
+ * newline. This is suitable as the body of an @ref ib_logger_batch_fn_t
+ * for writers using ib_logger_standard_formatter().
+ *
+ * @param[in] file The file to write to. It is flushed first.
+ * @param[in] records The @ref ib_logger_standard_msg_t records.
+ * @param[in] nrecords The number of @a records.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EOTHER On write failure.
+ */
+ib_status_t DLL_PUBLIC ib_logger_standard_msg_write_batch(
+    FILE         *file,
+    void * const *records,
+    size_t        nrecords
+);
+
 /**
  * A standard implementation of @ref ib_logger_format_fn_t without
  * date/time stamp for IronBee.
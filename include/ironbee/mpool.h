@@ -29,6 +29,7 @@
 #include <ironbee/build.h>
 #include <ironbee/types.h>
 
+#include <stdbool.h>
 #include <string.h>
 
 #ifdef __cplusplus
@@ -413,6 +414,82 @@ ib_mpool_t DLL_PUBLIC *ib_mpool_parent(
 )
 NONNULL_ATTRIBUTE(1);
 
+/**
+ * Page cache statistics.
+ *
+ * @sa ib_mpool_page_cache_stats_get()
+ */
+typedef struct ib_mpool_page_cache_stats_t ib_mpool_page_cache_stats_t;
+
+/** See ib_mpool_page_cache_stats_t */
+struct ib_mpool_page_cache_stats_t
+{
+    size_t page_hits;    /**< Pages taken from a thread cache or the depot. */
+    size_t page_misses;  /**< Pages allocated from the system. */
+    size_t page_frees;   /**< Pages returned to the system. */
+    size_t pool_hits;    /**< Pool structures reused from a thread cache. */
+    size_t pool_misses;  /**< Pool structures allocated from the system. */
+    size_t cached_pages; /**< Pages currently held in thread caches. */
+    size_t depot_pages;  /**< Pages currently held in the shared depot. */
+    size_t slabs;        /**< Huge page slabs mapped. */
+};
+
+/**
+ * Configure the page cache.
+ *
+ * Pools using the default page size, malloc() and free() take pages and
+ * pool structures from a cache local to the calling thread and return them
+ * to the cache of the destroying thread instead of calling free().  A
+ * thread whose cache is full moves half of it to a shared, locked depot;
+ * pages beyond the depot limit are freed.  Caches of exiting threads are
+ * moved to the depot.
+ *
+ * With @a huge_pages, the cache allocates pages by carving up 2 MiB slabs
+ * mapped with huge pages (falling back to transparent huge pages) rather
+ * than by malloc().  Slab pages are never returned to the system and the
+ * depot limit does not apply to them.
+ *
+ * The cache is enabled by default unless mpool.c is compiled with
+ * IB_MPOOL_VALGRIND.  This function must be called before the first cached
+ * pool is created.
+ *
+ * @param[in] enabled      Use the cache for new pools.
+ * @param[in] thread_pages Pages each thread may cache; 0 means default
+ *                         (32).
+ * @param[in] depot_pages  Pages the shared depot may hold; 0 means default
+ *                         (256).
+ * @param[in] huge_pages   Allocate pages from huge page slabs.
+ * @returns
+ * - IB_OK     -- Success.
+ * - IB_EINVAL -- The cache has already been used.
+ */
+ib_status_t DLL_PUBLIC ib_mpool_page_cache_configure(
+    bool   enabled,
+    size_t thread_pages,
+    size_t depot_pages,
+    bool   huge_pages
+);
+
+/**
+ * Fetch page cache statistics.
+ *
+ * Counters of running threads are read without synchronization and may be
+ * slightly stale.
+ *
+ * @param[out] stats Statistics summed over all threads.
+ */
+void DLL_PUBLIC ib_mpool_page_cache_stats_get(
+    ib_mpool_page_cache_stats_t *stats
+)
+NONNULL_ATTRIBUTE(1);
+
+/**
+ * Return the calling thread's cached pages and pools to the system.
+ *
+ * Pages are moved to the depot if they come from huge page slabs.
+ */
+void DLL_PUBLIC ib_mpool_page_cache_flush(void);
+
 /** @} IronBeeUtilMemPool */
 
 #ifdef __cplusplus
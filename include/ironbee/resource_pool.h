@@ -152,6 +152,62 @@ ib_status_t DLL_PUBLIC ib_resource_pool_create(
 )
 NONNULL_ATTRIBUTE(1);
 
+/**
+ * Create a new resource pool that may be used by several threads at once.
+ *
+ * The arguments and limits are the same as ib_resource_pool_create(), but
+ * callers need not lock the pool around ib_resource_acquire() and
+ * ib_resource_release().  Each thread keeps a small magazine of free
+ * resources and exchanges whole magazines with a lock-free depot shared
+ * by all threads, so most calls touch no shared state.  A thread that
+ * exits returns its magazines to the depot.
+ *
+ * The callbacks may be called from any thread using the pool.
+ * Free resources cached by a thread count against @a max_count.  Before
+ * an acquire is declined at the limit, free resources are taken from the
+ * magazines of other threads, so it is only declined when @a max_count
+ * resources are in use.
+ *
+ * ib_resource_pool_flush(), ib_resource_pool_set_min() and
+ * ib_resource_pool_set_max() must only be called while no other thread
+ * uses the pool.
+ *
+ * @param[out] resource_pool The resource pool created.
+ * @param[in] mm The memory manager of the pool.  Its cleanup destroys
+ *            the pool, which must not happen while any thread uses it.
+ * @param[in] min_count Minimum number of resources or 0.
+ * @param[in] max_count Maximum number of resources or 0 for no limit.
+ * @param[in] create_fn This function creates the resource.
+ * @param[in] create_data Callback data.
+ * @param[in] destroy_fn Destroy a resource.
+ * @param[in] destroy_data Callback data.
+ * @param[in] preuse_fn Called when a resource is acquired.  May be NULL.
+ * @param[in] preuse_data Callback data.
+ * @param[in] postuse_fn Called when a resource is released.  May be NULL.
+ * @param[in] postuse_data Callback data.
+ * @returns
+ * - IB_OK On success.
+ * - IB_EINVAL If @a max_count and @a min_count are greater than 0 and
+ *             @a max_count is less than @a min_count.
+ * - IB_EALLOC On allocation errors.
+ * - IB_EOTHER If the thread specific key cannot be created.
+ */
+ib_status_t DLL_PUBLIC ib_resource_pool_create_concurrent(
+    ib_resource_pool_t       **resource_pool,
+    ib_mm_t                    mm,
+    size_t                     min_count,
+    size_t                     max_count,
+    ib_resource_create_fn_t    create_fn,
+    void                      *create_data,
+    ib_resource_destroy_fn_t   destroy_fn,
+    void                      *destroy_data,
+    ib_resource_preuse_fn_t    preuse_fn,
+    void                      *preuse_data,
+    ib_resource_postuse_fn_t   postuse_fn,
+    void                      *postuse_data
+)
+NONNULL_ATTRIBUTE(1);
+
 /**
  * Acquire a resource, creating a new one if necessary.
  *
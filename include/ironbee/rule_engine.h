@@ -28,6 +28,7 @@
 #include <ironbee/action.h>
 #include <ironbee/build.h>
 #include <ironbee/config.h>
+#include <ironbee/hash.h>
 #include <ironbee/operator.h>
 #include <ironbee/rule_defs.h>
 #include <ironbee/types.h>
@@ -156,7 +157,8 @@ struct ib_rule_exec_t {
     /* Rule stack (for chains) */
     ib_list_t              *rule_stack;  /**< Stack of rules */
 
-    /* List of all rules to run during the current phase. */
+    /* List of injected rules to run during the current phase, before
+     * the context's compiled phase rules. */
     ib_list_t              *phase_rules; /**< List of ib_rule_t */
 
     /**
@@ -164,6 +166,17 @@ struct ib_rule_exec_t {
      */
     ib_list_t              *value_stack;
 
+    /**
+     * Transformation results shared by all rules of the transaction.
+     *
+     * Keyed on the source value and the transformation chain prefix
+     * applied to it; values are the resulting @ref ib_field_t.  Created
+     * on first use.
+     */
+    ib_hash_t              *tfn_cache;
+    size_t                  tfn_cache_hits;   /**< Reused tfn results. */
+    size_t                  tfn_cache_misses; /**< Executed tfns. */
+
 #ifdef IB_RULE_TRACE
     ib_rule_trace_t        *traces; /**< Rule trace information. */
 #endif
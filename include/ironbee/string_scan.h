@@ -0,0 +1,115 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+#ifndef _IB_STRING_SCAN_H_
+#define _IB_STRING_SCAN_H_
+
+/**
+ * @file
+ * @brief IronBee --- String Scanning Kernels
+ *
+ * Vectorized scans used by the string transformations to find the first
+ * byte they would change.  A transformation whose scan reaches the end of
+ * its input can hand back the input unchanged without allocating.
+ *
+ * On x86 the kernels use SSE2, or AVX2 when the CPU supports it, chosen
+ * once at first use.  Other platforms use a scalar implementation.
+ */
+
+#include <ironbee/build.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup IronBeeUtilString
+ *
+ * @{
+ */
+
+/**
+ * Offset of the first ASCII uppercase byte ('A' to 'Z').
+ *
+ * @param[in] data Data to scan.
+ * @param[in] dlen Length of @a data.
+ *
+ * @returns Offset of the first uppercase byte or @a dlen if there is none.
+ */
+size_t DLL_PUBLIC ib_str_scan_upper(
+    const uint8_t *data,
+    size_t         dlen
+);
+
+/**
+ * Offset of the first whitespace byte.
+ *
+ * Whitespace is the C locale isspace() set: space, tab, newline, vertical
+ * tab, form feed and carriage return.
+ *
+ * @param[in] data Data to scan.
+ * @param[in] dlen Length of @a data.
+ *
+ * @returns Offset of the first whitespace byte or @a dlen if there is none.
+ */
+size_t DLL_PUBLIC ib_str_scan_space(
+    const uint8_t *data,
+    size_t         dlen
+);
+
+/**
+ * Offset of the first byte equal to @a c1 or @a c2.
+ *
+ * Pass the same byte twice to look for a single byte.
+ *
+ * @param[in] data Data to scan.
+ * @param[in] dlen Length of @a data.
+ * @param[in] c1 First byte to look for.
+ * @param[in] c2 Second byte to look for.
+ *
+ * @returns Offset of the first match or @a dlen if there is none.
+ */
+size_t DLL_PUBLIC ib_str_scan_bytes(
+    const uint8_t *data,
+    size_t         dlen,
+    uint8_t        c1,
+    uint8_t        c2
+);
+
+/**
+ * Copy @a data to @a out converting ASCII uppercase to lowercase.
+ *
+ * @param[in] data Data to convert.
+ * @param[in] dlen Length of @a data.
+ * @param[out] out Buffer of at least @a dlen bytes.  May be @a data.
+ */
+void DLL_PUBLIC ib_str_lower_copy(
+    const uint8_t *data,
+    size_t         dlen,
+    uint8_t       *out
+);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _IB_STRING_SCAN_H_ */
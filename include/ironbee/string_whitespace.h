@@ -79,6 +79,42 @@ ib_status_t DLL_PUBLIC ib_str_whitespace_compress(
 )
 NONNULL_ATTRIBUTE(2, 4, 5);
 
+/**
+ * Delete all whitespace from a string into a buffer.
+ *
+ * @param[in] data_in Pointer to input data.
+ * @param[in] dlen_in Length of @a data_in.
+ * @param[out] data_out Buffer of @a dlen_in bytes.  May be @a data_in.
+ * @param[out] dlen_out Length of @a data_out.
+ *
+ * @result IB_OK
+ */
+ib_status_t DLL_PUBLIC ib_str_whitespace_remove_ex(
+    const uint8_t  *data_in,
+    size_t          dlen_in,
+    uint8_t        *data_out,
+    size_t         *dlen_out
+)
+NONNULL_ATTRIBUTE(1, 3, 4);
+
+/**
+ * Compress whitespace in a string into a buffer.
+ *
+ * @param[in] data_in Pointer to input data.
+ * @param[in] dlen_in Length of @a data_in.
+ * @param[out] data_out Buffer of @a dlen_in bytes.  May be @a data_in.
+ * @param[out] dlen_out Length of @a data_out.
+ *
+ * @result IB_OK
+ */
+ib_status_t DLL_PUBLIC ib_str_whitespace_compress_ex(
+    const uint8_t  *data_in,
+    size_t          dlen_in,
+    uint8_t        *data_out,
+    size_t         *dlen_out
+)
+NONNULL_ATTRIBUTE(1, 3, 4);
+
 /** @} */
 
 #ifdef __cplusplus
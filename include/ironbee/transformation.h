@@ -38,6 +38,7 @@
 
 #include <ironbee/build.h>
 #include <ironbee/engine.h>
+#include <ironbee/list.h>
 #include <ironbee/mm.h>
 #include <ironbee/types.h>
 
@@ -129,6 +130,42 @@ typedef ib_status_t (* ib_transformation_execute_fn_t)(
 )
 NONNULL_ATTRIBUTE(3, 4);
 
+/**
+ * Transformation fuse callback type.
+ *
+ * A fuse function is a byte string kernel of a transformation that can run
+ * as one step of a fused chain (see ib_transformation_fuse_chain()).  The
+ * steps of a fused chain share a single output buffer, so the kernel must
+ * never produce more bytes than it is given and must allow @a data_out to
+ * be @a data_in.
+ *
+ * If @a data_out is NULL the kernel only reports whether it would change
+ * @a data_in.
+ *
+ * @param[in]  data_in       Input data.  Never empty.
+ * @param[in]  dlen_in       Length of @a data_in.
+ * @param[out] data_out      Buffer of @a dlen_in bytes; may be @a data_in or
+ *                           NULL.
+ * @param[out] dlen_out      Bytes written to @a data_out.
+ * @param[in]  instance_data Instance data.
+ * @param[in]  cbdata        Callback data.
+ *
+ * @return
+ * - IB_OK if @a data_in changes; the result is in @a data_out unless it is
+ *   NULL.
+ * - IB_DECLINED if @a data_in would not change.  Nothing is written.
+ * - Other on failure.
+ */
+typedef ib_status_t (* ib_transformation_fuse_fn_t)(
+    const uint8_t  *data_in,
+    size_t          dlen_in,
+    uint8_t        *data_out,
+    size_t         *dlen_out,
+    void           *instance_data,
+    void           *cbdata
+)
+NONNULL_ATTRIBUTE(1, 4);
+
 /**
  * Create a transformation.
  *
@@ -165,6 +202,28 @@ ib_status_t DLL_PUBLIC ib_transformation_create(
 )
 NONNULL_ATTRIBUTE(1, 3, 9);
 
+/**
+ * Make a transformation fusable.
+ *
+ * @a fuse_fn must produce the same bytes as the execute function does for
+ * a byte string field.  Other input types are always passed to the execute
+ * function.
+ *
+ * @param[in] tfn     Transformation.  Must not handle lists.
+ * @param[in] fuse_fn Fuse function.
+ * @param[in] cbdata  Fuse callback data.
+ *
+ * @return
+ * - IB_OK on success.
+ * - IB_EINVAL if @a tfn handles lists.
+ */
+ib_status_t DLL_PUBLIC ib_transformation_fuse_fn_set(
+    ib_transformation_t         *tfn,
+    ib_transformation_fuse_fn_t  fuse_fn,
+    void                        *cbdata
+)
+NONNULL_ATTRIBUTE(1, 2);
+
 /**
  * Register a transformation with engine.
  *
@@ -268,6 +327,20 @@ bool DLL_PUBLIC ib_transformation_handle_list(
 )
 NONNULL_ATTRIBUTE(1);
 
+/**
+ * Is a transformation fusable?
+ *
+ * @sa ib_transformation_fuse_fn_set().
+ *
+ * @param[in] tfn Transformation.
+ *
+ * @return true if @a tfn has a fuse function.
+ */
+bool DLL_PUBLIC ib_transformation_fusable(
+    const ib_transformation_t *tfn
+)
+NONNULL_ATTRIBUTE(1);
+
 /**
  * Create a transformation instance.
  *
@@ -348,6 +421,37 @@ ib_status_t DLL_PUBLIC ib_transformation_inst_execute(
 )
 NONNULL_ATTRIBUTE(1, 3, 4);
 
+/**
+ * Fuse a chain of transformation instances.
+ *
+ * Each run of two or more consecutive fusable instances in @a tfn_insts is
+ * replaced by a single instance that runs their fuse functions one after
+ * another over one output buffer.  A fused chain therefore allocates at
+ * most one buffer and one field, and none if no step changes its input.
+ *
+ * Fused instances are shared engine wide: fusing the same run of
+ * transformations and parameters again yields the same instance.  Its
+ * transformation is named after the fused ones, joined by "+", and is not
+ * registered for lookup.
+ *
+ * @param[in]  ib        IronBee engine.
+ * @param[in]  mm        Memory manager for @a fused.
+ * @param[in]  tfn_insts List of @ref ib_transformation_inst_t.
+ * @param[out] fused     Fused list of @ref ib_transformation_inst_t.  This
+ *                       is @a tfn_insts if nothing could be fused.
+ *
+ * @return
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation failure.
+ */
+ib_status_t DLL_PUBLIC ib_transformation_fuse_chain(
+    ib_engine_t      *ib,
+    ib_mm_t           mm,
+    const ib_list_t  *tfn_insts,
+    const ib_list_t **fused
+)
+NONNULL_ATTRIBUTE(1, 3, 4);
+
 #ifdef __cplusplus
 }
 #endif
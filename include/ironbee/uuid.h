@@ -63,6 +63,10 @@ ib_status_t DLL_PUBLIC ib_uuid_shutdown(void);
 /**
  * Creates a new, random, v4 uuid (static buffer version).
  *
+ * Each thread uses its own ChaCha20 generator seeded from /dev/urandom, so
+ * no lock is taken.  If a generator cannot be seeded, this falls back to
+ * OSSP UUID under a global lock.
+ *
  * @param[in] uuid Where to write UUID.  Must be IB_UUID_LENGTH long.
  *
  * @returns
@@ -71,6 +75,25 @@ ib_status_t DLL_PUBLIC ib_uuid_shutdown(void);
  */
 ib_status_t DLL_PUBLIC ib_uuid_create_v4(char *uuid);
 
+/**
+ * Creates a new, time ordered, v7 uuid (static buffer version).
+ *
+ * The first 48 bits are the Unix time in milliseconds followed by a 12 bit
+ * sequence and 62 random bits.  UUIDs created by one thread are strictly
+ * increasing; UUIDs from different threads are ordered to the millisecond.
+ * Use these where index locality of IDs matters.
+ *
+ * Falls back to ib_uuid_create_v4() behavior if the thread generator
+ * cannot be seeded.
+ *
+ * @param[in] uuid Where to write UUID.  Must be IB_UUID_LENGTH long.
+ *
+ * @returns
+ * - IB_EALLOC on allocation failure.
+ * - IB_EOTHER on other failure.
+ */
+ib_status_t DLL_PUBLIC ib_uuid_create_v7(char *uuid);
+
 /** @} IronBeeUtilUUID */
 
 
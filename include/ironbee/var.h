@@ -719,8 +719,12 @@ NONNULL_ATTRIBUTE(1, 2, 3);
  *
  * The lifetime of @a result will depend on the value.  For non-filtered
  * list fields, the underlying value will be reported directly and @a result
- * will have lifetime equal to that field.  For all other results, the
- * lifetime will equal that of @a mp.
+ * will have lifetime equal to that field.  For filtered non-dynamic list
+ * fields, @a result comes from a case-insensitive name index kept in
+ * @a store; it has lifetime equal to @a store, is shared between calls and
+ * must not be modified.  The index is built on first use and rebuilt when
+ * the list changes.  For all other results, the lifetime will equal that
+ * of @a mp.
  *
  * @param[in]  target Target to get values of.
  * @param[out] result Fetched values.  Lifetime will vary.  See above.
@@ -327,6 +327,13 @@ ib_status_t modlua_context_close(
         cfg->lua_resource = NULL;
         cfg->L = NULL;
 
+        /* Stacks cached during configuration predate the committed
+         * configuration; return them so the flush replaces them too. */
+        rc = modlua_runtime_cache_flush(cfg->lua_cache);
+        if (rc != IB_OK) {
+            return rc;
+        }
+
         rc = ib_resource_pool_flush(cfg->lua_pool);
         if (rc != IB_OK) {
             return rc;
@@ -607,6 +614,18 @@ static ib_status_t modlua_init(
         return rc;
     }
 
+    /* Created after the pool so that it is torn down before it. */
+    rc = modlua_runtime_cache_create(
+        &(cfg->lua_cache),
+        cfg->lua_pool,
+        cfg->lua_pool_lock,
+        cfg->lua_pool_cfg,
+        mm);
+    if (rc != IB_OK) {
+        ib_log_error(ib, "Failed to create Lua runtime cache.");
+        return rc;
+    }
+
     /* Set up defaults */
     rc = ib_resource_acquire(cfg->lua_pool, &(cfg->lua_resource));
     if (rc != IB_OK) {
@@ -48,18 +48,26 @@
  */
 typedef struct modlua_runtime_cfg_t modlua_runtime_cfg_t;
 
+/**
+ * Per-thread cache of Lua runtimes in front of modlua_cfg_t::lua_pool.
+ *
+ * Opaque; see modlua_runtime_cache_create().
+ */
+typedef struct modlua_runtime_cache_t modlua_runtime_cache_t;
+
 //! Module configuration.
 struct modlua_cfg_t {
-    char                 *pkg_path;      /**< Package path Lua Configuration. */
-    char                 *pkg_cpath;     /**< Cpath Lua Configuration. */
-    char                 *module_path;   /**< Path to Lua modules. */
-    ib_list_t            *reloads;       /**< modlua_reload_t list. */
-    ib_list_t            *waggle_rules;  /**< Waggle rules to execute. */
-    ib_resource_pool_t   *lua_pool;      /**< Pool of Lua stacks. */
-    ib_lock_t            *lua_pool_lock; /**< Pool lock. */
-    modlua_runtime_cfg_t *lua_pool_cfg;  /**< Pool configuration. */
-    ib_resource_t        *lua_resource;  /**< Resource modlua_cfg_t::L. */
-    lua_State            *L;             /**< Lua stack used for config. */
+    char                   *pkg_path;      /**< Package path Lua Configuration. */
+    char                   *pkg_cpath;     /**< Cpath Lua Configuration. */
+    char                   *module_path;   /**< Path to Lua modules. */
+    ib_list_t              *reloads;       /**< modlua_reload_t list. */
+    ib_list_t              *waggle_rules;  /**< Waggle rules to execute. */
+    ib_resource_pool_t     *lua_pool;      /**< Pool of Lua stacks. */
+    ib_lock_t              *lua_pool_lock; /**< Pool lock. */
+    modlua_runtime_cfg_t   *lua_pool_cfg;  /**< Pool configuration. */
+    modlua_runtime_cache_t *lua_cache;     /**< Per-thread cached stacks. */
+    ib_resource_t          *lua_resource;  /**< Resource modlua_cfg_t::L. */
+    lua_State              *L;             /**< Lua stack used for config. */
 };
 typedef struct modlua_cfg_t modlua_cfg_t;
 
@@ -40,6 +40,7 @@
 #include <lualib.h>
 
 #include <assert.h>
+#include <pthread.h>
 #include <stdlib.h>
 
 /* If LUA_BASE_PATH was not set as part of autoconf, define a default. */
@@ -721,6 +722,236 @@ ib_status_t modlua_runtime_resource_pool_create(
     return IB_OK;
 }
 
+/**
+ * One thread's slot in a @ref modlua_runtime_cache_t.
+ */
+struct modlua_runtime_slot_t {
+    modlua_runtime_cache_t       *cache;   /**< Owning cache. */
+
+    /**
+     * Cached runtime or NULL.
+     *
+     * The owning thread takes and stores it without the cache lock.
+     * Other threads only take it, with the lock held, so every change is
+     * a compare and swap.
+     */
+    modlua_runtime_t * volatile   runtime;
+    struct modlua_runtime_slot_t *next;    /**< Next slot in the cache. */
+};
+typedef struct modlua_runtime_slot_t modlua_runtime_slot_t;
+
+struct modlua_runtime_cache_t {
+    pthread_key_t               key;         /**< Thread's slot. */
+    ib_resource_pool_t         *pool;        /**< Shared pool. */
+    ib_lock_t                  *lock;        /**< Lock for pool and slots. */
+    const modlua_runtime_cfg_t *runtime_cfg; /**< Stack use limit. */
+    modlua_runtime_slot_t      *slots;       /**< All slots ever created. */
+};
+
+/**
+ * Return the runtime in @a slot, if any, to the pool.
+ *
+ * The caller must hold the cache lock.
+ *
+ * @param[in] slot The slot to empty.
+ *
+ * @returns Status code of ib_resource_release().
+ */
+static ib_status_t modlua_runtime_slot_empty(modlua_runtime_slot_t *slot)
+{
+    assert(slot != NULL);
+
+    modlua_runtime_t *runtime = slot->runtime;
+
+    /* The owning thread may take it first. */
+    if (
+        runtime == NULL ||
+        ! __sync_bool_compare_and_swap(&(slot->runtime), runtime, NULL)
+    ) {
+        return IB_OK;
+    }
+
+    return ib_resource_release(runtime->resource);
+}
+
+/**
+ * Return the runtimes in all slots of @a cache to the pool.
+ *
+ * The caller must hold the cache lock.
+ *
+ * @param[in] cache The cache to empty.
+ *
+ * @returns The first failure of ib_resource_release() or IB_OK.
+ */
+static ib_status_t modlua_runtime_cache_empty(modlua_runtime_cache_t *cache)
+{
+    assert(cache != NULL);
+
+    ib_status_t            rc = IB_OK;
+    modlua_runtime_slot_t *slot;
+
+    for (slot = cache->slots; slot != NULL; slot = slot->next) {
+        ib_status_t rc2 = modlua_runtime_slot_empty(slot);
+        if (rc == IB_OK) {
+            rc = rc2;
+        }
+    }
+
+    return rc;
+}
+
+/**
+ * Thread exit destructor for a @ref modlua_runtime_slot_t.
+ *
+ * The slot stays linked into its cache and is freed with it.
+ *
+ * @param[in] data The slot.
+ */
+static void modlua_runtime_slot_destroy(void *data)
+{
+    assert(data != NULL);
+
+    modlua_runtime_slot_t *slot = (modlua_runtime_slot_t *)data;
+
+    if (ib_lock_lock(slot->cache->lock) != IB_OK) {
+        return;
+    }
+    modlua_runtime_slot_empty(slot);
+    ib_lock_unlock(slot->cache->lock);
+}
+
+/**
+ * Fetch the calling thread's slot, creating it if need be.
+ *
+ * @param[in] cache The cache.
+ *
+ * @returns The slot or NULL on failure.
+ */
+static modlua_runtime_slot_t *modlua_runtime_slot_get(
+    modlua_runtime_cache_t *cache
+)
+{
+    assert(cache != NULL);
+
+    modlua_runtime_slot_t *slot = pthread_getspecific(cache->key);
+
+    if (slot != NULL) {
+        return slot;
+    }
+
+    slot = calloc(1, sizeof(*slot));
+    if (slot == NULL) {
+        return NULL;
+    }
+    slot->cache = cache;
+
+    if (pthread_setspecific(cache->key, slot) != 0) {
+        free(slot);
+        return NULL;
+    }
+
+    /* Link the slot so that it is freed with the cache. */
+    if (ib_lock_lock(cache->lock) != IB_OK) {
+        pthread_setspecific(cache->key, NULL);
+        free(slot);
+        return NULL;
+    }
+    slot->next = cache->slots;
+    cache->slots = slot;
+    ib_lock_unlock(cache->lock);
+
+    return slot;
+}
+
+/**
+ * Memory manager cleanup to destroy a @ref modlua_runtime_cache_t.
+ *
+ * @param[in] data The cache.
+ */
+static void modlua_runtime_cache_destroy(void *data)
+{
+    assert(data != NULL);
+
+    modlua_runtime_cache_t *cache = (modlua_runtime_cache_t *)data;
+    modlua_runtime_slot_t  *slot;
+
+    /* No more thread exit destructors after this. */
+    pthread_key_delete(cache->key);
+
+    modlua_runtime_cache_flush(cache);
+
+    slot = cache->slots;
+    while (slot != NULL) {
+        modlua_runtime_slot_t *next = slot->next;
+
+        free(slot);
+        slot = next;
+    }
+    cache->slots = NULL;
+}
+
+ib_status_t modlua_runtime_cache_create(
+    modlua_runtime_cache_t **cache,
+    ib_resource_pool_t      *resource_pool,
+    ib_lock_t               *lock,
+    modlua_runtime_cfg_t    *runtime_cfg,
+    ib_mm_t                  mm
+)
+{
+    assert(cache != NULL);
+    assert(resource_pool != NULL);
+    assert(lock != NULL);
+    assert(runtime_cfg != NULL);
+
+    ib_status_t             rc;
+    modlua_runtime_cache_t *tmp_cache;
+
+    tmp_cache = ib_mm_calloc(mm, 1, sizeof(*tmp_cache));
+    if (tmp_cache == NULL) {
+        return IB_EALLOC;
+    }
+
+    if (pthread_key_create(&(tmp_cache->key), modlua_runtime_slot_destroy)
+        != 0)
+    {
+        return IB_EUNKNOWN;
+    }
+
+    tmp_cache->pool        = resource_pool;
+    tmp_cache->lock        = lock;
+    tmp_cache->runtime_cfg = runtime_cfg;
+
+    rc = ib_mm_register_cleanup(mm, modlua_runtime_cache_destroy, tmp_cache);
+    if (rc != IB_OK) {
+        pthread_key_delete(tmp_cache->key);
+        return rc;
+    }
+
+    *cache = tmp_cache;
+
+    return IB_OK;
+}
+
+ib_status_t modlua_runtime_cache_flush(
+    modlua_runtime_cache_t *cache
+)
+{
+    assert(cache != NULL);
+
+    ib_status_t rc;
+
+    rc = ib_lock_lock(cache->lock);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    rc = modlua_runtime_cache_empty(cache);
+
+    ib_lock_unlock(cache->lock);
+
+    return rc;
+}
+
 ib_status_t modlua_releasestate(
     ib_engine_t      *ib,
     modlua_cfg_t     *cfg,
@@ -730,7 +961,23 @@ ib_status_t modlua_releasestate(
     assert(ib != NULL);
     assert(cfg != NULL);
 
-    ib_status_t rc;
+    ib_status_t             rc;
+    modlua_runtime_cache_t *cache = cfg->lua_cache;
+
+    /* Keep the runtime for this thread's next acquire unless it is due to
+     * be replaced or the thread already holds one. */
+    if (   (cache != NULL)
+        && (modlua_runtime->use_count <= cache->runtime_cfg->max_lua_stack_uses) )
+    {
+        modlua_runtime_slot_t *slot = modlua_runtime_slot_get(cache);
+
+        if (
+            (slot != NULL) &&
+            __sync_bool_compare_and_swap(&(slot->runtime), NULL, modlua_runtime)
+        ) {
+            return IB_OK;
+        }
+    }
 
     rc = ib_lock_lock(cfg->lua_pool_lock);
     if (rc != IB_OK) {
@@ -763,12 +1010,36 @@ ib_status_t modlua_acquirestate(
     ib_status_t    rc;
     ib_resource_t *resource;
 
+    /* Take this thread's cached runtime, if any, without locking. */
+    if (cfg->lua_cache != NULL) {
+        modlua_runtime_slot_t *slot =
+            pthread_getspecific(cfg->lua_cache->key);
+        modlua_runtime_t      *cached = (slot != NULL) ? slot->runtime : NULL;
+
+        if (
+            (cached != NULL) &&
+            __sync_bool_compare_and_swap(&(slot->runtime), cached, NULL)
+        ) {
+            *modlua_runtime = cached;
+
+            /* Count the use as the pool would have. */
+            lua_pool_preuse_fn(*modlua_runtime, NULL);
+            return IB_OK;
+        }
+    }
+
     rc = ib_lock_lock(cfg->lua_pool_lock);
     if (rc != IB_OK) {
         return rc;
     }
 
     rc = ib_resource_acquire(cfg->lua_pool, &resource);
+    if ( (rc == IB_DECLINED) && (cfg->lua_cache != NULL) ) {
+        /* Runtimes idle in the slots of other threads count toward
+         * LuaStackMax. Return them to the pool and try again. */
+        modlua_runtime_cache_empty(cfg->lua_cache);
+        rc = ib_resource_acquire(cfg->lua_pool, &resource);
+    }
     if (rc != IB_OK) {
         ib_lock_unlock(cfg->lua_pool_lock);
         return rc;
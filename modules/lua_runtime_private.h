@@ -123,6 +123,54 @@ ib_status_t modlua_runtime_resource_pool_create(
     modlua_runtime_cfg_t **cfg
 );
 
+/**
+ * Create a per-thread cache of runtimes in front of @a resource_pool.
+ *
+ * Each thread keeps the last runtime it released and takes it back on its
+ * next acquire without touching @a lock, so the same stack (and its
+ * compiled traces) stays with the thread. Only a miss, a runtime past its
+ * use limit, or a nested acquire goes to the shared pool.
+ *
+ * Cached runtimes are returned to the pool when their thread exits, when
+ * an acquire would otherwise be declined because the pool is at its
+ * maximum, and when @a mm is destroyed. The cache must be created after
+ * @a resource_pool so that it is torn down first.
+ *
+ * @param[out] cache The created cache.
+ * @param[in] resource_pool The pool runtimes are acquired from.
+ * @param[in] lock The lock guarding @a resource_pool.
+ * @param[in] runtime_cfg The pool's runtime configuration.
+ * @param[in] mm Memory manager whose lifetime bounds the cache.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC On allocation failure.
+ * - IB_EUNKNOWN If a thread key cannot be created.
+ */
+ib_status_t modlua_runtime_cache_create(
+    modlua_runtime_cache_t **cache,
+    ib_resource_pool_t      *resource_pool,
+    ib_lock_t               *lock,
+    modlua_runtime_cfg_t    *runtime_cfg,
+    ib_mm_t                  mm
+);
+
+/**
+ * Return all cached runtimes to the resource pool.
+ *
+ * This must only be called when no other thread is using Lua runtimes,
+ * such as before flushing the resource pool at the end of configuration.
+ *
+ * @param[in] cache The cache to empty.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - Other on failure to lock or release.
+ */
+ib_status_t modlua_runtime_cache_flush(
+    modlua_runtime_cache_t *cache
+);
+
 /**
  * Reload @a ctx and all parent contexts except the main context.
  *
@@ -211,6 +259,8 @@ ib_status_t modlua_releasestate(
 /**
  * Acquire a @ref modlua_runtime_t from the resource pool.
  *
+ * The calling thread's cached runtime is used if it has one.
+ *
  * @param[in] ib IronBee engine.
  * @param[in] cfg The module configuration.
  * @param[out] modlua_runtime The fetched runtime is placed here.
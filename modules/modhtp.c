@@ -27,6 +27,7 @@
 
 #include <ironbee/bytestr.h>
 #include <ironbee/cfgmap.h>
+#include <ironbee/config.h>
 #include <ironbee/context.h>
 #include <ironbee/engine.h>
 #include <ironbee/engine_state.h>
@@ -92,6 +93,8 @@ typedef struct modhtp_context_t modhtp_context_t;
  */
 struct modhtp_config_t {
     const char             *personality;        /**< libhtp personality */
+    ib_num_t                parsed_input;       /**< Trust server parsing? */
+    ib_num_t                alias_values;       /**< Alias libhtp values? */
     const modhtp_context_t *context;            /**< Module context data */
 
     /* NOTE: The following two fields are engine-level values
@@ -137,6 +140,7 @@ struct modhtp_txdata_t {
     int                         error_code;  /**< Error code from parser */
     const char                 *error_msg;   /**< Error message from parser */
     ib_flags_t                  flags;       /**< Various flags */
+    bstr                       *request_uri; /**< Normalized URI if aliased */
 };
 typedef struct modhtp_txdata_t modhtp_txdata_t;
 
@@ -167,6 +171,8 @@ typedef struct {
 /* Instantiate a module global configuration. */
 static modhtp_config_t modhtp_global_config = {
     "generic", /* personality */
+    0,         /* parsed_input */
+    0,         /* alias_values */
     NULL,
     NULL,
     NULL
@@ -191,6 +197,17 @@ static const char *indexed_keys[] = {
     NULL
 };
 
+/* Request headers libhtp acts on when the server supplies parsed input. */
+static const char *parsed_input_headers[] = {
+    "host",
+    "content-length",
+    "transfer-encoding",
+    "content-type",
+    "cookie",
+    "authorization",
+    NULL
+};
+
 /* -- Define several function types for callbacks */
 
 /**
@@ -496,6 +513,27 @@ static ib_status_t modhtp_check_htprc(
     return IB_OK;
 }
 
+/**
+ * libhtp allocation strategy for data handed to it from IronBee
+ *
+ * When values are aliased, IronBee transaction memory outlives the libhtp
+ * transaction, so libhtp can reference it instead of copying it.
+ *
+ * @param[in] txdata modhtp transaction data
+ *
+ * @returns HTP_ALLOC_REUSE or HTP_ALLOC_COPY
+ */
+static inline enum htp_alloc_strategy_t modhtp_alloc_strategy(
+    const modhtp_txdata_t *txdata)
+{
+    assert(txdata != NULL);
+
+    if (txdata->module_cfg->alias_values != 0) {
+        return HTP_ALLOC_REUSE;
+    }
+    return HTP_ALLOC_COPY;
+}
+
 /**
  * Set headers to libhtp
  *
@@ -504,6 +542,9 @@ static ib_status_t modhtp_check_htprc(
  * @param[in] txdata modhtp transaction data
  * @param[in] label Label for logging
  * @param[in] header The header to iterate
+ * @param[in] only NULL terminated list of lower case header names to send,
+ *                 or NULL to send all headers
+ * @param[in] alloc libhtp allocation strategy for names and values
  * @param[in] fn The callback function
  * @param[in] fname The name of @a fn
  *
@@ -515,6 +556,8 @@ static ib_status_t modhtp_set_header(
     const modhtp_txdata_t    *txdata,
     const char               *label,
     const ib_parsed_header_t *header,
+    const char              **only,
+    enum htp_alloc_strategy_t alloc,
     modhtp_set_header_fn_t    fn,
     const char               *fname
 )
@@ -532,6 +575,23 @@ static ib_status_t modhtp_set_header(
         size_t vlen = ib_bytestr_length(node->value);
         ib_status_t irc;
 
+        if (only != NULL) {
+            const char  *name = (const char *)ib_bytestr_const_ptr(node->name);
+            size_t       nlen = ib_bytestr_length(node->name);
+            const char **key;
+
+            for (key = only;  *key != NULL;  ++key) {
+                if ( (strlen(*key) == nlen) &&
+                     (strncasecmp(*key, name, nlen) == 0) )
+                {
+                    break;
+                }
+            }
+            if (*key == NULL) {
+                continue;
+            }
+        }
+
         if (value == NULL) {
             value = "";
             vlen = 0;
@@ -540,7 +600,7 @@ static ib_status_t modhtp_set_header(
                  (const char *)ib_bytestr_const_ptr(node->name),
                  ib_bytestr_length(node->name),
                  value, vlen,
-                 HTP_ALLOC_COPY);
+                 alloc);
         irc = modhtp_check_htprc(hrc, txdata, fname);
         if (irc != IB_OK) {
             return irc;
@@ -563,6 +623,7 @@ static ib_status_t modhtp_set_header(
  * @param[in] itx IronBee transaction
  * @param[in] label Label for logging
  * @param[in] force Set even if value already set
+ * @param[in] alias Alias @a htp_bstr rather than copy it
  * @param[in] htp_bstr HTP bstr to copy from
  * @param[in] fallback Fallback string (or NULL)
  * @param[in,out] ib_bstr Pointer to IronBee bytestring to fill
@@ -573,6 +634,7 @@ static inline ib_status_t modhtp_set_bytestr(
     const ib_tx_t          *itx,
     const char             *label,
     bool                    force,
+    bool                    alias,
     const bstr             *htp_bstr,
     const char             *fallback,
     ib_bytestr_t          **ib_bstr)
@@ -607,9 +669,18 @@ static inline ib_status_t modhtp_set_bytestr(
 
     /*
      * If the target bytestring is NULL, create it, otherwise
-     * append to the zero-length bytestring.
+     * append to the zero-length bytestring.  When aliasing, the libhtp
+     * transaction lives as long as the IronBee one, so point at its data.
      */
-    if (*ib_bstr == NULL) {
+    if (alias) {
+        if (*ib_bstr == NULL) {
+            rc = ib_bytestr_alias_mem(ib_bstr, itx->mm, ptr, len);
+        }
+        else {
+            rc = ib_bytestr_setv_const(*ib_bstr, ptr, len);
+        }
+    }
+    else if (*ib_bstr == NULL) {
         rc = ib_bytestr_dup_mem(ib_bstr, itx->mm, ptr, len);
     }
     else if (force) {
@@ -1420,6 +1491,7 @@ static int modhtp_htp_req_line(
     modhtp_txdata_t *txdata;
     ib_tx_t         *itx;
     ib_status_t      irc;
+    bool             alias;
     bool             force_path = false;
 
     /* Check the parser status */
@@ -1434,9 +1506,10 @@ static int modhtp_htp_req_line(
     txdata->flags |= txdata_req_line;
     itx = txdata->itx;
     htx = txdata->htx;
+    alias = (txdata->module_cfg->alias_values != 0);
 
     /* Store the request line if required */
-    irc = modhtp_set_bytestr(itx, "Request Line", false,
+    irc = modhtp_set_bytestr(itx, "Request Line", false, alias,
                              htx->request_line, NULL,
                              &(itx->request_line->raw));
     if ( (irc != IB_OK) && (irc != IB_ENOENT) ) {
@@ -1444,7 +1517,7 @@ static int modhtp_htp_req_line(
     }
 
     /* Store the request method */
-    irc = modhtp_set_bytestr(itx, "Request method", false,
+    irc = modhtp_set_bytestr(itx, "Request method", false, alias,
                              htx->request_method, NULL,
                              &(itx->request_line->method));
     if ( (irc != IB_OK) && (irc != IB_ENOENT) ) {
@@ -1452,7 +1525,7 @@ static int modhtp_htp_req_line(
     }
 
     /* Store the request URI */
-    irc = modhtp_set_bytestr(itx, "Request URI", false,
+    irc = modhtp_set_bytestr(itx, "Request URI", false, alias,
                              htx->request_uri, NULL,
                              &(itx->request_line->uri));
     if ( (irc != IB_OK) && (irc != IB_ENOENT) ) {
@@ -1460,7 +1533,7 @@ static int modhtp_htp_req_line(
     }
 
     /* Store the request protocol */
-    irc = modhtp_set_bytestr(itx, "Request protocol", false,
+    irc = modhtp_set_bytestr(itx, "Request protocol", false, alias,
                              htx->request_protocol, NULL,
                              &(itx->request_line->protocol));
     if ( (irc != IB_OK) && (irc != IB_ENOENT) ) {
@@ -1658,6 +1731,7 @@ static int modhtp_htp_rsp_line(
     modhtp_txdata_t *txdata;
     ib_tx_t         *itx;
     ib_status_t      irc;
+    bool             alias;
 
     /* Check the parser status */
     irc = modhtp_check_tx(htx, "Response Line", &txdata);
@@ -1671,9 +1745,10 @@ static int modhtp_htp_rsp_line(
     txdata->flags |= txdata_rsp_line;
     itx = txdata->itx;
     htx = txdata->htx;
+    alias = (txdata->module_cfg->alias_values != 0);
 
     /* Store the response protocol */
-    irc = modhtp_set_bytestr(itx, "Response protocol", false,
+    irc = modhtp_set_bytestr(itx, "Response protocol", false, alias,
                              htx->response_protocol, NULL,
                              &itx->response_line->protocol);
     if ( (irc != IB_OK) && (irc != IB_ENOENT) ) {
@@ -1681,7 +1756,7 @@ static int modhtp_htp_rsp_line(
     }
 
     /* Store the response status */
-    irc = modhtp_set_bytestr(itx, "Response status", false,
+    irc = modhtp_set_bytestr(itx, "Response status", false, alias,
                              htx->response_status, NULL,
                              &itx->response_line->status);
     if ( (irc != IB_OK) && (irc != IB_ENOENT) ) {
@@ -1689,7 +1764,7 @@ static int modhtp_htp_rsp_line(
     }
 
     /* Store the request URI */
-    irc = modhtp_set_bytestr(itx, "Response message", false,
+    irc = modhtp_set_bytestr(itx, "Response message", false, alias,
                              htx->response_message, NULL,
                              &itx->response_line->msg);
     if ( (irc != IB_OK) && (irc != IB_ENOENT) ) {
@@ -1898,7 +1973,7 @@ static ib_status_t modhtp_get_or_create_list(
  * @returns IronBee status code
  */
 static ib_status_t modhtp_gen_request_uri_fields(
-    const modhtp_txdata_t *txdata)
+    modhtp_txdata_t *txdata)
 {
     assert(txdata != NULL);
     assert(txdata->itx != NULL);
@@ -1916,6 +1991,14 @@ static ib_status_t modhtp_gen_request_uri_fields(
     if (uri == NULL) {
         ib_log_error_tx(itx, "Failed to generate normalized URI.");
     }
+    else if (txdata->module_cfg->alias_values != 0) {
+        /* Keep the URI until the transaction is destroyed. */
+        modhtp_field_gen_bstr(itx, "request_uri", uri, false, NULL);
+        if (txdata->request_uri != NULL) {
+            bstr_free(txdata->request_uri);
+        }
+        txdata->request_uri = uri;
+    }
     else {
         modhtp_field_gen_bstr(itx, "request_uri", uri, true, NULL);
         bstr_free(uri);
@@ -2000,8 +2083,17 @@ static ib_status_t modhtp_gen_request_header_fields(
     ib_tx_t     *itx = txdata->itx;
     htp_tx_t    *htx = txdata->htx;
 
-    modhtp_field_gen_bstr(itx, "request_line",
-                          htx->request_line, false, NULL);
+    /* With parsed input libhtp never sees the raw line; alias IronBee's. */
+    if ( (htx->request_line == NULL) && (itx->request_line != NULL) ) {
+        modhtp_field_gen_bytestr(itx, "request_line",
+                                 ib_bytestr_const_ptr(itx->request_line->raw),
+                                 ib_bytestr_length(itx->request_line->raw),
+                                 false, NULL);
+    }
+    else {
+        modhtp_field_gen_bstr(itx, "request_line",
+                              htx->request_line, false, NULL);
+    }
 
     modhtp_field_gen_bytestr(itx, "request_host",
                              IB_S2SL(itx->hostname == NULL ? "" : itx->hostname),
@@ -2195,10 +2287,53 @@ static ib_status_t modhtp_build_context (
 static void modhtp_connp_cleanup(void *cbdata)
 {
     htp_connp_t *parser = (htp_connp_t *)cbdata;
+    htp_conn_t  *conn = htp_connp_get_connection(parser);
+
+    /* Transactions still held by IronBee transactions (see
+     * modhtp_tx_cleanup()) are destroyed with the parser; let go of them. */
+    if ( (conn != NULL) && (conn->transactions != NULL) ) {
+        for (size_t i = 0, n = htp_list_size(conn->transactions); i < n; ++i) {
+            htp_tx_t        *htx = htp_list_get(conn->transactions, i);
+            modhtp_txdata_t *txdata;
+
+            if (htx == NULL) {
+                continue;
+            }
+            txdata = htp_tx_get_user_data(htx);
+            if (txdata != NULL) {
+                txdata->htx = NULL;
+            }
+        }
+    }
 
     htp_connp_destroy_all(parser);
 }
 
+/**
+ * Destroy a libhtp transaction along with its IronBee transaction
+ *
+ * Used when values are aliased into libhtp memory.
+ *
+ * @param[in] cbdata Transaction data
+ */
+static void modhtp_tx_cleanup(void *cbdata)
+{
+    modhtp_txdata_t *txdata = (modhtp_txdata_t *)cbdata;
+
+    if (txdata->request_uri != NULL) {
+        bstr_free(txdata->request_uri);
+        txdata->request_uri = NULL;
+    }
+
+    if (txdata->htx != NULL) {
+        htp_tx_t *htx = txdata->htx;
+
+        txdata->htx = NULL;
+        htp_tx_set_user_data(htx, NULL);
+        htp_tx_destroy(htx);
+    }
+}
+
 /**
  * Connection Init Hook
  *
@@ -2437,6 +2572,16 @@ ib_status_t modhtp_tx_started(
         return irc;
     }
 
+    /* Aliased values must outlive tx_finished; keep the libhtp
+     * transaction until the IronBee one is destroyed. */
+    if (config->alias_values != 0) {
+        irc = ib_mm_register_cleanup(itx->mm, modhtp_tx_cleanup, txdata);
+        if (irc != IB_OK) {
+            ib_log_error_tx(itx, "Failed to register HTP transaction cleanup.");
+            return irc;
+        }
+    }
+
     /* Start the request */
     hrc = htp_tx_state_request_start(txdata->htx);
     return modhtp_check_htprc(hrc, txdata, "htp_tx_state_request_start()");
@@ -2476,6 +2621,12 @@ ib_status_t modhtp_tx_finished(
     /* Reset libhtp connection parser. */
     htp_connp_clear_error(txdata->parser_data->parser);
 
+    /* Aliased values still point into the transaction; modhtp_tx_cleanup()
+     * destroys it with the IronBee transaction. */
+    if (txdata->module_cfg->alias_values != 0) {
+        return IB_OK;
+    }
+
     /* Remove references to the txdata which is associated with the IB tx */
     txdata->htx = NULL;
     htp_tx_set_user_data(htx, NULL);
@@ -2486,6 +2637,69 @@ ib_status_t modhtp_tx_finished(
     return IB_OK;
 }
 
+/**
+ * Hand a server parsed request line to libhtp without re-parsing it
+ *
+ * The method, URI and protocol are aliased from IronBee transaction memory,
+ * which outlives the libhtp transaction.
+ *
+ * @param[in] txdata Transaction data
+ * @param[in] line The parsed request line
+ *
+ * @returns Status code
+ */
+static ib_status_t modhtp_set_parsed_req_line(
+    const modhtp_txdata_t      *txdata,
+    const ib_parsed_req_line_t *line)
+{
+    assert(txdata != NULL);
+    assert(line != NULL);
+
+    htp_tx_t     *htx = txdata->htx;
+    htp_status_t  hrc;
+    ib_status_t   irc;
+
+    hrc = htp_tx_req_set_method(htx,
+                                (const char *)ib_bytestr_const_ptr(line->method),
+                                ib_bytestr_length(line->method),
+                                HTP_ALLOC_REUSE);
+    irc = modhtp_check_htprc(hrc, txdata, "htp_tx_req_set_method");
+    if (irc != IB_OK) {
+        return irc;
+    }
+    htp_tx_req_set_method_number(
+        htx, htp_convert_method_to_number(htx->request_method));
+
+    hrc = htp_tx_req_set_uri(htx,
+                             (const char *)ib_bytestr_const_ptr(line->uri),
+                             ib_bytestr_length(line->uri),
+                             HTP_ALLOC_REUSE);
+    irc = modhtp_check_htprc(hrc, txdata, "htp_tx_req_set_uri");
+    if (irc != IB_OK) {
+        return irc;
+    }
+
+    /* No protocol means HTTP/0.9, as libhtp's own line parser decides. */
+    if (ib_bytestr_length(line->protocol) == 0) {
+        htp_tx_req_set_protocol_0_9(htx, 1);
+        htp_tx_req_set_protocol_number(htx, HTP_PROTOCOL_0_9);
+        return IB_OK;
+    }
+
+    hrc = htp_tx_req_set_protocol(htx,
+                                  (const char *)ib_bytestr_const_ptr(line->protocol),
+                                  ib_bytestr_length(line->protocol),
+                                  HTP_ALLOC_REUSE);
+    irc = modhtp_check_htprc(hrc, txdata, "htp_tx_req_set_protocol");
+    if (irc != IB_OK) {
+        return irc;
+    }
+    htp_tx_req_set_protocol_number(
+        htx, htp_parse_protocol(htx->request_protocol));
+
+    return IB_OK;
+}
+
 /**
  * Request Start Hook
  *
@@ -2527,12 +2741,21 @@ ib_status_t modhtp_request_started(
                     (int)ib_bytestr_length(line->raw),
                     (const char *)ib_bytestr_const_ptr(line->raw));
 
-    /* Hand the whole request line to libhtp */
-    hrc = htp_tx_req_set_line(txdata->htx,
-                              (const char *)ib_bytestr_const_ptr(line->raw),
-                              ib_bytestr_length(line->raw),
-                              HTP_ALLOC_COPY);
-    irc = modhtp_check_htprc(hrc, txdata, "htp_tx_req_set_line");
+    /* Use the server's parse of the line if it supplied one, otherwise
+     * hand the whole request line to libhtp. */
+    if ( (txdata->module_cfg->parsed_input != 0) &&
+         (ib_bytestr_length(line->method) != 0) &&
+         (ib_bytestr_length(line->uri) != 0) )
+    {
+        irc = modhtp_set_parsed_req_line(txdata, line);
+    }
+    else {
+        hrc = htp_tx_req_set_line(txdata->htx,
+                                  (const char *)ib_bytestr_const_ptr(line->raw),
+                                  ib_bytestr_length(line->raw),
+                                  modhtp_alloc_strategy(txdata));
+        irc = modhtp_check_htprc(hrc, txdata, "htp_tx_req_set_line");
+    }
     if (irc != IB_OK) {
         return irc;
     }
@@ -2583,11 +2806,23 @@ ib_status_t modhtp_request_header_data(
     /* Fetch the transaction data */
     txdata = modhtp_get_txdata_ibtx(m, itx);
 
-    ib_log_debug_tx(itx, "Sending request header data to LibHTP.");
-
-    /* Hand the headers off to libhtp */
-    irc = modhtp_set_header(txdata, "request", header,
-                            htp_tx_req_set_header, "htp_tx_req_set_header");
+    /* The server has already parsed the headers and IronBee builds
+     * REQUEST_HEADERS from them, so libhtp only needs to see the few it
+     * acts on, aliased rather than copied. */
+    if (txdata->module_cfg->parsed_input != 0) {
+        ib_log_debug_tx(itx, "Sending parsed request headers to LibHTP.");
+        irc = modhtp_set_header(txdata, "request", header,
+                                parsed_input_headers, HTP_ALLOC_REUSE,
+                                htp_tx_req_set_header,
+                                "htp_tx_req_set_header");
+    }
+    else {
+        ib_log_debug_tx(itx, "Sending request header data to LibHTP.");
+        irc = modhtp_set_header(txdata, "request", header,
+                                NULL, modhtp_alloc_strategy(txdata),
+                                htp_tx_req_set_header,
+                                "htp_tx_req_set_header");
+    }
     if (irc != IB_OK) {
         return irc;
     }
@@ -2844,7 +3079,7 @@ ib_status_t modhtp_response_started(
         htx,
         (const char *)ib_bytestr_const_ptr(line->raw),
         ib_bytestr_length(line->raw),
-        HTP_ALLOC_COPY);
+        modhtp_alloc_strategy(txdata));
     irc = modhtp_check_htprc(hrc, txdata, "htp_tx_res_set_status_line");
     if (irc != IB_OK) {
         return irc;
@@ -2899,6 +3134,7 @@ ib_status_t modhtp_response_header_data(
 
     /* Hand the response headers off to libhtp */
     return modhtp_set_header(txdata, "response", header,
+                             NULL, modhtp_alloc_strategy(txdata),
                              htp_tx_res_set_header, "htp_tx_res_set_header");
 }
 
@@ -3332,9 +3568,81 @@ static IB_CFGMAP_INIT_STRUCTURE(modhtp_config_map) = {
         modhtp_config_t,
         personality
     ),
+    IB_CFGMAP_INIT_ENTRY(
+        MODULE_NAME_STR ".parsed_input",
+        IB_FTYPE_NUM,
+        modhtp_config_t,
+        parsed_input
+    ),
+    IB_CFGMAP_INIT_ENTRY(
+        MODULE_NAME_STR ".alias_values",
+        IB_FTYPE_NUM,
+        modhtp_config_t,
+        alias_values
+    ),
     IB_CFGMAP_INIT_LAST
 };
 
+/**
+ * Handle the HtpParsedInput and HtpAliasValues directives
+ *
+ * @param[in] cp Configuration parser
+ * @param[in] name Directive name
+ * @param[in] onoff On/Off value
+ * @param[in] cbdata Callback data (unused)
+ *
+ * @returns Status code
+ */
+static ib_status_t modhtp_dir_onoff(
+    ib_cfgparser_t *cp,
+    const char     *name,
+    int             onoff,
+    void           *cbdata)
+{
+    assert(cp != NULL);
+    assert(name != NULL);
+
+    ib_context_t *ctx = cp->cur_ctx ? cp->cur_ctx : ib_context_main(cp->ib);
+    const char   *pname;
+    ib_status_t   rc;
+
+    if (strcasecmp("HtpParsedInput", name) == 0) {
+        pname = MODULE_NAME_STR ".parsed_input";
+    }
+    else if (strcasecmp("HtpAliasValues", name) == 0) {
+        pname = MODULE_NAME_STR ".alias_values";
+    }
+    else {
+        ib_cfg_log_error(cp, "Unhandled directive \"%s\"", name);
+        return IB_EINVAL;
+    }
+
+    rc = ib_context_set_num(ctx, pname, onoff);
+    if (rc != IB_OK) {
+        ib_cfg_log_error(cp, "Error setting \"%s\" to %s: %s",
+                         name, onoff ? "On" : "Off",
+                         ib_status_to_string(rc));
+    }
+    return rc;
+}
+
+/**
+ * Directive map
+ */
+static IB_DIRMAP_INIT_STRUCTURE(modhtp_directive_map) = {
+    IB_DIRMAP_INIT_ONOFF(
+        "HtpParsedInput",
+        modhtp_dir_onoff,
+        NULL
+    ),
+    IB_DIRMAP_INIT_ONOFF(
+        "HtpAliasValues",
+        modhtp_dir_onoff,
+        NULL
+    ),
+    IB_DIRMAP_INIT_LAST
+};
+
 /**
  * Module structure.
  *
@@ -3345,7 +3653,7 @@ IB_MODULE_INIT(
     MODULE_NAME_STR,                         /**< Module name */
     IB_MODULE_CONFIG(&modhtp_global_config), /**< Global config data */
     modhtp_config_map,                       /**< Configuration field map */
-    NULL,                                    /**< Config directive map */
+    modhtp_directive_map,                    /**< Config directive map */
     modhtp_init,                             /**< Initialize function */
     NULL,                                    /**< Callback data */
     NULL,                                    /**< Finish function */
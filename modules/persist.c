@@ -29,6 +29,8 @@
 #include <ironbee/json.h>
 #include <ironbee/kvstore.h>
 #include <ironbee/kvstore_filesystem.h>
+#include <ironbee/kvstore_log.h>
+#include <ironbee/kvstore_shm.h>
 #include <ironbee/list.h>
 #include <ironbee/mm.h>
 #include <ironbee/module.h>
@@ -40,6 +42,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <inttypes.h>
+#include <stdlib.h>
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/types.h>
@@ -48,6 +51,8 @@
 static const ib_num_t DEFAULT_EXPIRATION = 60;
 
 static const char FILE_URI_PREFIX[] = "persist-fs://";
+static const char SHM_URI_PREFIX[] = "persist-shm://";
+static const char LOG_URI_PREFIX[] = "persist-log://";
 static const char JSON_TYPE[] = "application_json";
 
 /* Define the module name as well as a string version of it. */
@@ -132,6 +137,9 @@ ib_status_t file_rw_create_fn(
     const ib_list_node_t *node;
     const char           *uri;
     file_rw_t            *file_rw;
+    size_t                slots = 0;
+    size_t                slot_size = 0;
+    bool                  sync = false;
     ib_status_t           rc;
 
     file_rw = ib_mm_calloc(mm, 1, sizeof(*file_rw));
@@ -172,6 +180,21 @@ ib_status_t file_rw_create_fn(
                 return IB_EALLOC;
             }
         }
+
+        val = get_val("slots=", opt);
+        if (val != NULL) {
+            slots = strtoul(val, NULL, 10);
+        }
+
+        val = get_val("slot_size=", opt);
+        if (val != NULL) {
+            slot_size = strtoul(val, NULL, 10);
+        }
+
+        val = get_val("sync=", opt);
+        if (val != NULL) {
+            sync = (strcmp(val, "true") == 0 || strcmp(val, "1") == 0);
+        }
     }
 
     file_rw->kvstore = ib_mm_alloc(mm, ib_kvstore_size());
@@ -192,6 +215,40 @@ ib_status_t file_rw_create_fn(
             return rc;
         }
     }
+    else if (strncmp(uri, SHM_URI_PREFIX, sizeof(SHM_URI_PREFIX)-1) == 0) {
+        const char *path = uri + sizeof(SHM_URI_PREFIX)-1;
+        ib_log_debug(ib, "Creating shared memory key-value store: %s", path);
+
+        rc = ib_kvstore_shm_init(file_rw->kvstore, path, slots, slot_size);
+        if (rc != IB_OK) {
+            ib_log_error(ib, "Failed to initialize kvstore.");
+            return rc;
+        }
+
+        rc = ib_kvstore_connect(file_rw->kvstore);
+        if (rc != IB_OK) {
+            ib_log_error(ib, "Failed to connect to kvstore.");
+            return rc;
+        }
+    }
+    else if (strncmp(uri, LOG_URI_PREFIX, sizeof(LOG_URI_PREFIX)-1) == 0) {
+        const char *dir = uri + sizeof(LOG_URI_PREFIX)-1;
+        ib_log_debug(ib, "Creating log key-value store in: %s", dir);
+
+        rc = ib_kvstore_log_init(file_rw->kvstore, dir);
+        if (rc != IB_OK) {
+            ib_log_error(ib, "Failed to initialize kvstore.");
+            return rc;
+        }
+        ib_kvstore_log_set_sync(file_rw->kvstore, sync);
+
+        /* The log itself is opened on first use, after any fork. */
+        rc = ib_kvstore_connect(file_rw->kvstore);
+        if (rc != IB_OK) {
+            ib_log_error(ib, "Failed to connect to kvstore.");
+            return rc;
+        }
+    }
     else {
         ib_log_error(ib, "Unsupported URI: %s", uri);
         return IB_EINVAL;
@@ -73,4 +73,121 @@ class TestModHTP < CLIPPTest::TestCase
     assert_log_match 'REQ - HOST_MISSING=1'
     assert_log_match 'RESP - HOST_MISSING=1'
   end
+
+  # Run the same transactions with HtpParsedInput set to _parsed_ and
+  # return the announced request_uri, ARGS, cookies and request flags.
+  def htp_parsed_input_fields(parsed)
+    clipp(
+      modules: %w[ htp ],
+      config: "HtpParsedInput #{parsed}",
+      default_site_config: '''
+        Rule request_uri       @nop "" id:1 rev:1 phase:LOGGING "clipp_announce:URI - %{FIELD}"
+        Rule ARGS              @nop "" id:2 rev:1 phase:LOGGING "clipp_announce:ARGS - %{FIELD_NAME}=%{FIELD}"
+        Rule request_cookies   @nop "" id:3 rev:1 phase:LOGGING "clipp_announce:COOKIE - %{FIELD_NAME}=%{FIELD}"
+        Rule HTP_REQUEST_FLAGS @nop "" id:4 rev:1 phase:LOGGING "clipp_announce:FLAGS - %{FIELD_NAME}=%{FIELD}"
+      '''
+    ) do
+      transaction do |t|
+        t.request(
+          raw: "GET /a/../b%2Fc?x=1&y=%41 HTTP/1.1",
+          headers: {
+            Host: 'www.myh/ost.com',
+            Cookie: 'c1=v1; c2=v2'
+          }
+        )
+        t.response(raw: "HTTP/1.1 200 OK")
+      end
+      transaction do |t|
+        t.request(
+          raw: "POST /form?q=z HTTP/1.1",
+          headers: {
+            Host: 'www.myhost.com',
+            'Content-Type' => 'application/x-www-form-urlencoded',
+            'Content-Length' => '7'
+          },
+          body: "p=1&r=2"
+        )
+        t.response(raw: "HTTP/1.1 200 OK")
+      end
+    end
+
+    assert_no_issues
+    log.scan(/CLIPP ANNOUNCE: ((?:URI|ARGS|COOKIE|FLAGS) - .*)$/).flatten
+  end
+
+  def test_modhtp_parsed_input_matches_raw
+    off = htp_parsed_input_fields('Off')
+    on  = htp_parsed_input_fields('On')
+
+    assert_equal(off, on)
+    assert_equal(2, off.grep(/^URI - /).size)
+    assert(off.include?('ARGS - x=1'))
+    assert(off.include?('ARGS - y=A'))
+    assert(off.include?('ARGS - q=z'))
+    assert(off.include?('ARGS - p=1'))
+    assert(off.include?('ARGS - r=2'))
+    assert(off.include?('COOKIE - c1=v1'))
+    assert(off.include?('COOKIE - c2=v2'))
+    assert(off.include?('FLAGS - HOSTH_INVALID=1'))
+  end
+
+  def test_modhtp_parsed_input_invalid_authorization
+    clipp(
+      modules: %w[ htp ],
+      config: "HtpParsedInput On",
+      default_site_config: '''
+        Rule HTP_REQUEST_FLAGS @eq "1" id:1 rev:1 phase:LOGGING "clipp_announce:REQ - %{FIELD_NAME}=%{FIELD}"
+      '''
+    ) do
+      transaction do |t|
+        # "foo" has no colon separating a user name and password.
+        t.request(
+          raw: "GET / HTTP/1.1",
+          headers: { Host: 'www.myhost.com', Authorization: 'Basic Zm9v' }
+        )
+        t.response(raw: "HTTP/1.1 200 OK")
+      end
+    end
+
+    assert_no_issues
+    assert_log_match 'REQ - AUTH_INVALID=1'
+  end
+
+  def test_modhtp_alias_values
+    clipp(
+      modules: %w[ htp ],
+      config: "HtpAliasValues On",
+      default_site_config: '''
+        Rule ARGS            @nop "" id:1 rev:1 phase:LOGGING "clipp_announce:ARGS - %{FIELD_NAME}=%{FIELD}"
+        Rule REQUEST_HEADERS @nop "" id:2 rev:1 phase:LOGGING "clipp_announce:HEADER - %{FIELD_NAME}=%{FIELD}"
+        Rule request_line    @nop "" id:3 rev:1 phase:LOGGING "clipp_announce:LINE - %{FIELD}"
+        Rule request_line    @nop "" id:4 rev:1 phase:REQUEST "clipp_announce:OPEN LINE - %{FIELD}"
+      '''
+    ) do
+      connection do |c|
+        c.transaction do |t|
+          t.request(
+            raw: "GET /a?x=1&y=2 HTTP/1.1",
+            headers: { Host: 'www.myhost.com', 'X-Test' => 'value' }
+          )
+          t.response(raw: "HTTP/1.1 200 OK")
+        end
+        # The connection closes while this transaction is still open.
+        c.transaction do |t|
+          t.request(
+            raw: "GET /open?z=3 HTTP/1.1",
+            headers: { Host: 'www.myhost.com' }
+          )
+        end
+      end
+    end
+
+    assert_no_issues
+    assert_log_match 'ARGS - x=1'
+    assert_log_match 'ARGS - y=2'
+    assert_log_match 'HEADER - Host=www.myhost.com'
+    assert_log_match 'HEADER - X-Test=value'
+    assert_log_match 'LINE - GET /a?x=1&y=2 HTTP/1.1'
+    assert_log_match 'OPEN LINE - GET /open?z=3 HTTP/1.1'
+  end
 end
\ No newline at end of file
@@ -0,0 +1,166 @@
+//////////////////////////////////////////////////////////////////////////////
+// Licensed to Qualys, Inc. (QUALYS) under one or more
+// contributor license agreements.  See the NOTICE file distributed with
+// this work for additional information regarding copyright ownership.
+// QUALYS licenses this file to You under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////
+/// @file
+/// @brief IronBee --- Lua runtime cache tests
+//////////////////////////////////////////////////////////////////////////////
+
+#include "gtest/gtest.h"
+#include "base_fixture.h"
+
+#include "lua_private.h"
+#include "lua_runtime_private.h"
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include <sstream>
+
+namespace {
+
+//! Acquire and release a runtime, storing the runtime in @a runtime.
+void acquire_release(
+    ib_engine_t       *ib,
+    modlua_cfg_t      *cfg,
+    modlua_runtime_t **runtime,
+    ib_status_t       *rc
+)
+{
+    *rc = modlua_acquirestate(ib, cfg, runtime);
+    if (*rc == IB_OK) {
+        *rc = modlua_releasestate(ib, cfg, *runtime);
+    }
+}
+
+//! As acquire_release(), then wait twice on @a barrier before exiting.
+void acquire_release_wait(
+    ib_engine_t       *ib,
+    modlua_cfg_t      *cfg,
+    modlua_runtime_t **runtime,
+    ib_status_t       *rc,
+    boost::barrier    *barrier
+)
+{
+    acquire_release(ib, cfg, runtime, rc);
+    barrier->wait();
+    barrier->wait();
+}
+
+}
+
+class LuaRuntime : public BaseFixture
+{
+public:
+    //! Configure the Lua module with at most @a max stacks.
+    void configure(int max)
+    {
+        std::ostringstream config;
+
+        config
+            << "LogLevel    info\n"
+            << "LoadModule  ibmod_lua.so\n"
+            << "LuaStackMin 1\n"
+            << "LuaStackMax " << max << "\n"
+            << "SensorId    B9C1B52B-C24A-4309-B9F9-0EF4CD577A3E\n"
+            << "<Site test-site>\n"
+            << "    SiteId AAAABBBB-1111-2222-3333-000000000000\n"
+            << "    Hostname somesite.com\n"
+            << "</Site>\n";
+        configureIronBeeByString(config.str());
+
+        ASSERT_EQ(
+            IB_OK,
+            modlua_cfg_get(ib_engine, ib_context_main(ib_engine), &m_cfg));
+    }
+
+    modlua_cfg_t *m_cfg;
+};
+
+TEST_F(LuaRuntime, SlotReuse)
+{
+    modlua_runtime_t *runtime1;
+    modlua_runtime_t *runtime2;
+    ssize_t           uses;
+
+    configure(2);
+
+    ASSERT_EQ(IB_OK, modlua_acquirestate(ib_engine, m_cfg, &runtime1));
+    uses = runtime1->use_count;
+    ASSERT_EQ(IB_OK, modlua_releasestate(ib_engine, m_cfg, runtime1));
+
+    /* The released runtime waits in this thread's slot. */
+    ASSERT_EQ(IB_OK, modlua_acquirestate(ib_engine, m_cfg, &runtime2));
+    EXPECT_EQ(runtime1, runtime2);
+    EXPECT_EQ(uses + 1, runtime2->use_count);
+
+    /* A nested acquire finds the slot empty and uses the pool. */
+    ASSERT_EQ(IB_OK, modlua_acquirestate(ib_engine, m_cfg, &runtime1));
+    EXPECT_NE(runtime1, runtime2);
+    ASSERT_EQ(IB_OK, modlua_releasestate(ib_engine, m_cfg, runtime1));
+    ASSERT_EQ(IB_OK, modlua_releasestate(ib_engine, m_cfg, runtime2));
+}
+
+TEST_F(LuaRuntime, ReclaimOnDecline)
+{
+    modlua_runtime_t *cached = NULL;
+    modlua_runtime_t *runtime;
+    ib_status_t       rc = IB_EUNKNOWN;
+    boost::barrier    barrier(2);
+
+    configure(1);
+
+    /* Another thread keeps the only runtime in its slot. */
+    boost::thread other(
+        boost::bind(
+            acquire_release_wait, ib_engine, m_cfg, &cached, &rc, &barrier));
+    barrier.wait();
+    EXPECT_EQ(IB_OK, rc);
+
+    /* The pool declines, so the runtime is taken from the other slot. */
+    EXPECT_EQ(IB_OK, modlua_acquirestate(ib_engine, m_cfg, &runtime));
+    EXPECT_EQ(cached, runtime);
+    EXPECT_EQ(IB_OK, modlua_releasestate(ib_engine, m_cfg, runtime));
+
+    barrier.wait();
+    other.join();
+}
+
+TEST_F(LuaRuntime, ReturnedOnThreadExit)
+{
+    modlua_runtime_t *cached = NULL;
+    ib_resource_t    *resource;
+    ib_status_t       rc = IB_EUNKNOWN;
+
+    configure(1);
+
+    boost::thread other(
+        boost::bind(acquire_release, ib_engine, m_cfg, &cached, &rc));
+    other.join();
+    ASSERT_EQ(IB_OK, rc);
+
+    /* The exited thread's runtime is back in the pool itself. */
+    ASSERT_EQ(IB_OK, ib_lock_lock(m_cfg->lua_pool_lock));
+    rc = ib_resource_acquire(m_cfg->lua_pool, &resource);
+    ib_lock_unlock(m_cfg->lua_pool_lock);
+    ASSERT_EQ(IB_OK, rc);
+    EXPECT_EQ(cached, ib_resource_get(resource));
+
+    ASSERT_EQ(IB_OK, ib_lock_lock(m_cfg->lua_pool_lock));
+    ib_resource_release(resource);
+    ib_lock_unlock(m_cfg->lua_pool_lock);
+}
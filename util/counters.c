@@ -0,0 +1,316 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronBee --- Per-Thread Counters Implementation
+ */
+
+#include "ironbee_config_auto.h"
+
+#include <ironbee/counters.h>
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Alignment of thread counters so that no two threads share a cache line.
+ */
+#define IB_COUNTERS_ALIGN 64
+
+/** See struct ib_counters_thread_t */
+typedef struct ib_counters_thread_t ib_counters_thread_t;
+
+/**
+ * Counters of a single thread.
+ *
+ * Only the owning thread writes @a values.  ib_counters_get() reads them
+ * without synchronization.
+ */
+struct ib_counters_thread_t {
+    ib_counters_t        *owner; /**< Set these counters belong to. */
+    ib_counters_thread_t *prev;  /**< Previous thread in the registry. */
+    ib_counters_thread_t *next;  /**< Next thread in the registry. */
+    volatile int64_t      values[]; /**< One value per counter. */
+};
+
+struct ib_counters_t {
+    size_t                num;     /**< Number of counters. */
+    pthread_key_t         key;     /**< Thread ib_counters_thread_t. */
+    pthread_mutex_t       lock;    /**< Protects @a threads and @a retired. */
+    ib_counters_thread_t *threads; /**< Registry of thread counters. */
+    int64_t              *retired; /**< Sums of exited threads. */
+};
+
+/**
+ * Thread specific data destructor.
+ *
+ * Folds the counters of the exiting thread into ib_counters_t::retired.
+ *
+ * @param[in] data The ib_counters_thread_t of the exiting thread.
+ */
+static void counters_thread_exit(void *data)
+{
+    assert(data != NULL);
+
+    ib_counters_thread_t *thread = (ib_counters_thread_t *)data;
+    ib_counters_t        *counters = thread->owner;
+
+    pthread_mutex_lock(&(counters->lock));
+    for (size_t i = 0; i < counters->num; ++i) {
+        counters->retired[i] += thread->values[i];
+    }
+    if (thread->prev != NULL) {
+        thread->prev->next = thread->next;
+    }
+    else {
+        counters->threads = thread->next;
+    }
+    if (thread->next != NULL) {
+        thread->next->prev = thread->prev;
+    }
+    pthread_mutex_unlock(&(counters->lock));
+
+    free(thread);
+}
+
+/**
+ * Create and register the counters of the calling thread.
+ *
+ * @param[in] counters The counter set.
+ *
+ * @returns The thread counters or NULL on allocation failure.
+ */
+static ib_counters_thread_t *counters_thread_create(ib_counters_t *counters)
+{
+    assert(counters != NULL);
+
+    ib_counters_thread_t *thread;
+    void                 *mem;
+    size_t                size;
+
+    size = sizeof(*thread) + counters->num * sizeof(int64_t);
+    size = (size + IB_COUNTERS_ALIGN - 1) & ~(size_t)(IB_COUNTERS_ALIGN - 1);
+    if (posix_memalign(&mem, IB_COUNTERS_ALIGN, size) != 0) {
+        return NULL;
+    }
+    memset(mem, 0, size);
+    thread = (ib_counters_thread_t *)mem;
+    thread->owner = counters;
+
+    if (pthread_setspecific(counters->key, thread) != 0) {
+        free(thread);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&(counters->lock));
+    thread->next = counters->threads;
+    if (thread->next != NULL) {
+        thread->next->prev = thread;
+    }
+    counters->threads = thread;
+    pthread_mutex_unlock(&(counters->lock));
+
+    return thread;
+}
+
+/**
+ * Initialize the synchronization of a counter set.
+ *
+ * @param[in] counters The counter set with @a num and @a retired set.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EOTHER If the key or mutex cannot be created.
+ */
+static ib_status_t counters_init(ib_counters_t *counters)
+{
+    assert(counters != NULL);
+
+    if (pthread_mutex_init(&(counters->lock), NULL) != 0) {
+        return IB_EOTHER;
+    }
+    if (pthread_key_create(&(counters->key), counters_thread_exit) != 0) {
+        pthread_mutex_destroy(&(counters->lock));
+        return IB_EOTHER;
+    }
+    counters->threads = NULL;
+
+    return IB_OK;
+}
+
+/**
+ * Release everything but the memory of the counter set itself.
+ *
+ * @param[in] data The counter set.
+ */
+static void counters_fini(void *data)
+{
+    assert(data != NULL);
+
+    ib_counters_t *counters = (ib_counters_t *)data;
+
+    /* No thread destructors run once the key is gone. */
+    pthread_key_delete(counters->key);
+
+    while (counters->threads != NULL) {
+        ib_counters_thread_t *thread = counters->threads;
+
+        counters->threads = thread->next;
+        free(thread);
+    }
+
+    pthread_mutex_destroy(&(counters->lock));
+}
+
+ib_status_t ib_counters_create(
+    ib_counters_t **counters,
+    ib_mm_t         mm,
+    size_t          num_counters
+)
+{
+    assert(counters != NULL);
+
+    ib_counters_t *c;
+    ib_status_t    rc;
+
+    c = ib_mm_alloc(mm, sizeof(*c));
+    if (c == NULL) {
+        return IB_EALLOC;
+    }
+    c->num = num_counters;
+    c->retired = ib_mm_calloc(mm, num_counters, sizeof(*c->retired));
+    if (c->retired == NULL) {
+        return IB_EALLOC;
+    }
+
+    rc = counters_init(c);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    rc = ib_mm_register_cleanup(mm, counters_fini, c);
+    if (rc != IB_OK) {
+        counters_fini(c);
+        return IB_EOTHER;
+    }
+
+    *counters = c;
+
+    return IB_OK;
+}
+
+ib_status_t ib_counters_create_malloc(
+    ib_counters_t **counters,
+    size_t          num_counters
+)
+{
+    assert(counters != NULL);
+
+    ib_counters_t *c;
+    ib_status_t    rc;
+
+    c = malloc(sizeof(*c));
+    if (c == NULL) {
+        return IB_EALLOC;
+    }
+    c->num = num_counters;
+    /* Never zero sized so that NULL always means failure. */
+    c->retired = calloc(num_counters + 1, sizeof(*c->retired));
+    if (c->retired == NULL) {
+        free(c);
+        return IB_EALLOC;
+    }
+
+    rc = counters_init(c);
+    if (rc != IB_OK) {
+        free(c->retired);
+        free(c);
+        return rc;
+    }
+
+    *counters = c;
+
+    return IB_OK;
+}
+
+void ib_counters_destroy_malloc(
+    ib_counters_t *counters
+)
+{
+    if (counters == NULL) {
+        return;
+    }
+
+    counters_fini(counters);
+    free(counters->retired);
+    free(counters);
+}
+
+void ib_counters_add(
+    ib_counters_t *counters,
+    size_t         index,
+    int64_t        n
+)
+{
+    assert(counters != NULL);
+    assert(index < counters->num);
+
+    ib_counters_thread_t *thread = pthread_getspecific(counters->key);
+
+    if (thread == NULL) {
+        thread = counters_thread_create(counters);
+        if (thread == NULL) {
+            return;
+        }
+    }
+
+    thread->values[index] += n;
+}
+
+void ib_counters_get(
+    ib_counters_t *counters,
+    int64_t       *values
+)
+{
+    assert(counters != NULL);
+    assert(values != NULL);
+
+    pthread_mutex_lock(&(counters->lock));
+    memcpy(values, counters->retired, counters->num * sizeof(*values));
+    for (
+        const ib_counters_thread_t *thread = counters->threads;
+        thread != NULL;
+        thread = thread->next
+    ) {
+        for (size_t i = 0; i < counters->num; ++i) {
+            values[i] += thread->values[i];
+        }
+    }
+    pthread_mutex_unlock(&(counters->lock));
+}
+
+size_t ib_counters_size(
+    const ib_counters_t *counters
+)
+{
+    assert(counters != NULL);
+
+    return counters->num;
+}
@@ -32,6 +32,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <sys/types.h>
 
 /* Internal Declarations */
 
@@ -70,10 +71,25 @@ struct ib_hash_entry_t {
     ib_hash_entry_t     *next_entry;
 };
 
+/**
+ * Open addressing: hash value and key length of a slot.
+ *
+ * Kept apart from keys and values so that probing scans a dense array.
+ **/
+typedef struct ib_hash_tag_t ib_hash_tag_t;
+struct ib_hash_tag_t {
+    /** Hash of key, never 0; 0 if slot is empty. */
+    uint32_t             hash_value;
+    /** Length of key. */
+    uint32_t             key_length;
+};
+
 /**
  * External iterator for ib_hash_t.
  *
- * The end of the sequence is indicated by @c current_entry being NULL.
+ * For chained hashes, the end of the sequence is indicated by
+ * @c current_entry being NULL.  For open addressed hashes, @c slot_index is
+ * the current slot and the end is indicated by it passing the last slot.
  * Any iterator is invalidated by any mutating operation on the hash.
  **/
 struct ib_hash_iterator_t {
@@ -117,6 +133,22 @@ struct ib_hash_t {
     size_t               size;
     /** Randomizer value. */
     uint32_t             randomizer;
+
+    /**
+     * Open addressed?
+     *
+     * If true, entries are stored in @c tags, @c keys and @c values, each
+     * of @c max_slot + 1 elements, and @c slots and @c free are unused.
+     **/
+    bool                 open;
+    /** Open addressing: Compare key lengths before @c equal_predicate? */
+    bool                 length_equal;
+    /** Open addressing: Hash value and key length of each slot. */
+    ib_hash_tag_t       *tags;
+    /** Open addressing: Key of each slot. */
+    const char         **keys;
+    /** Open addressing: Value of each slot. */
+    void               **values;
 };
 
 /**
@@ -199,6 +231,67 @@ static char ib_hash_tolower(
     char c
 );
 
+/**
+ * Open addressing: Find slot of @a key in @a hash.
+ *
+ * @param[in] hash       Hash table.
+ * @param[in] key        Key.
+ * @param[in] key_length Length of @a key.
+ * @param[in] hash_value Tag hash value of @a key.
+ *
+ * @returns Index of slot holding @a key or -1 if not found.
+ */
+static ssize_t ib_hash_open_find(
+    const ib_hash_t *hash,
+    const char      *key,
+    size_t           key_length,
+    uint32_t         hash_value
+);
+
+/**
+ * Open addressing: Insert an entry known not to be in @a hash.
+ *
+ * Does not grow @a hash; there must be an empty slot.
+ *
+ * @param[in] hash       Hash table.
+ * @param[in] key        Key.
+ * @param[in] key_length Length of @a key.
+ * @param[in] hash_value Tag hash value of @a key.
+ * @param[in] value      Value.
+ */
+static void ib_hash_open_insert(
+    ib_hash_t  *hash,
+    const char *key,
+    uint32_t    key_length,
+    uint32_t    hash_value,
+    void       *value
+);
+
+/**
+ * Open addressing: Remove entry at slot @a index.
+ *
+ * Later entries of the probe sequence are shifted back to fill the slot, so
+ * no tombstones are needed.
+ *
+ * @param[in] hash  Hash table.
+ * @param[in] index Slot to remove.
+ */
+static void ib_hash_open_erase(
+    ib_hash_t *hash,
+    size_t     index
+);
+
+/**
+ * Open addressing: Double the number of slots in @a hash.
+ *
+ * @returns
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation failure.
+ */
+static ib_status_t ib_hash_open_grow(
+    ib_hash_t *hash
+);
+
 /* End Internal Declarations */
 
 /* Internal Definitions */
@@ -289,6 +382,9 @@ ib_hash_iterator_t *ib_hash_iterator_create_malloc()
 
 bool ib_hash_iterator_at_end(const ib_hash_iterator_t *iterator)
 {
+    if (iterator->hash->open) {
+        return iterator->slot_index > iterator->hash->max_slot;
+    }
     return iterator->current_entry == NULL;
 }
 
@@ -302,6 +398,16 @@ void ib_hash_iterator_first(
 
     memset(iterator, 0, sizeof(*iterator));
     iterator->hash = hash;
+    if (hash->open) {
+        /* Advance to the first occupied slot. */
+        while (
+            iterator->slot_index <= hash->max_slot &&
+            hash->tags[iterator->slot_index].hash_value == 0
+        ) {
+            ++iterator->slot_index;
+        }
+        return;
+    }
     ib_hash_iterator_next(iterator);
 }
 
@@ -314,6 +420,22 @@ void ib_hash_iterator_fetch(
 {
     assert(iterator != NULL);
 
+    if (iterator->hash->open) {
+        const ib_hash_t *hash = iterator->hash;
+        size_t           i    = iterator->slot_index;
+
+        if (key != NULL) {
+            *key            = hash->keys[i];
+        }
+        if (key_length != NULL) {
+            *key_length     = hash->tags[i].key_length;
+        }
+        if (value != NULL) {
+            *(void **)value = hash->values[i];
+        }
+        return;
+    }
+
     if (key != NULL) {
         *key            = iterator->current_entry->key;
     }
@@ -330,6 +452,18 @@ void ib_hash_iterator_next(
 ) {
     assert(iterator != NULL);
 
+    if (iterator->hash->open) {
+        const ib_hash_t *hash = iterator->hash;
+
+        do {
+            ++iterator->slot_index;
+        } while (
+            iterator->slot_index <= hash->max_slot &&
+            hash->tags[iterator->slot_index].hash_value == 0
+        );
+        return;
+    }
+
     iterator->current_entry = iterator->next_entry;
     while (! iterator->current_entry) {
         if (iterator->slot_index > iterator->hash->max_slot) {
@@ -437,6 +571,201 @@ static char ib_hash_tolower(
     return s_table[(unsigned char)c];
 }
 
+/**
+ * Open addressing: Tag hash value for hash value @a hash_value.
+ *
+ * 0 marks empty slots, so is mapped to 1.
+ */
+#define IB_HASH_OPEN_TAG(hash_value) ((hash_value) == 0 ? 1 : (hash_value))
+
+/**
+ * Open addressing: Distance of slot @a index from the home slot of
+ * @a hash_value.
+ */
+#define IB_HASH_OPEN_DISTANCE(hash, index, hash_value) \
+    (((index) - ((hash_value) & (hash)->max_slot)) & (hash)->max_slot)
+
+ssize_t ib_hash_open_find(
+    const ib_hash_t *hash,
+    const char      *key,
+    size_t           key_length,
+    uint32_t         hash_value
+)
+{
+    assert(hash != NULL);
+    assert(hash->open);
+    assert(key  != NULL);
+
+    size_t index = hash_value & hash->max_slot;
+
+    for (size_t distance = 0; ; ++distance) {
+        const ib_hash_tag_t *tag = &hash->tags[index];
+
+        /* An empty slot, or an entry closer to its home slot than we are to
+         * ours, ends the search: Robin Hood insertion would have placed
+         * the key before it. */
+        if (
+            tag->hash_value == 0 ||
+            IB_HASH_OPEN_DISTANCE(hash, index, tag->hash_value) < distance
+        ) {
+            return -1;
+        }
+        if (
+            tag->hash_value == hash_value &&
+            (! hash->length_equal || tag->key_length == key_length) &&
+            hash->equal_predicate(
+                key,               key_length,
+                hash->keys[index], tag->key_length,
+                hash->equal_cbdata
+            )
+        ) {
+            return index;
+        }
+        index = (index + 1) & hash->max_slot;
+    }
+}
+
+void ib_hash_open_insert(
+    ib_hash_t  *hash,
+    const char *key,
+    uint32_t    key_length,
+    uint32_t    hash_value,
+    void       *value
+)
+{
+    assert(hash != NULL);
+    assert(hash->open);
+    assert(hash->size <= hash->max_slot);
+
+    ib_hash_tag_t tag = { hash_value, key_length };
+    size_t        index = hash_value & hash->max_slot;
+
+    for (size_t distance = 0; ; ++distance) {
+        ib_hash_tag_t *slot_tag = &hash->tags[index];
+        size_t         slot_distance;
+
+        if (slot_tag->hash_value == 0) {
+            *slot_tag           = tag;
+            hash->keys[index]   = key;
+            hash->values[index] = value;
+            return;
+        }
+
+        /* Take the slot from entries closer to home than we are. */
+        slot_distance =
+            IB_HASH_OPEN_DISTANCE(hash, index, slot_tag->hash_value);
+        if (slot_distance < distance) {
+            ib_hash_tag_t  temp_tag   = *slot_tag;
+            const char    *temp_key   = hash->keys[index];
+            void          *temp_value = hash->values[index];
+
+            *slot_tag           = tag;
+            hash->keys[index]   = key;
+            hash->values[index] = value;
+
+            tag      = temp_tag;
+            key      = temp_key;
+            value    = temp_value;
+            distance = slot_distance;
+        }
+        index = (index + 1) & hash->max_slot;
+    }
+}
+
+void ib_hash_open_erase(
+    ib_hash_t *hash,
+    size_t     index
+)
+{
+    assert(hash != NULL);
+    assert(hash->open);
+
+    for (;;) {
+        size_t next = (index + 1) & hash->max_slot;
+        const ib_hash_tag_t *next_tag = &hash->tags[next];
+
+        if (
+            next_tag->hash_value == 0 ||
+            IB_HASH_OPEN_DISTANCE(hash, next, next_tag->hash_value) == 0
+        ) {
+            hash->tags[index].hash_value = 0;
+            hash->keys[index]            = NULL;
+            hash->values[index]          = NULL;
+            return;
+        }
+
+        hash->tags[index]   = *next_tag;
+        hash->keys[index]   = hash->keys[next];
+        hash->values[index] = hash->values[next];
+        index = next;
+    }
+}
+
+/**
+ * Open addressing: Allocate slot arrays of @a num_slots elements.
+ *
+ * @returns
+ * - IB_OK on success.
+ * - IB_EALLOC on allocation failure.
+ */
+static ib_status_t ib_hash_open_alloc(
+    ib_mm_t          mm,
+    size_t           num_slots,
+    ib_hash_tag_t  **tags,
+    const char    ***keys,
+    void          ***values
+)
+{
+    *tags = (ib_hash_tag_t *)ib_mm_calloc(mm, num_slots, sizeof(**tags));
+    *keys = (const char **)ib_mm_calloc(mm, num_slots, sizeof(**keys));
+    *values = (void **)ib_mm_calloc(mm, num_slots, sizeof(**values));
+    if (*tags == NULL || *keys == NULL || *values == NULL) {
+        return IB_EALLOC;
+    }
+
+    return IB_OK;
+}
+
+ib_status_t ib_hash_open_grow(
+    ib_hash_t *hash
+)
+{
+    assert(hash != NULL);
+    assert(hash->open);
+
+    ib_hash_tag_t  *old_tags     = hash->tags;
+    const char    **old_keys     = hash->keys;
+    void          **old_values   = hash->values;
+    size_t          old_max_slot = hash->max_slot;
+    ib_status_t     rc;
+
+    rc = ib_hash_open_alloc(
+        hash->mm,
+        2 * (old_max_slot + 1),
+        &hash->tags, &hash->keys, &hash->values
+    );
+    if (rc != IB_OK) {
+        hash->tags   = old_tags;
+        hash->keys   = old_keys;
+        hash->values = old_values;
+        return rc;
+    }
+    hash->max_slot = 2 * old_max_slot + 1;
+
+    for (size_t i = 0; i <= old_max_slot; ++i) {
+        if (old_tags[i].hash_value != 0) {
+            ib_hash_open_insert(
+                hash,
+                old_keys[i], old_tags[i].key_length,
+                old_tags[i].hash_value,
+                old_values[i]
+            );
+        }
+    }
+
+    return IB_OK;
+}
+
 /* End Internal Definitions */
 
 uint32_t ib_hashfunc_djb2(
@@ -475,6 +804,94 @@ uint32_t ib_hashfunc_djb2_nocase(
     return hash;
 }
 
+/**
+ * Downcase the ASCII letters of the eight bytes of @a w.
+ *
+ * Bytes with the high bit set are left alone, matching ib_hash_tolower().
+ */
+static inline uint64_t ib_hash_tolower64(uint64_t w)
+{
+    static const uint64_t c_ones = UINT64_C(0x0101010101010101);
+    static const uint64_t c_high = UINT64_C(0x8080808080808080);
+    uint64_t heptets = w & ~c_high;
+    /* High bit of each byte set if byte is >= 'A' or > 'Z' respectively. */
+    uint64_t ge_a = heptets + (0x80 - 'A') * c_ones;
+    uint64_t gt_z = heptets + (0x80 - 'Z' - 1) * c_ones;
+    uint64_t is_upper = ge_a & ~gt_z & ~w & c_high;
+
+    /* 0x80 >> 2 == 'a' - 'A' */
+    return w | (is_upper >> 2);
+}
+
+/**
+ * Implementation of ib_hashfunc_fast() and ib_hashfunc_fast_nocase().
+ */
+static inline uint32_t ib_hashfunc_fast_impl(
+    const char *key,
+    size_t      key_length,
+    uint32_t    randomizer,
+    bool        nocase
+)
+{
+    static const uint64_t c_mul = UINT64_C(0x9e3779b97f4a7c15);
+    uint64_t hash = (randomizer ^ ((uint64_t)key_length << 32)) * c_mul;
+    uint64_t w;
+
+    while (key_length >= sizeof(w)) {
+        memcpy(&w, key, sizeof(w));
+        if (nocase) {
+            w = ib_hash_tolower64(w);
+        }
+        hash = (hash ^ w) * c_mul;
+        hash ^= hash >> 29;
+        key += sizeof(w);
+        key_length -= sizeof(w);
+    }
+    if (key_length > 0) {
+        /* Assemble the tail by hand; a variable length memcpy() is a call. */
+        w = 0;
+        for (size_t i = 0; i < key_length; ++i) {
+            w |= (uint64_t)(unsigned char)key[i] << (8 * i);
+        }
+        if (nocase) {
+            w = ib_hash_tolower64(w);
+        }
+        hash = (hash ^ w) * c_mul;
+        hash ^= hash >> 29;
+    }
+
+    /* MurmurHash3 finalizer. */
+    hash ^= hash >> 33;
+    hash *= UINT64_C(0xff51afd7ed558ccd);
+    hash ^= hash >> 33;
+    hash *= UINT64_C(0xc4ceb9fe1a85ec53);
+    hash ^= hash >> 33;
+
+    return (uint32_t)hash;
+}
+
+uint32_t ib_hashfunc_fast(
+    const char *key,
+    size_t      key_length,
+    uint32_t    randomizer,
+    void       *cbdata
+) {
+    assert(key != NULL);
+
+    return ib_hashfunc_fast_impl(key, key_length, randomizer, false);
+}
+
+uint32_t ib_hashfunc_fast_nocase(
+    const char *key,
+    size_t      key_length,
+    uint32_t    randomizer,
+    void       *cbdata
+) {
+    assert(key != NULL);
+
+    return ib_hashfunc_fast_impl(key, key_length, randomizer, true);
+}
+
 int ib_hashequal_default(
     const char *a,
     size_t      a_length,
@@ -505,6 +922,24 @@ int ib_hashequal_nocase(
         return 0;
     }
 
+    /* Compare a word at a time, downcasing only words that differ. */
+    while (a_length >= sizeof(uint64_t)) {
+        uint64_t a_w;
+        uint64_t b_w;
+
+        memcpy(&a_w, a_s, sizeof(a_w));
+        memcpy(&b_w, b_s, sizeof(b_w));
+        if (
+            a_w != b_w &&
+            ib_hash_tolower64(a_w) != ib_hash_tolower64(b_w)
+        ) {
+            return 0;
+        }
+        a_s += sizeof(a_w);
+        b_s += sizeof(b_w);
+        a_length -= sizeof(a_w);
+    }
+
     for (size_t i = 0; i < a_length; ++i) {
         if (ib_hash_tolower(a_s[i]) != ib_hash_tolower(b_s[i])) {
             return 0;
@@ -574,6 +1009,66 @@ ib_status_t ib_hash_create_ex(
     new_hash->free            = NULL;
     new_hash->size            = 0;
     new_hash->randomizer      = (uint32_t)clock();
+    new_hash->open            = false;
+
+    *hash = new_hash;
+
+    return IB_OK;
+}
+
+ib_status_t ib_hash_create_open_ex(
+    ib_hash_t          **hash,
+    ib_mm_t              mm,
+    size_t               size,
+    ib_hash_function_t   hash_function,
+    void                *hash_cbdata,
+    ib_hash_equal_t      equal_predicate,
+    void                *equal_cbdata
+) {
+    assert(hash != NULL);
+    assert(size > 0);
+
+    ib_hash_t   *new_hash = NULL;
+    ib_status_t  rc;
+
+    if (hash == NULL) {
+        return IB_EINVAL;
+    }
+
+    /* Power of 2. */
+    if (size == 0 || (size & (size - 1)) != 0) {
+        return IB_EINVAL;
+    }
+
+    new_hash = (ib_hash_t *)ib_mm_alloc(mm, sizeof(*new_hash));
+    if (new_hash == NULL) {
+        *hash = NULL;
+        return IB_EALLOC;
+    }
+
+    rc = ib_hash_open_alloc(
+        mm, size,
+        &new_hash->tags, &new_hash->keys, &new_hash->values
+    );
+    if (rc != IB_OK) {
+        *hash = NULL;
+        return rc;
+    }
+
+    new_hash->hash_function   = hash_function;
+    new_hash->hash_cbdata     = hash_cbdata;
+    new_hash->equal_predicate = equal_predicate;
+    new_hash->equal_cbdata    = equal_cbdata;
+    new_hash->max_slot        = size-1;
+    new_hash->slots           = NULL;
+    new_hash->mm              = mm;
+    new_hash->free            = NULL;
+    new_hash->size            = 0;
+    new_hash->randomizer      = (uint32_t)clock();
+    new_hash->open            = true;
+    new_hash->length_equal    =
+        equal_predicate == ib_hashequal_default ||
+        equal_predicate == ib_hashequal_nocase;
 
     *hash = new_hash;
 
@@ -610,6 +1105,36 @@ ib_status_t ib_hash_create_nocase(
     );
 }
 
+ib_status_t ib_hash_create_open(
+    ib_hash_t **hash,
+    ib_mm_t     mm
+) {
+    assert(hash != NULL);
+
+    return ib_hash_create_open_ex(
+        hash,
+        mm,
+        IB_HASH_INITIAL_SIZE,
+        ib_hashfunc_fast, NULL,
+        ib_hashequal_default, NULL
+    );
+}
+
+ib_status_t ib_hash_create_open_nocase(
+    ib_hash_t **hash,
+    ib_mm_t     mm
+) {
+    assert(hash != NULL);
+
+    return ib_hash_create_open_ex(
+        hash,
+        mm,
+        IB_HASH_INITIAL_SIZE,
+        ib_hashfunc_fast_nocase, NULL,
+        ib_hashequal_nocase, NULL
+    );
+}
+
 ib_mm_t ib_hash_mm(
     const ib_hash_t *hash
 ) {
@@ -642,6 +1167,22 @@ ib_status_t ib_hash_get_ex(
         return IB_EINVAL;
     }
 
+    if (hash->open) {
+        uint32_t hash_value = hash->hash_function(
+            key, key_length,
+            hash->randomizer,
+            hash->hash_cbdata
+        );
+        ssize_t index = ib_hash_open_find(
+            hash, key, key_length, IB_HASH_OPEN_TAG(hash_value)
+        );
+
+        if (value != NULL) {
+            *(void **)value = (index < 0) ? NULL : hash->values[index];
+        }
+        return (index < 0) ? IB_ENOENT : IB_OK;
+    }
+
     rc = ib_hash_find_entry(
         hash,
         &current_entry,
@@ -693,7 +1234,10 @@ ib_status_t ib_hash_get_all(
 
     ib_hash_iterator_t i;
     IB_HASH_LOOP(i, hash) {
-        ib_list_push(list, i.current_entry->value);
+        void *value;
+
+        ib_hash_iterator_fetch(NULL, NULL, &value, &i);
+        ib_list_push(list, value);
     }
 
     if (ib_list_elements(list) <= 0) {
@@ -725,6 +1269,40 @@ ib_status_t ib_hash_set_ex(
         hash->randomizer,
         hash->hash_cbdata
     );
+
+    if (hash->open) {
+        ssize_t index;
+
+        if (key_length > UINT32_MAX) {
+            return IB_EINVAL;
+        }
+
+        hash_value = IB_HASH_OPEN_TAG(hash_value);
+        index = ib_hash_open_find(hash, key, key_length, hash_value);
+        if (index >= 0) {
+            if (value == NULL) {
+                ib_hash_open_erase(hash, index);
+                --hash->size;
+            }
+            else {
+                hash->values[index] = value;
+            }
+        }
+        else if (value != NULL) {
+            /* Keep the load factor at most 7/8. */
+            if ((hash->size + 1) * 8 > (hash->max_slot + 1) * 7) {
+                ib_status_t rc = ib_hash_open_grow(hash);
+                if (rc != IB_OK) {
+                    return rc;
+                }
+            }
+            ib_hash_open_insert(hash, key, key_length, hash_value, value);
+            ++hash->size;
+        }
+
+        return IB_OK;
+    }
+
     slot_index = (hash_value & hash->max_slot);
 
     current_entry_handle = &hash->slots[slot_index];
@@ -826,6 +1404,16 @@ ib_status_t ib_hash_set(
 void ib_hash_clear(ib_hash_t *hash) {
     assert(hash != NULL);
 
+    if (hash->open) {
+        size_t num_slots = hash->max_slot + 1;
+
+        memset(hash->tags, 0, num_slots * sizeof(*hash->tags));
+        memset(hash->keys, 0, num_slots * sizeof(*hash->keys));
+        memset(hash->values, 0, num_slots * sizeof(*hash->values));
+        hash->size = 0;
+        return;
+    }
+
     for (size_t i = 0; i <= hash->max_slot; ++i) {
         if (hash->slots[i] != NULL) {
             ib_hash_entry_t *current_entry;
@@ -27,8 +27,10 @@
 #include "kvstore_private.h"
 
 #include <ironbee/bytestr.h>
+#include <ironbee/counters.h>
 
 #include <assert.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -40,6 +42,72 @@ struct ib_kvstore_key_t {
     size_t         data_len; /**< Length of ib_kvstore_key_t::data. */
 };
 
+/**
+ * Indexes of the process wide key-value store counters.
+ */
+enum {
+    KVSTORE_COUNTER_GETS,
+    KVSTORE_COUNTER_GET_MISSES,
+    KVSTORE_COUNTER_GET_USEC,
+    KVSTORE_COUNTER_SETS,
+    KVSTORE_COUNTER_SET_USEC,
+    KVSTORE_COUNTER_REMOVES,
+    KVSTORE_COUNTER_REMOVE_USEC,
+    KVSTORE_COUNTER_ERRORS,
+    KVSTORE_COUNTER_NUM
+};
+
+/** Initializes @ref g_kvstore_counters. */
+static pthread_once_t g_kvstore_counters_once = PTHREAD_ONCE_INIT;
+
+/** Counters of all key-value stores; NULL if they could not be created. */
+static ib_counters_t *g_kvstore_counters;
+
+/** Create @ref g_kvstore_counters.  Called via pthread_once(). */
+static void kvstore_counters_create(void)
+{
+    if (
+        ib_counters_create_malloc(
+            &g_kvstore_counters,
+            KVSTORE_COUNTER_NUM) != IB_OK
+    )
+    {
+        g_kvstore_counters = NULL;
+    }
+}
+
+/**
+ * Record a key-value store operation.
+ *
+ * @param[in] count Counter of the operation.
+ * @param[in] usec Counter of the time spent in the operation.
+ * @param[in] start When the operation started.
+ * @param[in] rc Result of the operation.
+ */
+static void kvstore_count(
+    size_t      count,
+    size_t      usec,
+    ib_time_t   start,
+    ib_status_t rc
+)
+{
+    ib_time_t end = ib_clock_get_time();
+
+    pthread_once(&g_kvstore_counters_once, kvstore_counters_create);
+    if (g_kvstore_counters == NULL) {
+        return;
+    }
+
+    ib_counters_add(g_kvstore_counters, count, 1);
+    ib_counters_add(g_kvstore_counters, usec, end - start);
+    if (rc == IB_ENOENT && count == KVSTORE_COUNTER_GETS) {
+        ib_counters_add(g_kvstore_counters, KVSTORE_COUNTER_GET_MISSES, 1);
+    }
+    else if (rc != IB_OK) {
+        ib_counters_add(g_kvstore_counters, KVSTORE_COUNTER_ERRORS, 1);
+    }
+}
+
 /**
  * Default malloc implementation that wraps malloc.
  * @param[in] kvstore Key-value store.
@@ -161,9 +229,12 @@ ib_status_t ib_kvstore_get(
     ib_status_t          rc;
     ib_mm_t              mm_tmp;
     ib_mpool_lite_t     *mp_tmp;
+    ib_time_t            start = ib_clock_get_time();
 
     rc = ib_mpool_lite_create(&mp_tmp);
     if (rc != IB_OK) {
+        kvstore_count(
+            KVSTORE_COUNTER_GETS, KVSTORE_COUNTER_GET_USEC, start, rc);
         return rc;
     }
 
@@ -214,6 +285,8 @@ exit_get:
 
     ib_mpool_lite_destroy(mp_tmp);
 
+    kvstore_count(KVSTORE_COUNTER_GETS, KVSTORE_COUNTER_GET_USEC, start, rc);
+
     return rc;
 }
 
@@ -228,6 +301,7 @@ ib_status_t ib_kvstore_set(
     assert(val != NULL);
 
     ib_status_t rc;
+    ib_time_t   start = ib_clock_get_time();
 
     if ( merge_policy == NULL ) {
         merge_policy = kvstore->default_merge_policy;
@@ -235,6 +309,8 @@ ib_status_t ib_kvstore_set(
 
     rc = kvstore->set(kvstore, merge_policy, key, val, kvstore->set_cbdata);
 
+    kvstore_count(KVSTORE_COUNTER_SETS, KVSTORE_COUNTER_SET_USEC, start, rc);
+
     return rc;
 }
 
@@ -245,8 +321,12 @@ ib_status_t ib_kvstore_remove(
     assert(kvstore != NULL);
     assert(key != NULL);
 
+    ib_time_t   start = ib_clock_get_time();
     ib_status_t rc = kvstore->remove(kvstore, key, kvstore->remove_cbdata);
 
+    kvstore_count(
+        KVSTORE_COUNTER_REMOVES, KVSTORE_COUNTER_REMOVE_USEC, start, rc);
+
     return rc;
 }
 
@@ -258,6 +338,27 @@ void ib_kvstore_destroy(ib_kvstore_t *kvstore) {
     kvstore->destroy(kvstore, kvstore->destroy_cbdata);
 }
 
+void ib_kvstore_stats_get(ib_kvstore_stats_t *stats)
+{
+    assert(stats != NULL);
+
+    int64_t values[KVSTORE_COUNTER_NUM] = { 0 };
+
+    pthread_once(&g_kvstore_counters_once, kvstore_counters_create);
+    if (g_kvstore_counters != NULL) {
+        ib_counters_get(g_kvstore_counters, values);
+    }
+
+    stats->gets        = values[KVSTORE_COUNTER_GETS];
+    stats->get_misses  = values[KVSTORE_COUNTER_GET_MISSES];
+    stats->get_usec    = values[KVSTORE_COUNTER_GET_USEC];
+    stats->sets        = values[KVSTORE_COUNTER_SETS];
+    stats->set_usec    = values[KVSTORE_COUNTER_SET_USEC];
+    stats->removes     = values[KVSTORE_COUNTER_REMOVES];
+    stats->remove_usec = values[KVSTORE_COUNTER_REMOVE_USEC];
+    stats->errors      = values[KVSTORE_COUNTER_ERRORS];
+}
+
 
 ib_status_t DLL_PUBLIC ib_kvstore_key_create(
     ib_kvstore_key_t **key,
@@ -1036,7 +1036,9 @@ static ib_status_t kvset(
 
     server = (ib_kvstore_filesystem_server_t *)kvstore->server;
 
-    rc = ib_kvstore_remove(kvstore, key);
+    /* Call the implementation directly so that this is not counted as a
+     * remove in the kvstore statistics. */
+    rc = kvstore->remove(kvstore, key, kvstore->remove_cbdata);
     if (rc != IB_OK) {
         ib_util_log_debug("Failed to remove key from kvstore.");
     }
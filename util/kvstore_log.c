@@ -0,0 +1,1707 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronBee --- Persist to an append-only log of segment files.
+ */
+
+#include "ironbee_config_auto.h"
+
+#include <ironbee/kvstore_log.h>
+
+#include "kvstore_private.h"
+
+#include <ironbee/clock.h>
+#include <ironbee/hash.h>
+#include <ironbee/kvstore.h>
+#include <ironbee/lock.h>
+#include <ironbee/mm_mpool.h>
+#include <ironbee/mpool.h>
+#include <ironbee/util.h>
+
+#include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * Magic number starting every record ("KVLG").
+ */
+#define KVLOG_MAGIC 0x4b564c47
+
+/**
+ * Record flag marking a removal.
+ */
+#define KVLOG_TOMBSTONE 0x1
+
+/**
+ * Suffix of segment file names; the name is the segment id and suffix.
+ */
+#define KVLOG_SUFFIX ".kvlog"
+
+/**
+ * Name of the lock file held by the process using a directory.
+ *
+ * It starts with a dot so that it is not mistaken for a segment.
+ */
+#define KVLOG_LOCK_NAME ".lock"
+
+/**
+ * Width of the segment id in file names.
+ */
+#define KVLOG_ID_WIDTH 8
+
+/**
+ * Upper bound on each length in a record, to reject garbage early.
+ */
+#define KVLOG_MAX_FIELD (1U << 30)
+
+/**
+ * The default fmode for segment files.
+ */
+static const mode_t DEFAULT_FILE_MODE = 0644;
+
+/**
+ * Header of every record; the key, type and value follow it.
+ */
+typedef struct {
+    uint32_t  magic;        /**< KVLOG_MAGIC. */
+    uint32_t  checksum;     /**< CRC-32 of the rest of the record. */
+    uint32_t  flags;        /**< KVLOG_TOMBSTONE or 0. */
+    uint32_t  key_length;   /**< Length of the key. */
+    uint32_t  type_length;  /**< Length of the type. */
+    uint32_t  value_length; /**< Length of the value. */
+    ib_time_t expiration;   /**< Absolute expiration; 0 for never. */
+    ib_time_t creation;     /**< Creation time. */
+} kvlog_record_t;
+
+/**
+ * Offset of the checksummed part of a record.
+ */
+#define KVLOG_CHECKSUM_START offsetof(kvlog_record_t, flags)
+
+/**
+ * A segment file.
+ *
+ * Only the last segment is appended to.  Others are immutable until
+ * compaction deletes them.
+ */
+typedef struct {
+    uint32_t id;   /**< Id; also the file name. */
+    int      fd;   /**< Open descriptor. */
+    uint64_t size; /**< Bytes of records. */
+    uint64_t dead; /**< Bytes of superseded, removed or expired records. */
+} kvlog_segment_t;
+
+/**
+ * Index entry for a key.
+ */
+typedef struct {
+    kvlog_segment_t *segment;    /**< Segment holding the latest record. */
+    uint64_t         offset;     /**< Offset of the record in @c segment. */
+    uint32_t         length;     /**< Length of the record. */
+    ib_time_t        expiration; /**< Expiration of the record. */
+    size_t           key_length; /**< Length of @c key. */
+    char             key[];      /**< Key; also the key in the index. */
+} kvlog_entry_t;
+
+/** See struct kvlog_server_t */
+typedef struct kvlog_server_t kvlog_server_t;
+
+/**
+ * Server object.
+ *
+ * There is one server per directory in a process, shared by every store
+ * initialized with that directory.
+ */
+struct kvlog_server_t {
+    kvlog_server_t   *next;             /**< Next in s_servers. */
+    size_t            refs;             /**< Stores using this server. */
+    size_t            connections;      /**< Connects minus disconnects. */
+    pid_t             pid;              /**< Process that opened the log. */
+    int               lock_fd;          /**< Locked KVLOG_LOCK_NAME. */
+
+    char             *directory;        /**< Directory of segments. */
+    size_t            segment_size;     /**< Rotation size. */
+    bool              sync;             /**< fdatasync() each write? */
+    unsigned          compact_interval; /**< Seconds between checks. */
+    unsigned          compact_percent;  /**< Dead percentage to compact. */
+
+    ib_lock_t        *lock;             /**< Guards everything below. */
+    bool              connected;        /**< Is the log open? */
+    ib_mpool_t       *mp;               /**< Memory pool of the index. */
+    ib_hash_t        *index;            /**< Key to kvlog_entry_t. */
+    kvlog_segment_t **segments;         /**< Segments by ascending id. */
+    size_t            num_segments;     /**< Length of @c segments. */
+    size_t            max_segments;     /**< Capacity of @c segments. */
+    uint64_t          appended;         /**< Records appended. */
+
+    ib_lock_t        *sync_lock;        /**< Guards @c synced; held while
+                                         *   syncing or closing segments. */
+    uint64_t          synced;           /**< Records known to be durable. */
+
+    ib_lock_t        *compact_lock;     /**< Serializes compactions. */
+    pthread_mutex_t   thread_lock;      /**< Guards thread state. */
+    pthread_cond_t    thread_cond;      /**< Wakes the thread to stop. */
+    pthread_t         thread;           /**< Compaction thread. */
+    bool              thread_running;   /**< Is @c thread running? */
+    bool              thread_stop;      /**< Should @c thread exit? */
+};
+
+/**
+ * Servers by directory.
+ *
+ * Two servers appending to the same segments would corrupt them, so
+ * stores of the same directory, such as those of the old and new engine
+ * during a reload, share one server.
+ */
+static kvlog_server_t *s_servers = NULL;
+
+/**
+ * Guards s_servers and the connection state of every server.
+ *
+ * Taken before any lock of a server.
+ */
+static pthread_mutex_t s_servers_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * CRC-32 table, built once.
+ */
+static uint32_t s_crc_table[256];
+
+/**
+ * Once control for @ref s_crc_table.
+ */
+static pthread_once_t s_crc_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Build @ref s_crc_table.
+ */
+static void kvlog_crc_init(void)
+{
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k) {
+            c = (c & 1) ? (0xedb88320 ^ (c >> 1)) : (c >> 1);
+        }
+        s_crc_table[i] = c;
+    }
+}
+
+/**
+ * Continue CRC-32 @a crc over @a length bytes of @a data.
+ */
+static uint32_t kvlog_crc(uint32_t crc, const void *data, size_t length)
+{
+    const uint8_t *p = (const uint8_t *)data;
+
+    crc = ~crc;
+    while (length-- > 0) {
+        crc = s_crc_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/**
+ * Current time.
+ */
+static ib_time_t kvlog_now(void)
+{
+    ib_timeval_t tv;
+
+    ib_clock_gettimeofday(&tv);
+    return IB_CLOCK_TIMEVAL_TIME(tv);
+}
+
+/**
+ * Total length of the record with header @a record.
+ */
+static size_t kvlog_record_length(const kvlog_record_t *record)
+{
+    return sizeof(*record) +
+        record->key_length + record->type_length + record->value_length;
+}
+
+/**
+ * Build a record in a malloc()ed buffer.
+ *
+ * @param[out] buffer Record; free with free().
+ * @param[out] length Length of @a buffer.
+ * @param[in] flags Record flags.
+ * @param[in] key Key.
+ * @param[in] key_length Length of @a key.
+ * @param[in] type Type; may be NULL if @a type_length is 0.
+ * @param[in] type_length Length of @a type.
+ * @param[in] value Value; may be NULL if @a value_length is 0.
+ * @param[in] value_length Length of @a value.
+ * @param[in] expiration Absolute expiration.
+ * @param[in] creation Creation time.
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EINVAL if a length is too large.
+ *   - IB_EALLOC on allocation failure.
+ */
+static ib_status_t kvlog_record_build(
+    uint8_t       **buffer,
+    size_t         *length,
+    uint32_t        flags,
+    const uint8_t  *key,
+    size_t          key_length,
+    const char     *type,
+    size_t          type_length,
+    const uint8_t  *value,
+    size_t          value_length,
+    ib_time_t       expiration,
+    ib_time_t       creation)
+{
+    kvlog_record_t record;
+    uint8_t       *p;
+
+    if (
+        key_length > KVLOG_MAX_FIELD ||
+        type_length > KVLOG_MAX_FIELD ||
+        value_length > KVLOG_MAX_FIELD
+    ) {
+        return IB_EINVAL;
+    }
+
+    record.magic        = KVLOG_MAGIC;
+    record.flags        = flags;
+    record.key_length   = key_length;
+    record.type_length  = type_length;
+    record.value_length = value_length;
+    record.expiration   = expiration;
+    record.creation     = creation;
+
+    *length = kvlog_record_length(&record);
+    *buffer = malloc(*length);
+    if (*buffer == NULL) {
+        return IB_EALLOC;
+    }
+
+    p = *buffer + sizeof(record);
+    memcpy(p, key, key_length);
+    p += key_length;
+    if (type_length > 0) {
+        memcpy(p, type, type_length);
+        p += type_length;
+    }
+    if (value_length > 0) {
+        memcpy(p, value, value_length);
+    }
+
+    record.checksum = kvlog_crc(
+        0,
+        (const uint8_t *)&record + KVLOG_CHECKSUM_START,
+        sizeof(record) - KVLOG_CHECKSUM_START);
+    record.checksum = kvlog_crc(
+        record.checksum, *buffer + sizeof(record), *length - sizeof(record));
+    memcpy(*buffer, &record, sizeof(record));
+
+    return IB_OK;
+}
+
+/**
+ * Validate the record at @a offset of the @a size bytes at @a base.
+ *
+ * @param[in] base Start of the segment.
+ * @param[in] size Size of the segment.
+ * @param[in] offset Offset of the record.
+ * @param[out] record Header of the record.
+ * @returns true if a complete record with a good checksum is there.
+ */
+static bool kvlog_record_read(
+    const uint8_t  *base,
+    uint64_t        size,
+    uint64_t        offset,
+    kvlog_record_t *record)
+{
+    uint32_t crc;
+    size_t   length;
+
+    if (size - offset < sizeof(*record)) {
+        return false;
+    }
+    memcpy(record, base + offset, sizeof(*record));
+    if (
+        record->magic != KVLOG_MAGIC ||
+        record->key_length > KVLOG_MAX_FIELD ||
+        record->type_length > KVLOG_MAX_FIELD ||
+        record->value_length > KVLOG_MAX_FIELD
+    ) {
+        return false;
+    }
+    length = kvlog_record_length(record);
+    if (size - offset < length) {
+        return false;
+    }
+
+    crc = kvlog_crc(
+        0,
+        base + offset + KVLOG_CHECKSUM_START,
+        length - KVLOG_CHECKSUM_START);
+    return crc == record->checksum;
+}
+
+/**
+ * Write the path of segment @a id to @a path.
+ */
+static void kvlog_segment_path(
+    const kvlog_server_t *server,
+    uint32_t              id,
+    char                 *path,
+    size_t                path_size)
+{
+    snprintf(path, path_size, "%s/%0*" PRIu32 KVLOG_SUFFIX,
+             server->directory, KVLOG_ID_WIDTH, id);
+}
+
+/**
+ * Open segment @a id and add it to the end of the segment list.
+ *
+ * @param[in] server Server.
+ * @param[in] id Segment id.
+ * @param[in] create Create a new file?
+ * @param[out] segment The segment.
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EALLOC on allocation failure.
+ *   - IB_EOTHER on I/O error.
+ */
+static ib_status_t kvlog_segment_open(
+    kvlog_server_t   *server,
+    uint32_t          id,
+    bool              create,
+    kvlog_segment_t **segment)
+{
+    char             path[PATH_MAX];
+    struct stat      sb;
+    kvlog_segment_t *seg;
+    int              fd;
+
+    if (server->num_segments == server->max_segments) {
+        size_t            max = server->max_segments * 2 + 4;
+        kvlog_segment_t **segments =
+            realloc(server->segments, max * sizeof(*segments));
+        if (segments == NULL) {
+            return IB_EALLOC;
+        }
+        server->segments = segments;
+        server->max_segments = max;
+    }
+
+    seg = calloc(1, sizeof(*seg));
+    if (seg == NULL) {
+        return IB_EALLOC;
+    }
+
+    kvlog_segment_path(server, id, path, sizeof(path));
+    fd = open(path, O_RDWR | (create ? O_CREAT | O_EXCL : 0),
+              DEFAULT_FILE_MODE);
+    if (fd < 0 || fstat(fd, &sb) != 0) {
+        ib_util_log_error("kvstore: Failed to open \"%s\": %s",
+                          path, strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        free(seg);
+        return IB_EOTHER;
+    }
+
+    seg->id = id;
+    seg->fd = fd;
+    seg->size = sb.st_size;
+    server->segments[server->num_segments++] = seg;
+    *segment = seg;
+
+    return IB_OK;
+}
+
+/**
+ * The segment appended to.
+ */
+static kvlog_segment_t *kvlog_active(const kvlog_server_t *server)
+{
+    assert(server->num_segments > 0);
+
+    return server->segments[server->num_segments - 1];
+}
+
+/**
+ * Append @a length bytes of @a buffer to the log.
+ *
+ * Must be called with the server locked.  Starts a new segment if the
+ * active one is full, syncing the full one first if syncing.  Other
+ * records are synced by kvlog_sync().
+ *
+ * @param[in] server Server.
+ * @param[in] buffer Record.
+ * @param[in] length Length of @a buffer.
+ * @param[out] segment Segment written to.
+ * @param[out] offset Offset written at.
+ * @returns
+ *   - IB_OK on success.
+ *   - Other on failure; the log is unchanged.
+ */
+static ib_status_t kvlog_append(
+    kvlog_server_t   *server,
+    const uint8_t    *buffer,
+    size_t            length,
+    kvlog_segment_t **segment,
+    uint64_t         *offset)
+{
+    kvlog_segment_t *active = kvlog_active(server);
+    size_t           written = 0;
+    ib_status_t      rc;
+
+    if (active->size > 0 && active->size + length > server->segment_size) {
+        if (server->sync) {
+            fdatasync(active->fd);
+        }
+        rc = kvlog_segment_open(server, active->id + 1, true, &active);
+        if (rc != IB_OK) {
+            return rc;
+        }
+    }
+
+    while (written < length) {
+        ssize_t n = pwrite(
+            active->fd, buffer + written, length - written,
+            active->size + written);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            ib_util_log_error("kvstore: Failed to append to log: %s",
+                              strerror(errno));
+            /* Drop any partial record so the next one follows a good one. */
+            if (ftruncate(active->fd, active->size) != 0) {
+                ib_util_log_error("kvstore: Failed to truncate log: %s",
+                                  strerror(errno));
+            }
+            return IB_EOTHER;
+        }
+        written += n;
+    }
+
+    *segment = active;
+    *offset = active->size;
+    active->size += length;
+    ++server->appended;
+
+    return IB_OK;
+}
+
+/**
+ * Find the index entry for @a key or NULL.
+ */
+static kvlog_entry_t *kvlog_index_get(
+    const kvlog_server_t *server,
+    const uint8_t        *key,
+    size_t                key_length)
+{
+    kvlog_entry_t *entry = NULL;
+
+    ib_hash_get_ex(server->index, &entry, (const char *)key, key_length);
+    return entry;
+}
+
+/**
+ * Point the index entry of @a key at a new record.
+ *
+ * The previous record, if any, becomes dead.
+ *
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EALLOC on allocation failure.
+ */
+static ib_status_t kvlog_index_put(
+    kvlog_server_t  *server,
+    const uint8_t   *key,
+    size_t           key_length,
+    kvlog_segment_t *segment,
+    uint64_t         offset,
+    uint32_t         length,
+    ib_time_t        expiration)
+{
+    kvlog_entry_t *entry = kvlog_index_get(server, key, key_length);
+    ib_status_t    rc;
+
+    if (entry != NULL) {
+        entry->segment->dead += entry->length;
+    }
+    else {
+        entry = malloc(sizeof(*entry) + key_length);
+        if (entry == NULL) {
+            return IB_EALLOC;
+        }
+        entry->key_length = key_length;
+        memcpy(entry->key, key, key_length);
+        rc = ib_hash_set_ex(server->index, entry->key, key_length, entry);
+        if (rc != IB_OK) {
+            free(entry);
+            return rc;
+        }
+    }
+
+    entry->segment = segment;
+    entry->offset = offset;
+    entry->length = length;
+    entry->expiration = expiration;
+
+    return IB_OK;
+}
+
+/**
+ * Remove @a entry from the index; its record becomes dead.
+ */
+static void kvlog_index_drop(kvlog_server_t *server, kvlog_entry_t *entry)
+{
+    ib_hash_remove_ex(server->index, NULL, entry->key, entry->key_length);
+    entry->segment->dead += entry->length;
+    free(entry);
+}
+
+/**
+ * Is @a expiration past at @a now?
+ */
+static bool kvlog_expired(ib_time_t expiration, ib_time_t now)
+{
+    return expiration != 0 && now > expiration;
+}
+
+/**
+ * Replay @a segment into the index.
+ *
+ * A bad record ends the segment.  In the last segment this is a torn
+ * write and the file is truncated there so appends follow good records.
+ *
+ * @param[in] server Server.
+ * @param[in] segment Segment to read.
+ * @param[in] last Is this the last segment?
+ * @returns
+ *   - IB_OK on success.
+ *   - Other on error.
+ */
+static ib_status_t kvlog_replay(
+    kvlog_server_t  *server,
+    kvlog_segment_t *segment,
+    bool             last)
+{
+    const uint8_t  *base;
+    uint64_t        offset = 0;
+    kvlog_record_t  record;
+    ib_time_t       now = kvlog_now();
+    ib_status_t     rc = IB_OK;
+
+    if (segment->size == 0) {
+        return IB_OK;
+    }
+
+    base = mmap(NULL, segment->size, PROT_READ, MAP_PRIVATE, segment->fd, 0);
+    if (base == MAP_FAILED) {
+        return IB_EOTHER;
+    }
+
+    while (offset < segment->size) {
+        const uint8_t *key = base + offset + sizeof(record);
+        size_t         length;
+
+        if (! kvlog_record_read(base, segment->size, offset, &record)) {
+            break;
+        }
+        length = kvlog_record_length(&record);
+
+        if (
+            (record.flags & KVLOG_TOMBSTONE) ||
+            kvlog_expired(record.expiration, now)
+        ) {
+            kvlog_entry_t *entry =
+                kvlog_index_get(server, key, record.key_length);
+            if (entry != NULL) {
+                kvlog_index_drop(server, entry);
+            }
+            segment->dead += length;
+        }
+        else {
+            rc = kvlog_index_put(
+                server, key, record.key_length,
+                segment, offset, length, record.expiration);
+            if (rc != IB_OK) {
+                goto finish;
+            }
+        }
+        offset += length;
+    }
+
+    if (offset < segment->size) {
+        if (last) {
+            ib_util_log_error(
+                "kvstore: Truncating segment %" PRIu32 " from %" PRIu64
+                " to %" PRIu64 " bytes after a torn write.",
+                segment->id, segment->size, offset);
+            if (ftruncate(segment->fd, offset) != 0) {
+                rc = IB_EOTHER;
+                goto finish;
+            }
+            segment->size = offset;
+        }
+        else {
+            ib_util_log_error(
+                "kvstore: Segment %" PRIu32 " is corrupt after offset %"
+                PRIu64 "; ignoring the rest.",
+                segment->id, offset);
+            segment->dead += segment->size - offset;
+        }
+    }
+
+finish:
+    munmap((void *)base, segment->size);
+    return rc;
+}
+
+/**
+ * Compare segment ids for qsort().
+ */
+static int kvlog_id_cmp(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * List the ids of the segments in the directory in ascending order.
+ *
+ * @param[in] server Server.
+ * @param[out] ids malloc()ed ids.
+ * @param[out] num_ids Length of @a ids.
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EALLOC on allocation failure.
+ *   - IB_EOTHER if the directory cannot be read.
+ */
+static ib_status_t kvlog_list(
+    const kvlog_server_t *server,
+    uint32_t            **ids,
+    size_t               *num_ids)
+{
+    DIR           *dir;
+    struct dirent *entry;
+    size_t         max = 0;
+
+    *ids = NULL;
+    *num_ids = 0;
+
+    dir = opendir(server->directory);
+    if (dir == NULL) {
+        ib_util_log_error("kvstore: Failed to open \"%s\": %s",
+                          server->directory, strerror(errno));
+        return IB_EOTHER;
+    }
+
+    while ((entry = readdir(dir)) != NULL) {
+        char          *end;
+        unsigned long  id = strtoul(entry->d_name, &end, 10);
+
+        if (
+            end != entry->d_name + KVLOG_ID_WIDTH ||
+            strcmp(end, KVLOG_SUFFIX) != 0 ||
+            id > UINT32_MAX
+        ) {
+            continue;
+        }
+        if (*num_ids == max) {
+            uint32_t *tmp;
+
+            max = max * 2 + 16;
+            tmp = realloc(*ids, max * sizeof(**ids));
+            if (tmp == NULL) {
+                closedir(dir);
+                free(*ids);
+                *ids = NULL;
+                return IB_EALLOC;
+            }
+            *ids = tmp;
+        }
+        (*ids)[(*num_ids)++] = id;
+    }
+    closedir(dir);
+
+    qsort(*ids, *num_ids, sizeof(**ids), kvlog_id_cmp);
+
+    return IB_OK;
+}
+
+/**
+ * Copy or drop each record of @a segment and delete it.
+ *
+ * Records the index still points at are copied to the end of the log.
+ * Expired ones and tombstones are dropped if @a segment is the oldest, as
+ * nothing older can be resurrected, and otherwise carried forward as
+ * tombstones.
+ *
+ * Must be called with the compaction lock held.  @a segment is immutable
+ * so is read without the server lock.
+ */
+static ib_status_t kvlog_compact_segment(
+    kvlog_server_t  *server,
+    kvlog_segment_t *segment)
+{
+    const uint8_t  *base = NULL;
+    uint64_t        offset = 0;
+    kvlog_record_t  record;
+    ib_time_t       now = kvlog_now();
+    char            path[PATH_MAX];
+    ib_status_t     rc = IB_OK;
+
+    if (segment->size > 0) {
+        base = mmap(
+            NULL, segment->size, PROT_READ, MAP_PRIVATE, segment->fd, 0);
+        if (base == MAP_FAILED) {
+            return IB_EOTHER;
+        }
+    }
+
+    while (offset < segment->size) {
+        const uint8_t   *key = base + offset + sizeof(record);
+        kvlog_entry_t   *entry;
+        kvlog_segment_t *to;
+        uint64_t         to_offset;
+        uint8_t         *tombstone = NULL;
+        size_t           length;
+        bool             oldest;
+
+        if (! kvlog_record_read(base, segment->size, offset, &record)) {
+            break;
+        }
+        length = kvlog_record_length(&record);
+
+        ib_lock_lock(server->lock);
+        oldest = (server->segments[0] == segment);
+        entry = kvlog_index_get(server, key, record.key_length);
+
+        if (record.flags & KVLOG_TOMBSTONE) {
+            /* An indexed key was set after this removal. */
+            if (! oldest && entry == NULL) {
+                rc = kvlog_append(
+                    server, base + offset, length, &to, &to_offset);
+                if (rc == IB_OK) {
+                    to->dead += length;
+                }
+            }
+        }
+        else if (
+            entry != NULL &&
+            entry->segment == segment &&
+            entry->offset == offset
+        ) {
+            if (kvlog_expired(entry->expiration, now)) {
+                kvlog_index_drop(server, entry);
+                if (! oldest) {
+                    size_t tombstone_length;
+
+                    rc = kvlog_record_build(
+                        &tombstone, &tombstone_length, KVLOG_TOMBSTONE,
+                        key, record.key_length, NULL, 0, NULL, 0, 0, now);
+                    if (rc == IB_OK) {
+                        rc = kvlog_append(
+                            server, tombstone, tombstone_length,
+                            &to, &to_offset);
+                    }
+                    if (rc == IB_OK) {
+                        to->dead += tombstone_length;
+                    }
+                }
+            }
+            else {
+                rc = kvlog_append(
+                    server, base + offset, length, &to, &to_offset);
+                if (rc == IB_OK) {
+                    entry->segment = to;
+                    entry->offset = to_offset;
+                }
+            }
+        }
+        ib_lock_unlock(server->lock);
+
+        free(tombstone);
+        if (rc != IB_OK) {
+            goto finish;
+        }
+        offset += length;
+    }
+
+    if (base != NULL) {
+        munmap((void *)base, segment->size);
+        base = NULL;
+    }
+
+    ib_lock_lock(server->lock);
+    for (size_t i = 0; i < server->num_segments; ++i) {
+        if (server->segments[i] == segment) {
+            memmove(server->segments + i, server->segments + i + 1,
+                    (server->num_segments - i - 1) *
+                        sizeof(*server->segments));
+            --server->num_segments;
+            break;
+        }
+    }
+    ib_lock_unlock(server->lock);
+
+    /* Copies must be durable before the originals go. */
+    if (server->sync) {
+        fdatasync(kvlog_active(server)->fd);
+    }
+    kvlog_segment_path(server, segment->id, path, sizeof(path));
+    unlink(path);
+    /* kvlog_sync() may be syncing the segment. */
+    ib_lock_lock(server->sync_lock);
+    close(segment->fd);
+    ib_lock_unlock(server->sync_lock);
+    free(segment);
+
+finish:
+    if (base != NULL) {
+        munmap((void *)base, segment->size);
+    }
+    return rc;
+}
+
+/**
+ * Compact every immutable segment that is dead enough, oldest first.
+ */
+static ib_status_t kvlog_compact(kvlog_server_t *server)
+{
+    ib_status_t rc = IB_OK;
+
+    ib_lock_lock(server->compact_lock);
+    while (rc == IB_OK) {
+        kvlog_segment_t *candidate = NULL;
+
+        ib_lock_lock(server->lock);
+        if (! server->connected) {
+            ib_lock_unlock(server->lock);
+            break;
+        }
+        for (size_t i = 0; i + 1 < server->num_segments; ++i) {
+            kvlog_segment_t *segment = server->segments[i];
+            if (
+                segment->dead * 100 >=
+                segment->size * server->compact_percent
+            ) {
+                candidate = segment;
+                break;
+            }
+        }
+        ib_lock_unlock(server->lock);
+
+        if (candidate == NULL) {
+            break;
+        }
+        rc = kvlog_compact_segment(server, candidate);
+    }
+    ib_lock_unlock(server->compact_lock);
+
+    return rc;
+}
+
+/**
+ * Background compaction thread.
+ */
+static void *kvlog_compact_thread(void *arg)
+{
+    kvlog_server_t  *server = (kvlog_server_t *)arg;
+    struct timespec  ts;
+
+    pthread_mutex_lock(&server->thread_lock);
+    while (! server->thread_stop) {
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += server->compact_interval;
+        pthread_cond_timedwait(&server->thread_cond, &server->thread_lock, &ts);
+        if (server->thread_stop) {
+            break;
+        }
+        pthread_mutex_unlock(&server->thread_lock);
+        if (kvlog_compact(server) != IB_OK) {
+            ib_util_log_error("kvstore: Log compaction failed.");
+        }
+        pthread_mutex_lock(&server->thread_lock);
+    }
+    pthread_mutex_unlock(&server->thread_lock);
+
+    return NULL;
+}
+
+/**
+ * Lock the directory against use by other processes.
+ *
+ * @param[in] server Server.
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EAGAIN if another process uses the directory.
+ *   - IB_EOTHER on I/O error.
+ */
+static ib_status_t kvlog_lock(kvlog_server_t *server)
+{
+    char path[PATH_MAX];
+    int  fd;
+
+    snprintf(path, sizeof(path), "%s/" KVLOG_LOCK_NAME, server->directory);
+    fd = open(path, O_RDWR | O_CREAT, DEFAULT_FILE_MODE);
+    if (fd < 0) {
+        ib_util_log_error("kvstore: Failed to open \"%s\": %s",
+                          path, strerror(errno));
+        return IB_EOTHER;
+    }
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        int error = errno;
+
+        close(fd);
+        if (error == EWOULDBLOCK) {
+            ib_util_log_error(
+                "kvstore: Log directory \"%s\" is in use by another process.",
+                server->directory);
+            return IB_EAGAIN;
+        }
+        ib_util_log_error("kvstore: Failed to lock \"%s\": %s",
+                          path, strerror(error));
+        return IB_EOTHER;
+    }
+
+    server->lock_fd = fd;
+
+    return IB_OK;
+}
+
+/**
+ * Stop the compaction thread, close all segments and free the index.
+ *
+ * A log opened by the parent of this process is discarded without
+ * syncing: the parent still owns it, and the compaction thread and any
+ * lock held at fork() did not survive into this process.
+ *
+ * Must be called with s_servers_lock held.
+ */
+static void kvlog_close(kvlog_server_t *server)
+{
+    bool inherited = (server->pid != getpid());
+
+    if (inherited) {
+        server->thread_running = false;
+        pthread_mutex_init(server->lock, NULL);
+        pthread_mutex_init(server->sync_lock, NULL);
+        pthread_mutex_init(server->compact_lock, NULL);
+        pthread_mutex_init(&server->thread_lock, NULL);
+        pthread_cond_init(&server->thread_cond, NULL);
+    }
+
+    if (server->thread_running) {
+        pthread_mutex_lock(&server->thread_lock);
+        server->thread_stop = true;
+        pthread_cond_signal(&server->thread_cond);
+        pthread_mutex_unlock(&server->thread_lock);
+        pthread_join(server->thread, NULL);
+        server->thread_running = false;
+    }
+
+    ib_lock_lock(server->sync_lock);
+    ib_lock_lock(server->lock);
+    if (server->index != NULL) {
+        ib_hash_iterator_t *iterator = ib_hash_iterator_create_malloc();
+
+        if (iterator != NULL) {
+            for (
+                ib_hash_iterator_first(iterator, server->index);
+                ! ib_hash_iterator_at_end(iterator);
+                ib_hash_iterator_next(iterator)
+            ) {
+                kvlog_entry_t *entry;
+                ib_hash_iterator_fetch(NULL, NULL, &entry, iterator);
+                free(entry);
+            }
+            free(iterator);
+        }
+        server->index = NULL;
+    }
+    if (server->mp != NULL) {
+        ib_mpool_destroy(server->mp);
+        server->mp = NULL;
+    }
+    for (size_t i = 0; i < server->num_segments; ++i) {
+        if (server->sync && ! inherited) {
+            fdatasync(server->segments[i]->fd);
+        }
+        close(server->segments[i]->fd);
+        free(server->segments[i]);
+    }
+    free(server->segments);
+    server->segments = NULL;
+    server->num_segments = 0;
+    server->max_segments = 0;
+    server->appended = 0;
+    server->synced = 0;
+    server->connected = false;
+    server->pid = 0;
+    ib_lock_unlock(server->lock);
+    ib_lock_unlock(server->sync_lock);
+
+    /* Closing the last descriptor releases the lock, so a parent's lock
+     * is kept. */
+    if (server->lock_fd >= 0) {
+        close(server->lock_fd);
+        server->lock_fd = -1;
+    }
+}
+
+/**
+ * Lock the directory, open the log, replay it and start the compaction
+ * thread.
+ *
+ * Must be called with s_servers_lock held.
+ */
+static ib_status_t kvlog_open(kvlog_server_t *server)
+{
+    kvlog_segment_t *segment;
+    uint32_t        *ids = NULL;
+    size_t           num_ids;
+    ib_status_t      rc;
+
+    server->pid = getpid();
+
+    rc = kvlog_lock(server);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    rc = ib_mpool_create(&server->mp, "kvstore_log", NULL);
+    if (rc != IB_OK) {
+        goto failure;
+    }
+    rc = ib_hash_create_open(&server->index, ib_mm_mpool(server->mp));
+    if (rc != IB_OK) {
+        goto failure;
+    }
+
+    rc = kvlog_list(server, &ids, &num_ids);
+    if (rc != IB_OK) {
+        goto failure;
+    }
+    for (size_t i = 0; i < num_ids; ++i) {
+        rc = kvlog_segment_open(server, ids[i], false, &segment);
+        if (rc != IB_OK) {
+            goto failure;
+        }
+        rc = kvlog_replay(server, segment, i + 1 == num_ids);
+        if (rc != IB_OK) {
+            goto failure;
+        }
+    }
+
+    if (num_ids == 0) {
+        rc = kvlog_segment_open(server, 1, true, &segment);
+        if (rc != IB_OK) {
+            goto failure;
+        }
+    }
+
+    server->connected = true;
+
+    if (server->compact_interval > 0) {
+        server->thread_stop = false;
+        if (
+            pthread_create(
+                &server->thread, NULL, kvlog_compact_thread, server) != 0
+        ) {
+            rc = IB_EOTHER;
+            goto failure;
+        }
+        server->thread_running = true;
+    }
+
+    free(ids);
+    return IB_OK;
+
+failure:
+    free(ids);
+    kvlog_close(server);
+    return rc;
+}
+
+/**
+ * Lock @a server with its log open in this process.
+ *
+ * The log is opened on first use rather than on connect, so that a server
+ * that forks after configuration opens it in the process that uses it.  A
+ * log opened before a fork() is never used by the child, whose index
+ * would go stale at the next write of either process; the child discards
+ * it and opens the directory itself, which fails while the parent has it.
+ *
+ * @param[in] server Server.
+ * @returns
+ *   - IB_OK on success, with server->lock held.
+ *   - IB_EAGAIN if another process uses the directory.
+ *   - Other on failure or if no store is connected.
+ */
+static ib_status_t kvlog_acquire(kvlog_server_t *server)
+{
+    pid_t       pid = getpid();
+    ib_status_t rc = IB_OK;
+
+    /* A server->lock inherited across fork() may be held, so it is not
+     * taken until this process has opened the log. */
+    if (server->pid == pid) {
+        ib_lock_lock(server->lock);
+        if (server->connected) {
+            return IB_OK;
+        }
+        ib_lock_unlock(server->lock);
+    }
+
+    pthread_mutex_lock(&s_servers_lock);
+    if (server->connections == 0) {
+        rc = IB_EOTHER;
+    }
+    else if (server->pid != pid || ! server->connected) {
+        if (server->pid != 0) {
+            kvlog_close(server);
+        }
+        rc = kvlog_open(server);
+    }
+    if (rc == IB_OK) {
+        ib_lock_lock(server->lock);
+    }
+    pthread_mutex_unlock(&s_servers_lock);
+
+    return rc;
+}
+
+/**
+ * Make the first @a appended records durable.
+ *
+ * Called without the server lock, so that other writes proceed while
+ * this one waits for the disk.  One fdatasync() of the active segment
+ * covers every record appended before it, so concurrent writers share it.
+ * Earlier segments were synced when rotated.
+ *
+ * @param[in] server Server.
+ * @param[in] appended Value of server->appended after the write.
+ * @returns
+ *   - IB_OK on success.
+ *   - IB_EOTHER on I/O error or if the log was closed.
+ */
+static ib_status_t kvlog_sync(kvlog_server_t *server, uint64_t appended)
+{
+    ib_status_t rc = IB_OK;
+
+    ib_lock_lock(server->sync_lock);
+    if (server->synced < appended) {
+        int      fd = -1;
+        uint64_t target = 0;
+
+        ib_lock_lock(server->lock);
+        if (server->connected) {
+            fd = kvlog_active(server)->fd;
+            target = server->appended;
+        }
+        ib_lock_unlock(server->lock);
+
+        if (fd < 0 || fdatasync(fd) != 0) {
+            rc = IB_EOTHER;
+        }
+        else {
+            server->synced = target;
+        }
+    }
+    ib_lock_unlock(server->sync_lock);
+
+    return rc;
+}
+
+/**
+ * Check the directory.  The log is opened by kvlog_acquire().
+ */
+static ib_status_t kvconnect(
+    ib_kvstore_t *kvstore,
+    ib_kvstore_cbdata_t *cbdata)
+{
+    assert(kvstore != NULL);
+
+    kvlog_server_t *server = (kvlog_server_t *)kvstore->server;
+
+    if (access(server->directory, R_OK | W_OK | X_OK) != 0) {
+        ib_util_log_error("kvstore: Cannot use log directory \"%s\": %s",
+                          server->directory, strerror(errno));
+        return IB_EOTHER;
+    }
+
+    pthread_mutex_lock(&s_servers_lock);
+    ++server->connections;
+    pthread_mutex_unlock(&s_servers_lock);
+
+    return IB_OK;
+}
+
+/**
+ * Close the log once every store of the directory has disconnected.
+ */
+static ib_status_t kvdisconnect(
+    ib_kvstore_t *kvstore,
+    ib_kvstore_cbdata_t *cbdata)
+{
+    assert(kvstore != NULL);
+
+    kvlog_server_t *server = (kvlog_server_t *)kvstore->server;
+
+    pthread_mutex_lock(&s_servers_lock);
+    if (
+        server->connections > 0 &&
+        --server->connections == 0 &&
+        server->pid != 0
+    ) {
+        kvlog_close(server);
+    }
+    pthread_mutex_unlock(&s_servers_lock);
+
+    return IB_OK;
+}
+
+static ib_status_t kvget(
+    ib_kvstore_t             *kvstore,
+    ib_mm_t                   mm,
+    const ib_kvstore_key_t   *key,
+    ib_kvstore_value_t     ***values,
+    size_t                   *values_length,
+    ib_kvstore_cbdata_t      *cbdata
+)
+{
+    assert(kvstore != NULL);
+    assert(key != NULL);
+
+    kvlog_server_t     *server = (kvlog_server_t *)kvstore->server;
+    kvlog_entry_t      *entry;
+    kvlog_record_t      record;
+    ib_kvstore_value_t *value;
+    const uint8_t      *key_data;
+    size_t              key_length;
+    uint8_t            *buffer;
+    ssize_t             n;
+    ib_status_t         rc;
+
+    *values = ib_mm_alloc(mm, sizeof(**values));
+    if (*values == NULL) {
+        return IB_EALLOC;
+    }
+    rc = ib_kvstore_value_create(&value, mm);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    ib_kvstore_key_get(key, &key_data, &key_length);
+
+    rc = kvlog_acquire(server);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    entry = kvlog_index_get(server, key_data, key_length);
+    if (entry == NULL) {
+        ib_lock_unlock(server->lock);
+        return IB_ENOENT;
+    }
+    if (kvlog_expired(entry->expiration, kvlog_now())) {
+        kvlog_index_drop(server, entry);
+        ib_lock_unlock(server->lock);
+        return IB_ENOENT;
+    }
+
+    buffer = ib_mm_alloc(mm, entry->length);
+    if (buffer == NULL) {
+        ib_lock_unlock(server->lock);
+        return IB_EALLOC;
+    }
+    n = pread(entry->segment->fd, buffer, entry->length, entry->offset);
+    ib_lock_unlock(server->lock);
+
+    if (n < (ssize_t)sizeof(record)) {
+        return IB_EOTHER;
+    }
+    memcpy(&record, buffer, sizeof(record));
+    if (
+        record.magic != KVLOG_MAGIC ||
+        (size_t)n != kvlog_record_length(&record)
+    ) {
+        return IB_EOTHER;
+    }
+
+    ib_kvstore_value_type_set(
+        value,
+        (const char *)buffer + sizeof(record) + record.key_length,
+        record.type_length);
+    ib_kvstore_value_value_set(
+        value,
+        buffer + sizeof(record) + record.key_length + record.type_length,
+        record.value_length);
+    ib_kvstore_value_expiration_set(value, record.expiration);
+    ib_kvstore_value_creation_set(value, record.creation);
+
+    (*values)[0] = value;
+    *values_length = 1;
+
+    return IB_OK;
+}
+
+static ib_status_t kvset(
+    ib_kvstore_t                 *kvstore,
+    ib_kvstore_merge_policy_fn_t  merge_policy,
+    const ib_kvstore_key_t       *key,
+    ib_kvstore_value_t           *value,
+    ib_kvstore_cbdata_t          *cbdata
+)
+{
+    assert(kvstore != NULL);
+    assert(key != NULL);
+    assert(value != NULL);
+
+    kvlog_server_t  *server = (kvlog_server_t *)kvstore->server;
+    kvlog_segment_t *segment;
+    uint64_t         offset;
+    const uint8_t   *key_data;
+    size_t           key_length;
+    const char      *type;
+    size_t           type_length;
+    const uint8_t   *data;
+    size_t           data_length;
+    uint8_t         *buffer;
+    size_t           length;
+    ib_time_t        now = kvlog_now();
+    ib_time_t        ttl = ib_kvstore_value_expiration_get(value);
+    ib_time_t        creation = ib_kvstore_value_creation_get(value);
+    ib_time_t        expiration = (ttl == 0) ? 0 : now + ttl;
+    uint64_t         appended = 0;
+    ib_status_t      rc;
+
+    ib_kvstore_key_get(key, &key_data, &key_length);
+    ib_kvstore_value_type_get(value, &type, &type_length);
+    ib_kvstore_value_value_get(value, &data, &data_length);
+
+    rc = kvlog_record_build(
+        &buffer, &length, 0,
+        key_data, key_length, type, type_length, data, data_length,
+        expiration, (creation == 0) ? now : creation);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    rc = kvlog_acquire(server);
+    if (rc != IB_OK) {
+        free(buffer);
+        return rc;
+    }
+    rc = kvlog_append(server, buffer, length, &segment, &offset);
+    if (rc == IB_OK) {
+        appended = server->appended;
+        rc = kvlog_index_put(
+            server, key_data, key_length, segment, offset, length,
+            expiration);
+    }
+    ib_lock_unlock(server->lock);
+
+    if (rc == IB_OK && server->sync) {
+        rc = kvlog_sync(server, appended);
+    }
+
+    free(buffer);
+    return rc;
+}
+
+static ib_status_t kvremove(
+    ib_kvstore_t           *kvstore,
+    const ib_kvstore_key_t *key,
+    ib_kvstore_cbdata_t    *cbdata
+)
+{
+    assert(kvstore != NULL);
+    assert(key != NULL);
+
+    kvlog_server_t  *server = (kvlog_server_t *)kvstore->server;
+    kvlog_entry_t   *entry;
+    kvlog_segment_t *segment;
+    uint64_t         offset;
+    const uint8_t   *key_data;
+    size_t           key_length;
+    uint8_t         *buffer;
+    size_t           length;
+    uint64_t         appended = 0;
+    ib_status_t      rc;
+
+    ib_kvstore_key_get(key, &key_data, &key_length);
+
+    rc = kvlog_record_build(
+        &buffer, &length, KVLOG_TOMBSTONE,
+        key_data, key_length, NULL, 0, NULL, 0, 0, kvlog_now());
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    rc = kvlog_acquire(server);
+    if (rc != IB_OK) {
+        free(buffer);
+        return rc;
+    }
+    entry = kvlog_index_get(server, key_data, key_length);
+    if (entry == NULL) {
+        goto finish;
+    }
+    rc = kvlog_append(server, buffer, length, &segment, &offset);
+    if (rc != IB_OK) {
+        goto finish;
+    }
+    appended = server->appended;
+    segment->dead += length;
+    kvlog_index_drop(server, entry);
+
+finish:
+    ib_lock_unlock(server->lock);
+    if (appended > 0 && server->sync) {
+        rc = kvlog_sync(server, appended);
+    }
+    free(buffer);
+    return rc;
+}
+
+static void kvdestroy(ib_kvstore_t* kvstore, ib_kvstore_cbdata_t *cbdata)
+{
+    assert(kvstore != NULL);
+
+    kvlog_server_t *server = (kvlog_server_t *)(kvstore->server);
+
+    kvstore->server = NULL;
+
+    pthread_mutex_lock(&s_servers_lock);
+    if (--server->refs > 0) {
+        pthread_mutex_unlock(&s_servers_lock);
+        return;
+    }
+    for (
+        kvlog_server_t **link = &s_servers;
+        *link != NULL;
+        link = &(*link)->next
+    ) {
+        if (*link == server) {
+            *link = server->next;
+            break;
+        }
+    }
+    server->connections = 0;
+    if (server->pid != 0) {
+        kvlog_close(server);
+    }
+    pthread_mutex_unlock(&s_servers_lock);
+
+    pthread_cond_destroy(&server->thread_cond);
+    pthread_mutex_destroy(&server->thread_lock);
+    ib_lock_destroy_malloc(server->compact_lock);
+    ib_lock_destroy_malloc(server->sync_lock);
+    ib_lock_destroy_malloc(server->lock);
+    free(server->directory);
+    free(server);
+
+    return;
+}
+
+/**
+ * Point @a kvstore at @a server.
+ */
+static void kvlog_store_init(ib_kvstore_t *kvstore, kvlog_server_t *server)
+{
+    kvstore->server = (ib_kvstore_server_t *)server;
+    kvstore->get = kvget;
+    kvstore->set = kvset;
+    kvstore->remove = kvremove;
+    kvstore->connect = kvconnect;
+    kvstore->disconnect = kvdisconnect;
+    kvstore->destroy = kvdestroy;
+
+    kvstore->malloc_cbdata = NULL;
+    kvstore->free_cbdata = NULL;
+    kvstore->connect_cbdata = NULL;
+    kvstore->disconnect_cbdata = NULL;
+    kvstore->get_cbdata = NULL;
+    kvstore->set_cbdata = NULL;
+    kvstore->remove_cbdata = NULL;
+    kvstore->merge_policy_cbdata = NULL;
+    kvstore->destroy_cbdata = NULL;
+}
+
+ib_status_t ib_kvstore_log_init(
+    ib_kvstore_t *kvstore,
+    const char   *directory)
+{
+    assert(kvstore != NULL);
+    assert(directory != NULL);
+
+    kvlog_server_t *server;
+    char           *path;
+    ib_status_t     rc;
+
+    pthread_once(&s_crc_once, kvlog_crc_init);
+
+    /* There is no callback data used for this implementation. */
+    ib_kvstore_init(kvstore);
+
+    /* Different spellings of a directory must find the same server. A
+     * missing directory is reported when connecting. */
+    path = realpath(directory, NULL);
+    if (path == NULL) {
+        path = strdup(directory);
+        if (path == NULL) {
+            return IB_EALLOC;
+        }
+    }
+
+    pthread_mutex_lock(&s_servers_lock);
+    for (server = s_servers; server != NULL; server = server->next) {
+        if (strcmp(server->directory, path) == 0) {
+            ++server->refs;
+            pthread_mutex_unlock(&s_servers_lock);
+            free(path);
+            kvlog_store_init(kvstore, server);
+            return IB_OK;
+        }
+    }
+
+    server = calloc(1, sizeof(*server));
+    if (server == NULL) {
+        rc = IB_EALLOC;
+        goto finish;
+    }
+    server->directory = path;
+    path = NULL;
+    server->lock_fd = -1;
+
+    rc = ib_lock_create_malloc(&server->lock);
+    if (rc != IB_OK) {
+        goto failure;
+    }
+    rc = ib_lock_create_malloc(&server->compact_lock);
+    if (rc != IB_OK) {
+        goto failure;
+    }
+    rc = ib_lock_create_malloc(&server->sync_lock);
+    if (rc != IB_OK) {
+        goto failure;
+    }
+    if (pthread_mutex_init(&server->thread_lock, NULL) != 0) {
+        rc = IB_EOTHER;
+        goto failure;
+    }
+    if (pthread_cond_init(&server->thread_cond, NULL) != 0) {
+        pthread_mutex_destroy(&server->thread_lock);
+        rc = IB_EOTHER;
+        goto failure;
+    }
+    server->segment_size = IB_KVSTORE_LOG_DEFAULT_SEGMENT_SIZE;
+    server->compact_interval = IB_KVSTORE_LOG_DEFAULT_COMPACT_INTERVAL;
+    server->compact_percent = IB_KVSTORE_LOG_DEFAULT_COMPACT_PERCENT;
+
+    server->refs = 1;
+    server->next = s_servers;
+    s_servers = server;
+
+    kvlog_store_init(kvstore, server);
+    goto finish;
+
+failure:
+    if (server->sync_lock != NULL) {
+        ib_lock_destroy_malloc(server->sync_lock);
+    }
+    if (server->compact_lock != NULL) {
+        ib_lock_destroy_malloc(server->compact_lock);
+    }
+    if (server->lock != NULL) {
+        ib_lock_destroy_malloc(server->lock);
+    }
+    free(server->directory);
+    free(server);
+
+finish:
+    pthread_mutex_unlock(&s_servers_lock);
+    free(path);
+    return rc;
+}
+
+void ib_kvstore_log_set_segment_size(ib_kvstore_t *kvstore, size_t size)
+{
+    assert(kvstore != NULL);
+    assert(kvstore->server != NULL);
+
+    kvlog_server_t *server = (kvlog_server_t *)(kvstore->server);
+    server->segment_size = size;
+}
+
+void ib_kvstore_log_set_sync(ib_kvstore_t *kvstore, bool sync)
+{
+    assert(kvstore != NULL);
+    assert(kvstore->server != NULL);
+
+    kvlog_server_t *server = (kvlog_server_t *)(kvstore->server);
+    server->sync = sync;
+}
+
+void ib_kvstore_log_set_compaction(
+    ib_kvstore_t *kvstore,
+    unsigned      interval,
+    unsigned      percent)
+{
+    assert(kvstore != NULL);
+    assert(kvstore->server != NULL);
+
+    kvlog_server_t *server = (kvlog_server_t *)(kvstore->server);
+    server->compact_interval = interval;
+    server->compact_percent = percent;
+}
+
+ib_status_t ib_kvstore_log_compact(ib_kvstore_t *kvstore)
+{
+    assert(kvstore != NULL);
+    assert(kvstore->server != NULL);
+
+    kvlog_server_t *server = (kvlog_server_t *)(kvstore->server);
+    ib_status_t     rc;
+
+    rc = kvlog_acquire(server);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    ib_lock_unlock(server->lock);
+
+    return kvlog_compact(server);
+}
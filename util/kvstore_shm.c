@@ -0,0 +1,761 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronBee --- Persist to a shared memory mapped hash table.
+ */
+
+#include "ironbee_config_auto.h"
+
+#include <ironbee/kvstore_shm.h>
+
+#include "kvstore_private.h"
+
+#include <ironbee/clock.h>
+#include <ironbee/hash.h>
+#include <ironbee/kvstore.h>
+#include <ironbee/util.h>
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/**
+ * Magic number identifying a store file ("IBKV").
+ */
+#define KVSHM_MAGIC 0x49424b56
+
+/**
+ * Version of the store file layout.
+ */
+#define KVSHM_VERSION 1
+
+/**
+ * Maximum number of stripes.
+ */
+#define KVSHM_MAX_STRIPES 64
+
+/**
+ * Alignment of stripes and of the first slot.
+ */
+#define KVSHM_ALIGN 64
+
+/**
+ * Round @a n up to a multiple of KVSHM_ALIGN.
+ */
+#define KVSHM_ROUND(n) (((n) + KVSHM_ALIGN - 1) & ~(size_t)(KVSHM_ALIGN - 1))
+
+/**
+ * The default fmode for the created file.
+ */
+static const mode_t DEFAULT_FILE_MODE = 0644;
+
+/**
+ * Slot states.
+ */
+enum {
+    KVSHM_EMPTY   = 0, /**< Never used; ends a probe sequence. */
+    KVSHM_USED    = 1, /**< Holds an entry. */
+    KVSHM_DELETED = 2  /**< Tombstone; reusable but continues a probe. */
+};
+
+/**
+ * Header at the start of the file.
+ */
+typedef struct {
+    uint32_t magic;            /**< KVSHM_MAGIC once initialized. */
+    uint32_t version;          /**< KVSHM_VERSION. */
+    uint32_t num_stripes;      /**< Number of stripes. */
+    uint32_t slots_per_stripe; /**< Slots in each stripe. */
+    uint32_t slot_size;        /**< Size of each slot. */
+    uint32_t seed;             /**< Hash randomizer. */
+    uint64_t length;           /**< Total file length. */
+} kvshm_header_t;
+
+/**
+ * A stripe of slots and its lock.
+ */
+typedef struct {
+    pthread_mutex_t lock; /**< Process shared lock for the stripe's slots. */
+    uint32_t        used; /**< Slots in state KVSHM_USED. */
+} kvshm_stripe_t;
+
+/**
+ * Header of a slot; the key, type and value follow it.
+ */
+typedef struct {
+    uint32_t  state;        /**< KVSHM_EMPTY, KVSHM_USED or KVSHM_DELETED. */
+    uint32_t  hash;         /**< Hash of the key. */
+    uint32_t  key_length;   /**< Length of the key. */
+    uint32_t  type_length;  /**< Length of the type. */
+    uint32_t  value_length; /**< Length of the value. */
+    uint32_t  reserved;     /**< Padding. */
+    ib_time_t expiration;   /**< Absolute expiration; 0 for never. */
+    ib_time_t creation;     /**< Creation time. */
+} kvshm_slot_t;
+
+/**
+ * Server object.
+ */
+typedef struct {
+    char            *path;             /**< File to map. */
+    mode_t           fmode;            /**< Mode of a created file. */
+    size_t           slots;            /**< Requested slots. */
+    size_t           slot_size;        /**< Requested slot size. */
+    kvshm_header_t  *header;           /**< Mapping or NULL. */
+    size_t           stripe_stride;    /**< Size of a stripe record. */
+    size_t           slots_offset;     /**< Offset of the first slot. */
+} kvshm_server_t;
+
+/**
+ * Stripe @a i of @a server.
+ */
+static kvshm_stripe_t *kvshm_stripe(const kvshm_server_t *server, size_t i)
+{
+    return (kvshm_stripe_t *)(
+        (char *)server->header + KVSHM_ROUND(sizeof(kvshm_header_t)) +
+        i * server->stripe_stride);
+}
+
+/**
+ * Slot @a i of stripe @a stripe of @a server.
+ */
+static kvshm_slot_t *kvshm_slot(
+    const kvshm_server_t *server,
+    size_t                stripe,
+    size_t                i)
+{
+    const kvshm_header_t *header = server->header;
+
+    return (kvshm_slot_t *)(
+        (char *)header + server->slots_offset +
+        ((size_t)stripe * header->slots_per_stripe + i) * header->slot_size);
+}
+
+/**
+ * Lock a stripe, recovering it if its previous owner died.
+ *
+ * Slots are marked KVSHM_DELETED while being written so a stripe whose
+ * owner died is consistent.
+ */
+static ib_status_t kvshm_lock(kvshm_stripe_t *stripe)
+{
+    int sys_rc = pthread_mutex_lock(&stripe->lock);
+
+#if defined(__linux__) || defined(__FreeBSD__)
+    if (sys_rc == EOWNERDEAD) {
+        sys_rc = pthread_mutex_consistent(&stripe->lock);
+    }
+#endif
+
+    return (sys_rc == 0) ? IB_OK : IB_EOTHER;
+}
+
+/**
+ * Initialize the header and stripe locks of a new file.
+ */
+static ib_status_t kvshm_format(
+    kvshm_server_t *server,
+    uint32_t        num_stripes,
+    uint32_t        slots_per_stripe,
+    uint32_t        slot_size,
+    uint64_t        length)
+{
+    kvshm_header_t      *header = server->header;
+    pthread_mutexattr_t  attr;
+    ib_timeval_t         tv;
+    ib_status_t          rc = IB_OK;
+
+    if (pthread_mutexattr_init(&attr) != 0) {
+        return IB_EOTHER;
+    }
+    if (pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED) != 0) {
+        rc = IB_EOTHER;
+        goto finish;
+    }
+#if defined(__linux__) || defined(__FreeBSD__)
+    if (pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST) != 0) {
+        rc = IB_EOTHER;
+        goto finish;
+    }
+#endif
+
+    header->version          = KVSHM_VERSION;
+    header->num_stripes      = num_stripes;
+    header->slots_per_stripe = slots_per_stripe;
+    header->slot_size        = slot_size;
+    header->length           = length;
+    ib_clock_gettimeofday(&tv);
+    header->seed             = (uint32_t)(tv.tv_usec ^ tv.tv_sec ^ getpid());
+
+    for (uint32_t i = 0; i < num_stripes; ++i) {
+        if (pthread_mutex_init(&kvshm_stripe(server, i)->lock, &attr) != 0) {
+            rc = IB_EOTHER;
+            goto finish;
+        }
+    }
+
+    /* Publish last; other processes check the magic under flock(). */
+    header->magic = KVSHM_MAGIC;
+
+finish:
+    pthread_mutexattr_destroy(&attr);
+    return rc;
+}
+
+/**
+ * Map the file, creating and formatting it if it is new.
+ */
+static ib_status_t kvconnect(
+    ib_kvstore_t *kvstore,
+    ib_kvstore_cbdata_t *cbdata)
+{
+    assert(kvstore != NULL);
+
+    kvshm_server_t *server = (kvshm_server_t *)kvstore->server;
+    ib_status_t     rc     = IB_OK;
+    struct stat     sb;
+    uint32_t        num_stripes;
+    uint32_t        slots_per_stripe;
+    uint64_t        length;
+    void           *map;
+    int             fd;
+
+    if (server->header != NULL) {
+        return IB_OK;
+    }
+
+    num_stripes = KVSHM_MAX_STRIPES;
+    if (server->slots < num_stripes) {
+        num_stripes = server->slots;
+    }
+    slots_per_stripe = (server->slots + num_stripes - 1) / num_stripes;
+    server->stripe_stride = KVSHM_ROUND(sizeof(kvshm_stripe_t));
+
+    fd = open(server->path, O_RDWR | O_CREAT, server->fmode);
+    if (fd < 0) {
+        ib_util_log_error("kvstore: Failed to open \"%s\": %s",
+                          server->path, strerror(errno));
+        return IB_EOTHER;
+    }
+    if (flock(fd, LOCK_EX) != 0 || fstat(fd, &sb) != 0) {
+        rc = IB_EOTHER;
+        goto finish;
+    }
+
+    if (sb.st_size == 0) {
+        server->slots_offset =
+            KVSHM_ROUND(sizeof(kvshm_header_t)) +
+            num_stripes * server->stripe_stride;
+        length = server->slots_offset +
+            (uint64_t)num_stripes * slots_per_stripe * server->slot_size;
+        if (ftruncate(fd, length) != 0) {
+            rc = IB_EOTHER;
+            goto finish;
+        }
+    }
+    else if ((uint64_t)sb.st_size < sizeof(kvshm_header_t)) {
+        ib_util_log_error("kvstore: \"%s\" is not a shared memory store.",
+                          server->path);
+        rc = IB_EINVAL;
+        goto finish;
+    }
+    else {
+        length = sb.st_size;
+    }
+
+    map = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        rc = IB_EOTHER;
+        goto finish;
+    }
+    server->header = (kvshm_header_t *)map;
+
+    if (sb.st_size == 0) {
+        rc = kvshm_format(
+            server, num_stripes, slots_per_stripe, server->slot_size, length);
+    }
+    else if (
+        server->header->magic != KVSHM_MAGIC ||
+        server->header->version != KVSHM_VERSION ||
+        server->header->length != length ||
+        server->header->num_stripes == 0 ||
+        server->header->num_stripes > KVSHM_MAX_STRIPES
+    ) {
+        ib_util_log_error("kvstore: \"%s\" is not a shared memory store.",
+                          server->path);
+        rc = IB_EINVAL;
+    }
+    else {
+        server->slots_offset =
+            KVSHM_ROUND(sizeof(kvshm_header_t)) +
+            server->header->num_stripes * server->stripe_stride;
+    }
+
+    if (rc != IB_OK) {
+        munmap(map, length);
+        server->header = NULL;
+    }
+
+finish:
+    /* The lock only serializes creating and checking the file; it is
+     * released here.  Unlock explicitly: the mapping keeps the open file,
+     * and so the flock(), alive after close(). */
+    flock(fd, LOCK_UN);
+    close(fd);
+    return rc;
+}
+
+static ib_status_t kvdisconnect(
+    ib_kvstore_t *kvstore,
+    ib_kvstore_cbdata_t *cbdata)
+{
+    assert(kvstore != NULL);
+
+    kvshm_server_t *server = (kvshm_server_t *)kvstore->server;
+
+    if (server->header != NULL) {
+        munmap(server->header, server->header->length);
+        server->header = NULL;
+    }
+
+    return IB_OK;
+}
+
+/**
+ * Current time.
+ */
+static ib_time_t kvshm_now(void)
+{
+    ib_timeval_t tv;
+
+    ib_clock_gettimeofday(&tv);
+    return IB_CLOCK_TIMEVAL_TIME(tv);
+}
+
+/**
+ * Turn @a slot at index @a i of stripe @a s into a tombstone.
+ *
+ * If the following slot is empty, no probe sequence continues past @a slot
+ * and it and any tombstones before it become empty.
+ */
+static void kvshm_delete(
+    const kvshm_server_t *server,
+    kvshm_stripe_t       *stripe,
+    size_t                s,
+    size_t                i)
+{
+    size_t n = server->header->slots_per_stripe;
+
+    kvshm_slot(server, s, i)->state = KVSHM_DELETED;
+    --stripe->used;
+
+    if (kvshm_slot(server, s, (i + 1) % n)->state != KVSHM_EMPTY) {
+        return;
+    }
+    for (size_t j = 0; j < n; ++j) {
+        kvshm_slot_t *slot = kvshm_slot(server, s, (i + n - j) % n);
+        if (slot->state != KVSHM_DELETED) {
+            break;
+        }
+        slot->state = KVSHM_EMPTY;
+    }
+}
+
+/**
+ * Find @a key in stripe @a s, dropping expired entries on the way.
+ *
+ * Must be called with the stripe locked.
+ *
+ * @param[in]  server     Server.
+ * @param[in]  s          Stripe index.
+ * @param[in]  hash       Hash of the key.
+ * @param[in]  key        Key data.
+ * @param[in]  key_length Length of @a key.
+ * @param[out] free_index If not NULL, set to the index of the first
+ *                        reusable slot seen or to -1 if there is none.
+ * @returns Index of the entry or -1.
+ */
+static ssize_t kvshm_find(
+    const kvshm_server_t *server,
+    size_t                s,
+    uint32_t              hash,
+    const uint8_t        *key,
+    size_t                key_length,
+    ssize_t              *free_index)
+{
+    kvshm_stripe_t *stripe = kvshm_stripe(server, s);
+    size_t          n      = server->header->slots_per_stripe;
+    size_t          home   = (hash / server->header->num_stripes) % n;
+    ib_time_t       now    = 0;
+
+    if (free_index != NULL) {
+        *free_index = -1;
+    }
+
+    for (size_t probe = 0; probe < n; ++probe) {
+        size_t        i    = (home + probe) % n;
+        kvshm_slot_t *slot = kvshm_slot(server, s, i);
+
+        if (slot->state == KVSHM_EMPTY) {
+            if (free_index != NULL && *free_index < 0) {
+                *free_index = i;
+            }
+            return -1;
+        }
+
+        if (slot->state == KVSHM_USED && slot->expiration != 0) {
+            if (now == 0) {
+                now = kvshm_now();
+            }
+            if (now > slot->expiration) {
+                kvshm_delete(server, stripe, s, i);
+            }
+        }
+
+        if (slot->state != KVSHM_USED) {
+            if (free_index != NULL && *free_index < 0) {
+                *free_index = i;
+            }
+            continue;
+        }
+
+        if (
+            slot->hash == hash &&
+            slot->key_length == key_length &&
+            memcmp(slot + 1, key, key_length) == 0
+        ) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * Hash @a key for @a server and pick its stripe.
+ */
+static void kvshm_hash(
+    const kvshm_server_t   *server,
+    const ib_kvstore_key_t *key,
+    const uint8_t         **key_data,
+    size_t                 *key_length,
+    uint32_t               *hash,
+    size_t                 *s)
+{
+    ib_kvstore_key_get(key, key_data, key_length);
+    *hash = ib_hashfunc_fast(
+        (const char *)*key_data, *key_length, server->header->seed, NULL);
+    *s = *hash % server->header->num_stripes;
+}
+
+static ib_status_t kvget(
+    ib_kvstore_t             *kvstore,
+    ib_mm_t                   mm,
+    const ib_kvstore_key_t   *key,
+    ib_kvstore_value_t     ***values,
+    size_t                   *values_length,
+    ib_kvstore_cbdata_t      *cbdata
+)
+{
+    assert(kvstore != NULL);
+    assert(key != NULL);
+
+    kvshm_server_t      *server = (kvshm_server_t *)kvstore->server;
+    kvshm_stripe_t      *stripe;
+    kvshm_slot_t        *slot;
+    ib_kvstore_value_t  *value;
+    const uint8_t       *key_data;
+    size_t               key_length;
+    uint32_t             hash;
+    size_t               s;
+    ssize_t              i;
+    char                *type;
+    uint8_t             *data;
+    ib_status_t          rc;
+
+    if (server->header == NULL) {
+        return IB_EOTHER;
+    }
+
+    *values = ib_mm_alloc(mm, sizeof(**values));
+    if (*values == NULL) {
+        return IB_EALLOC;
+    }
+    rc = ib_kvstore_value_create(&value, mm);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    kvshm_hash(server, key, &key_data, &key_length, &hash, &s);
+    stripe = kvshm_stripe(server, s);
+    rc = kvshm_lock(stripe);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    i = kvshm_find(server, s, hash, key_data, key_length, NULL);
+    if (i < 0) {
+        pthread_mutex_unlock(&stripe->lock);
+        return IB_ENOENT;
+    }
+    slot = kvshm_slot(server, s, i);
+
+    /* One copy of type and value; the extra byte keeps it non-NULL. */
+    type = ib_mm_alloc(mm, slot->type_length + slot->value_length + 1);
+    if (type == NULL) {
+        pthread_mutex_unlock(&stripe->lock);
+        return IB_EALLOC;
+    }
+    memcpy(type, (const uint8_t *)(slot + 1) + slot->key_length,
+           slot->type_length + slot->value_length);
+    data = (uint8_t *)type + slot->type_length;
+    ib_kvstore_value_type_set(value, type, slot->type_length);
+    ib_kvstore_value_value_set(value, data, slot->value_length);
+    ib_kvstore_value_expiration_set(value, slot->expiration);
+    ib_kvstore_value_creation_set(value, slot->creation);
+
+    pthread_mutex_unlock(&stripe->lock);
+
+    (*values)[0] = value;
+    *values_length = 1;
+
+    return IB_OK;
+}
+
+static ib_status_t kvset(
+    ib_kvstore_t                 *kvstore,
+    ib_kvstore_merge_policy_fn_t  merge_policy,
+    const ib_kvstore_key_t       *key,
+    ib_kvstore_value_t           *value,
+    ib_kvstore_cbdata_t          *cbdata
+)
+{
+    assert(kvstore != NULL);
+    assert(key != NULL);
+    assert(value != NULL);
+
+    kvshm_server_t *server = (kvshm_server_t *)kvstore->server;
+    kvshm_stripe_t *stripe;
+    kvshm_slot_t   *slot;
+    const uint8_t  *key_data;
+    size_t          key_length;
+    const char     *type;
+    size_t          type_length;
+    const uint8_t  *data;
+    size_t          data_length;
+    uint32_t        hash;
+    size_t          s;
+    ssize_t         i;
+    ssize_t         free_index;
+    ib_time_t       now;
+    ib_time_t       ttl;
+    ib_time_t       creation;
+    ib_status_t     rc;
+
+    if (server->header == NULL) {
+        return IB_EOTHER;
+    }
+
+    kvshm_hash(server, key, &key_data, &key_length, &hash, &s);
+    ib_kvstore_value_type_get(value, &type, &type_length);
+    ib_kvstore_value_value_get(value, &data, &data_length);
+
+    if (
+        sizeof(kvshm_slot_t) + key_length + type_length + data_length >
+        server->header->slot_size
+    ) {
+        ib_util_log_debug(
+            "kvstore: Entry of %zd bytes does not fit in a %u byte slot.",
+            key_length + type_length + data_length,
+            server->header->slot_size);
+        return IB_EINVAL;
+    }
+
+    now = kvshm_now();
+    ttl = ib_kvstore_value_expiration_get(value);
+    creation = ib_kvstore_value_creation_get(value);
+
+    stripe = kvshm_stripe(server, s);
+    rc = kvshm_lock(stripe);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    i = kvshm_find(server, s, hash, key_data, key_length, &free_index);
+    if (i < 0) {
+        if (free_index < 0) {
+            pthread_mutex_unlock(&stripe->lock);
+            ib_util_log_debug("kvstore: Stripe %zd is full.", s);
+            return IB_EALLOC;
+        }
+        i = free_index;
+        ++stripe->used;
+    }
+    slot = kvshm_slot(server, s, i);
+
+    /* A writer that dies part way leaves a tombstone. */
+    slot->state        = KVSHM_DELETED;
+    slot->hash         = hash;
+    slot->key_length   = key_length;
+    slot->type_length  = type_length;
+    slot->value_length = data_length;
+    slot->expiration   = (ttl == 0) ? 0 : now + ttl;
+    slot->creation     = (creation == 0) ? now : creation;
+    memcpy((uint8_t *)(slot + 1), key_data, key_length);
+    memcpy((uint8_t *)(slot + 1) + key_length, type, type_length);
+    memcpy((uint8_t *)(slot + 1) + key_length + type_length,
+           data, data_length);
+    slot->state        = KVSHM_USED;
+
+    pthread_mutex_unlock(&stripe->lock);
+
+    return IB_OK;
+}
+
+static ib_status_t kvremove(
+    ib_kvstore_t           *kvstore,
+    const ib_kvstore_key_t *key,
+    ib_kvstore_cbdata_t    *cbdata
+)
+{
+    assert(kvstore != NULL);
+    assert(key != NULL);
+
+    kvshm_server_t *server = (kvshm_server_t *)kvstore->server;
+    kvshm_stripe_t *stripe;
+    const uint8_t  *key_data;
+    size_t          key_length;
+    uint32_t        hash;
+    size_t          s;
+    ssize_t         i;
+    ib_status_t     rc;
+
+    if (server->header == NULL) {
+        return IB_EOTHER;
+    }
+
+    kvshm_hash(server, key, &key_data, &key_length, &hash, &s);
+    stripe = kvshm_stripe(server, s);
+    rc = kvshm_lock(stripe);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    i = kvshm_find(server, s, hash, key_data, key_length, NULL);
+    if (i >= 0) {
+        kvshm_delete(server, stripe, s, i);
+    }
+
+    pthread_mutex_unlock(&stripe->lock);
+
+    return IB_OK;
+}
+
+static void kvdestroy(ib_kvstore_t* kvstore, ib_kvstore_cbdata_t *cbdata)
+{
+    assert(kvstore != NULL);
+
+    kvshm_server_t *server = (kvshm_server_t *)(kvstore->server);
+
+    kvdisconnect(kvstore, cbdata);
+    free(server->path);
+    free(server);
+    kvstore->server = NULL;
+
+    return;
+}
+
+ib_status_t ib_kvstore_shm_init(
+    ib_kvstore_t *kvstore,
+    const char   *path,
+    size_t        slots,
+    size_t        slot_size)
+{
+    assert(kvstore != NULL);
+    assert(path != NULL);
+
+    kvshm_server_t *server;
+
+    if (slots == 0) {
+        slots = IB_KVSTORE_SHM_DEFAULT_SLOTS;
+    }
+    if (slot_size == 0) {
+        slot_size = IB_KVSTORE_SHM_DEFAULT_SLOT_SIZE;
+    }
+    if (slot_size <= sizeof(kvshm_slot_t) || slot_size > UINT32_MAX) {
+        return IB_EINVAL;
+    }
+    /* Keep slot headers aligned. */
+    slot_size = (slot_size + 7) & ~(size_t)7;
+
+    /* There is no callback data used for this implementation. */
+    ib_kvstore_init(kvstore);
+
+    server = calloc(1, sizeof(*server));
+    if (server == NULL) {
+        return IB_EALLOC;
+    }
+
+    server->path = strdup(path);
+    if (server->path == NULL) {
+        free(server);
+        return IB_EALLOC;
+    }
+    server->fmode = DEFAULT_FILE_MODE;
+    server->slots = slots;
+    server->slot_size = slot_size;
+
+    kvstore->server = (ib_kvstore_server_t *)server;
+    kvstore->get = kvget;
+    kvstore->set = kvset;
+    kvstore->remove = kvremove;
+    kvstore->connect = kvconnect;
+    kvstore->disconnect = kvdisconnect;
+    kvstore->destroy = kvdestroy;
+
+    kvstore->malloc_cbdata = NULL;
+    kvstore->free_cbdata = NULL;
+    kvstore->connect_cbdata = NULL;
+    kvstore->disconnect_cbdata = NULL;
+    kvstore->get_cbdata = NULL;
+    kvstore->set_cbdata = NULL;
+    kvstore->remove_cbdata = NULL;
+    kvstore->merge_policy_cbdata = NULL;
+    kvstore->destroy_cbdata = NULL;
+
+    return IB_OK;
+}
+
+void ib_kvstore_shm_set_file_mode(ib_kvstore_t *kvstore, mode_t mode)
+{
+    assert(kvstore != NULL);
+    assert(kvstore->server != NULL);
+
+    kvshm_server_t *server = (kvshm_server_t *)(kvstore->server);
+    server->fmode = mode;
+}
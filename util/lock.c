@@ -25,6 +25,101 @@
 
 #include <ironbee/lock.h>
 
+#include <assert.h>
+#include <errno.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * Minimum busy-wait iterations of a contended spin lock.
+ */
+#define IB_SPINLOCK_SPIN_MIN 16
+
+/**
+ * Maximum busy-wait iterations of a contended spin lock.
+ */
+#define IB_SPINLOCK_SPIN_MAX 4096
+
+/**
+ * Hint to the CPU that we are busy-waiting.
+ */
+#if defined(__i386__) || defined(__x86_64__)
+#define IB_LOCK_CPU_RELAX() __asm__ __volatile__("pause" ::: "memory")
+#elif defined(__aarch64__)
+#define IB_LOCK_CPU_RELAX() __asm__ __volatile__("yield" ::: "memory")
+#else
+#define IB_LOCK_CPU_RELAX() __asm__ __volatile__("" ::: "memory")
+#endif
+
+struct ib_rwlock_t {
+    pthread_rwlock_t rwlock; /**< The lock. */
+    ib_lock_stats_t  stats;  /**< Contention statistics. */
+};
+
+struct ib_spinlock_t {
+    volatile int     locked;     /**< 1 if held. */
+    int              spin_limit; /**< Current busy-wait limit. */
+    ib_lock_stats_t  stats;      /**< Contention statistics. */
+};
+
+/**
+ * Contention hook.
+ */
+static ib_lock_contention_fn_t s_contention_fn = NULL;
+
+/**
+ * Contention hook callback data.
+ */
+static void *s_contention_cbdata = NULL;
+
+/**
+ * Current monotonic time in nanoseconds.
+ */
+static uint64_t lock_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * Record a contended acquisition of @a lock that started at @a start_ns.
+ *
+ * @param[in] lock The lock.
+ * @param[in] stats Statistics of @a lock or NULL if it has none.
+ * @param[in] start_ns When waiting started.
+ */
+static void lock_contended(
+    const void      *lock,
+    ib_lock_stats_t *stats,
+    uint64_t         start_ns
+)
+{
+    uint64_t wait_ns = lock_now_ns() - start_ns;
+    ib_lock_contention_fn_t fn = s_contention_fn;
+
+    if (stats != NULL) {
+        __sync_add_and_fetch(&stats->contended, 1);
+        __sync_add_and_fetch(&stats->wait_ns, wait_ns);
+    }
+    if (fn != NULL) {
+        fn(lock, wait_ns, s_contention_cbdata);
+    }
+}
+
+void ib_lock_contention_hook_set(
+    ib_lock_contention_fn_t  fn,
+    void                    *cbdata
+)
+{
+    s_contention_cbdata = cbdata;
+    s_contention_fn = fn;
+    __sync_synchronize();
+}
+
 static void lock_destroy(void *cbdata)
 {
     ib_lock_t *lock = (ib_lock_t *)cbdata;
@@ -99,7 +194,27 @@ void ib_lock_destroy_malloc(ib_lock_t *lock)
 
 ib_status_t ib_lock_lock(ib_lock_t *lock)
 {
-    int rc = pthread_mutex_lock(lock);
+    int rc;
+
+    /* Only pay for timing if the hook wants it and the lock is held. */
+    if (s_contention_fn != NULL) {
+        rc = pthread_mutex_trylock(lock);
+        if (rc == 0) {
+            return IB_OK;
+        }
+        if (rc == EBUSY) {
+            uint64_t start_ns = lock_now_ns();
+
+            rc = pthread_mutex_lock(lock);
+            if (rc != 0) {
+                return IB_EUNKNOWN;
+            }
+            lock_contended(lock, NULL, start_ns);
+            return IB_OK;
+        }
+    }
+
+    rc = pthread_mutex_lock(lock);
     if (rc != 0) {
         return IB_EUNKNOWN;
     }
@@ -116,3 +231,296 @@ ib_status_t ib_lock_unlock(ib_lock_t *lock)
 
     return IB_OK;
 }
+
+/**
+ * Initialize @a lock.
+ *
+ * @param[in] lock The lock.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC On failure.
+ */
+static ib_status_t rwlock_init(ib_rwlock_t *lock)
+{
+    pthread_rwlockattr_t attr;
+    int                  rc;
+
+    rc = pthread_rwlockattr_init(&attr);
+    if (rc != 0) {
+        return IB_EALLOC;
+    }
+#ifdef PTHREAD_RWLOCK_WRITER_NONRECURSIVE_INITIALIZER_NP
+    /* glibc prefers readers by default, which can starve writers. */
+    pthread_rwlockattr_setkind_np(
+        &attr,
+        PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP
+    );
+#endif
+    rc = pthread_rwlock_init(&lock->rwlock, &attr);
+    pthread_rwlockattr_destroy(&attr);
+    if (rc != 0) {
+        return IB_EALLOC;
+    }
+
+    memset(&lock->stats, 0, sizeof(lock->stats));
+
+    return IB_OK;
+}
+
+static void rwlock_destroy(void *cbdata)
+{
+    ib_rwlock_t *lock = (ib_rwlock_t *)cbdata;
+
+    if (lock == NULL) {
+        return;
+    }
+
+    pthread_rwlock_destroy(&lock->rwlock);
+}
+
+ib_status_t ib_rwlock_create(ib_rwlock_t **lock, ib_mm_t mm)
+{
+    ib_rwlock_t *l;
+    ib_status_t  rc;
+
+    l = ib_mm_alloc(mm, sizeof(*l));
+    if (l == NULL) {
+        return IB_EALLOC;
+    }
+
+    rc = rwlock_init(l);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    rc = ib_mm_register_cleanup(mm, &rwlock_destroy, l);
+    if (rc != IB_OK) {
+        return IB_EOTHER;
+    }
+
+    *lock = l;
+
+    return IB_OK;
+}
+
+ib_status_t ib_rwlock_create_malloc(ib_rwlock_t **lock)
+{
+    ib_rwlock_t *l;
+    ib_status_t  rc;
+
+    l = malloc(sizeof(*l));
+    if (l == NULL) {
+        return IB_EALLOC;
+    }
+
+    rc = rwlock_init(l);
+    if (rc != IB_OK) {
+        free(l);
+        return rc;
+    }
+
+    *lock = l;
+
+    return IB_OK;
+}
+
+void ib_rwlock_destroy_malloc(ib_rwlock_t *lock)
+{
+    if (lock != NULL) {
+        rwlock_destroy(lock);
+
+        free(lock);
+    }
+}
+
+ib_status_t ib_rwlock_rdlock(ib_rwlock_t *lock)
+{
+    assert(lock != NULL);
+
+    int rc = pthread_rwlock_tryrdlock(&lock->rwlock);
+    if (rc == EBUSY) {
+        uint64_t start_ns = lock_now_ns();
+
+        rc = pthread_rwlock_rdlock(&lock->rwlock);
+        if (rc == 0) {
+            lock_contended(lock, &lock->stats, start_ns);
+        }
+    }
+    if (rc != 0) {
+        return IB_EUNKNOWN;
+    }
+
+    return IB_OK;
+}
+
+ib_status_t ib_rwlock_wrlock(ib_rwlock_t *lock)
+{
+    assert(lock != NULL);
+
+    int rc = pthread_rwlock_trywrlock(&lock->rwlock);
+    if (rc == EBUSY) {
+        uint64_t start_ns = lock_now_ns();
+
+        rc = pthread_rwlock_wrlock(&lock->rwlock);
+        if (rc == 0) {
+            lock_contended(lock, &lock->stats, start_ns);
+        }
+    }
+    if (rc != 0) {
+        return IB_EUNKNOWN;
+    }
+
+    /* Exclusive, so no atomic needed. */
+    ++lock->stats.acquired;
+
+    return IB_OK;
+}
+
+ib_status_t ib_rwlock_unlock(ib_rwlock_t *lock)
+{
+    assert(lock != NULL);
+
+    int rc = pthread_rwlock_unlock(&lock->rwlock);
+    if (rc != 0) {
+        return IB_EUNKNOWN;
+    }
+
+    return IB_OK;
+}
+
+void ib_rwlock_stats_get(
+    const ib_rwlock_t *lock,
+    ib_lock_stats_t   *stats
+)
+{
+    assert(lock != NULL);
+    assert(stats != NULL);
+
+    *stats = lock->stats;
+}
+
+/**
+ * Initialize @a lock.
+ *
+ * @param[in] lock The lock.
+ */
+static void spinlock_init(ib_spinlock_t *lock)
+{
+    lock->locked = 0;
+    lock->spin_limit = IB_SPINLOCK_SPIN_MIN;
+    memset(&lock->stats, 0, sizeof(lock->stats));
+}
+
+ib_status_t ib_spinlock_create(ib_spinlock_t **lock, ib_mm_t mm)
+{
+    ib_spinlock_t *l;
+
+    l = ib_mm_alloc(mm, sizeof(*l));
+    if (l == NULL) {
+        return IB_EALLOC;
+    }
+    spinlock_init(l);
+
+    *lock = l;
+
+    return IB_OK;
+}
+
+ib_status_t ib_spinlock_create_malloc(ib_spinlock_t **lock)
+{
+    ib_spinlock_t *l;
+
+    l = malloc(sizeof(*l));
+    if (l == NULL) {
+        return IB_EALLOC;
+    }
+    spinlock_init(l);
+
+    *lock = l;
+
+    return IB_OK;
+}
+
+void ib_spinlock_destroy_malloc(ib_spinlock_t *lock)
+{
+    free(lock);
+}
+
+ib_status_t ib_spinlock_lock(ib_spinlock_t *lock)
+{
+    assert(lock != NULL);
+
+    uint64_t start_ns;
+    int      spins = 0;
+    int      limit;
+
+    if (__sync_lock_test_and_set(&lock->locked, 1) == 0) {
+        ++lock->stats.acquired;
+        return IB_OK;
+    }
+
+    start_ns = lock_now_ns();
+    limit = lock->spin_limit;
+    do {
+        /* Wait on a read so the cache line is shared while held. */
+        while (lock->locked) {
+            if (spins < limit) {
+                IB_LOCK_CPU_RELAX();
+                ++spins;
+            }
+            else {
+                sched_yield();
+            }
+        }
+    } while (__sync_lock_test_and_set(&lock->locked, 1) != 0);
+
+    /* Held: adapt the limit towards twice what this wait needed, so that
+     * short waits keep spinning and long ones soon stop wasting CPU. */
+    limit = spins * 2;
+    if (limit > IB_SPINLOCK_SPIN_MAX) {
+        limit = IB_SPINLOCK_SPIN_MAX;
+    }
+    lock->spin_limit += (limit - lock->spin_limit) / 8;
+    if (lock->spin_limit < IB_SPINLOCK_SPIN_MIN) {
+        lock->spin_limit = IB_SPINLOCK_SPIN_MIN;
+    }
+
+    ++lock->stats.acquired;
+    lock->stats.spins += spins;
+    lock_contended(lock, &lock->stats, start_ns);
+
+    return IB_OK;
+}
+
+ib_status_t ib_spinlock_trylock(ib_spinlock_t *lock)
+{
+    assert(lock != NULL);
+
+    if (lock->locked || __sync_lock_test_and_set(&lock->locked, 1) != 0) {
+        return IB_EAGAIN;
+    }
+    ++lock->stats.acquired;
+
+    return IB_OK;
+}
+
+ib_status_t ib_spinlock_unlock(ib_spinlock_t *lock)
+{
+    assert(lock != NULL);
+
+    __sync_lock_release(&lock->locked);
+
+    return IB_OK;
+}
+
+void ib_spinlock_stats_get(
+    const ib_spinlock_t *lock,
+    ib_lock_stats_t     *stats
+)
+{
+    assert(lock != NULL);
+    assert(stats != NULL);
+
+    *stats = lock->stats;
+}
@@ -36,10 +36,12 @@
 #endif
 
 #include <assert.h>
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/mman.h>
 
 
 /**
@@ -438,6 +440,16 @@ struct ib_mpool_t
      * @sa ib_mpool_t
      **/
     ib_mpool_t              *free_children;
+
+    /**
+     * Pages and this structure come from and return to the page cache.
+     *
+     * Set at creation for pools with the default page size, malloc() and
+     * free() while the page cache is enabled.
+     *
+     * @sa ib_mpool_page_cache_configure()
+     **/
+    bool page_cached;
 };
 
 /**
@@ -588,6 +600,547 @@ void ib_mpool_remove_child_from_parent(const ib_mpool_t *child)
 
 /**@}*/
 
+/**
+ * @name Page cache.
+ *
+ * Pools with page_cached set take pages and pool structures from a cache
+ * local to the calling thread.  Full thread caches spill half of their
+ * pages into a shared depot protected by a mutex; empty ones refill from it
+ * in batches so that the depot lock is rarely taken.
+ *
+ * @sa ib_mpool_page_cache_configure()
+ */
+/**@{*/
+
+/** Default number of pages each thread may cache. */
+#define IB_MPOOL_PAGE_CACHE_THREAD_PAGES 32
+/** Default number of pages the depot may hold. */
+#define IB_MPOOL_PAGE_CACHE_DEPOT_PAGES 256
+/** Number of pool structures each thread may cache. */
+#define IB_MPOOL_PAGE_CACHE_THREAD_POOLS 64
+/** Number of pages moved from the depot to a thread cache at once. */
+#define IB_MPOOL_PAGE_CACHE_BATCH 8
+/**
+ * Page size of cached pools.
+ *
+ * This is the default page size after raising it to the minimum.
+ **/
+#define IB_MPOOL_PAGE_CACHE_PAGESIZE \
+    (IB_MPOOL_DEFAULT_PAGE_SIZE > IB_MPOOL_MINIMUM_PAGESIZE ? \
+        IB_MPOOL_DEFAULT_PAGE_SIZE : IB_MPOOL_MINIMUM_PAGESIZE)
+/** Size of a huge page slab. */
+#define IB_MPOOL_PAGE_CACHE_SLAB_SIZE (2 * 1024 * 1024)
+/** Size of a cached page including its header, rounded for alignment. */
+#define IB_MPOOL_PAGE_CACHE_STRIDE \
+    ((sizeof(ib_mpool_page_t) + IB_MPOOL_PAGE_CACHE_PAGESIZE - 1 + 15) & ~15)
+
+/** See struct ib_mpool_thread_cache_t */
+typedef struct ib_mpool_thread_cache_t ib_mpool_thread_cache_t;
+
+/**
+ * Per-thread cache of pages and pool structures.
+ *
+ * Only the owning thread touches the lists.  The counters are read by
+ * ib_mpool_page_cache_stats_get() without synchronization.
+ **/
+struct ib_mpool_thread_cache_t
+{
+    /** Singly linked list of cached pages. */
+    ib_mpool_page_t *pages;
+    /** Length of @c pages. */
+    size_t num_pages;
+    /** Singly linked list (via next) of cached pool structures. */
+    ib_mpool_t *pools;
+    /** Length of @c pools. */
+    size_t num_pools;
+    /** Counters of this thread. */
+    ib_mpool_page_cache_stats_t stats;
+    /** Previous cache in the registry. */
+    ib_mpool_thread_cache_t *prev;
+    /** Next cache in the registry. */
+    ib_mpool_thread_cache_t *next;
+};
+
+/**
+ * Global page cache state.
+ **/
+static struct
+{
+    /** Initializes @c key. */
+    pthread_once_t once;
+    /** Thread specific ib_mpool_thread_cache_t. */
+    pthread_key_t key;
+    /** Is @c key usable? */
+    bool key_valid;
+    /**
+     * Protects everything below.
+     *
+     * Pool creation reads @c enabled and @c used without it: neither
+     * changes once @c used is set.
+     */
+    pthread_mutex_t lock;
+    /** Registry of all thread caches. */
+    ib_mpool_thread_cache_t *threads;
+    /** Shared depot of pages. */
+    ib_mpool_page_t *depot;
+    /** Length of @c depot. */
+    size_t depot_size;
+    /** Counters of exited threads and of the depot. */
+    ib_mpool_page_cache_stats_t retired;
+    /** Use the cache for new pools? */
+    bool enabled;
+    /** Has a cached pool been created? */
+    bool used;
+    /** Carve pages out of huge page slabs? */
+    bool huge_pages;
+    /** Pages each thread may cache. */
+    size_t thread_pages;
+    /** Pages the depot may hold. */
+    size_t depot_pages;
+} s_page_cache = {
+    .once         = PTHREAD_ONCE_INIT,
+    .lock         = PTHREAD_MUTEX_INITIALIZER,
+#ifdef IB_MPOOL_VALGRIND
+    /* Keep every page visible to valgrind. */
+    .enabled      = false,
+#else
+    .enabled      = true,
+#endif
+    .thread_pages = IB_MPOOL_PAGE_CACHE_THREAD_PAGES,
+    .depot_pages  = IB_MPOOL_PAGE_CACHE_DEPOT_PAGES
+};
+
+static void ib_mpool_thread_cache_exit(void *data);
+
+/**
+ * Create the thread specific key.  Called via pthread_once().
+ **/
+static
+void ib_mpool_page_cache_key_create(void)
+{
+    if (pthread_key_create(
+            &s_page_cache.key,
+            ib_mpool_thread_cache_exit) == 0)
+    {
+        s_page_cache.key_valid = true;
+    }
+}
+
+/**
+ * Fetch or create the cache of the calling thread.
+ *
+ * @return Thread cache or NULL if one could not be created.
+ **/
+static
+ib_mpool_thread_cache_t *ib_mpool_thread_cache(void)
+{
+    ib_mpool_thread_cache_t *tc;
+
+    pthread_once(&s_page_cache.once, ib_mpool_page_cache_key_create);
+    if (! s_page_cache.key_valid) {
+        return NULL;
+    }
+
+    tc = pthread_getspecific(s_page_cache.key);
+    if (tc != NULL) {
+        return tc;
+    }
+
+    tc = calloc(1, sizeof(*tc));
+    if (tc == NULL) {
+        return NULL;
+    }
+    if (pthread_setspecific(s_page_cache.key, tc) != 0) {
+        free(tc);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&s_page_cache.lock);
+    tc->next = s_page_cache.threads;
+    if (tc->next != NULL) {
+        tc->next->prev = tc;
+    }
+    s_page_cache.threads = tc;
+    pthread_mutex_unlock(&s_page_cache.lock);
+
+    return tc;
+}
+
+/**
+ * Add the counters of @a from to @a to.
+ *
+ * @param[in] to   Counters to add to.
+ * @param[in] from Counters to add.
+ **/
+static
+void ib_mpool_page_cache_stats_add(
+    ib_mpool_page_cache_stats_t       *to,
+    const ib_mpool_page_cache_stats_t *from
+)
+{
+    to->page_hits   += from->page_hits;
+    to->page_misses += from->page_misses;
+    to->page_frees  += from->page_frees;
+    to->pool_hits   += from->pool_hits;
+    to->pool_misses += from->pool_misses;
+    to->slabs       += from->slabs;
+}
+
+/**
+ * Move the list of @a n pages at @a pages to the depot.
+ *
+ * Pages that do not fit are freed unless they come from huge page slabs.
+ *
+ * @param[in] pages List of pages.
+ * @param[in] n     Length of @a pages.
+ **/
+static
+void ib_mpool_page_cache_depot_put(ib_mpool_page_t *pages, size_t n)
+{
+    ib_mpool_page_t *excess = NULL;
+
+    pthread_mutex_lock(&s_page_cache.lock);
+    IB_MPOOL_FOREACH(ib_mpool_page_t, mpage, pages) {
+        if (
+            s_page_cache.huge_pages ||
+            s_page_cache.depot_size < s_page_cache.depot_pages
+        ) {
+            mpage->next = s_page_cache.depot;
+            s_page_cache.depot = mpage;
+            ++s_page_cache.depot_size;
+        }
+        else {
+            mpage->next = excess;
+            excess = mpage;
+            ++s_page_cache.retired.page_frees;
+        }
+        --n;
+    }
+    pthread_mutex_unlock(&s_page_cache.lock);
+    assert(n == 0);
+
+    IB_MPOOL_FOREACH(ib_mpool_page_t, mpage, excess) {
+        free(mpage);
+    }
+}
+
+/**
+ * Map a huge page slab and carve it into pages.
+ *
+ * @param[out] n Number of pages carved.
+ * @return List of pages or NULL on failure.
+ **/
+static
+ib_mpool_page_t *ib_mpool_page_cache_slab(size_t *n)
+{
+    void *slab = MAP_FAILED;
+    ib_mpool_page_t *pages = NULL;
+
+#ifdef MAP_HUGETLB
+    slab = mmap(NULL, IB_MPOOL_PAGE_CACHE_SLAB_SIZE, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+    if (slab == MAP_FAILED) {
+        /* No reserved huge pages; ask for transparent ones. */
+        slab = mmap(NULL, IB_MPOOL_PAGE_CACHE_SLAB_SIZE,
+                    PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                    -1, 0);
+        if (slab == MAP_FAILED) {
+            return NULL;
+        }
+#ifdef MADV_HUGEPAGE
+        madvise(slab, IB_MPOOL_PAGE_CACHE_SLAB_SIZE, MADV_HUGEPAGE);
+#endif
+    }
+
+    *n = IB_MPOOL_PAGE_CACHE_SLAB_SIZE / IB_MPOOL_PAGE_CACHE_STRIDE;
+    for (size_t i = *n; i > 0; --i) {
+        ib_mpool_page_t *mpage = (ib_mpool_page_t *)(
+            (char *)slab + (i - 1) * IB_MPOOL_PAGE_CACHE_STRIDE);
+        mpage->next = pages;
+        pages = mpage;
+    }
+
+    return pages;
+}
+
+/**
+ * Take a page from the page cache.
+ *
+ * @return Uninitialized page of IB_MPOOL_PAGE_CACHE_PAGESIZE or NULL on
+ *         allocation error.
+ **/
+static
+ib_mpool_page_t *ib_mpool_page_cache_acquire(void)
+{
+    ib_mpool_thread_cache_t *tc = ib_mpool_thread_cache();
+    ib_mpool_page_t *mpage;
+
+    if (tc != NULL) {
+        if (tc->pages == NULL && s_page_cache.depot != NULL) {
+            /* Unlocked peek above; worst case is an extra allocation. */
+            pthread_mutex_lock(&s_page_cache.lock);
+            while (
+                s_page_cache.depot != NULL &&
+                tc->num_pages < IB_MPOOL_PAGE_CACHE_BATCH
+            ) {
+                mpage = s_page_cache.depot;
+                s_page_cache.depot = mpage->next;
+                --s_page_cache.depot_size;
+                mpage->next = tc->pages;
+                tc->pages = mpage;
+                ++tc->num_pages;
+            }
+            pthread_mutex_unlock(&s_page_cache.lock);
+        }
+        if (tc->pages != NULL) {
+            mpage = tc->pages;
+            tc->pages = mpage->next;
+            --tc->num_pages;
+            ++tc->stats.page_hits;
+            return mpage;
+        }
+    }
+
+    if (! s_page_cache.huge_pages) {
+        mpage = malloc(
+            sizeof(ib_mpool_page_t) + IB_MPOOL_PAGE_CACHE_PAGESIZE - 1
+        );
+        if (mpage != NULL) {
+            if (tc != NULL) {
+                ++tc->stats.page_misses;
+            }
+            else {
+                __sync_add_and_fetch(&s_page_cache.retired.page_misses, 1);
+            }
+        }
+        return mpage;
+    }
+
+    {
+        size_t n = 0;
+        ib_mpool_page_t *pages = ib_mpool_page_cache_slab(&n);
+
+        if (pages == NULL) {
+            return NULL;
+        }
+        mpage = pages;
+        pages = pages->next;
+        if (tc != NULL) {
+            /* Slab pages may exceed the thread limit; they spill to the
+             * depot as they are returned. */
+            tc->pages = pages;
+            tc->num_pages = n - 1;
+            ++tc->stats.slabs;
+            tc->stats.page_misses += n;
+            ++tc->stats.page_hits;
+        }
+        else {
+            ib_mpool_page_cache_depot_put(pages, n - 1);
+            pthread_mutex_lock(&s_page_cache.lock);
+            ++s_page_cache.retired.slabs;
+            s_page_cache.retired.page_misses += n;
+            ++s_page_cache.retired.page_hits;
+            pthread_mutex_unlock(&s_page_cache.lock);
+        }
+    }
+
+    return mpage;
+}
+
+/**
+ * Return a list of pages to the page cache.
+ *
+ * @param[in] pages List of pages of IB_MPOOL_PAGE_CACHE_PAGESIZE.
+ **/
+static
+void ib_mpool_page_cache_release(ib_mpool_page_t *pages)
+{
+    ib_mpool_thread_cache_t *tc = ib_mpool_thread_cache();
+
+    if (tc == NULL) {
+        size_t n = 0;
+        IB_MPOOL_FOREACH(ib_mpool_page_t, mpage, pages) {
+            ++n;
+        }
+        ib_mpool_page_cache_depot_put(pages, n);
+        return;
+    }
+
+    IB_MPOOL_FOREACH(ib_mpool_page_t, mpage, pages) {
+        if (tc->num_pages >= s_page_cache.thread_pages) {
+            /* Spill the older half to the depot. */
+            size_t keep = tc->num_pages / 2;
+            ib_mpool_page_t *last = tc->pages;
+            for (size_t i = 1; i < keep; ++i) {
+                last = last->next;
+            }
+            if (keep == 0) {
+                ib_mpool_page_cache_depot_put(tc->pages, tc->num_pages);
+                tc->pages = NULL;
+            }
+            else {
+                ib_mpool_page_cache_depot_put(
+                    last->next,
+                    tc->num_pages - keep
+                );
+                last->next = NULL;
+            }
+            tc->num_pages = keep;
+        }
+        mpage->next = tc->pages;
+        tc->pages = mpage;
+        ++tc->num_pages;
+    }
+}
+
+/**
+ * Free a pool structure and the free lists it retains.
+ *
+ * @param[in] mp Pool with no pages, children, or cleanups pending.
+ **/
+static
+void ib_mpool_free_struct(ib_mpool_t *mp)
+{
+    IB_MPOOL_FOREACH(ib_mpool_pointer_page_t, ppage, mp->free_pointer_pages) {
+        mp->free_fn(ppage);
+    }
+
+    IB_MPOOL_FOREACH(ib_mpool_cleanup_t, cleanup, mp->free_cleanups) {
+        mp->free_fn(cleanup);
+    }
+
+    ib_lock_destroy_malloc(mp->lock);
+
+    mp->free_fn(mp);
+}
+
+/**
+ * Take a pool structure from the cache of the calling thread.
+ *
+ * The structure keeps its lock and free pointer pages and cleanups; all
+ * other members are zero.
+ *
+ * @return Pool structure or NULL if the cache is empty.
+ **/
+static
+ib_mpool_t *ib_mpool_page_cache_pool_acquire(void)
+{
+    ib_mpool_thread_cache_t *tc = ib_mpool_thread_cache();
+    ib_mpool_t *mp;
+
+    if (tc == NULL) {
+        return NULL;
+    }
+    if (tc->pools == NULL) {
+        ++tc->stats.pool_misses;
+        return NULL;
+    }
+
+    mp = tc->pools;
+    tc->pools = mp->next;
+    --tc->num_pools;
+    ++tc->stats.pool_hits;
+
+    {
+        ib_lock_t               *lock               = mp->lock;
+        ib_mpool_pointer_page_t *free_pointer_pages = mp->free_pointer_pages;
+        ib_mpool_cleanup_t      *free_cleanups      = mp->free_cleanups;
+
+        memset(mp, 0, sizeof(*mp));
+        mp->lock               = lock;
+        mp->free_pointer_pages = free_pointer_pages;
+        mp->free_cleanups      = free_cleanups;
+    }
+
+    return mp;
+}
+
+/**
+ * Offer a pool structure to the cache of the calling thread.
+ *
+ * @param[in] mp Pool with no pages, children, or cleanups pending.
+ * @return true if @a mp was cached; false if the caller should free it.
+ **/
+static
+bool ib_mpool_page_cache_pool_release(ib_mpool_t *mp)
+{
+    ib_mpool_thread_cache_t *tc = ib_mpool_thread_cache();
+
+    if (tc == NULL || tc->num_pools >= IB_MPOOL_PAGE_CACHE_THREAD_POOLS) {
+        return false;
+    }
+
+    mp->next = tc->pools;
+    tc->pools = mp;
+    ++tc->num_pools;
+
+    return true;
+}
+
+/**
+ * Empty the cache @a tc.
+ *
+ * Pages go to the depot if they come from slabs or are freed otherwise.
+ *
+ * @param[in] tc Thread cache.
+ **/
+static
+void ib_mpool_thread_cache_empty(ib_mpool_thread_cache_t *tc)
+{
+    IB_MPOOL_FOREACH(ib_mpool_t, mp, tc->pools) {
+        ib_mpool_free_struct(mp);
+    }
+    tc->pools = NULL;
+    tc->num_pools = 0;
+
+    if (s_page_cache.huge_pages) {
+        ib_mpool_page_cache_depot_put(tc->pages, tc->num_pages);
+    }
+    else {
+        IB_MPOOL_FOREACH(ib_mpool_page_t, mpage, tc->pages) {
+            free(mpage);
+        }
+        tc->stats.page_frees += tc->num_pages;
+    }
+    tc->pages = NULL;
+    tc->num_pages = 0;
+}
+
+/**
+ * Thread specific data destructor: retire the cache of an exiting thread.
+ *
+ * @param[in] data Thread cache.
+ **/
+static
+void ib_mpool_thread_cache_exit(void *data)
+{
+    ib_mpool_thread_cache_t *tc = (ib_mpool_thread_cache_t *)data;
+
+    /* Keep the pages for other threads. */
+    ib_mpool_page_cache_depot_put(tc->pages, tc->num_pages);
+    tc->pages = NULL;
+    tc->num_pages = 0;
+    ib_mpool_thread_cache_empty(tc);
+
+    pthread_mutex_lock(&s_page_cache.lock);
+    if (tc->prev != NULL) {
+        tc->prev->next = tc->next;
+    }
+    else {
+        s_page_cache.threads = tc->next;
+    }
+    if (tc->next != NULL) {
+        tc->next->prev = tc->prev;
+    }
+    ib_mpool_page_cache_stats_add(&s_page_cache.retired, &tc->stats);
+    pthread_mutex_unlock(&s_page_cache.lock);
+
+    free(tc);
+}
+
+/**@}*/
+
 /**
  * @name Helper functions for managing internal memory.
  */
@@ -615,6 +1168,9 @@ ib_mpool_page_t *ib_mpool_acquire_page(
         mpage = mp->free_pages;
         mp->free_pages = mp->free_pages->next;
     }
+    else if (mp->page_cached) {
+        mpage = ib_mpool_page_cache_acquire();
+    }
     else {
         mpage = mp->malloc_fn(sizeof(ib_mpool_page_t) + mp->pagesize - 1);
     }
@@ -1442,6 +1998,22 @@ ib_status_t ib_mpool_create_ex(
         }
     }
 
+    bool page_cached =
+        s_page_cache.enabled &&
+        pagesize  == IB_MPOOL_PAGE_CACHE_PAGESIZE &&
+        malloc_fn == &malloc &&
+        free_fn   == &free;
+    if (page_cached && ! s_page_cache.used) {
+        /* Recheck under the lock, as ib_mpool_page_cache_configure() may
+         * be changing the configuration; it is frozen once used is set. */
+        pthread_mutex_lock(&s_page_cache.lock);
+        page_cached = s_page_cache.enabled;
+        if (page_cached) {
+            s_page_cache.used = true;
+        }
+        pthread_mutex_unlock(&s_page_cache.lock);
+    }
+
     bool reacquired = false;
     if (parent != NULL) {
         rc = ib_lock_lock(parent->lock);
@@ -1464,6 +2036,10 @@ ib_status_t ib_mpool_create_ex(
         }
         ib_lock_unlock(parent->lock);
     }
+    if (! reacquired && page_cached) {
+        mp = ib_mpool_page_cache_pool_acquire();
+        reacquired = (mp != NULL);
+    }
     if (! reacquired) {
         mp = (ib_mpool_t *)malloc_fn(sizeof(**pmp));
         if (mp == NULL) {
@@ -1483,6 +2059,7 @@ ib_status_t ib_mpool_create_ex(
     mp->inuse                  = 0;
     mp->large_allocation_inuse = 0;
     mp->parent                 = parent;
+    mp->page_cached            = page_cached;
 
     rc = ib_mpool_setname(mp, name);
     if (rc != IB_OK) {
@@ -1732,30 +2309,56 @@ void ib_mpool_destroy(
     ib_mpool_call_cleanups(mp);
     ib_mpool_free_large_allocations(mp);
 
-    for (size_t track_num = 0; track_num < IB_MPOOL_NUM_TRACKS; ++track_num) {
-        IB_MPOOL_FOREACH(ib_mpool_page_t, mpage, mp->tracks[track_num]) {
-            mp->free_fn(mpage);
+    if (mp->page_cached) {
+        /* Return pages to the page cache and keep the pointer pages and
+         * cleanup nodes with the structure for its next use. */
+        for (
+            size_t track_num = 0;
+            track_num < IB_MPOOL_NUM_TRACKS;
+            ++track_num
+        ) {
+            if (mp->tracks[track_num] != NULL) {
+                ib_mpool_page_cache_release(mp->tracks[track_num]);
+            }
+        }
+        if (mp->free_pages != NULL) {
+            ib_mpool_page_cache_release(mp->free_pages);
         }
-    }
-
-    IB_MPOOL_FOREACH(ib_mpool_pointer_page_t, ppage, mp->large_allocations) {
-        mp->free_fn(ppage);
-    }
 
-    IB_MPOOL_FOREACH(ib_mpool_cleanup_t, cleanup, mp->cleanups) {
-        mp->free_fn(cleanup);
+        if (mp->large_allocations != NULL) {
+            mp->large_allocations_end->next = mp->free_pointer_pages;
+            mp->free_pointer_pages          = mp->large_allocations;
+        }
+        if (mp->cleanups != NULL) {
+            mp->cleanups_end->next = mp->free_cleanups;
+            mp->free_cleanups      = mp->cleanups;
+        }
     }
+    else {
+        for (
+            size_t track_num = 0;
+            track_num < IB_MPOOL_NUM_TRACKS;
+            ++track_num
+        ) {
+            IB_MPOOL_FOREACH(ib_mpool_page_t, mpage, mp->tracks[track_num]) {
+                mp->free_fn(mpage);
+            }
+        }
 
-    IB_MPOOL_FOREACH(ib_mpool_page_t, mpage, mp->free_pages) {
-        mp->free_fn(mpage);
-    }
+        IB_MPOOL_FOREACH(
+            ib_mpool_pointer_page_t, ppage,
+            mp->large_allocations
+        ) {
+            mp->free_fn(ppage);
+        }
 
-    IB_MPOOL_FOREACH(ib_mpool_pointer_page_t, ppage, mp->free_pointer_pages) {
-        mp->free_fn(ppage);
-    }
+        IB_MPOOL_FOREACH(ib_mpool_cleanup_t, cleanup, mp->cleanups) {
+            mp->free_fn(cleanup);
+        }
 
-    IB_MPOOL_FOREACH(ib_mpool_cleanup_t, cleanup, mp->free_cleanups) {
-        mp->free_fn(cleanup);
+        IB_MPOOL_FOREACH(ib_mpool_page_t, mpage, mp->free_pages) {
+            mp->free_fn(mpage);
+        }
     }
 
    /* We remove the child's parent link so that the child does not
@@ -1784,9 +2387,9 @@ void ib_mpool_destroy(
         mp->free_fn(mp->name);
     }
 
-    ib_lock_destroy_malloc(mp->lock);
-
-    mp->free_fn(mp);
+    if (! mp->page_cached || ! ib_mpool_page_cache_pool_release(mp)) {
+        ib_mpool_free_struct(mp);
+    }
 
 #ifdef IB_MPOOL_VALGRIND
     /* Check existence so we don't double destroy free children's pools. */
@@ -2250,4 +2853,60 @@ ib_mpool_t *ib_mpool_parent(
     return mp->parent;
 }
 
+ib_status_t ib_mpool_page_cache_configure(
+    bool   enabled,
+    size_t thread_pages,
+    size_t depot_pages,
+    bool   huge_pages
+)
+{
+    ib_status_t rc = IB_OK;
+
+    pthread_mutex_lock(&s_page_cache.lock);
+    if (s_page_cache.used) {
+        rc = IB_EINVAL;
+    }
+    else {
+        s_page_cache.enabled      = enabled;
+        s_page_cache.huge_pages   = huge_pages;
+        s_page_cache.thread_pages = (thread_pages == 0) ?
+            IB_MPOOL_PAGE_CACHE_THREAD_PAGES : thread_pages;
+        s_page_cache.depot_pages  = (depot_pages == 0) ?
+            IB_MPOOL_PAGE_CACHE_DEPOT_PAGES : depot_pages;
+    }
+    pthread_mutex_unlock(&s_page_cache.lock);
+
+    return rc;
+}
+
+void ib_mpool_page_cache_stats_get(
+    ib_mpool_page_cache_stats_t *stats
+)
+{
+    assert(stats != NULL);
+
+    pthread_mutex_lock(&s_page_cache.lock);
+    *stats = s_page_cache.retired;
+    stats->cached_pages = 0;
+    stats->depot_pages  = s_page_cache.depot_size;
+    for (
+        const ib_mpool_thread_cache_t *tc = s_page_cache.threads;
+        tc != NULL;
+        tc = tc->next
+    ) {
+        ib_mpool_page_cache_stats_add(stats, &tc->stats);
+        stats->cached_pages += tc->num_pages;
+    }
+    pthread_mutex_unlock(&s_page_cache.lock);
+}
+
+void ib_mpool_page_cache_flush(void)
+{
+    ib_mpool_thread_cache_t *tc = ib_mpool_thread_cache();
+
+    if (tc != NULL) {
+        ib_mpool_thread_cache_empty(tc);
+    }
+}
+
 /**@}*/
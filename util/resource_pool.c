@@ -29,8 +29,19 @@
 #include <ironbee/util.h>
 
 #include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/types.h>
 #include <unistd.h>
 
+/** Number of resources a magazine holds. */
+#define IB_RESOURCE_MAGAZINE_SIZE 8
+/** Minimum number of magazines each depot queue holds.  Power of 2. */
+#define IB_RESOURCE_DEPOT_MAGAZINES 64
+
+/** See struct ib_resource_depot_t */
+typedef struct ib_resource_depot_t ib_resource_depot_t;
+
 /**
  * This represents a resource to be managed by an ib_resource_pool_t.
  */
@@ -40,6 +51,76 @@ struct ib_resource_t {
     size_t              use;      /**< Number of times this has been used. */
 };
 
+/**
+ * A fixed size stack of free resources.
+ *
+ * A magazine is owned by a single thread or sits in a depot queue.
+ */
+typedef struct ib_resource_magazine_t {
+    size_t         rounds;  /**< Number of resources in @a resources. */
+    ib_resource_t *resources[IB_RESOURCE_MAGAZINE_SIZE]; /**< Resources. */
+} ib_resource_magazine_t;
+
+/** See struct ib_resource_thread_t */
+typedef struct ib_resource_thread_t ib_resource_thread_t;
+
+/**
+ * Magazines of a single thread.
+ *
+ * Acquire pops from @a loaded and release pushes to it.  Keeping a second
+ * magazine avoids going to the depot when a thread alternates between
+ * acquiring and releasing at a magazine boundary.
+ *
+ * The owning thread holds @a lock while it uses the magazines.  It is only
+ * contended when another thread reclaims a free resource at the limit.
+ */
+struct ib_resource_thread_t {
+    ib_resource_pool_t     *owner;    /**< Pool of the magazines. */
+    ib_resource_magazine_t *loaded;   /**< Magazine in use. */
+    ib_resource_magazine_t *previous; /**< Full or empty spare magazine. */
+    pthread_mutex_t         lock;     /**< Protects the magazines. */
+    ib_resource_thread_t   *prev;     /**< Previous thread in the registry. */
+    ib_resource_thread_t   *next;     /**< Next thread in the registry. */
+};
+
+/**
+ * A cell of a depot queue.
+ */
+typedef struct ib_resource_depot_cell_t {
+    volatile size_t         seq; /**< Sequence number gating @a mag. */
+    ib_resource_magazine_t *mag; /**< The magazine. */
+} ib_resource_depot_cell_t;
+
+/**
+ * Bounded lock-free queue of magazines.
+ *
+ * This is the sequence-numbered ring also used by the logger: any number
+ * of threads may push and pop magazines without a lock.
+ */
+typedef struct ib_resource_depot_queue_t {
+    ib_resource_depot_cell_t *cells; /**< mask + 1 cells. */
+    size_t                    mask;  /**< Number of cells minus one. */
+    volatile size_t           head;  /**< Next position to push. */
+    char                      pad[64]; /**< Keep head and tail apart. */
+    volatile size_t           tail;  /**< Next position to pop. */
+} ib_resource_depot_queue_t;
+
+/**
+ * Shared state of a concurrent pool.
+ *
+ * Threads exchange whole magazines with the depot queues, so the shared
+ * state is touched at most once every IB_RESOURCE_MAGAZINE_SIZE calls.
+ * The mutex guards the registry of thread magazines, which changes when a
+ * thread first uses the pool or exits.  It is taken before any thread lock.
+ */
+struct ib_resource_depot_t {
+    ib_resource_depot_queue_t full;    /**< Magazines holding resources. */
+    ib_resource_depot_queue_t empty;   /**< Spare empty magazines. */
+    pthread_key_t             key;     /**< Thread ib_resource_thread_t. */
+    pthread_mutex_t           lock;    /**< Protects @a threads. */
+    ib_resource_thread_t     *threads; /**< Registry of thread magazines. */
+};
+
 /**
  * A pool of resources.
  */
@@ -55,6 +136,13 @@ struct ib_resource_pool_t {
     ib_queue_t *free_queue;
     size_t      count;     /**< Number of created resources. */
 
+    /**
+     * Magazines and depot of a concurrent pool.
+     *
+     * NULL for pools created by ib_resource_pool_create().
+     */
+    ib_resource_depot_t *depot;
+
     /* Callbacks. */
     ib_resource_create_fn_t    create_fn;    /**< Create a resource. */
     void                      *create_data;  /**< Callback data. */
@@ -199,6 +287,728 @@ static ib_status_t fill_to_min(
     return IB_OK;
 }
 
+/**
+ * @name Concurrent pools.
+ *
+ * Pools created by ib_resource_pool_create_concurrent() keep free resources
+ * in per-thread magazines.  Threads exchange full and empty magazines with
+ * lock-free depot queues shared by all threads of the pool.
+ */
+/**@{*/
+
+/**
+ * Initialize @a queue with room for at least @a magazines magazines.
+ *
+ * @param[out] queue The queue.
+ * @param[in] mm Memory manager the cells are allocated from.
+ * @param[in] magazines Minimum capacity.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC On allocation failure.
+ */
+static ib_status_t depot_queue_init(
+    ib_resource_depot_queue_t *queue,
+    ib_mm_t                    mm,
+    size_t                     magazines
+)
+{
+    assert(queue != NULL);
+
+    size_t size = IB_RESOURCE_DEPOT_MAGAZINES;
+    size_t i;
+
+    while (size < magazines) {
+        size <<= 1;
+    }
+
+    queue->cells = ib_mm_alloc(mm, sizeof(*queue->cells) * size);
+    if (queue->cells == NULL) {
+        return IB_EALLOC;
+    }
+    for (i = 0; i < size; ++i) {
+        queue->cells[i].seq = i;
+        queue->cells[i].mag = NULL;
+    }
+    queue->mask = size - 1;
+    queue->head = 0;
+    queue->tail = 0;
+
+    return IB_OK;
+}
+
+/**
+ * Push @a mag onto @a queue.
+ *
+ * @param[in] queue The queue.
+ * @param[in] mag The magazine.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EAGAIN If the queue is full.
+ */
+static ib_status_t depot_queue_push(
+    ib_resource_depot_queue_t *queue,
+    ib_resource_magazine_t    *mag
+)
+{
+    assert(queue != NULL);
+    assert(mag != NULL);
+
+    ib_resource_depot_cell_t *cell;
+    size_t                    pos = queue->head;
+
+    for (;;) {
+        ssize_t diff;
+
+        cell = &(queue->cells[pos & queue->mask]);
+        diff = (ssize_t)cell->seq - (ssize_t)pos;
+        if (diff == 0) {
+            if (__sync_bool_compare_and_swap(&(queue->head), pos, pos + 1)) {
+                break;
+            }
+        }
+        else if (diff < 0) {
+            return IB_EAGAIN;
+        }
+        pos = queue->head;
+    }
+
+    cell->mag = mag;
+    __sync_synchronize();
+    cell->seq = pos + 1;
+
+    return IB_OK;
+}
+
+/**
+ * Pop a magazine from @a queue.
+ *
+ * @param[in] queue The queue.
+ *
+ * @returns The magazine or NULL if @a queue is empty.
+ */
+static ib_resource_magazine_t *depot_queue_pop(
+    ib_resource_depot_queue_t *queue
+)
+{
+    assert(queue != NULL);
+
+    ib_resource_depot_cell_t *cell;
+    ib_resource_magazine_t   *mag;
+    size_t                    pos = queue->tail;
+
+    for (;;) {
+        ssize_t diff;
+
+        cell = &(queue->cells[pos & queue->mask]);
+        diff = (ssize_t)cell->seq - (ssize_t)(pos + 1);
+        if (diff == 0) {
+            if (__sync_bool_compare_and_swap(&(queue->tail), pos, pos + 1)) {
+                break;
+            }
+        }
+        else if (diff < 0) {
+            return NULL;
+        }
+        pos = queue->tail;
+    }
+
+    __sync_synchronize();
+    mag = cell->mag;
+    cell->mag = NULL;
+    __sync_synchronize();
+    cell->seq = pos + queue->mask + 1;
+
+    return mag;
+}
+
+/**
+ * Get an empty magazine from the depot of @a rp or allocate one.
+ *
+ * @param[in] rp The resource pool.
+ *
+ * @returns The magazine or NULL on allocation failure.
+ */
+static ib_resource_magazine_t *magazine_get_empty(ib_resource_pool_t *rp)
+{
+    assert(rp != NULL);
+    assert(rp->depot != NULL);
+
+    ib_resource_magazine_t *mag = depot_queue_pop(&(rp->depot->empty));
+
+    if (mag == NULL) {
+        mag = malloc(sizeof(*mag));
+        if (mag == NULL) {
+            return NULL;
+        }
+        mag->rounds = 0;
+    }
+
+    return mag;
+}
+
+/**
+ * Return the empty magazine @a mag to the depot of @a rp or free it.
+ *
+ * @param[in] rp The resource pool.
+ * @param[in] mag The empty magazine.
+ */
+static void magazine_put_empty(
+    ib_resource_pool_t     *rp,
+    ib_resource_magazine_t *mag
+)
+{
+    assert(rp != NULL);
+    assert(rp->depot != NULL);
+    assert(mag != NULL);
+    assert(mag->rounds == 0);
+
+    if (depot_queue_push(&(rp->depot->empty), mag) != IB_OK) {
+        free(mag);
+    }
+}
+
+/**
+ * Create a new resource for the concurrent pool @a rp.
+ *
+ * The count is reserved before calling the user create function so that
+ * concurrent callers never exceed the maximum.  The @ref ib_resource_t is
+ * allocated with malloc() as the memory manager is not thread safe.
+ *
+ * @param[in] rp The resource pool.
+ * @param[out] resource The resource created.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_DECLINED If the max limit is reached.
+ * - IB_EALLOC If an allocation error occurs.
+ * - Other from the user create function.
+ */
+static ib_status_t concurrent_create_resource(
+    ib_resource_pool_t  *rp,
+    ib_resource_t      **resource
+)
+{
+    assert(rp != NULL);
+    assert(resource != NULL);
+
+    ib_resource_t *tmp_resource;
+    void          *user_resource = NULL;
+    ib_status_t    rc;
+
+    for (;;) {
+        size_t count = rp->count;
+
+        if (rp->max_count != 0 && count >= rp->max_count) {
+            return IB_DECLINED;
+        }
+        if (__sync_bool_compare_and_swap(&(rp->count), count, count + 1)) {
+            break;
+        }
+    }
+
+    tmp_resource = malloc(sizeof(*tmp_resource));
+    if (tmp_resource == NULL) {
+        rc = IB_EALLOC;
+        goto failure;
+    }
+
+    rc = (rp->create_fn)(&user_resource, rp->create_data);
+    if (rc != IB_OK) {
+        free(tmp_resource);
+        goto failure;
+    }
+
+    tmp_resource->use = 0;
+    tmp_resource->owner = rp;
+    tmp_resource->resource = user_resource;
+
+    *resource = tmp_resource;
+
+    return IB_OK;
+
+failure:
+    __sync_sub_and_fetch(&(rp->count), 1);
+    return rc;
+}
+
+/**
+ * Destroy @a resource of a concurrent pool.
+ *
+ * @param[in] resource The resource.
+ */
+static void concurrent_destroy_resource(ib_resource_t *resource)
+{
+    assert(resource != NULL);
+    assert(resource->owner != NULL);
+
+    ib_resource_pool_t *rp = resource->owner;
+
+    (rp->destroy_fn)(resource->resource, rp->destroy_data);
+    free(resource);
+    __sync_sub_and_fetch(&(rp->count), 1);
+}
+
+/**
+ * Destroy all resources in @a mag, leaving it empty.
+ *
+ * @param[in] mag The magazine.
+ */
+static void magazine_destroy_rounds(ib_resource_magazine_t *mag)
+{
+    assert(mag != NULL);
+
+    while (mag->rounds > 0) {
+        --(mag->rounds);
+        concurrent_destroy_resource(mag->resources[mag->rounds]);
+    }
+}
+
+/**
+ * Return the magazines of @a thread to the depot and unregister it.
+ *
+ * Resources that do not fit in the depot are destroyed.
+ *
+ * @param[in] thread The thread magazines.  Freed on return.
+ */
+static void thread_magazines_release(ib_resource_thread_t *thread)
+{
+    assert(thread != NULL);
+
+    ib_resource_pool_t     *rp = thread->owner;
+    ib_resource_magazine_t *mags[2] = { thread->loaded, thread->previous };
+    size_t                  i;
+
+    for (i = 0; i < sizeof(mags) / sizeof(*mags); ++i) {
+        if (
+            mags[i]->rounds > 0 &&
+            depot_queue_push(&(rp->depot->full), mags[i]) == IB_OK
+        )
+        {
+            continue;
+        }
+        magazine_destroy_rounds(mags[i]);
+        magazine_put_empty(rp, mags[i]);
+    }
+
+    if (thread->prev != NULL) {
+        thread->prev->next = thread->next;
+    }
+    else {
+        rp->depot->threads = thread->next;
+    }
+    if (thread->next != NULL) {
+        thread->next->prev = thread->prev;
+    }
+
+    pthread_mutex_destroy(&(thread->lock));
+    free(thread);
+}
+
+/**
+ * Thread specific data destructor.
+ *
+ * @param[in] data The ib_resource_thread_t of the exiting thread.
+ */
+static void thread_magazines_exit(void *data)
+{
+    assert(data != NULL);
+
+    ib_resource_thread_t *thread = (ib_resource_thread_t *)data;
+    ib_resource_depot_t  *depot = thread->owner->depot;
+
+    pthread_mutex_lock(&(depot->lock));
+    thread_magazines_release(thread);
+    pthread_mutex_unlock(&(depot->lock));
+}
+
+/**
+ * Fetch or create the magazines of the calling thread.
+ *
+ * @param[in] rp The resource pool.
+ *
+ * @returns The thread magazines or NULL on allocation failure.
+ */
+static ib_resource_thread_t *thread_magazines(ib_resource_pool_t *rp)
+{
+    assert(rp != NULL);
+    assert(rp->depot != NULL);
+
+    ib_resource_depot_t  *depot = rp->depot;
+    ib_resource_thread_t *thread = pthread_getspecific(depot->key);
+
+    if (thread != NULL) {
+        return thread;
+    }
+
+    thread = calloc(1, sizeof(*thread));
+    if (thread == NULL) {
+        return NULL;
+    }
+    thread->owner = rp;
+    if (pthread_mutex_init(&(thread->lock), NULL) != 0) {
+        free(thread);
+        return NULL;
+    }
+    thread->loaded = magazine_get_empty(rp);
+    thread->previous = magazine_get_empty(rp);
+    if (
+        thread->loaded == NULL ||
+        thread->previous == NULL ||
+        pthread_setspecific(depot->key, thread) != 0
+    )
+    {
+        pthread_mutex_destroy(&(thread->lock));
+        free(thread->loaded);
+        free(thread->previous);
+        free(thread);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&(depot->lock));
+    thread->next = depot->threads;
+    if (thread->next != NULL) {
+        thread->next->prev = thread;
+    }
+    depot->threads = thread;
+    pthread_mutex_unlock(&(depot->lock));
+
+    return thread;
+}
+
+/**
+ * Ensure that the concurrent pool @a rp has the minimum number of resources.
+ *
+ * New resources are put in the depot.  Filling stops early if the depot
+ * is full.
+ *
+ * @param[in] rp The resource pool.
+ *
+ * @returns
+ * - IB_OK On success.
+ * - IB_EALLOC On allocation errors.
+ * - Other on user function failures.
+ */
+static ib_status_t concurrent_fill_to_min(ib_resource_pool_t *rp)
+{
+    assert(rp != NULL);
+    assert(rp->depot != NULL);
+
+    while (rp->min_count > rp->count) {
+        ib_resource_magazine_t *mag = magazine_get_empty(rp);
+
+        if (mag == NULL) {
+            return IB_EALLOC;
+        }
+
+        while (
+            mag->rounds < IB_RESOURCE_MAGAZINE_SIZE &&
+            rp->min_count > rp->count
+        )
+        {
+            ib_status_t rc;
+
+            rc = concurrent_create_resource(rp, &(mag->resources[mag->rounds]));
+            if (rc != IB_OK) {
+                magazine_destroy_rounds(mag);
+                magazine_put_empty(rp, mag);
+                return rc;
+            }
+            ++(mag->rounds);
+        }
+
+        if (depot_queue_push(&(rp->depot->full), mag) != IB_OK) {
+            magazine_destroy_rounds(mag);
+            magazine_put_empty(rp, mag);
+            break;
+        }
+    }
+
+    return IB_OK;
+}
+
+/**
+ * Destroy all free resources of the concurrent pool @a rp.
+ *
+ * @param[in] rp The resource pool.
+ */
+static void concurrent_drain(ib_resource_pool_t *rp)
+{
+    assert(rp != NULL);
+    assert(rp->depot != NULL);
+
+    ib_resource_thread_t   *thread;
+    ib_resource_magazine_t *mag;
+
+    pthread_mutex_lock(&(rp->depot->lock));
+    for (thread = rp->depot->threads; thread != NULL; thread = thread->next) {
+        pthread_mutex_lock(&(thread->lock));
+        magazine_destroy_rounds(thread->loaded);
+        magazine_destroy_rounds(thread->previous);
+        pthread_mutex_unlock(&(thread->lock));
+    }
+    pthread_mutex_unlock(&(rp->depot->lock));
+
+    while ((mag = depot_queue_pop(&(rp->depot->full))) != NULL) {
+        magazine_destroy_rounds(mag);
+        magazine_put_empty(rp, mag);
+    }
+}
+
+/**
+ * Destroy the depot of the concurrent pool @a data.
+ *
+ * Registered with the memory manager of the pool after
+ * ib_resource_pool_destroy().
+ *
+ * @param[in] data The resource pool.
+ */
+static void concurrent_destroy(void *data)
+{
+    assert(data != NULL);
+
+    ib_resource_pool_t     *rp = (ib_resource_pool_t *)data;
+    ib_resource_depot_t    *depot = rp->depot;
+    ib_resource_magazine_t *mag;
+
+    /* No thread destructors run once the key is gone. */
+    pthread_key_delete(depot->key);
+
+    concurrent_drain(rp);
+    while (depot->threads != NULL) {
+        ib_resource_thread_t *thread = depot->threads;
+
+        depot->threads = thread->next;
+        pthread_mutex_destroy(&(thread->lock));
+        free(thread->loaded);
+        free(thread->previous);
+        free(thread);
+    }
+    while ((mag = depot_queue_pop(&(depot->empty))) != NULL) {
+        free(mag);
+    }
+
+    pthread_mutex_destroy(&(depot->lock));
+}
+
+/**
+ * Take a free resource of @a rp from the depot or any thread magazine.
+ *
+ * Free resources cached by other threads count against the maximum, so
+ * this is tried before an acquire is declined at the limit.
+ *
+ * @param[in] rp The resource pool.
+ *
+ * @returns A free resource or NULL if every resource is in use.
+ */
+static ib_resource_t *concurrent_reclaim(ib_resource_pool_t *rp)
+{
+    assert(rp != NULL);
+    assert(rp->depot != NULL);
+
+    ib_resource_depot_t    *depot = rp->depot;
+    ib_resource_thread_t   *thread;
+    ib_resource_magazine_t *mag;
+    ib_resource_t          *resource = NULL;
+    size_t                  i;
+
+    /* A full magazine may have reached the depot since it was checked. */
+    mag = depot_queue_pop(&(depot->full));
+    if (mag != NULL) {
+        --(mag->rounds);
+        resource = mag->resources[mag->rounds];
+        if (
+            mag->rounds > 0 &&
+            depot_queue_push(&(depot->full), mag) == IB_OK
+        )
+        {
+            return resource;
+        }
+        magazine_destroy_rounds(mag);
+        magazine_put_empty(rp, mag);
+        return resource;
+    }
+
+    pthread_mutex_lock(&(depot->lock));
+    for (
+        thread = depot->threads;
+        thread != NULL && resource == NULL;
+        thread = thread->next
+    )
+    {
+        ib_resource_magazine_t *mags[2];
+
+        pthread_mutex_lock(&(thread->lock));
+        mags[0] = thread->loaded;
+        mags[1] = thread->previous;
+        for (i = 0; i < sizeof(mags) / sizeof(*mags); ++i) {
+            if (mags[i]->rounds > 0) {
+                --(mags[i]->rounds);
+                resource = mags[i]->resources[mags[i]->rounds];
+                break;
+            }
+        }
+        pthread_mutex_unlock(&(thread->lock));
+    }
+    pthread_mutex_unlock(&(depot->lock));
+
+    return resource;
+}
+
+/**
+ * Acquire a resource from the concurrent pool @a rp.
+ *
+ * @param[in] rp The resource pool.
+ * @param[out] resource The resource.
+ *
+ * @returns
+ * - IB_OK If a resource is acquired.
+ * - IB_DECLINED If the max limit is reached.
+ * - IB_EALLOC On allocation errors.
+ * - Other from the user create function.
+ */
+static ib_status_t concurrent_acquire(
+    ib_resource_pool_t  *rp,
+    ib_resource_t      **resource
+)
+{
+    assert(rp != NULL);
+    assert(rp->depot != NULL);
+    assert(resource != NULL);
+
+    ib_resource_thread_t   *thread = thread_magazines(rp);
+    ib_resource_magazine_t *mag;
+    ib_resource_t          *tmp_resource = NULL;
+    ib_status_t             rc;
+
+    if (thread == NULL) {
+        return IB_EALLOC;
+    }
+
+    pthread_mutex_lock(&(thread->lock));
+    if (thread->loaded->rounds == 0) {
+        /* Prefer the spare magazine, then a full one from the depot. */
+        if (thread->previous->rounds > 0) {
+            mag = thread->loaded;
+            thread->loaded = thread->previous;
+            thread->previous = mag;
+        }
+        else if ((mag = depot_queue_pop(&(rp->depot->full))) != NULL) {
+            magazine_put_empty(rp, thread->previous);
+            thread->previous = thread->loaded;
+            thread->loaded = mag;
+        }
+    }
+
+    mag = thread->loaded;
+    if (mag->rounds > 0) {
+        --(mag->rounds);
+        tmp_resource = mag->resources[mag->rounds];
+    }
+    pthread_mutex_unlock(&(thread->lock));
+
+    if (tmp_resource == NULL) {
+        rc = concurrent_create_resource(rp, &tmp_resource);
+        if (rc == IB_DECLINED) {
+            tmp_resource = concurrent_reclaim(rp);
+            if (tmp_resource == NULL) {
+                return IB_DECLINED;
+            }
+        }
+        else if (rc != IB_OK) {
+            return rc;
+        }
+    }
+
+    if (rp->preuse_fn != NULL) {
+        (rp->preuse_fn)(tmp_resource->resource, rp->preuse_data);
+    }
+
+    ++(tmp_resource->use);
+
+    *resource = tmp_resource;
+
+    return IB_OK;
+}
+
+/**
+ * Release @a resource to its concurrent pool.
+ *
+ * @param[in] resource The resource.
+ *
+ * @returns
+ * - IB_OK On success.
+ */
+static ib_status_t concurrent_release(ib_resource_t *resource)
+{
+    assert(resource != NULL);
+    assert(resource->owner != NULL);
+    assert(resource->owner->depot != NULL);
+
+    ib_resource_pool_t     *rp = resource->owner;
+    ib_resource_thread_t   *thread;
+    ib_resource_magazine_t *mag;
+
+    if (rp->postuse_fn != NULL) {
+        ib_status_t rc = (rp->postuse_fn)(
+            resource->resource,
+            rp->postuse_data);
+
+        /* If the user says that the resource is invalid, replace it. */
+        if (rc == IB_EINVAL) {
+            concurrent_destroy_resource(resource);
+            if (
+                rp->min_count <= rp->count ||
+                concurrent_create_resource(rp, &resource) != IB_OK
+            )
+            {
+                return IB_OK;
+            }
+        }
+    }
+
+    thread = thread_magazines(rp);
+    if (thread == NULL) {
+        concurrent_destroy_resource(resource);
+        return IB_OK;
+    }
+
+    pthread_mutex_lock(&(thread->lock));
+    if (thread->loaded->rounds == IB_RESOURCE_MAGAZINE_SIZE) {
+        /* Prefer the spare magazine, then trade a full one for an empty. */
+        if (thread->previous->rounds > 0) {
+            mag = magazine_get_empty(rp);
+            if (
+                mag == NULL ||
+                depot_queue_push(&(rp->depot->full), thread->previous) != IB_OK
+            )
+            {
+                /* The depot is full: these resources are surplus. */
+                if (mag != NULL) {
+                    magazine_put_empty(rp, mag);
+                }
+                magazine_destroy_rounds(thread->previous);
+            }
+            else {
+                thread->previous = mag;
+            }
+        }
+        mag = thread->loaded;
+        thread->loaded = thread->previous;
+        thread->previous = mag;
+    }
+
+    mag = thread->loaded;
+    mag->resources[mag->rounds] = resource;
+    ++(mag->rounds);
+    pthread_mutex_unlock(&(thread->lock));
+
+    return IB_OK;
+}
+
+/**@}*/
+
 ib_status_t ib_resource_pool_create(
     ib_resource_pool_t       **resource_pool,
     ib_mm_t                    mm,
@@ -275,6 +1085,93 @@ ib_status_t ib_resource_pool_create(
     return IB_OK;
 }
 
+ib_status_t ib_resource_pool_create_concurrent(
+    ib_resource_pool_t       **resource_pool,
+    ib_mm_t                    mm,
+    size_t                     min_count,
+    size_t                     max_count,
+    ib_resource_create_fn_t    create_fn,
+    void                      *create_data,
+    ib_resource_destroy_fn_t   destroy_fn,
+    void                      *destroy_data,
+    ib_resource_preuse_fn_t    preuse_fn,
+    void                      *preuse_data,
+    ib_resource_postuse_fn_t   postuse_fn,
+    void                      *postuse_data
+)
+{
+    assert(resource_pool != NULL);
+    assert(create_fn != NULL);
+    assert(destroy_fn != NULL);
+
+    ib_resource_pool_t  *rp;
+    ib_resource_depot_t *depot;
+    size_t               magazines;
+    ib_status_t          rc;
+
+    if (max_count > 0 && min_count > max_count) {
+        return IB_EINVAL;
+    }
+
+    /* Create an empty pool and fill it once the depot exists. */
+    rc = ib_resource_pool_create(
+        &rp, mm, 0, max_count,
+        create_fn, create_data,
+        destroy_fn, destroy_data,
+        preuse_fn, preuse_data,
+        postuse_fn, postuse_data);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    depot = ib_mm_calloc(mm, sizeof(*depot), 1);
+    if (depot == NULL) {
+        return IB_EALLOC;
+    }
+
+    /* Room in the depot for every resource the pool may hold. */
+    magazines = (max_count > min_count) ? max_count : min_count;
+    magazines =
+        (magazines + IB_RESOURCE_MAGAZINE_SIZE - 1) /
+        IB_RESOURCE_MAGAZINE_SIZE;
+
+    rc = depot_queue_init(&(depot->full), mm, magazines);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    rc = depot_queue_init(&(depot->empty), mm, magazines);
+    if (rc != IB_OK) {
+        return rc;
+    }
+    if (pthread_mutex_init(&(depot->lock), NULL) != 0) {
+        return IB_EOTHER;
+    }
+    if (pthread_key_create(&(depot->key), thread_magazines_exit) != 0) {
+        pthread_mutex_destroy(&(depot->lock));
+        return IB_EOTHER;
+    }
+
+    rp->depot = depot;
+    rp->min_count = min_count;
+
+    rc = ib_mm_register_cleanup(mm, concurrent_destroy, rp);
+    if (rc != IB_OK) {
+        pthread_key_delete(depot->key);
+        pthread_mutex_destroy(&(depot->lock));
+        rp->depot = NULL;
+        return rc;
+    }
+
+    rc = concurrent_fill_to_min(rp);
+    if (rc != IB_OK) {
+        return rc;
+    }
+
+    *resource_pool = rp;
+
+    return IB_OK;
+}
+
 ib_status_t ib_resource_acquire(
     ib_resource_pool_t *resource_pool,
     ib_resource_t **resource
@@ -286,6 +1183,10 @@ ib_status_t ib_resource_acquire(
     ib_resource_t *tmp_resource = NULL;
     ib_status_t rc;
 
+    if (resource_pool->depot != NULL) {
+        return concurrent_acquire(resource_pool, resource);
+    }
+
     /* If there is a free resource, acquire it. */
     if (ib_queue_size(resource_pool->resources) > 0) {
         rc = ib_queue_pop_front(
@@ -387,6 +1288,10 @@ ib_status_t ib_resource_release(
 
     ib_status_t rc;
 
+    if (resource->owner->depot != NULL) {
+        return concurrent_release(resource);
+    }
+
     /* If a postuse function is defined, handle it. */
     if (resource->owner->postuse_fn != NULL) {
         rc = (resource->owner->postuse_fn)(
@@ -451,6 +1356,11 @@ ib_status_t ib_resource_pool_flush(
 
     ib_status_t rc;
 
+    if (resource_pool->depot != NULL) {
+        concurrent_drain(resource_pool);
+        return concurrent_fill_to_min(resource_pool);
+    }
+
     /* Destroy all the resources. */
     while (resource_pool->count > 0) {
         ib_resource_t *r;
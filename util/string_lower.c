@@ -25,9 +25,9 @@
 #include "ironbee_config_auto.h"
 
 #include <ironbee/string_lower.h>
+#include <ironbee/string_scan.h>
 
 #include <assert.h>
-#include <ctype.h>
 
 ib_status_t ib_strlower(
     ib_mm_t         mm,
@@ -39,14 +39,11 @@ ib_status_t ib_strlower(
     assert(in != NULL);
     assert(out != NULL);
 
-    *out = ib_mm_memdup(mm, in, in_len);
+    *out = ib_mm_alloc(mm, in_len);
     if (*out == NULL) {
         return IB_EALLOC;
     }
-    for (size_t i = 0; i < in_len; ++i) {
-        int c = *(in+i);
-        *(*out+i) = tolower(c);
-    }
+    ib_str_lower_copy(in, in_len, *out);
 
     return IB_OK;
 }
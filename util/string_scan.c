@@ -0,0 +1,473 @@
+/*****************************************************************************
+ * Licensed to Qualys, Inc. (QUALYS) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.
+ * QUALYS licenses this file to You under the Apache License, Version 2.0
+ * (the "License"); you may not use this file except in compliance with
+ * the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ ****************************************************************************/
+
+/**
+ * @file
+ * @brief IronBee --- String Scanning Kernels
+ *
+ * Each kernel comes in a scalar, an SSE2 and an AVX2 flavor.  The vector
+ * flavors handle the final partial block by re-reading the last full
+ * block of the input, so they never touch memory outside of it.  Inputs
+ * shorter than a block fall through to the next narrower flavor.
+ */
+
+#include "ironbee_config_auto.h"
+
+#include <ironbee/string_scan.h>
+
+#include <assert.h>
+#include <stdbool.h>
+
+#ifdef __SSE2__
+#define IB_SCAN_SSE2
+#include <emmintrin.h>
+
+#if defined(__clang__) || \
+    (__GNUC__ > 4) || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#define IB_SCAN_AVX2
+#define IB_SCAN_AVX2_FN __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+#endif
+
+/**
+ * Kernel table.
+ */
+typedef struct {
+    size_t (*scan_upper)(const uint8_t *data, size_t dlen);
+    size_t (*scan_space)(const uint8_t *data, size_t dlen);
+    size_t (*scan_bytes)(const uint8_t *data, size_t dlen,
+                         uint8_t c1, uint8_t c2);
+    void   (*lower_copy)(const uint8_t *data, size_t dlen, uint8_t *out);
+} scan_kernels_t;
+
+/* Scalar kernels. */
+
+/** Is @a c in @a lo to @a hi inclusive? */
+static inline bool in_range(uint8_t c, uint8_t lo, uint8_t hi)
+{
+    return (uint8_t)(c - lo) <= (uint8_t)(hi - lo);
+}
+
+/** Is @a c whitespace in the C locale? */
+static inline bool is_space(uint8_t c)
+{
+    return c == ' ' || in_range(c, '\t', '\r');
+}
+
+static size_t scalar_scan_upper(const uint8_t *data, size_t dlen)
+{
+    for (size_t i = 0; i < dlen; ++i) {
+        if (in_range(data[i], 'A', 'Z')) {
+            return i;
+        }
+    }
+    return dlen;
+}
+
+static size_t scalar_scan_space(const uint8_t *data, size_t dlen)
+{
+    for (size_t i = 0; i < dlen; ++i) {
+        if (is_space(data[i])) {
+            return i;
+        }
+    }
+    return dlen;
+}
+
+static size_t scalar_scan_bytes(
+    const uint8_t *data,
+    size_t         dlen,
+    uint8_t        c1,
+    uint8_t        c2
+)
+{
+    for (size_t i = 0; i < dlen; ++i) {
+        if (data[i] == c1 || data[i] == c2) {
+            return i;
+        }
+    }
+    return dlen;
+}
+
+static void scalar_lower_copy(const uint8_t *data, size_t dlen, uint8_t *out)
+{
+    for (size_t i = 0; i < dlen; ++i) {
+        uint8_t c = data[i];
+        out[i] = in_range(c, 'A', 'Z') ? (c | 0x20) : c;
+    }
+}
+
+#ifndef IB_SCAN_SSE2
+static const scan_kernels_t s_scalar_kernels = {
+    scalar_scan_upper,
+    scalar_scan_space,
+    scalar_scan_bytes,
+    scalar_lower_copy
+};
+#endif
+
+#ifdef IB_SCAN_SSE2
+
+/* SSE2 kernels. */
+
+/**
+ * Mask of the bytes of @a v in @a lo to @a hi inclusive.
+ *
+ * Shifts the range down to start at -128 so that a single signed compare
+ * checks both bounds.
+ */
+static inline __m128i sse2_range(__m128i v, uint8_t lo, uint8_t hi)
+{
+    __m128i x = _mm_add_epi8(v, _mm_set1_epi8((char)(0x80 - lo)));
+    return _mm_cmplt_epi8(x, _mm_set1_epi8((char)(-128 + (hi - lo) + 1)));
+}
+
+static inline __m128i sse2_upper(__m128i v)
+{
+    return sse2_range(v, 'A', 'Z');
+}
+
+static inline __m128i sse2_space(__m128i v)
+{
+    return _mm_or_si128(
+        _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+        sse2_range(v, '\t', '\r'));
+}
+
+static inline __m128i sse2_load(const uint8_t *p)
+{
+    return _mm_loadu_si128((const __m128i *)p);
+}
+
+/**
+ * Define an SSE2 scan kernel named @a name using @a mask_expr on @a v.
+ */
+#define SSE2_SCAN(name, fallback, mask_expr)                         \
+static size_t name(const uint8_t *data, size_t dlen)                 \
+{                                                                    \
+    size_t i;                                                        \
+    __m128i v;                                                       \
+    int m;                                                           \
+                                                                     \
+    if (dlen < 16) {                                                 \
+        return fallback(data, dlen);                                 \
+    }                                                                \
+    for (i = 0; i + 16 <= dlen; i += 16) {                           \
+        v = sse2_load(data + i);                                     \
+        m = _mm_movemask_epi8(mask_expr);                            \
+        if (m != 0) {                                                \
+            return i + __builtin_ctz(m);                             \
+        }                                                            \
+    }                                                                \
+    if (i < dlen) {                                                  \
+        i = dlen - 16;                                               \
+        v = sse2_load(data + i);                                     \
+        m = _mm_movemask_epi8(mask_expr);                            \
+        if (m != 0) {                                                \
+            return i + __builtin_ctz(m);                             \
+        }                                                            \
+    }                                                                \
+    return dlen;                                                     \
+}
+
+SSE2_SCAN(sse2_scan_upper, scalar_scan_upper, sse2_upper(v))
+SSE2_SCAN(sse2_scan_space, scalar_scan_space, sse2_space(v))
+
+static size_t sse2_scan_bytes(
+    const uint8_t *data,
+    size_t         dlen,
+    uint8_t        c1,
+    uint8_t        c2
+)
+{
+    const __m128i v1 = _mm_set1_epi8((char)c1);
+    const __m128i v2 = _mm_set1_epi8((char)c2);
+    size_t i;
+    __m128i v;
+    int m;
+
+    if (dlen < 16) {
+        return scalar_scan_bytes(data, dlen, c1, c2);
+    }
+    for (i = 0; i + 16 <= dlen; i += 16) {
+        v = sse2_load(data + i);
+        m = _mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(v, v1), _mm_cmpeq_epi8(v, v2)));
+        if (m != 0) {
+            return i + __builtin_ctz(m);
+        }
+    }
+    if (i < dlen) {
+        i = dlen - 16;
+        v = sse2_load(data + i);
+        m = _mm_movemask_epi8(
+            _mm_or_si128(_mm_cmpeq_epi8(v, v1), _mm_cmpeq_epi8(v, v2)));
+        if (m != 0) {
+            return i + __builtin_ctz(m);
+        }
+    }
+    return dlen;
+}
+
+static inline void sse2_lower_block(const uint8_t *data, uint8_t *out)
+{
+    __m128i v = sse2_load(data);
+    __m128i bit = _mm_and_si128(sse2_upper(v), _mm_set1_epi8(0x20));
+    _mm_storeu_si128((__m128i *)out, _mm_or_si128(v, bit));
+}
+
+static void sse2_lower_copy(const uint8_t *data, size_t dlen, uint8_t *out)
+{
+    size_t i;
+
+    if (dlen < 16) {
+        scalar_lower_copy(data, dlen, out);
+        return;
+    }
+    for (i = 0; i + 16 <= dlen; i += 16) {
+        sse2_lower_block(data + i, out + i);
+    }
+    if (i < dlen) {
+        /* Lowercasing is idempotent so an overlap with the last block,
+         * in place or not, is harmless. */
+        sse2_lower_block(data + dlen - 16, out + dlen - 16);
+    }
+}
+
+static const scan_kernels_t s_sse2_kernels = {
+    sse2_scan_upper,
+    sse2_scan_space,
+    sse2_scan_bytes,
+    sse2_lower_copy
+};
+
+#endif /* IB_SCAN_SSE2 */
+
+#ifdef IB_SCAN_AVX2
+
+/* AVX2 kernels. */
+
+/** AVX2 version of sse2_range(). */
+static inline IB_SCAN_AVX2_FN
+__m256i avx2_range(__m256i v, uint8_t lo, uint8_t hi)
+{
+    __m256i x = _mm256_add_epi8(v, _mm256_set1_epi8((char)(0x80 - lo)));
+    return _mm256_cmpgt_epi8(
+        _mm256_set1_epi8((char)(-128 + (hi - lo) + 1)), x);
+}
+
+static inline IB_SCAN_AVX2_FN
+__m256i avx2_upper(__m256i v)
+{
+    return avx2_range(v, 'A', 'Z');
+}
+
+static inline IB_SCAN_AVX2_FN
+__m256i avx2_space(__m256i v)
+{
+    return _mm256_or_si256(
+        _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+        avx2_range(v, '\t', '\r'));
+}
+
+static inline IB_SCAN_AVX2_FN
+__m256i avx2_load(const uint8_t *p)
+{
+    return _mm256_loadu_si256((const __m256i *)p);
+}
+
+/**
+ * Define an AVX2 scan kernel named @a name using @a mask_expr on @a v.
+ */
+#define AVX2_SCAN(name, fallback, mask_expr)                         \
+static IB_SCAN_AVX2_FN size_t name(const uint8_t *data, size_t dlen) \
+{                                                                    \
+    size_t i;                                                        \
+    __m256i v;                                                       \
+    unsigned m;                                                      \
+                                                                     \
+    if (dlen < 32) {                                                 \
+        return fallback(data, dlen);                                 \
+    }                                                                \
+    for (i = 0; i + 32 <= dlen; i += 32) {                           \
+        v = avx2_load(data + i);                                     \
+        m = (unsigned)_mm256_movemask_epi8(mask_expr);               \
+        if (m != 0) {                                                \
+            return i + __builtin_ctz(m);                             \
+        }                                                            \
+    }                                                                \
+    if (i < dlen) {                                                  \
+        i = dlen - 32;                                               \
+        v = avx2_load(data + i);                                     \
+        m = (unsigned)_mm256_movemask_epi8(mask_expr);               \
+        if (m != 0) {                                                \
+            return i + __builtin_ctz(m);                             \
+        }                                                            \
+    }                                                                \
+    return dlen;                                                     \
+}
+
+AVX2_SCAN(avx2_scan_upper, sse2_scan_upper, avx2_upper(v))
+AVX2_SCAN(avx2_scan_space, sse2_scan_space, avx2_space(v))
+
+static IB_SCAN_AVX2_FN size_t avx2_scan_bytes(
+    const uint8_t *data,
+    size_t         dlen,
+    uint8_t        c1,
+    uint8_t        c2
+)
+{
+    const __m256i v1 = _mm256_set1_epi8((char)c1);
+    const __m256i v2 = _mm256_set1_epi8((char)c2);
+    size_t i;
+    __m256i v;
+    unsigned m;
+
+    if (dlen < 32) {
+        return sse2_scan_bytes(data, dlen, c1, c2);
+    }
+    for (i = 0; i + 32 <= dlen; i += 32) {
+        v = avx2_load(data + i);
+        m = (unsigned)_mm256_movemask_epi8(
+            _mm256_or_si256(
+                _mm256_cmpeq_epi8(v, v1), _mm256_cmpeq_epi8(v, v2)));
+        if (m != 0) {
+            return i + __builtin_ctz(m);
+        }
+    }
+    if (i < dlen) {
+        i = dlen - 32;
+        v = avx2_load(data + i);
+        m = (unsigned)_mm256_movemask_epi8(
+            _mm256_or_si256(
+                _mm256_cmpeq_epi8(v, v1), _mm256_cmpeq_epi8(v, v2)));
+        if (m != 0) {
+            return i + __builtin_ctz(m);
+        }
+    }
+    return dlen;
+}
+
+static inline IB_SCAN_AVX2_FN
+void avx2_lower_block(const uint8_t *data, uint8_t *out)
+{
+    __m256i v = avx2_load(data);
+    __m256i bit = _mm256_and_si256(avx2_upper(v), _mm256_set1_epi8(0x20));
+    _mm256_storeu_si256((__m256i *)out, _mm256_or_si256(v, bit));
+}
+
+static IB_SCAN_AVX2_FN
+void avx2_lower_copy(const uint8_t *data, size_t dlen, uint8_t *out)
+{
+    size_t i;
+
+    if (dlen < 32) {
+        sse2_lower_copy(data, dlen, out);
+        return;
+    }
+    for (i = 0; i + 32 <= dlen; i += 32) {
+        avx2_lower_block(data + i, out + i);
+    }
+    if (i < dlen) {
+        avx2_lower_block(data + dlen - 32, out + dlen - 32);
+    }
+}
+
+static const scan_kernels_t s_avx2_kernels = {
+    avx2_scan_upper,
+    avx2_scan_space,
+    avx2_scan_bytes,
+    avx2_lower_copy
+};
+
+#endif /* IB_SCAN_AVX2 */
+
+/**
+ * Selected kernels; NULL until first use.
+ *
+ * Racing first uses all select the same table, so no locking is needed.
+ */
+static const scan_kernels_t *s_kernels = NULL;
+
+/**
+ * The kernel table for this CPU.
+ */
+static inline const scan_kernels_t *kernels(void)
+{
+    const scan_kernels_t *k = s_kernels;
+
+    if (k != NULL) {
+        return k;
+    }
+
+#if defined(IB_SCAN_AVX2)
+    __builtin_cpu_init();
+    k = __builtin_cpu_supports("avx2") ? &s_avx2_kernels : &s_sse2_kernels;
+#elif defined(IB_SCAN_SSE2)
+    k = &s_sse2_kernels;
+#else
+    k = &s_scalar_kernels;
+#endif
+
+    s_kernels = k;
+    return k;
+}
+
+size_t ib_str_scan_upper(
+    const uint8_t *data,
+    size_t         dlen
+)
+{
+    assert(data != NULL || dlen == 0);
+
+    return kernels()->scan_upper(data, dlen);
+}
+
+size_t ib_str_scan_space(
+    const uint8_t *data,
+    size_t         dlen
+)
+{
+    assert(data != NULL || dlen == 0);
+
+    return kernels()->scan_space(data, dlen);
+}
+
+size_t ib_str_scan_bytes(
+    const uint8_t *data,
+    size_t         dlen,
+    uint8_t        c1,
+    uint8_t        c2
+)
+{
+    assert(data != NULL || dlen == 0);
+
+    return kernels()->scan_bytes(data, dlen, c1, c2);
+}
+
+void ib_str_lower_copy(
+    const uint8_t *data,
+    size_t         dlen,
+    uint8_t       *out
+)
+{
+    assert(data != NULL || dlen == 0);
+    assert(out != NULL || dlen == 0);
+
+    kernels()->lower_copy(data, dlen, out);
+}
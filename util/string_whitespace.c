@@ -25,9 +25,32 @@
 #include "ironbee_config_auto.h"
 
 #include <ironbee/string_whitespace.h>
+#include <ironbee/string_scan.h>
 
 #include <assert.h>
 #include <ctype.h>
+#include <string.h>
+
+/**
+ * Offset of the first non-whitespace character at or after @a i.
+ *
+ * @param[in] data String.
+ * @param[in] dlen Length of @a data.
+ * @param[in] i Offset to start at.
+ *
+ * @returns Offset of the end of the whitespace region at @a i.
+ **/
+static size_t skip_ws(
+    const uint8_t *data,
+    size_t         dlen,
+    size_t         i
+)
+{
+    while (i < dlen && isspace(data[i])) {
+        ++i;
+    }
+    return i;
+}
 
 /**
  * Count the total whitespace and number of whitespace regions.
@@ -48,23 +71,14 @@ void count_ws(
 
     size_t local_spaces = 0;
     size_t local_regions = 0;
-    local_spaces = 0;
-    local_regions = 0;
-    bool last_char_is_space = false;
-
-    for (size_t i = 0; i < dlen; ++i) {
-        uint8_t c = data[i];
-
-        if (isspace(c)) {
-            ++local_spaces;
-            if (! last_char_is_space) {
-                ++local_regions;
-            }
-            last_char_is_space = true;
-        }
-        else {
-            last_char_is_space = false;
-        }
+    size_t i = ib_str_scan_space(data, dlen);
+
+    while (i < dlen) {
+        size_t end = skip_ws(data, dlen, i);
+
+        local_spaces += end - i;
+        ++local_regions;
+        i = end + ib_str_scan_space(data + end, dlen - end);
     }
 
     if (spaces != NULL) {
@@ -75,6 +89,73 @@ void count_ws(
     }
 }
 
+ib_status_t ib_str_whitespace_remove_ex(
+    const uint8_t  *data_in,
+    size_t          dlen_in,
+    uint8_t        *data_out,
+    size_t         *dlen_out
+)
+{
+    assert(data_in != NULL);
+    assert(data_out != NULL);
+    assert(dlen_out != NULL);
+
+    uint8_t *cur = data_out;
+    size_t i = 0;
+
+    /* Copy each run of non-whitespace, then skip the whitespace after.
+     * The output never passes the input, so memmove() makes this safe in
+     * place. */
+    while (i < dlen_in) {
+        size_t run = ib_str_scan_space(data_in + i, dlen_in - i);
+
+        if (cur != data_in + i) {
+            memmove(cur, data_in + i, run);
+        }
+        cur += run;
+        i = skip_ws(data_in, dlen_in, i + run);
+    }
+
+    *dlen_out = cur - data_out;
+
+    return IB_OK;
+}
+
+ib_status_t ib_str_whitespace_compress_ex(
+    const uint8_t  *data_in,
+    size_t          dlen_in,
+    uint8_t        *data_out,
+    size_t         *dlen_out
+)
+{
+    assert(data_in != NULL);
+    assert(data_out != NULL);
+    assert(dlen_out != NULL);
+
+    uint8_t *cur = data_out;
+    size_t i = 0;
+
+    /* Copy each run of non-whitespace and the first whitespace after. */
+    while (i < dlen_in) {
+        size_t run = ib_str_scan_space(data_in + i, dlen_in - i);
+
+        if (cur != data_in + i) {
+            memmove(cur, data_in + i, run);
+        }
+        cur += run;
+        i += run;
+        if (i < dlen_in) {
+            *cur = data_in[i];
+            ++cur;
+            i = skip_ws(data_in, dlen_in, i + 1);
+        }
+    }
+
+    *dlen_out = cur - data_out;
+
+    return IB_OK;
+}
+
 ib_status_t ib_str_whitespace_remove(
     ib_mm_t         mm,
     const uint8_t  *data_in,
@@ -89,7 +170,6 @@ ib_status_t ib_str_whitespace_remove(
 
     size_t spaces = 0;
     uint8_t *buf;
-    uint8_t *cur;
 
     count_ws(data_in, dlen_in, &spaces, NULL);
     buf = ib_mm_alloc(mm, dlen_in - spaces);
@@ -97,19 +177,9 @@ ib_status_t ib_str_whitespace_remove(
         return IB_EALLOC;
     }
 
-    cur = buf;
-    for (size_t i = 0; i < dlen_in; ++i) {
-        uint8_t c = data_in[i];
-        if (! isspace(c)) {
-            *cur = c;
-            ++cur;
-        }
-    }
-
     *data_out = buf;
-    *dlen_out = dlen_in - spaces;
 
-    return IB_OK;
+    return ib_str_whitespace_remove_ex(data_in, dlen_in, buf, dlen_out);
 }
 
 ib_status_t ib_str_whitespace_compress(
@@ -127,8 +197,6 @@ ib_status_t ib_str_whitespace_compress(
     size_t spaces = 0;
     size_t regions = 0;
     uint8_t *buf;
-    uint8_t *cur;
-    bool last_char_is_space = false;
 
     count_ws(data_in, dlen_in, &spaces, &regions);
     buf = ib_mm_alloc(mm, dlen_in - spaces + regions);
@@ -136,19 +204,7 @@ ib_status_t ib_str_whitespace_compress(
         return IB_EALLOC;
     }
 
-    cur = buf;
-    for (size_t i = 0; i < dlen_in; ++i) {
-        uint8_t c = data_in[i];
-        if (! isspace(c) || ! last_char_is_space) {
-            *cur = c;
-            ++cur;
-        }
-
-        last_char_is_space = isspace(c);
-    }
-
     *data_out = buf;
-    *dlen_out = dlen_in - spaces + regions;
 
-    return IB_OK;
+    return ib_str_whitespace_compress_ex(data_in, dlen_in, buf, dlen_out);
 }
@@ -0,0 +1,187 @@
+//////////////////////////////////////////////////////////////////////////////
+// Licensed to Qualys, Inc. (QUALYS) under one or more
+// contributor license agreements.  See the NOTICE file distributed with
+// this work for additional information regarding copyright ownership.
+// QUALYS licenses this file to You under the Apache License, Version 2.0
+// (the "License"); you may not use this file except in compliance with
+// the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//////////////////////////////////////////////////////////////////////////////
+
+/**
+ * @file
+ * @brief IronBee --- Per-thread counter tests.
+ */
+
+#include "ironbee_config_auto.h"
+
+#include <ironbee/clock.h>
+#include <ironbee/counters.h>
+#include <ironbee/mm_mpool_lite.h>
+
+#include "gtest/gtest.h"
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include <iostream>
+
+namespace {
+
+//! Add one to counter 0 and @a n to counter 1, @a iterations times.
+void add_loop(ib_counters_t *counters, int64_t n, size_t iterations)
+{
+    for (size_t i = 0; i < iterations; ++i) {
+        ib_counters_add(counters, 0, 1);
+        ib_counters_add(counters, 1, n);
+    }
+}
+
+//! Raise level counter 2; the caller lowers it from another thread.
+void open_loop(ib_counters_t *counters, size_t iterations)
+{
+    for (size_t i = 0; i < iterations; ++i) {
+        ib_counters_add(counters, 2, 1);
+    }
+}
+
+//! Add to two shared counters with atomic operations, as add_loop() does.
+void atomic_loop(int64_t *shared, int64_t n, size_t iterations)
+{
+    for (size_t i = 0; i < iterations; ++i) {
+        __sync_add_and_fetch(&shared[0], 1);
+        __sync_add_and_fetch(&shared[1], n);
+    }
+}
+
+}
+
+class TestCounters : public testing::Test
+{
+public:
+    virtual void SetUp()
+    {
+        ASSERT_EQ(IB_OK, ib_mpool_lite_create(&m_mpl));
+        ASSERT_EQ(
+            IB_OK,
+            ib_counters_create(&m_counters, ib_mm_mpool_lite(m_mpl), 3));
+    }
+
+    virtual void TearDown()
+    {
+        ib_mpool_lite_destroy(m_mpl);
+    }
+
+    ib_mpool_lite_t *m_mpl;
+    ib_counters_t   *m_counters;
+};
+
+TEST_F(TestCounters, Basic)
+{
+    int64_t values[3];
+
+    ASSERT_EQ(3U, ib_counters_size(m_counters));
+
+    ib_counters_get(m_counters, values);
+    EXPECT_EQ(0, values[0]);
+    EXPECT_EQ(0, values[1]);
+    EXPECT_EQ(0, values[2]);
+
+    ib_counters_add(m_counters, 0, 5);
+    ib_counters_add(m_counters, 2, 1);
+    ib_counters_add(m_counters, 2, -3);
+
+    ib_counters_get(m_counters, values);
+    EXPECT_EQ(5, values[0]);
+    EXPECT_EQ(0, values[1]);
+    EXPECT_EQ(-2, values[2]);
+}
+
+TEST_F(TestCounters, Threads)
+{
+    static const int    c_num_threads = 8;
+    static const size_t c_iterations = 100000;
+    int64_t             values[3];
+    boost::thread_group threads;
+
+    for (int i = 0; i < c_num_threads; ++i) {
+        threads.create_thread(
+            boost::bind(add_loop, m_counters, i, c_iterations));
+    }
+    threads.create_thread(boost::bind(open_loop, m_counters, c_iterations));
+    threads.join_all();
+
+    /* All threads have exited: their counters must have been retired. */
+    add_loop(m_counters, 1, 1);
+    ib_counters_add(m_counters, 2, -int64_t(c_iterations));
+
+    ib_counters_get(m_counters, values);
+    EXPECT_EQ(int64_t(c_num_threads * c_iterations + 1), values[0]);
+    EXPECT_EQ(
+        int64_t(c_num_threads * (c_num_threads - 1) / 2 * c_iterations + 1),
+        values[1]);
+    EXPECT_EQ(0, values[2]);
+}
+
+TEST(TestCountersMalloc, Basic)
+{
+    ib_counters_t *counters;
+    int64_t        value;
+
+    ASSERT_EQ(IB_OK, ib_counters_create_malloc(&counters, 1));
+    ib_counters_add(counters, 0, 7);
+    ib_counters_get(counters, &value);
+    EXPECT_EQ(7, value);
+    ib_counters_destroy_malloc(counters);
+}
+
+/**
+ * Per-thread counters against a shared atomic counter.
+ */
+TEST_F(TestCounters, Benchmark)
+{
+    static const int    c_num_threads = 4;
+    static const size_t c_iterations = 1000000;
+    static const double c_updates = c_num_threads * c_iterations * 2;
+    boost::thread_group counter_threads;
+    boost::thread_group atomic_threads;
+    int64_t             shared[2] = { 0, 0 };
+    int64_t             values[3];
+    ib_time_t           start;
+    ib_time_t           counter_usec;
+    ib_time_t           atomic_usec;
+
+    start = ib_clock_get_time();
+    for (int i = 0; i < c_num_threads; ++i) {
+        counter_threads.create_thread(
+            boost::bind(add_loop, m_counters, 1, c_iterations));
+    }
+    counter_threads.join_all();
+    counter_usec = ib_clock_get_time() - start;
+
+    start = ib_clock_get_time();
+    for (int i = 0; i < c_num_threads; ++i) {
+        atomic_threads.create_thread(
+            boost::bind(atomic_loop, shared, 1, c_iterations));
+    }
+    atomic_threads.join_all();
+    atomic_usec = ib_clock_get_time() - start;
+
+    std::cout << c_num_threads << " threads updating 2 counters: "
+              << "per-thread " << counter_usec << "us ("
+              << (static_cast<double>(counter_usec) * 1000.0 / c_updates)
+              << "ns/update), atomic " << atomic_usec << "us ("
+              << (static_cast<double>(atomic_usec) * 1000.0 / c_updates)
+              << "ns/update)" << std::endl;
+
+    ib_counters_get(m_counters, values);
+    EXPECT_EQ(shared[0], values[0]);
+    EXPECT_EQ(shared[1], values[1]);
+}
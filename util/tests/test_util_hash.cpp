@@ -30,9 +30,15 @@
 #include "gtest/gtest.h"
 #include "simple_fixture.hpp"
 
+#include <ironbee/clock.h>
 #include <ironbee/mm.h>
 
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <sstream>
 #include <stdexcept>
+#include <vector>
 
 class TestIBUtilHash : public SimpleFixture
 {
@@ -515,3 +521,214 @@ TEST_F(TestIBUtilHash, non_printable_keys) {
     hash_data = NULL;
     ASSERT_EQ(IB_ENOENT, ib_hash_get(hash, &hash_data, key));
 }
+
+TEST_F(TestIBUtilHash, hashfunc_fast) {
+    EXPECT_EQ(
+        ib_hashfunc_fast("Key", 3, 0, NULL),
+        ib_hashfunc_fast("Key", 3, 0, NULL)
+    );
+    EXPECT_NE(
+        ib_hashfunc_fast("Key", 3, 0, NULL),
+        ib_hashfunc_fast("Key", 3, 1, NULL)
+    );
+    EXPECT_NE(
+        ib_hashfunc_fast("Key", 3, 0, NULL),
+        ib_hashfunc_fast("key", 3, 0, NULL)
+    );
+    /* Tail bytes are zero padded; the length must still distinguish. */
+    EXPECT_NE(
+        ib_hashfunc_fast("ab", 2, 0, NULL),
+        ib_hashfunc_fast("ab\0", 3, 0, NULL)
+    );
+
+    /* Only ASCII letters are folded, in both the word and tail loops. */
+    static const char upper[] = "AZ@[`{ Header-Name-With-Caps\xc0\xde";
+    static const char lower[] = "az@[`{ header-name-with-caps\xc0\xde";
+    static const size_t length = sizeof(upper) - 1;
+    EXPECT_EQ(
+        ib_hashfunc_fast_nocase(upper, length, 7, NULL),
+        ib_hashfunc_fast_nocase(lower, length, 7, NULL)
+    );
+    EXPECT_EQ(
+        ib_hashfunc_fast(lower, length, 7, NULL),
+        ib_hashfunc_fast_nocase(upper, length, 7, NULL)
+    );
+    EXPECT_NE(
+        ib_hashfunc_fast_nocase("@", 1, 7, NULL),
+        ib_hashfunc_fast_nocase("`", 1, 7, NULL)
+    );
+}
+
+TEST_F(TestIBUtilHash, open_bad_size) {
+    ib_hash_t *hash = NULL;
+
+    EXPECT_EQ(
+        IB_EINVAL,
+        ib_hash_create_open_ex(
+            &hash, MM(), 6,
+            ib_hashfunc_fast, NULL,
+            ib_hashequal_default, NULL
+        )
+    );
+}
+
+TEST_F(TestIBUtilHash, open_set_get_remove) {
+    ib_hash_t *hash = NULL;
+    std::map<std::string, std::string> expected;
+    std::vector<std::string> keys;
+
+    ASSERT_EQ(IB_OK, ib_hash_create_open(&hash, MM()));
+
+    for (int i = 0; i < 5000; ++i) {
+        std::ostringstream key;
+        key << "key-" << i;
+        keys.push_back(key.str());
+    }
+
+    // Insert, overwrite every third key and remove every fifth, so that
+    // removal shifts and resizes happen with other entries present.
+    for (size_t i = 0; i < keys.size(); ++i) {
+        const std::string &key = keys[i];
+        ASSERT_EQ(
+            IB_OK,
+            ib_hash_set_ex(hash, key.data(), key.length(),
+                           const_cast<char *>(key.c_str())));
+        expected[key] = key;
+        if (i % 3 == 0) {
+            ASSERT_EQ(
+                IB_OK,
+                ib_hash_set_ex(hash, key.data(), key.length(),
+                               const_cast<char *>("overwritten")));
+            expected[key] = "overwritten";
+        }
+        if (i % 5 == 0) {
+            const char *removed = NULL;
+            const std::string &old = keys[i / 2];
+            if (expected.count(old) > 0) {
+                ASSERT_EQ(
+                    IB_OK,
+                    ib_hash_remove_ex(hash, &removed,
+                                      old.data(), old.length()));
+                EXPECT_EQ(expected[old], removed);
+                expected.erase(old);
+            }
+        }
+    }
+
+    EXPECT_EQ(expected.size(), ib_hash_size(hash));
+    for (size_t i = 0; i < keys.size(); ++i) {
+        const std::string &key = keys[i];
+        const char *value = NULL;
+        ib_status_t rc = ib_hash_get_ex(hash, &value, key.data(), key.length());
+        if (expected.count(key) > 0) {
+            ASSERT_EQ(IB_OK, rc) << key;
+            EXPECT_EQ(expected[key], value);
+        }
+        else {
+            EXPECT_EQ(IB_ENOENT, rc) << key;
+            EXPECT_FALSE(value);
+        }
+    }
+
+    // Iteration visits each entry exactly once.
+    std::map<std::string, std::string> seen;
+    ib_hash_iterator_t *i = ib_hash_iterator_create(MM());
+    for (
+        ib_hash_iterator_first(i, hash);
+        ! ib_hash_iterator_at_end(i);
+        ib_hash_iterator_next(i)
+    ) {
+        const char *key;
+        size_t key_length;
+        const char *value;
+
+        ib_hash_iterator_fetch(&key, &key_length, &value, i);
+        std::string k(key, key_length);
+        EXPECT_EQ(0UL, seen.count(k));
+        seen[k] = value;
+    }
+    EXPECT_TRUE(expected == seen);
+
+    ib_list_t *list;
+    ASSERT_EQ(IB_OK, ib_list_create(&list, MM()));
+    ASSERT_EQ(IB_OK, ib_hash_get_all(hash, list));
+    EXPECT_EQ(expected.size(), ib_list_elements(list));
+
+    ib_hash_clear(hash);
+    EXPECT_EQ(0UL, ib_hash_size(hash));
+    EXPECT_EQ(IB_ENOENT, ib_hash_get(hash, NULL, keys[1].c_str()));
+    ib_hash_iterator_first(i, hash);
+    EXPECT_TRUE(ib_hash_iterator_at_end(i));
+}
+
+TEST_F(TestIBUtilHash, open_nocase) {
+    ib_hash_t *hash = NULL;
+    const char *value = NULL;
+
+    ASSERT_EQ(IB_OK, ib_hash_create_open_nocase(&hash, MM()));
+    ASSERT_EQ(IB_OK, ib_hash_set(hash, "Content-Type", (void *)"a"));
+    ASSERT_EQ(IB_OK, ib_hash_set(hash, "CONTENT-type", (void *)"b"));
+    EXPECT_EQ(1UL, ib_hash_size(hash));
+    ASSERT_EQ(IB_OK, ib_hash_get(hash, &value, "content-type"));
+    EXPECT_STREQ("b", value);
+    ASSERT_EQ(IB_OK, ib_hash_remove(hash, NULL, "CoNtEnT-TyPe"));
+    EXPECT_EQ(0UL, ib_hash_size(hash));
+}
+
+namespace {
+
+//! Time @a lookups lookups of @a keys in @a hash in microseconds.
+ib_time_t time_lookups(
+    const ib_hash_t                *hash,
+    const std::vector<std::string> &keys,
+    size_t                          lookups
+)
+{
+    ib_time_t start = ib_clock_get_time();
+    size_t found = 0;
+    for (size_t i = 0; i < lookups; ++i) {
+        const std::string &key = keys[i % keys.size()];
+        if (ib_hash_get_ex(hash, NULL, key.data(), key.length()) == IB_OK) {
+            ++found;
+        }
+    }
+    ib_time_t usec = ib_clock_get_time() - start;
+    EXPECT_EQ(lookups, found);
+    return usec;
+}
+
+}
+
+TEST_F(TestIBUtilHash, Benchmark) {
+    static const size_t c_num_keys = 10000;
+    static const size_t c_num_lookups = 2000000;
+    std::vector<std::string> keys;
+    ib_hash_t *chained;
+    ib_hash_t *open;
+
+    for (size_t i = 0; i < c_num_keys; ++i) {
+        std::ostringstream key;
+        key << "REQUEST_HEADERS:X-Header-" << i;
+        keys.push_back(key.str());
+    }
+
+    ASSERT_EQ(IB_OK, ib_hash_create_nocase(&chained, MM()));
+    ASSERT_EQ(IB_OK, ib_hash_create_open_nocase(&open, MM()));
+    for (size_t i = 0; i < c_num_keys; ++i) {
+        void *value = const_cast<char *>(keys[i].c_str());
+        ASSERT_EQ(IB_OK, ib_hash_set(chained, keys[i].c_str(), value));
+        ASSERT_EQ(IB_OK, ib_hash_set(open, keys[i].c_str(), value));
+    }
+
+    // Look up in an order unrelated to insertion order.
+    for (size_t i = keys.size() - 1; i > 0; --i) {
+        std::swap(keys[i], keys[(i * 7919) % (i + 1)]);
+    }
+
+    ib_time_t chained_usec = time_lookups(chained, keys, c_num_lookups);
+    ib_time_t open_usec = time_lookups(open, keys, c_num_lookups);
+
+    std::cout << c_num_lookups << " lookups over " << c_num_keys << " keys:"
+              << " chained/djb2 " << chained_usec << "us,"
+              << " open/fast " << open_usec << "us" << std::endl;
+}
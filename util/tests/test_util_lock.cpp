@@ -28,6 +28,7 @@
 #include <ironbee/mm.h>
 #include <ironbee/util.h>
 #include <ironbee/lock.h>
+#include <ironbee/mm_mpool.h>
 
 #include "gtest/gtest.h"
 #include "simple_fixture.hpp"
@@ -35,6 +36,7 @@
 #include <stdexcept>
 #include <math.h>
 #include <pthread.h>
+#include <time.h>
 
 using namespace std;
 
@@ -424,3 +426,171 @@ TEST_F(TestIBUtilLock, test_long)
     ASSERT_EQ(IB_OK, rc);
 #endif
 }
+
+namespace {
+
+//! State shared by the reader/writer and spin lock threads below.
+struct shared_state_t
+{
+    ib_rwlock_t   *rwlock;
+    ib_spinlock_t *spinlock;
+    int            loops;
+    volatile int   readers;     //!< Readers holding the lock.
+    volatile int   max_readers; //!< Most readers seen at once.
+    volatile int   writers;     //!< Writers holding the lock.
+    volatile int   errors;
+    volatile long  counter;
+};
+
+void *rwlock_reader(void *data)
+{
+    shared_state_t *state = static_cast<shared_state_t *>(data);
+    struct timespec ts = { 0, 100000 };
+
+    for (int n = 0; n < state->loops; ++n) {
+        if (ib_rwlock_rdlock(state->rwlock) != IB_OK) {
+            __sync_add_and_fetch(&state->errors, 1);
+            break;
+        }
+        int readers = __sync_add_and_fetch(&state->readers, 1);
+        if (state->writers != 0) {
+            __sync_add_and_fetch(&state->errors, 1);
+        }
+        int max = state->max_readers;
+        while (readers > max) {
+            max = __sync_val_compare_and_swap(
+                &state->max_readers, max, readers);
+        }
+        nanosleep(&ts, NULL);
+        __sync_sub_and_fetch(&state->readers, 1);
+        ib_rwlock_unlock(state->rwlock);
+    }
+    return NULL;
+}
+
+void *rwlock_writer(void *data)
+{
+    shared_state_t *state = static_cast<shared_state_t *>(data);
+
+    for (int n = 0; n < state->loops; ++n) {
+        if (ib_rwlock_wrlock(state->rwlock) != IB_OK) {
+            __sync_add_and_fetch(&state->errors, 1);
+            break;
+        }
+        if (++state->writers != 1 || state->readers != 0) {
+            __sync_add_and_fetch(&state->errors, 1);
+        }
+        ++state->counter;
+        --state->writers;
+        ib_rwlock_unlock(state->rwlock);
+    }
+    return NULL;
+}
+
+void *spinlock_incr(void *data)
+{
+    shared_state_t *state = static_cast<shared_state_t *>(data);
+
+    for (int n = 0; n < state->loops; ++n) {
+        ib_spinlock_lock(state->spinlock);
+        // Non-atomic read-modify-write; only correct under the lock.
+        long value = state->counter;
+        state->counter = value + 1;
+        ib_spinlock_unlock(state->spinlock);
+    }
+    return NULL;
+}
+
+size_t g_contentions = 0;
+
+extern "C" void count_contention(const void *lock, uint64_t wait_ns, void *)
+{
+    __sync_add_and_fetch(&g_contentions, 1);
+}
+
+}
+
+TEST(test_util_rwlock, readers_share_writers_exclude)
+{
+    static const int c_num_readers = 4;
+    static const int c_num_writers = 2;
+    shared_state_t state = {};
+    pthread_t threads[c_num_readers + c_num_writers];
+    ib_lock_stats_t stats;
+
+    ASSERT_EQ(IB_OK, ib_rwlock_create_malloc(&state.rwlock));
+    state.loops = 200;
+
+    for (int i = 0; i < c_num_readers + c_num_writers; ++i) {
+        ASSERT_EQ(0, pthread_create(
+            &threads[i], NULL,
+            (i < c_num_readers) ? rwlock_reader : rwlock_writer,
+            &state));
+    }
+    for (int i = 0; i < c_num_readers + c_num_writers; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+
+    EXPECT_EQ(0, state.errors);
+    EXPECT_EQ(c_num_writers * state.loops, state.counter);
+    EXPECT_LT(1, state.max_readers);
+
+    ib_rwlock_stats_get(state.rwlock, &stats);
+    EXPECT_EQ(uint64_t(c_num_writers * state.loops), stats.acquired);
+    EXPECT_EQ(0UL, stats.spins);
+
+    ib_rwlock_destroy_malloc(state.rwlock);
+}
+
+TEST(test_util_rwlock, mm)
+{
+    ib_mpool_t *mp;
+    ib_rwlock_t *lock;
+    ib_spinlock_t *spinlock;
+
+    ASSERT_EQ(IB_OK, ib_mpool_create(&mp, "rwlock", NULL));
+    ASSERT_EQ(IB_OK, ib_rwlock_create(&lock, ib_mm_mpool(mp)));
+    ASSERT_EQ(IB_OK, ib_rwlock_rdlock(lock));
+    ASSERT_EQ(IB_OK, ib_rwlock_rdlock(lock));
+    ASSERT_EQ(IB_OK, ib_rwlock_unlock(lock));
+    ASSERT_EQ(IB_OK, ib_rwlock_unlock(lock));
+    ASSERT_EQ(IB_OK, ib_rwlock_wrlock(lock));
+    ASSERT_EQ(IB_OK, ib_rwlock_unlock(lock));
+
+    ASSERT_EQ(IB_OK, ib_spinlock_create(&spinlock, ib_mm_mpool(mp)));
+    ASSERT_EQ(IB_OK, ib_spinlock_trylock(spinlock));
+    EXPECT_EQ(IB_EAGAIN, ib_spinlock_trylock(spinlock));
+    ASSERT_EQ(IB_OK, ib_spinlock_unlock(spinlock));
+
+    ib_mpool_destroy(mp);
+}
+
+TEST(test_util_spinlock, mutual_exclusion)
+{
+    static const int c_num_threads = 8;
+    shared_state_t state = {};
+    pthread_t threads[c_num_threads];
+    ib_lock_stats_t stats;
+
+    ASSERT_EQ(IB_OK, ib_spinlock_create_malloc(&state.spinlock));
+    state.loops = 100000;
+
+    g_contentions = 0;
+    ib_lock_contention_hook_set(count_contention, NULL);
+    for (int i = 0; i < c_num_threads; ++i) {
+        ASSERT_EQ(0, pthread_create(&threads[i], NULL, spinlock_incr, &state));
+    }
+    for (int i = 0; i < c_num_threads; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+    ib_lock_contention_hook_set(NULL, NULL);
+
+    EXPECT_EQ(c_num_threads * state.loops, state.counter);
+
+    ib_spinlock_stats_get(state.spinlock, &stats);
+    EXPECT_EQ(uint64_t(c_num_threads * state.loops), stats.acquired);
+    EXPECT_EQ(g_contentions, stats.contended);
+    EXPECT_GE(stats.acquired, stats.contended);
+
+    ib_spinlock_destroy_malloc(state.spinlock);
+}
@@ -848,3 +848,69 @@ TEST(TestMpool, ReleaseComplex)
     ASSERT_EQ(g_malloc_calls, g_free_calls);
     ASSERT_EQ(g_malloc_bytes, g_free_bytes);
 }
+
+namespace {
+
+//! Create and destroy a connection pool with a transaction pool.
+void page_cache_cycle()
+{
+    ib_mpool_t *conn;
+    ib_mpool_t *tx;
+
+    ASSERT_EQ(IB_OK, ib_mpool_create(&conn, "conn", NULL));
+    ASSERT_EQ(IB_OK, ib_mpool_create(&tx, "tx", conn));
+    for (size_t i = 0; i < 200; ++i) {
+        ASSERT_TRUE(ib_mpool_alloc(tx, 100));
+        ASSERT_TRUE(ib_mpool_alloc(conn, 10));
+    }
+    EXPECT_VALID(conn);
+    ib_mpool_destroy(conn);
+}
+
+}
+
+TEST(TestMpool, PageCache)
+{
+    ib_mpool_page_cache_stats_t before;
+    ib_mpool_page_cache_stats_t after;
+    ib_mpool_t                 *mp;
+
+    /* Once a cached pool exists, the cache can no longer be changed. */
+    ASSERT_EQ(IB_OK, ib_mpool_create(&mp, "used", NULL));
+    ib_mpool_destroy(mp);
+    EXPECT_EQ(IB_EINVAL, ib_mpool_page_cache_configure(true, 0, 0, false));
+
+    page_cache_cycle();
+    ib_mpool_page_cache_stats_get(&before);
+    EXPECT_LT(0UL, before.cached_pages);
+
+    for (size_t i = 0; i < 1000; ++i) {
+        page_cache_cycle();
+    }
+    ib_mpool_page_cache_stats_get(&after);
+
+    /* Steady state allocates no pages or pools. */
+    EXPECT_EQ(before.page_misses, after.page_misses);
+    EXPECT_EQ(before.pool_misses, after.pool_misses);
+    EXPECT_LT(before.page_hits, after.page_hits);
+    EXPECT_EQ(before.pool_hits + 2000, after.pool_hits);
+
+    ib_mpool_page_cache_flush();
+    ib_mpool_page_cache_stats_get(&after);
+    EXPECT_EQ(0UL, after.cached_pages);
+}
+
+TEST(TestMpool, PageCacheThreads)
+{
+    ib_mpool_page_cache_stats_t stats;
+    boost::thread_group threads;
+
+    for (size_t i = 0; i < 4; ++i) {
+        threads.create_thread(page_cache_cycle);
+    }
+    threads.join_all();
+
+    /* Pages of exited threads are kept in the depot. */
+    ib_mpool_page_cache_stats_get(&stats);
+    EXPECT_LT(0UL, stats.depot_pages);
+}
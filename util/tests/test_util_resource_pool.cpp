@@ -30,6 +30,11 @@
 
 #include "gtest/gtest.h"
 
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include <cstdlib>
+
 namespace {
 extern "C" {
     //! The resource we are going to build and test the resource pool with.
@@ -234,3 +239,279 @@ TEST_F(ResourcePoolTest, create_destroy) {
         }
     }
 }
+
+namespace {
+extern "C" {
+    //! Resource of concurrent pool tests.
+    struct concurrent_resource_t {
+        volatile int in_use; //!< Set while acquired.
+        int          uses;   //!< Number of releases.
+    };
+    typedef struct concurrent_resource_t concurrent_resource_t;
+
+    //! Callback data for concurrent resource tests.
+    struct concurrent_cbdata_t {
+        size_t created;   //!< Resources created.
+        size_t destroyed; //!< Resources destroyed.
+        size_t overlaps;  //!< Resources acquired while in use.
+        int    max_uses;  //!< Invalidate resources after this many uses.
+    };
+    typedef struct concurrent_cbdata_t concurrent_cbdata_t;
+
+    ib_status_t concurrent_create_fn(void *resource, void *data) {
+        concurrent_cbdata_t *cbdata =
+            reinterpret_cast<concurrent_cbdata_t *>(data);
+        concurrent_resource_t *r = reinterpret_cast<concurrent_resource_t *>(
+            calloc(1, sizeof(*r)));
+        if (r == NULL) {
+            return IB_EALLOC;
+        }
+        __sync_add_and_fetch(&(cbdata->created), 1);
+        *(concurrent_resource_t **)resource = r;
+        return IB_OK;
+    }
+
+    void concurrent_destroy_fn(void *resource, void *data) {
+        concurrent_cbdata_t *cbdata =
+            reinterpret_cast<concurrent_cbdata_t *>(data);
+        __sync_add_and_fetch(&(cbdata->destroyed), 1);
+        free(resource);
+    }
+
+    void concurrent_preuse_fn(void *resource, void *data) {
+        concurrent_cbdata_t *cbdata =
+            reinterpret_cast<concurrent_cbdata_t *>(data);
+        concurrent_resource_t *r =
+            reinterpret_cast<concurrent_resource_t *>(resource);
+        if (__sync_lock_test_and_set(&(r->in_use), 1) != 0) {
+            __sync_add_and_fetch(&(cbdata->overlaps), 1);
+        }
+    }
+
+    ib_status_t concurrent_postuse_fn(void *resource, void *data) {
+        concurrent_cbdata_t *cbdata =
+            reinterpret_cast<concurrent_cbdata_t *>(data);
+        concurrent_resource_t *r =
+            reinterpret_cast<concurrent_resource_t *>(resource);
+        __sync_lock_release(&(r->in_use));
+        ++(r->uses);
+        return (cbdata->max_uses > 0 && r->uses >= cbdata->max_uses) ?
+            IB_EINVAL : IB_OK;
+    }
+} /* Close extern "C" */
+
+//! Acquire and release resources of @a rp @a n times.
+void acquire_release_loop(ib_resource_pool_t *rp, int n)
+{
+    for (int i = 0; i < n; ++i) {
+        ib_resource_t *resource;
+
+        if (ib_resource_acquire(rp, &resource) == IB_OK) {
+            ib_resource_release(resource);
+        }
+    }
+}
+
+//! Acquire and release resources of @a rp @a n times, counting declines.
+void acquire_release_count(ib_resource_pool_t *rp, int n, size_t *declined)
+{
+    for (int i = 0; i < n; ++i) {
+        ib_resource_t *resource;
+
+        if (ib_resource_acquire(rp, &resource) == IB_OK) {
+            ib_resource_release(resource);
+        }
+        else {
+            __sync_add_and_fetch(declined, 1);
+        }
+    }
+}
+
+//! Release @a n resources in @a resources, then wait twice on @a barrier.
+void release_and_wait(
+    ib_resource_t  **resources,
+    int              n,
+    boost::barrier  *barrier
+)
+{
+    for (int i = 0; i < n; ++i) {
+        ib_resource_release(resources[i]);
+    }
+    barrier->wait();
+    barrier->wait();
+}
+
+} /* Close anonymous namespace. */
+
+class ConcurrentResourcePoolTest : public ::testing::Test {
+public:
+    virtual void SetUp()
+    {
+        ASSERT_EQ(
+            IB_OK,
+            ib_mpool_create(&m_mp, "ConcurrentResourcePoolTest", NULL));
+        m_cbdata.created = 0;
+        m_cbdata.destroyed = 0;
+        m_cbdata.overlaps = 0;
+        m_cbdata.max_uses = 0;
+    }
+
+    virtual void TearDown()
+    {
+        if (m_mp != NULL) {
+            ib_mpool_release(m_mp);
+        }
+    }
+
+    void create(size_t min_count, size_t max_count)
+    {
+        void *cbdata = reinterpret_cast<void *>(&m_cbdata);
+        ASSERT_EQ(IB_OK, ib_resource_pool_create_concurrent(
+            &m_rp,
+            ib_mm_mpool(m_mp),
+            min_count,
+            max_count,
+            &concurrent_create_fn,
+            cbdata,
+            &concurrent_destroy_fn,
+            cbdata,
+            &concurrent_preuse_fn,
+            cbdata,
+            &concurrent_postuse_fn,
+            cbdata
+        ));
+    }
+
+protected:
+    concurrent_cbdata_t m_cbdata;
+    ib_mpool_t *m_mp;
+    ib_resource_pool_t *m_rp;
+};
+
+TEST_F(ConcurrentResourcePoolTest, get_release) {
+    ib_resource_t *ib_r;
+    ib_resource_t *ib_r2;
+
+    create(1, 0);
+    ASSERT_EQ(1U, m_cbdata.created);
+
+    ASSERT_EQ(IB_OK, ib_resource_acquire(m_rp, &ib_r));
+    ASSERT_EQ(1U, ib_resource_use_get(ib_r));
+    ASSERT_EQ(IB_OK, ib_resource_release(ib_r));
+
+    /* The released resource is reused by the same thread. */
+    ASSERT_EQ(IB_OK, ib_resource_acquire(m_rp, &ib_r2));
+    ASSERT_EQ(ib_r, ib_r2);
+    ASSERT_EQ(2U, ib_resource_use_get(ib_r2));
+    ASSERT_EQ(IB_OK, ib_resource_release(ib_r2));
+    ASSERT_EQ(1U, m_cbdata.created);
+
+    ib_mpool_release(m_mp);
+    m_mp = NULL;
+    ASSERT_EQ(1U, m_cbdata.destroyed);
+}
+
+TEST_F(ConcurrentResourcePoolTest, limit_reached) {
+    ib_resource_t *ib_r[21];
+
+    create(0, 20);
+
+    for (int i = 0; i < 20; ++i) {
+        ASSERT_EQ(IB_OK, ib_resource_acquire(m_rp, &ib_r[i]));
+    }
+    ASSERT_EQ(IB_DECLINED, ib_resource_acquire(m_rp, &ib_r[20]));
+
+    /* Release them all, overflowing the thread magazines. */
+    for (int i = 0; i < 20; ++i) {
+        ASSERT_EQ(IB_OK, ib_resource_release(ib_r[i]));
+    }
+    for (int i = 0; i < 20; ++i) {
+        ASSERT_EQ(IB_OK, ib_resource_acquire(m_rp, &ib_r[i]));
+    }
+    ASSERT_EQ(20U, m_cbdata.created);
+    for (int i = 0; i < 20; ++i) {
+        ASSERT_EQ(IB_OK, ib_resource_release(ib_r[i]));
+    }
+
+    ASSERT_EQ(IB_OK, ib_resource_pool_flush(m_rp));
+    ASSERT_EQ(20U, m_cbdata.destroyed);
+}
+
+TEST_F(ConcurrentResourcePoolTest, replace_invalid) {
+    create(2, 0);
+    m_cbdata.max_uses = 3;
+
+    acquire_release_loop(m_rp, 30);
+
+    /* Invalid resources are destroyed and replaced up to the minimum. */
+    ASSERT_EQ(m_cbdata.created - 2, m_cbdata.destroyed);
+    ASSERT_LT(2U, m_cbdata.created);
+}
+
+TEST_F(ConcurrentResourcePoolTest, threads) {
+    static const int c_num_threads = 8;
+    static const int c_num_loops = 100000;
+    boost::thread_group threads;
+
+    create(4, 0);
+    m_cbdata.max_uses = 1000;
+
+    for (int i = 0; i < c_num_threads; ++i) {
+        threads.create_thread(
+            boost::bind(acquire_release_loop, m_rp, c_num_loops));
+    }
+    threads.join_all();
+
+    ASSERT_EQ(0U, m_cbdata.overlaps);
+
+    /* Exited threads returned their magazines to the depot. */
+    ib_mpool_release(m_mp);
+    m_mp = NULL;
+    ASSERT_EQ(m_cbdata.created, m_cbdata.destroyed);
+}
+
+TEST_F(ConcurrentResourcePoolTest, reclaim_from_other_thread) {
+    ib_resource_t *ib_r[3];
+    boost::barrier barrier(2);
+
+    create(0, 2);
+
+    ASSERT_EQ(IB_OK, ib_resource_acquire(m_rp, &ib_r[0]));
+    ASSERT_EQ(IB_OK, ib_resource_acquire(m_rp, &ib_r[1]));
+
+    /* Another thread releases both and keeps them in its magazine. */
+    boost::thread releaser(
+        boost::bind(release_and_wait, ib_r, 2, &barrier));
+    barrier.wait();
+
+    EXPECT_EQ(IB_OK, ib_resource_acquire(m_rp, &ib_r[0]));
+    EXPECT_EQ(IB_OK, ib_resource_acquire(m_rp, &ib_r[1]));
+    EXPECT_EQ(IB_DECLINED, ib_resource_acquire(m_rp, &ib_r[2]));
+    EXPECT_EQ(2U, m_cbdata.created);
+
+    barrier.wait();
+    releaser.join();
+
+    ASSERT_EQ(IB_OK, ib_resource_release(ib_r[0]));
+    ASSERT_EQ(IB_OK, ib_resource_release(ib_r[1]));
+}
+
+TEST_F(ConcurrentResourcePoolTest, threads_at_limit) {
+    static const int c_num_threads = 8;
+    static const int c_num_loops = 20000;
+    boost::thread_group threads;
+    size_t declined = 0;
+
+    /* Each thread holds at most one resource, so none is declined. */
+    create(0, c_num_threads);
+
+    for (int i = 0; i < c_num_threads; ++i) {
+        threads.create_thread(
+            boost::bind(acquire_release_count, m_rp, c_num_loops, &declined));
+    }
+    threads.join_all();
+
+    ASSERT_EQ(0U, declined);
+    ASSERT_EQ(0U, m_cbdata.overlaps);
+    ASSERT_GE(size_t(c_num_threads), m_cbdata.created);
+}
@@ -24,10 +24,17 @@
 
 #include "ironbee_config_auto.h"
 
+#include <ironbee/clock.h>
 #include <ironbee/uuid.h>
 
 #include "gtest/gtest.h"
 
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <pthread.h>
 #include <string.h>
 
 TEST(TestIBUtilUUID, random)
@@ -49,3 +56,145 @@ TEST(TestIBUtilUUID, random)
 
     ib_uuid_shutdown();
 }
+
+namespace {
+
+//! Check that @a uuid is a well formed, lower case UUID of @a version.
+void expect_format(const char *uuid, char version)
+{
+    ASSERT_EQ(IB_UUID_LENGTH - 1, strlen(uuid));
+    for (size_t i = 0; i < IB_UUID_LENGTH - 1; ++i) {
+        if (i == 8 || i == 13 || i == 18 || i == 23) {
+            EXPECT_EQ('-', uuid[i]);
+        }
+        else {
+            EXPECT_TRUE(strchr("0123456789abcdef", uuid[i]) != NULL) << uuid;
+        }
+    }
+    EXPECT_EQ(version, uuid[14]) << uuid;
+    EXPECT_TRUE(strchr("89ab", uuid[19]) != NULL) << uuid;
+}
+
+typedef ib_status_t (*create_fn_t)(char *);
+
+//! Thread arguments and results.
+struct uuid_thread_t
+{
+    create_fn_t              create;
+    size_t                   count;
+    std::vector<std::string> uuids;
+    bool                     failed;
+    bool                     keep;
+};
+
+void *uuid_thread(void *data)
+{
+    uuid_thread_t *t = static_cast<uuid_thread_t *>(data);
+    char uuid[IB_UUID_LENGTH];
+
+    for (size_t i = 0; i < t->count; ++i) {
+        if (t->create(uuid) != IB_OK) {
+            t->failed = true;
+            break;
+        }
+        if (t->keep) {
+            t->uuids.push_back(uuid);
+        }
+    }
+    return NULL;
+}
+
+//! Create @a count UUIDs in each of @a num_threads threads.
+ib_time_t run_threads(
+    create_fn_t                  create,
+    size_t                       num_threads,
+    size_t                       count,
+    bool                         keep,
+    std::vector<uuid_thread_t>  &threads
+)
+{
+    std::vector<pthread_t> ids(num_threads);
+
+    threads.resize(num_threads);
+    ib_time_t start = ib_clock_get_time();
+    for (size_t i = 0; i < num_threads; ++i) {
+        threads[i].create = create;
+        threads[i].count = count;
+        threads[i].failed = false;
+        threads[i].keep = keep;
+        pthread_create(&ids[i], NULL, uuid_thread, &threads[i]);
+    }
+    for (size_t i = 0; i < num_threads; ++i) {
+        pthread_join(ids[i], NULL);
+    }
+    return ib_clock_get_time() - start;
+}
+
+}
+
+TEST(TestIBUtilUUID, v4)
+{
+    char uuid[IB_UUID_LENGTH];
+
+    ib_uuid_initialize();
+    for (size_t i = 0; i < 100; ++i) {
+        ASSERT_EQ(IB_OK, ib_uuid_create_v4(uuid));
+        expect_format(uuid, '4');
+    }
+    ib_uuid_shutdown();
+}
+
+TEST(TestIBUtilUUID, v7)
+{
+    char uuid[IB_UUID_LENGTH];
+    std::string last;
+
+    ib_uuid_initialize();
+    for (size_t i = 0; i < 10000; ++i) {
+        ASSERT_EQ(IB_OK, ib_uuid_create_v7(uuid));
+        expect_format(uuid, '7');
+        EXPECT_LT(last, std::string(uuid));
+        last = uuid;
+    }
+    ib_uuid_shutdown();
+}
+
+TEST(TestIBUtilUUID, UniqueAcrossThreads)
+{
+    static const size_t c_num_threads = 4;
+    static const size_t c_count = 10000;
+    std::vector<uuid_thread_t> threads;
+    std::set<std::string> all;
+
+    ib_uuid_initialize();
+    run_threads(ib_uuid_create_v4, c_num_threads, c_count, true, threads);
+    run_threads(ib_uuid_create_v7, c_num_threads, c_count, true, threads);
+    for (size_t i = 0; i < threads.size(); ++i) {
+        EXPECT_FALSE(threads[i].failed);
+        all.insert(threads[i].uuids.begin(), threads[i].uuids.end());
+    }
+    EXPECT_EQ(2 * c_num_threads * c_count, all.size());
+    ib_uuid_shutdown();
+}
+
+TEST(TestIBUtilUUID, Benchmark)
+{
+    static const size_t c_count = 200000;
+    std::vector<uuid_thread_t> threads;
+
+    ib_uuid_initialize();
+    for (size_t num_threads = 1; num_threads <= 8; num_threads *= 2) {
+        ib_time_t v4 = run_threads(
+            ib_uuid_create_v4, num_threads, c_count, false, threads);
+        ib_time_t v7 = run_threads(
+            ib_uuid_create_v7, num_threads, c_count, false, threads);
+
+        std::cout << num_threads << " threads x " << c_count << " UUIDs: "
+                  << "v4 " << v4 << "us ("
+                  << (v4 * 1000.0 / (num_threads * c_count)) << "ns/uuid) "
+                  << "v7 " << v7 << "us ("
+                  << (v7 * 1000.0 / (num_threads * c_count)) << "ns/uuid)"
+                  << std::endl;
+    }
+    ib_uuid_shutdown();
+}
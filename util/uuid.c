@@ -31,42 +31,319 @@
 #include <ironbee/lock.h>
 
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 /*
  * These are initialized by ib_uuid_init();
  * OSSP UUID is ... generous .. in what it creates for a UUID.  E.g., it will
  * do multiple allocations, check its MAC (it may have changed?), etc. for
  * every creation.  So we only keep one at reuse it.
+ *
+ * It is only used if a thread generator cannot be seeded.
  */
 static ib_lock_t *g_uuid_lock;
 static uuid_t    *g_ossp_uuid;
 
-ib_status_t ib_uuid_initialize(void)
+/**
+ * @name Thread generators.
+ *
+ * Each thread owns a ChaCha20 generator keyed from /dev/urandom.  Every
+ * refill produces IB_UUID_RNG_BLOCKS blocks, the first 32 bytes of which
+ * replace the key so that earlier output cannot be recovered from the
+ * state ("fast key erasure").  A fork bumps g_uuid_generation, causing the
+ * threads of the child to reseed rather than repeat the parent's output.
+ */
+/**@{*/
+
+/** Blocks generated per refill. */
+#define IB_UUID_RNG_BLOCKS 8
+/** Bytes generated per refill. */
+#define IB_UUID_RNG_BUFFER (IB_UUID_RNG_BLOCKS * 64)
+/** Bytes of key. */
+#define IB_UUID_RNG_KEY 32
+
+/** Per-thread generator state. */
+typedef struct ib_uuid_rng_t ib_uuid_rng_t;
+
+/** See ib_uuid_rng_t */
+struct ib_uuid_rng_t
 {
-    ib_status_t rc;
+    /** Output buffer; the first IB_UUID_RNG_KEY bytes are the next key. */
+    uint8_t  buffer[IB_UUID_RNG_BUFFER];
+    /** Bytes of buffer already consumed. */
+    size_t   used;
+    /** Value of g_uuid_generation when seeded. */
+    unsigned generation;
+    /** Timestamp of the last v7 UUID in milliseconds. */
+    uint64_t last_ms;
+    /** Sequence within @c last_ms of the last v7 UUID. */
+    uint16_t sequence;
+};
 
-    if (uuid_create(&g_ossp_uuid) != UUID_RC_OK) {
-        return IB_EOTHER;
+/** Initializes g_uuid_key. */
+static pthread_once_t g_uuid_once = PTHREAD_ONCE_INIT;
+/** Thread specific ib_uuid_rng_t. */
+static pthread_key_t  g_uuid_key;
+/** Is g_uuid_key usable? */
+static bool           g_uuid_key_valid = false;
+/** Incremented in the child of every fork. */
+static volatile unsigned g_uuid_generation = 0;
+
+/** Child fork handler. */
+static
+void uuid_atfork_child(void)
+{
+    __sync_add_and_fetch(&g_uuid_generation, 1);
+}
+
+/** Erase and free a thread generator. */
+static
+void uuid_rng_destroy(void *data)
+{
+    memset(data, 0, sizeof(ib_uuid_rng_t));
+    free(data);
+}
+
+/** Create g_uuid_key.  Called via pthread_once(). */
+static
+void uuid_key_create(void)
+{
+    if (pthread_key_create(&g_uuid_key, uuid_rng_destroy) != 0) {
+        return;
+    }
+    if (pthread_atfork(NULL, NULL, uuid_atfork_child) != 0) {
+        return;
     }
+    g_uuid_key_valid = true;
+}
 
-    rc = ib_lock_create_malloc(&g_uuid_lock);
-    if ( rc != IB_OK ) {
-        return rc;
+/** Rotate a 32 bit word left. */
+#define IB_UUID_ROTL(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+
+/** ChaCha quarter round. */
+#define IB_UUID_QR(a, b, c, d) \
+    do { \
+        a += b; d ^= a; d = IB_UUID_ROTL(d, 16); \
+        c += d; b ^= c; b = IB_UUID_ROTL(b, 12); \
+        a += b; d ^= a; d = IB_UUID_ROTL(d,  8); \
+        c += d; b ^= c; b = IB_UUID_ROTL(b,  7); \
+    } while (0)
+
+/**
+ * Read a little endian 32 bit word.
+ *
+ * @param[in] p Bytes.
+ * @return Word.
+ */
+static
+uint32_t uuid_load32(const uint8_t *p)
+{
+    return (uint32_t)p[0]         | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * Write a little endian 32 bit word.
+ *
+ * @param[in] p Bytes.
+ * @param[in] v Word.
+ */
+static
+void uuid_store32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+/**
+ * Refill @a rng from the key in the first IB_UUID_RNG_KEY bytes of its
+ * buffer.
+ *
+ * @param[in] rng Generator.
+ */
+static
+void uuid_rng_refill(ib_uuid_rng_t *rng)
+{
+    static const uint32_t c_sigma[4] = {
+        0x61707865, 0x3320646e, 0x79622d32, 0x6b206574
+    };
+    uint32_t input[16];
+
+    input[0] = c_sigma[0];
+    input[1] = c_sigma[1];
+    input[2] = c_sigma[2];
+    input[3] = c_sigma[3];
+    for (size_t i = 0; i < 8; ++i) {
+        input[4 + i] = uuid_load32(rng->buffer + 4 * i);
     }
+    /* Key changes every refill, so counter and nonce can start at zero. */
+    input[12] = input[13] = input[14] = input[15] = 0;
 
-    return rc;
+    for (size_t block = 0; block < IB_UUID_RNG_BLOCKS; ++block) {
+        uint32_t x[16];
+
+        input[12] = (uint32_t)block;
+        memcpy(x, input, sizeof(x));
+        for (size_t round = 0; round < 10; ++round) {
+            IB_UUID_QR(x[0], x[4], x[ 8], x[12]);
+            IB_UUID_QR(x[1], x[5], x[ 9], x[13]);
+            IB_UUID_QR(x[2], x[6], x[10], x[14]);
+            IB_UUID_QR(x[3], x[7], x[11], x[15]);
+            IB_UUID_QR(x[0], x[5], x[10], x[15]);
+            IB_UUID_QR(x[1], x[6], x[11], x[12]);
+            IB_UUID_QR(x[2], x[7], x[ 8], x[13]);
+            IB_UUID_QR(x[3], x[4], x[ 9], x[14]);
+        }
+        for (size_t i = 0; i < 16; ++i) {
+            uuid_store32(rng->buffer + 64 * block + 4 * i, x[i] + input[i]);
+        }
+    }
+
+    memset(input, 0, sizeof(input));
+    rng->used = IB_UUID_RNG_KEY;
 }
 
-ib_status_t ib_uuid_shutdown(void)
+/**
+ * Key @a rng from /dev/urandom.
+ *
+ * @param[in] rng Generator.
+ * @returns
+ * - IB_OK on success.
+ * - IB_EOTHER if /dev/urandom could not be read.
+ */
+static
+ib_status_t uuid_rng_seed(ib_uuid_rng_t *rng)
 {
-    ib_lock_destroy_malloc(g_uuid_lock);
-    uuid_destroy(g_ossp_uuid);
+    size_t have = 0;
+    int fd;
+
+    fd = open("/dev/urandom", O_RDONLY);
+    if (fd < 0) {
+        return IB_EOTHER;
+    }
+    while (have < IB_UUID_RNG_KEY) {
+        ssize_t n = read(fd, rng->buffer + have, IB_UUID_RNG_KEY - have);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            close(fd);
+            return IB_EOTHER;
+        }
+        have += n;
+    }
+    close(fd);
+
+    rng->generation = g_uuid_generation;
+    uuid_rng_refill(rng);
 
     return IB_OK;
 }
 
-ib_status_t ib_uuid_create_v4(char *uuid)
+/**
+ * Fetch the generator of the calling thread, seeding it if needed.
+ *
+ * @return Generator or NULL if one could not be created or seeded.
+ */
+static
+ib_uuid_rng_t *uuid_rng(void)
+{
+    ib_uuid_rng_t *rng;
+
+    pthread_once(&g_uuid_once, uuid_key_create);
+    if (! g_uuid_key_valid) {
+        return NULL;
+    }
+
+    rng = pthread_getspecific(g_uuid_key);
+    if (rng == NULL) {
+        rng = calloc(1, sizeof(*rng));
+        if (rng == NULL) {
+            return NULL;
+        }
+        if (uuid_rng_seed(rng) != IB_OK) {
+            free(rng);
+            return NULL;
+        }
+        if (pthread_setspecific(g_uuid_key, rng) != 0) {
+            uuid_rng_destroy(rng);
+            return NULL;
+        }
+    }
+    else if (rng->generation != g_uuid_generation) {
+        if (uuid_rng_seed(rng) != IB_OK) {
+            return NULL;
+        }
+    }
+
+    return rng;
+}
+
+/**
+ * Fill @a out with @a n random bytes from @a rng.
+ *
+ * @param[in]  rng Generator.
+ * @param[out] out Where to write.
+ * @param[in]  n   Number of bytes; at most IB_UUID_RNG_BUFFER - IB_UUID_RNG_KEY.
+ */
+static
+void uuid_rng_bytes(ib_uuid_rng_t *rng, uint8_t *out, size_t n)
+{
+    assert(n <= IB_UUID_RNG_BUFFER - IB_UUID_RNG_KEY);
+
+    if (rng->used + n > IB_UUID_RNG_BUFFER) {
+        uuid_rng_refill(rng);
+    }
+    memcpy(out, rng->buffer + rng->used, n);
+    /* Do not keep output around. */
+    memset(rng->buffer + rng->used, 0, n);
+    rng->used += n;
+}
+
+/**
+ * Format the 16 bytes at @a bytes as a UUID string.
+ *
+ * @param[in]  bytes UUID.
+ * @param[out] uuid  Where to write; must be IB_UUID_LENGTH long.
+ */
+static
+void uuid_format(const uint8_t *bytes, char *uuid)
+{
+    static const char c_hex[] = "0123456789abcdef";
+
+    for (size_t i = 0; i < 16; ++i) {
+        if (i == 4 || i == 6 || i == 8 || i == 10) {
+            *uuid++ = '-';
+        }
+        *uuid++ = c_hex[bytes[i] >> 4];
+        *uuid++ = c_hex[bytes[i] & 0x0f];
+    }
+    *uuid = '\0';
+}
+
+/**@}*/
+
+/**
+ * Create a v4 UUID with OSSP UUID under the global lock.
+ *
+ * @param[in] uuid Where to write UUID.  Must be IB_UUID_LENGTH long.
+ *
+ * @returns
+ * - IB_EALLOC on allocation failure.
+ * - IB_EOTHER on other failure.
+ */
+static
+ib_status_t uuid_create_v4_ossp(char *uuid)
 {
     assert(uuid != NULL);
 
@@ -109,3 +386,93 @@ finish:
 
     return rc;
 }
+
+ib_status_t ib_uuid_initialize(void)
+{
+    ib_status_t rc;
+
+    if (uuid_create(&g_ossp_uuid) != UUID_RC_OK) {
+        return IB_EOTHER;
+    }
+
+    rc = ib_lock_create_malloc(&g_uuid_lock);
+    if ( rc != IB_OK ) {
+        return rc;
+    }
+
+    pthread_once(&g_uuid_once, uuid_key_create);
+
+    return rc;
+}
+
+ib_status_t ib_uuid_shutdown(void)
+{
+    ib_lock_destroy_malloc(g_uuid_lock);
+    uuid_destroy(g_ossp_uuid);
+
+    return IB_OK;
+}
+
+ib_status_t ib_uuid_create_v4(char *uuid)
+{
+    assert(uuid != NULL);
+
+    ib_uuid_rng_t *rng = uuid_rng();
+    uint8_t bytes[16];
+
+    if (rng == NULL) {
+        return uuid_create_v4_ossp(uuid);
+    }
+
+    uuid_rng_bytes(rng, bytes, sizeof(bytes));
+    bytes[6] = (bytes[6] & 0x0f) | 0x40;
+    bytes[8] = (bytes[8] & 0x3f) | 0x80;
+    uuid_format(bytes, uuid);
+
+    return IB_OK;
+}
+
+ib_status_t ib_uuid_create_v7(char *uuid)
+{
+    assert(uuid != NULL);
+
+    ib_uuid_rng_t *rng = uuid_rng();
+    uint8_t bytes[16];
+    struct timespec ts;
+    uint64_t ms;
+
+    if (rng == NULL) {
+        return uuid_create_v4_ossp(uuid);
+    }
+    if (clock_gettime(CLOCK_REALTIME, &ts) != 0) {
+        return IB_EOTHER;
+    }
+    ms = (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+
+    uuid_rng_bytes(rng, bytes + 6, sizeof(bytes) - 6);
+    if (ms > rng->last_ms) {
+        /* Start the sequence low to leave room for increments. */
+        rng->last_ms  = ms;
+        rng->sequence = ((bytes[6] << 8) | bytes[7]) & 0x07ff;
+    }
+    else if (++rng->sequence > 0x0fff) {
+        /* Sequence exhausted (or clock stepped back): borrow from the
+         * next millisecond to stay monotonic. */
+        ++rng->last_ms;
+        rng->sequence = 0;
+    }
+    ms = rng->last_ms;
+
+    bytes[0] = (uint8_t)(ms >> 40);
+    bytes[1] = (uint8_t)(ms >> 32);
+    bytes[2] = (uint8_t)(ms >> 24);
+    bytes[3] = (uint8_t)(ms >> 16);
+    bytes[4] = (uint8_t)(ms >> 8);
+    bytes[5] = (uint8_t)ms;
+    bytes[6] = 0x70 | (uint8_t)(rng->sequence >> 8);
+    bytes[7] = (uint8_t)rng->sequence;
+    bytes[8] = (bytes[8] & 0x3f) | 0x80;
+    uuid_format(bytes, uuid);
+
+    return IB_OK;
+}